@@ -10,22 +10,93 @@ CONFIG += c++11
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    assetloader.cpp \
+    assetpack.cpp \
+    atlasspriteitem.cpp \
+    audiomanager.cpp \
     audiosystem.cpp \
+    challengescheduler.cpp \
+    collisionworld.cpp \
+    dspbenchmark.cpp \
+    dspkernels.cpp \
+    entitysystems.cpp \
+    entityworld.cpp \
+    flowfield.cpp \
+    gameloop.cpp \
+    gameview.cpp \
     gamewindow.cpp \
+    headlesssimulation.cpp \
+    health.cpp \
     inputhandler.cpp \
+    inputlog.cpp \
+    keywordspotter.cpp \
+    level.cpp \
+    levelcompiler.cpp \
+    logger.cpp \
     main.cpp \
     mainwindow.cpp \
+    mfcc.cpp \
+    monsterai.cpp \
     movement.cpp \
+    musicstream.cpp \
+    navgrid.cpp \
     player.cpp \
+    profiler.cpp \
+    roommanager.cpp \
+    soundbank.cpp \
+    soundmixer.cpp \
+    spriteanimation.cpp \
+    spritecache.cpp \
+    startupbenchmark.cpp \
+    textureatlas.cpp \
+    triggertracker.cpp \
+    voiceactivitydetector.cpp \
     voicechallenge.cpp
 
 HEADERS += \
+    assetloader.h \
+    assetpack.h \
+    atlasspriteitem.h \
+    audiomanager.h \
     audiosystem.h \
+    challengescheduler.h \
+    collisionworld.h \
+    dspbenchmark.h \
+    dspkernels.h \
+    entitysystems.h \
+    entityworld.h \
+    flowfield.h \
+    gameloop.h \
+    gameview.h \
     gamewindow.h \
+    headlesssimulation.h \
+    health.h \
     inputhandler.h \
+    inputlog.h \
+    keywordspotter.h \
+    level.h \
+    levelcompiler.h \
+    levelformat.h \
+    logger.h \
     mainwindow.h \
+    mfcc.h \
+    monsterai.h \
     movement.h \
+    mpscringbuffer.h \
+    musicstream.h \
+    navgrid.h \
     player.h \
+    profiler.h \
+    roommanager.h \
+    soundbank.h \
+    soundmixer.h \
+    spriteanimation.h \
+    spritecache.h \
+    spscringbuffer.h \
+    startupbenchmark.h \
+    textureatlas.h \
+    triggertracker.h \
+    voiceactivitydetector.h \
     voicechallenge.h
 
 FORMS += \
@@ -36,8 +107,48 @@ qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
-RESOURCES += \
-    resources.qrc
+# Asset pipeline: "make assets" downscales the sprites to their render size and transcodes the
+# audio into $$OUT_PWD/assets (see tools/build_assets.py and its manifest.json). Building with
+# CONFIG+=built_assets then embeds that pack instead of the source assets
+assets.commands = python3 $$PWD/tools/build_assets.py $$PWD/resources.qrc $$OUT_PWD/assets
+QMAKE_EXTRA_TARGETS += assets
+
+built_assets {
+    !exists($$OUT_PWD/assets/assets.qrc): error("Run make assets before building with CONFIG+=built_assets")
+    ASSET_QRC = $$OUT_PWD/assets/assets.qrc
+} else {
+    ASSET_QRC = $$PWD/resources.qrc
+}
+
+# External asset pack: CONFIG+=external_assets links no resources and compiles them with rcc into
+# assets.rcc next to the executable instead, which AssetPack mounts at startup. Stored
+# uncompressed so it is read straight from the mapping
+external_assets {
+    DEFINES += EXTERNAL_ASSETS
+
+    ASSET_RCC = $$[QT_HOST_LIBEXECS]/rcc
+    assetpack.target = $$OUT_PWD/assets.rcc
+    assetpack.depends = $$ASSET_QRC $$system($$ASSET_RCC --list $$ASSET_QRC)
+    assetpack.commands = $$ASSET_RCC --binary --no-compress $$ASSET_QRC -o $$OUT_PWD/assets.rcc
+    QMAKE_EXTRA_TARGETS += assetpack
+    PRE_TARGETDEPS += $$OUT_PWD/assets.rcc
+
+    macx {
+        assetbundle.files = $$OUT_PWD/assets.rcc
+        assetbundle.path = Contents/Resources
+        QMAKE_BUNDLE_DATA += assetbundle
+    }
+
+    assetinstall.files = $$OUT_PWD/assets.rcc
+    assetinstall.path = $$target.path
+    assetinstall.CONFIG += no_check_exist
+    !isEmpty(target.path): INSTALLS += assetinstall
+} else {
+    RESOURCES += $$ASSET_QRC
+}
+
+# Resident memory for --bench-startup
+win32: LIBS += -lpsapi
 
 # Suppress SDK version warning
 CONFIG += sdk_no_version_check
@@ -0,0 +1,183 @@
+/**
+ * @file assetloader.cpp
+ * @brief Implementation of the AssetLoader class
+ * @author Cherie Duong, Kiet Tran
+ */
+
+#include "assetloader.h"
+#include "assetpack.h"
+#include "logger.h"
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMetaObject>
+#include <QPixmapCache>
+#include <QPointer>
+#include <QPromise>
+#include <QThread>
+#include <memory>
+
+/**
+ * @brief Returns the application wide loader
+ */
+
+AssetLoader &AssetLoader::instance()
+{
+
+    static AssetLoader loader;
+    return loader;
+
+}
+
+/**
+ * @brief Constructs the loader with one decoding thread per core, leaving one for the GUI
+ */
+
+AssetLoader::AssetLoader(QObject *parent) : QObject(parent)
+{
+
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+
+}
+
+/**
+ * @brief Decodes an image off the GUI thread
+ * @param path represents the image path, resource paths are supported
+ * @param priority represents how urgently the image is needed
+ * @param scaleTo represents the target size, an invalid size keeps the original size
+ * @param aspectMode represents how the aspect ratio is handled when scaling
+ * @param shrinkOnly represents whether images smaller than scaleTo keep their size
+ * @return Returns a future that finishes with the decoded image (null on failure)
+ */
+
+QFuture<QImage> AssetLoader::loadImage(const QString &path, Priority priority,
+                                       const QSize &scaleTo, Qt::AspectRatioMode aspectMode, bool shrinkOnly)
+{
+
+    std::shared_ptr<QPromise<QImage>> promise = std::make_shared<QPromise<QImage>>();
+    QFuture<QImage> future = promise->future();
+
+    promise->start();
+    m_pool.start([promise, path, scaleTo, aspectMode, shrinkOnly]() {
+        promise->addResult(decode(path, scaleTo, aspectMode, shrinkOnly));
+        promise->finish();
+    }, priority);
+
+    return future;
+
+}
+
+/**
+ * @brief Decodes an image off the GUI thread and delivers it as a pixmap
+ * @param path represents the image path, resource paths are supported
+ * @param context represents the object whose lifetime guards the callback
+ * @param callback represents the function called on the GUI thread with the pixmap
+ * @param priority represents how urgently the image is needed
+ * @param scaleTo represents the target size, an invalid size keeps the original size
+ * @param aspectMode represents how the aspect ratio is handled when scaling
+ * @param shrinkOnly represents whether images smaller than scaleTo keep their size
+ * @param cache represents whether the converted pixmap is kept in QPixmapCache
+ *
+ * Pixmaps already converted once are served from QPixmapCache without decoding again. The
+ * loader must be first used on the GUI thread, which its deliveries are queued to
+ */
+
+void AssetLoader::loadPixmap(const QString &path, QObject *context, PixmapCallback callback,
+                             Priority priority, const QSize &scaleTo, Qt::AspectRatioMode aspectMode,
+                             bool shrinkOnly, bool cache)
+{
+
+    const QString key = cacheKey(path, scaleTo, aspectMode, shrinkOnly);
+
+    QPixmap cached;
+    if (QPixmapCache::find(key, &cached)) {
+        callback(cached);
+        return;
+    }
+
+    // The guard is only read on the GUI thread, where context is destroyed. The worker posts to
+    // the loader, which outlives its pool, since context may be gone by the time decoding ends
+    QPointer<QObject> guard(context);
+    m_pool.start([this, guard, callback, key, path, scaleTo, aspectMode, shrinkOnly, cache]() {
+        const QImage image = decode(path, scaleTo, aspectMode, shrinkOnly);
+
+        // QPixmap may only be created on the GUI thread
+        QMetaObject::invokeMethod(this, [guard, callback, key, image, cache]() {
+            const QPixmap pixmap = QPixmap::fromImage(image);
+            if (cache && !pixmap.isNull()) {
+                QPixmapCache::insert(key, pixmap);
+            }
+            if (guard) {
+                callback(pixmap);
+            }
+        }, Qt::QueuedConnection);
+    }, priority);
+
+}
+
+/**
+ * @brief Blocks until every queued request has been decoded
+ */
+
+void AssetLoader::waitForDone()
+{
+
+    m_pool.waitForDone();
+
+}
+
+/**
+ * @brief Decodes and scales an image
+ * @param path represents the image path
+ * @param scaleTo represents the target size, an invalid size keeps the original size
+ * @param aspectMode represents how the aspect ratio is handled when scaling
+ * @param shrinkOnly represents whether images smaller than scaleTo keep their size
+ *
+ * Formats that can scale while decoding (such as JPEG) are asked to do so, which is much
+ * cheaper than decoding at full size and scaling afterwards
+ */
+
+QImage AssetLoader::decode(const QString &path, const QSize &scaleTo, Qt::AspectRatioMode aspectMode, bool shrinkOnly)
+{
+
+    // Uncompressed resources are decoded straight from their mapping
+    std::unique_ptr<QIODevice> device(AssetPack::open(path));
+    if (!device) {
+        LOG_WARNING("asset", "Failed to open image %1", path);
+        return QImage();
+    }
+    QImageReader reader(device.get(), QFileInfo(path).suffix().toLatin1());
+
+    if (scaleTo.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize)) {
+        const QSize original = reader.size();
+        const bool fits = original.width() <= scaleTo.width() && original.height() <= scaleTo.height();
+        if (original.isValid() && !(shrinkOnly && fits)) {
+            reader.setScaledSize(original.scaled(scaleTo, aspectMode));
+        }
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        LOG_WARNING("asset", "Failed to decode image %1: %2", path, reader.errorString());
+        return image;
+    }
+
+    const bool fits = image.width() <= scaleTo.width() && image.height() <= scaleTo.height();
+    if (scaleTo.isValid() && !(shrinkOnly && fits) && image.size() != image.size().scaled(scaleTo, aspectMode)) {
+        image = image.scaled(scaleTo, aspectMode, Qt::SmoothTransformation);
+    }
+
+    return image;
+
+}
+
+/**
+ * @brief Returns the QPixmapCache key of a decoded pixmap
+ */
+
+QString AssetLoader::cacheKey(const QString &path, const QSize &scaleTo, Qt::AspectRatioMode aspectMode, bool shrinkOnly)
+{
+
+    return QString("asset:%1@%2x%3:%4:%5").arg(path).arg(scaleTo.width()).arg(scaleTo.height())
+        .arg(int(aspectMode)).arg(shrinkOnly ? 1 : 0);
+
+}
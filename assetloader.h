@@ -0,0 +1,74 @@
+/**
+ * @file assetloader.h
+ * @brief Decodes images on a thread pool and delivers them to the GUI thread
+ * @author Cherie Duong, Kiet Tran
+ */
+
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <QObject>
+#include <QFuture>
+#include <QImage>
+#include <QPixmap>
+#include <QSize>
+#include <QThreadPool>
+#include <functional>
+
+/**
+ * @brief Asynchronous image loader shared by the whole game
+ *
+ * Decoding (and optional scaling) happens on a dedicated thread pool, so multi-megabyte
+ * PNG and JPEG files never block the GUI thread. Callers either wait on a QFuture<QImage>
+ * or get a QPixmap callback on the GUI thread, where the QImage to QPixmap conversion has
+ * to happen. Higher priority requests are started before lower priority ones
+ */
+
+class AssetLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority {
+        Low = 0,        // Prefetching for later
+        Normal = 1,
+        High = 2,       // Needed for the next screen
+        Critical = 3    // Needed for the current frame
+    };
+
+    using PixmapCallback = std::function<void(const QPixmap &)>;
+
+    // Returns the application wide loader
+    static AssetLoader &instance();
+
+    // Decodes an image off the GUI thread, scaled to scaleTo when it is valid.
+    // With shrinkOnly set, images already smaller than scaleTo keep their size
+    QFuture<QImage> loadImage(const QString &path, Priority priority = Normal,
+                              const QSize &scaleTo = QSize(),
+                              Qt::AspectRatioMode aspectMode = Qt::KeepAspectRatio,
+                              bool shrinkOnly = false);
+
+    // Decodes an image off the GUI thread and calls callback with the pixmap on the GUI thread.
+    // The callback is dropped if context is destroyed first. Callers keeping the pixmap in a
+    // cache of their own clear cache so it is not held in QPixmapCache as well
+    void loadPixmap(const QString &path, QObject *context, PixmapCallback callback,
+                    Priority priority = Normal, const QSize &scaleTo = QSize(),
+                    Qt::AspectRatioMode aspectMode = Qt::KeepAspectRatio,
+                    bool shrinkOnly = false, bool cache = true);
+
+    // Blocks until every queued request has been decoded
+    void waitForDone();
+
+private:
+    explicit AssetLoader(QObject *parent = nullptr);
+
+    // Decodes and scales an image, safe on any thread
+    static QImage decode(const QString &path, const QSize &scaleTo, Qt::AspectRatioMode aspectMode, bool shrinkOnly);
+
+    // Key under which a decoded pixmap is kept in QPixmapCache
+    static QString cacheKey(const QString &path, const QSize &scaleTo, Qt::AspectRatioMode aspectMode, bool shrinkOnly);
+
+    QThreadPool m_pool;
+};
+
+#endif // ASSETLOADER_H
@@ -0,0 +1,200 @@
+/**
+ * @file assetpack.cpp
+ * @brief Implementation of the AssetPack class
+ * @author Cherie Duong
+ */
+
+#include "assetpack.h"
+#include "logger.h"
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QResource>
+#include <QUrl>
+
+namespace {
+
+// Path of the registered pack, only written by mount() at startup
+QString g_mountedPath;
+
+}
+
+const char AssetPack::kFileName[] = "assets.rcc";
+
+/**
+ * @brief Registers the external pack with QResource
+ * @param error receives a description of the failure if not null
+ * @return Returns true if resources can be opened afterwards
+ *
+ * Builds with embedded resources have nothing to mount and always succeed. Call it once the
+ * application object exists and before anything opens a resource
+ */
+
+bool AssetPack::mount(QString *error)
+{
+
+#ifdef EXTERNAL_ASSETS
+    if (isMounted()) return true;
+
+    const QStringList candidates = candidatePaths();
+    for (const QString &path : candidates) {
+        if (!QFileInfo::exists(path)) continue;
+
+        if (!QResource::registerResource(path)) {
+            if (error) *error = QString("%1 is not a valid asset pack").arg(path);
+            return false;
+        }
+
+        g_mountedPath = path;
+        LOG_INFO("asset", "Mounted asset pack %1 (%2 KB)", path, QFileInfo(path).size() / 1024);
+        return true;
+    }
+
+    if (error) *error = QString("No asset pack found, looked for %1").arg(candidates.join(", "));
+    return false;
+#else
+    Q_UNUSED(error);
+    return true;
+#endif
+
+}
+
+/**
+ * @brief Returns true once the external pack is registered
+ */
+
+bool AssetPack::isMounted()
+{
+
+    return !g_mountedPath.isEmpty();
+
+}
+
+/**
+ * @brief Returns the path of the registered pack, empty if none is
+ */
+
+QString AssetPack::mountedPath()
+{
+
+    return g_mountedPath;
+
+}
+
+/**
+ * @brief Returns true for ":/..." and "qrc:/..." paths
+ */
+
+bool AssetPack::isResource(const QString &path)
+{
+
+    return path.startsWith(":/") || path.startsWith("qrc:", Qt::CaseInsensitive);
+
+}
+
+/**
+ * @brief Opens a resource or a file for reading
+ * @param path represents a local path, or a : or qrc: resource path
+ * @param parent represents the owner of the device
+ * @return Returns the open device, or nullptr if it could not be opened
+ *
+ * An uncompressed resource is wrapped in a QBuffer over its mapped bytes, so reading it never
+ * copies the file, compressed resources and local files are opened with QFile
+ */
+
+QIODevice *AssetPack::open(const QString &path, QObject *parent)
+{
+
+    const QString local = isResource(path) ? resourcePath(path) : path;
+
+    if (isResource(path)) {
+        const QResource resource(local);
+        if (resource.isValid() && resource.data() && resource.compressionAlgorithm() == QResource::NoCompression) {
+            QBuffer *buffer = new QBuffer(parent);
+            buffer->setData(QByteArray::fromRawData(reinterpret_cast<const char *>(resource.data()), int(resource.size())));
+            buffer->open(QIODevice::ReadOnly);
+            return buffer;
+        }
+    }
+
+    QFile *file = new QFile(local, parent);
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
+        return nullptr;
+    }
+
+    return file;
+
+}
+
+/**
+ * @brief Returns the contents of a resource or a file
+ * @param path represents a local path, or a : or qrc: resource path
+ * @param ok receives false if the path could not be read
+ *
+ * The array of an uncompressed resource points into the mapping and stays valid for the life of
+ * the process, resources are never unregistered
+ */
+
+QByteArray AssetPack::read(const QString &path, bool *ok)
+{
+
+    if (ok) *ok = false;
+
+    if (isResource(path)) {
+        const QResource resource(resourcePath(path));
+        if (!resource.isValid() || !resource.data()) return QByteArray();
+
+        if (ok) *ok = true;
+        if (resource.compressionAlgorithm() == QResource::NoCompression) {
+            return QByteArray::fromRawData(reinterpret_cast<const char *>(resource.data()), int(resource.size()));
+        }
+        return resource.uncompressedData();
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+    if (ok) *ok = true;
+    return file.readAll();
+
+}
+
+/**
+ * @brief Returns the places the pack is looked for
+ *
+ * The ASSET_PACK environment variable, then next to the executable, then the Resources folder
+ * of a macOS bundle
+ */
+
+QStringList AssetPack::candidatePaths()
+{
+
+    QStringList paths;
+
+    const QString override = qEnvironmentVariable("ASSET_PACK");
+    if (!override.isEmpty()) {
+        paths << override;
+    }
+
+    const QDir directory(QCoreApplication::applicationDirPath());
+    paths << directory.filePath(kFileName);
+    paths << QDir::cleanPath(directory.filePath(QString("../Resources/") + kFileName));
+
+    return paths;
+
+}
+
+/**
+ * @brief Returns the ":/..." form of a resource path
+ */
+
+QString AssetPack::resourcePath(const QString &path)
+{
+
+    if (path.startsWith(":/")) return path;
+    return ":" + QUrl(path).path();
+
+}
@@ -0,0 +1,64 @@
+/**
+ * @file assetpack.h
+ * @brief External, memory-mapped resource pack and zero-copy access to resources
+ * @author Cherie Duong
+ */
+
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+class QIODevice;
+class QObject;
+
+/**
+ * @brief Mounts the external asset pack and opens resources without copying them
+ *
+ * Builds made with CONFIG+=external_assets link no resources. Their media is compiled by rcc
+ * into assets.rcc, one indexed archive next to the executable, which mount() registers with
+ * QResource at startup. Qt memory-maps the file and reads only its index, so the executable and
+ * the time to open the pack stay the same however much content is added, and the pages of an
+ * asset are read from disk the first time it is used. Every ":/images/..." and
+ * "qrc:/horror_music/..." path resolves against the pack as it would against embedded resources.
+ *
+ * The pack is stored uncompressed, so open() and read() hand out views of the mapping itself
+ * instead of copies. Embedded resources stored uncompressed get the same treatment
+ */
+
+class AssetPack
+{
+public:
+    // File name of the pack next to the executable
+    static const char kFileName[];
+
+    // Registers the pack in builds without embedded resources, true if resources are available
+    static bool mount(QString *error = nullptr);
+
+    // True once the external pack is registered
+    static bool isMounted();
+
+    // Path of the registered pack, empty if none is
+    static QString mountedPath();
+
+    // True for ":/..." and "qrc:/..." paths
+    static bool isResource(const QString &path);
+
+    // Opens a resource or a file for reading, nullptr if it cannot be. Uncompressed resources
+    // are read straight from their mapping
+    static QIODevice *open(const QString &path, QObject *parent = nullptr);
+
+    // Contents of a resource or a file, a view of the mapping for uncompressed resources
+    static QByteArray read(const QString &path, bool *ok = nullptr);
+
+private:
+    // Places the pack is looked for, in order
+    static QStringList candidatePaths();
+
+    // ":/..." form of a resource path
+    static QString resourcePath(const QString &path);
+};
+
+#endif // ASSETPACK_H
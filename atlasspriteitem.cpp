@@ -0,0 +1,80 @@
+/**
+ * @file atlasspriteitem.cpp
+ * @brief Implementation of the AtlasSpriteItem class
+ * @author Kiet Tran, Steph Oh
+ */
+
+#include "atlasspriteitem.h"
+#include <QPainter>
+
+/**
+ * @brief Constructs an empty AtlasSpriteItem
+ * @param parent represents the parent item
+ */
+
+AtlasSpriteItem::AtlasSpriteItem(QGraphicsItem *parent) : QGraphicsItem(parent)
+{
+
+}
+
+/**
+ * @brief Shows a region of the shared atlas
+ * @param region represents the region, an invalid region draws nothing
+ *
+ * The item takes the size of a valid region
+ */
+
+void AtlasSpriteItem::setRegion(const AtlasRegion &region)
+{
+
+    if (region.page == m_region.page && region.rect == m_region.rect) return;
+
+    m_region = region;
+    if (region.isValid()) {
+        setSize(region.rect.size());
+    }
+    update();
+
+}
+
+/**
+ * @brief Sets the size the region is drawn at
+ * @param size represents the size in item coordinates
+ */
+
+void AtlasSpriteItem::setSize(const QSizeF &size)
+{
+
+    if (size == m_size) return;
+
+    prepareGeometryChange();
+    m_size = size;
+
+}
+
+/**
+ * @brief Returns the bounds of the item
+ */
+
+QRectF AtlasSpriteItem::boundingRect() const
+{
+
+    return QRectF(QPointF(0, 0), m_size);
+
+}
+
+/**
+ * @brief Draws the region from its atlas page
+ */
+
+void AtlasSpriteItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+
+    if (!m_region.isValid()) return;
+
+    painter->drawPixmap(boundingRect(), TextureAtlas::instance().page(m_region.page), m_region.rect);
+
+}
@@ -0,0 +1,42 @@
+/**
+ * @file atlasspriteitem.h
+ * @brief Graphics item drawing a sub-rectangle of a texture atlas page
+ * @author Kiet Tran, Steph Oh
+ */
+
+#ifndef ATLASSPRITEITEM_H
+#define ATLASSPRITEITEM_H
+
+#include <QGraphicsItem>
+#include "textureatlas.h"
+
+/**
+ * @brief Scene item showing one region of a TextureAtlas
+ *
+ * Behaves like a QGraphicsPixmapItem whose pixmap is a region of a shared atlas page. The item
+ * keeps its own size, so switching to a region that is not packed yet leaves the bounds (and
+ * anything relying on them, such as collision boxes) unchanged
+ */
+
+class AtlasSpriteItem : public QGraphicsItem
+{
+public:
+    explicit AtlasSpriteItem(QGraphicsItem *parent = nullptr);
+
+    // Shows a region of the shared atlas, the item takes the region's size
+    void setRegion(const AtlasRegion &region);
+    AtlasRegion region() const { return m_region; }
+
+    // Size the region is drawn at
+    void setSize(const QSizeF &size);
+    QSizeF size() const { return m_size; }
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
+
+private:
+    AtlasRegion m_region;
+    QSizeF m_size;
+};
+
+#endif // ATLASSPRITEITEM_H
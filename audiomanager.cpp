@@ -1,117 +1,451 @@
+/**
+ * @file audiomanager.cpp
+ * @brief Implementation of the AudioManager class
+ * @author Kiet Tran, Steph Oh
+ */
+
 #include "audiomanager.h"
-#include <QAudioDevice>
+#include "dspkernels.h"
+#include "logger.h"
+#include "profiler.h"
+#include <QAudioSource>
+#include <QElapsedTimer>
 #include <QMediaDevices>
-#include <QDebug>
-#include <cmath>
+#include <QThread>
+#include <cstring>
+
+namespace {
+
+// Hops of audio read from the source at once and buffered by the backend
+const int kHopsPerRead = 4;
+
+// Returns one channel of a frame as a signed 16-bit sample
+qint16 toInt16(const uint8_t *sample, QAudioFormat::SampleFormat format)
+{
+
+    switch (format) {
+    case QAudioFormat::UInt8:
+        return qint16((int(*sample) - 128) << 8);
+    case QAudioFormat::Int16: {
+        qint16 value;
+        std::memcpy(&value, sample, sizeof(value));
+        return value;
+    }
+    case QAudioFormat::Int32: {
+        qint32 value;
+        std::memcpy(&value, sample, sizeof(value));
+        return qint16(value >> 16);
+    }
+    case QAudioFormat::Float: {
+        float value;
+        std::memcpy(&value, sample, sizeof(value));
+        return qint16(qBound(-1.0f, value, 1.0f) * 32767.0f);
+    }
+    default:
+        return 0;
+    }
+
+}
+
+}
+
+/**
+ * @brief Constructs the AudioManager and picks the default input device
+ * @param parent represents the parent QObject
+ */
 
 AudioManager::AudioManager(QObject *parent)
-    : QObject(parent),
-    threshold(1000),
-    audioInput(nullptr),
-    initialized(false)
+    : QObject(parent)
+    , m_initialized(false)
+    , m_listening(false)
+    , m_hopSize(0)
+    , m_captureThread(nullptr)
+    , m_captureContext(nullptr)
+    , m_source(nullptr)
+    , m_sourceDevice(nullptr)
+    , m_analysisThread(nullptr)
+    , m_analysing(false)
+    , m_processingEnabled(false)
+    , m_vad(kHopMs)
+    , m_preRollNext(0)
+    , m_preRollCount(0)
+    , m_forwarding(false)
+    , m_threshold(0.0)
+    , m_level(0.0)
+    , m_droppedSamples(0)
+    , m_hops(0)
+    , m_forwardedHops(0)
+    , m_downstreamNs(0)
 {
+
     initAudio();
+
 }
 
+/**
+ * @brief Stops both threads before the ring buffer goes away
+ */
+
 AudioManager::~AudioManager()
 {
+
     stopListening();
+
 }
 
+/**
+ * @brief Picks the default input device and negotiates the capture format
+ *
+ * Asks for 16 kHz mono 16-bit, which is all the analysis needs. Devices that refuse it are
+ * opened in their preferred format and converted in audioCallback()
+ */
+
 void AudioManager::initAudio()
 {
-    // Get default audio input device
-    const QAudioDevice inputDevice = QMediaDevices::defaultAudioInput();
-    if (!inputDevice.isNull()) {
-        audioDevice = inputDevice;
-        audioDeviceId = inputDevice.id();
 
-        // Create audio input
-        audioInput = new QAudioInput(this);
-        captureSession.setAudioInput(audioInput);
+    const QAudioDevice device = QMediaDevices::defaultAudioInput();
+    if (device.isNull()) {
+        LOG_WARNING("audio", "No audio input device found");
+        return;
+    }
 
-        // Set up buffer
-        audioBuffer.resize(8192); // 4 seconds at 44.1kHz mono
+    QAudioFormat format;
+    format.setSampleRate(kPreferredSampleRate);
+    format.setChannelCount(1);
+    format.setSampleFormat(QAudioFormat::Int16);
 
-        initialized = true;
-        qDebug() << "Audio system initialized with device:" << inputDevice.description();
-    } else {
-        qWarning() << "No audio input device found";
+    if (!device.isFormatSupported(format)) {
+        format = device.preferredFormat();
     }
+
+    m_device = device;
+    m_format = format;
+    m_hopSize = qMax(1, format.sampleRate() * kHopMs / 1000);
+    m_preRoll.resize(m_hopSize * kPreRollHops);
+    m_initialized = true;
+
+    LOG_INFO("audio", "Audio input %1 at %2 Hz, %3 channel(s)",
+             device.description(), format.sampleRate(), format.channelCount());
+
 }
 
+/**
+ * @brief Starts capturing on one thread and analysing on another
+ */
+
 void AudioManager::startListening()
 {
-    if (!initialized) {
-        qWarning() << "Cannot start listening - audio system not initialized";
+
+    if (!m_initialized) {
+        LOG_WARNING("audio", "Cannot start listening - audio system not initialized");
         return;
     }
 
-    // Create a simple audio probe/monitor here
-    // This is simplified as Qt6's audio handling is different from SDL_Audio used in UML
+    if (m_listening) return;
+
+    qint16 discard[256];
+    while (m_samples.read(discard, 256) > 0) {}
+    m_level.store(0.0, std::memory_order_relaxed);
+    m_hops.store(0);
+    m_forwardedHops.store(0);
+    m_downstreamNs.store(0);
+    m_vad.reset();
+    m_threshold.store(m_vad.threshold());
+    m_preRollCount = 0;
+    m_forwarding = false;
+
+    m_captureThread = new QThread();
+    m_captureThread->setObjectName("AudioCapture");
+    m_captureContext = new QObject();
+    m_captureContext->moveToThread(m_captureThread);
+    m_captureThread->start();
+    QMetaObject::invokeMethod(m_captureContext, [this]() { openSource(); }, Qt::BlockingQueuedConnection);
+
+    m_analysing.store(true);
+    m_analysisThread = QThread::create([this]() { analysisLoop(); });
+    m_analysisThread->setObjectName("AudioAnalysis");
+    m_analysisThread->start();
+
+    m_listening = true;
+    LOG_INFO("audio", "Audio manager started listening");
 
-    qDebug() << "Audio manager started listening";
 }
 
+/**
+ * @brief Stops capturing and waits for both threads to finish
+ */
+
 void AudioManager::stopListening()
 {
-    if (!initialized) {
+
+    if (!m_listening) return;
+
+    QMetaObject::invokeMethod(m_captureContext, [this]() { closeSource(); }, Qt::BlockingQueuedConnection);
+    m_captureThread->quit();
+    m_captureThread->wait();
+    delete m_captureContext;
+    delete m_captureThread;
+    m_captureContext = nullptr;
+    m_captureThread = nullptr;
+
+    m_analysing.store(false);
+    m_analysisThread->wait();
+    delete m_analysisThread;
+    m_analysisThread = nullptr;
+
+    m_listening = false;
+
+    const AudioGateStats stats = gateStats();
+    LOG_INFO("audio", "Audio manager stopped listening, the voice gate skipped %1% of %2 hops and saved about %3 ms of speech processing",
+             qRound(stats.skippedFraction() * 100), stats.hops, qRound(stats.savedMs()));
+
+}
+
+/**
+ * @brief Returns true if the last analysed hop was above the threshold
+ */
+
+bool AudioManager::isLoud() const
+{
+
+    return m_listening && level() > threshold();
+
+}
+
+/**
+ * @brief Returns the RMS of the last analysed hop
+ */
+
+qreal AudioManager::level() const
+{
+
+    return m_level.load(std::memory_order_relaxed);
+
+}
+
+/**
+ * @brief Returns the counters of the voice activity gate
+ */
+
+AudioGateStats AudioManager::gateStats() const
+{
+
+    AudioGateStats stats;
+    stats.hops = m_hops.load(std::memory_order_relaxed);
+    stats.forwardedHops = m_forwardedHops.load(std::memory_order_relaxed);
+    stats.downstreamNs = m_downstreamNs.load(std::memory_order_relaxed);
+    return stats;
+
+}
+
+/**
+ * @brief Sets the function speech is passed to
+ * @param callback represents the function, called on the analysis thread
+ *
+ * While processing is enabled, every segment the detector hears reaches the callback as the
+ * pre-roll hops and the segment's Speech and Hangover hops, closed by one End hop. Disabling
+ * processing in the middle of a segment closes it straight away. Ignored while listening, the
+ * analysis thread reads the callback without a lock
+ */
+
+void AudioManager::setHopCallback(HopCallback callback)
+{
+
+    if (m_listening) {
+        LOG_WARNING("audio", "Cannot change the hop callback while listening");
         return;
     }
 
-    qDebug() << "Audio manager stopped listening";
+    m_hopCallback = callback;
+
 }
 
-bool AudioManager::isLoud()
+/**
+ * @brief Converts raw PCM to mono and queues it for analysis
+ * @param userdata represents unused context, kept for callback compatibility
+ * @param stream represents whole frames in the capture format
+ * @param len represents the number of bytes in stream
+ *
+ * Only ever called by the capture thread, the single producer of the ring buffer. Samples that
+ * do not fit are dropped and counted rather than blocking the capture
+ */
+
+void AudioManager::audioCallback(void *userdata, uint8_t *stream, int len)
 {
-    if (!initialized) {
-        return false;
-    }
 
-    // Calculate current audio level
-    qreal level = calculateAudioLevel(audioBuffer);
+    Q_UNUSED(userdata);
+
+    const int frameBytes = m_format.bytesPerFrame();
+    const int sampleBytes = m_format.bytesPerSample();
+    const int channels = m_format.channelCount();
+    const QAudioFormat::SampleFormat sampleFormat = m_format.sampleFormat();
+    if (!stream || frameBytes <= 0) return;
+
+    const int frames = qMin(len / frameBytes, m_convertBuffer.size());
+    qint16 *out = m_convertBuffer.data();
 
-    // Check if above threshold
-    if (level > threshold) {
-        emit noiseDetected(level);
-        return true;
+    if (sampleFormat == QAudioFormat::Int16 && channels == 1) {
+        std::memcpy(out, stream, frames * sizeof(qint16));
+    } else {
+        for (int i = 0; i < frames; ++i) {
+            const uint8_t *frame = stream + i * frameBytes;
+            int sum = 0;
+            for (int c = 0; c < channels; ++c) {
+                sum += toInt16(frame + c * sampleBytes, sampleFormat);
+            }
+            out[i] = qint16(sum / channels);
+        }
+    }
+
+    const int written = m_samples.write(out, frames);
+    if (written < frames) {
+        m_droppedSamples.fetch_add(quint64(frames - written), std::memory_order_relaxed);
     }
 
-    return false;
 }
 
-void AudioManager::audioCallback(void* /*userdata*/, uint8_t* stream, int len)
+/**
+ * @brief Opens the audio source in pull mode on the capture thread
+ */
+
+void AudioManager::openSource()
 {
-    if (!initialized) {
+
+    const int readFrames = m_hopSize * kHopsPerRead;
+    m_readBuffer.resize(readFrames * m_format.bytesPerFrame());
+    m_convertBuffer.resize(readFrames);
+
+    m_source = new QAudioSource(m_device, m_format, m_captureContext);
+    m_source->setBufferSize(m_readBuffer.size() * 2);
+    m_sourceDevice = m_source->start();
+
+    if (!m_sourceDevice) {
+        LOG_WARNING("audio", "Failed to open the audio input, error %1", int(m_source->error()));
         return;
     }
 
-    // Copy audio data to our buffer for analysis
-    // This is simplified as we don't have direct SDL-style callbacks in Qt6
+    connect(m_sourceDevice, &QIODevice::readyRead, m_captureContext, [this]() { readSource(); });
 
-    // Calculate audio level
-    qreal level = calculateAudioLevel(audioBuffer);
-
-    // Emit signal for level change
-    emit audioLevelChanged(level);
 }
 
-void AudioManager::noiseDetected()
+/**
+ * @brief Stops and deletes the audio source on the capture thread
+ */
+
+void AudioManager::closeSource()
 {
-    qDebug() << "Noise detected above threshold";
+
+    if (!m_source) return;
+
+    m_source->stop();
+    delete m_source;
+    m_source = nullptr;
+    m_sourceDevice = nullptr;
+
 }
 
-qreal AudioManager::calculateAudioLevel(const QVector<qint16>& buffer)
+/**
+ * @brief Moves everything the source has buffered into the ring buffer
+ *
+ * Reads whole frames only, so a frame is never split between two callbacks
+ */
+
+void AudioManager::readSource()
 {
-    if (buffer.isEmpty()) {
-        return 0.0;
+
+    if (!m_sourceDevice) return;
+
+    const int frameBytes = m_format.bytesPerFrame();
+    const qint64 maxBytes = m_readBuffer.size();
+
+    for (;;) {
+        const qint64 wanted = qMin(m_sourceDevice->bytesAvailable(), maxBytes) / frameBytes * frameBytes;
+        if (wanted <= 0) break;
+
+        const qint64 got = m_sourceDevice->read(m_readBuffer.data(), wanted);
+        if (got <= 0) break;
+
+        audioCallback(this, reinterpret_cast<uint8_t *>(m_readBuffer.data()), int(got));
     }
 
-    // Calculate RMS value
-    qreal sum = 0.0;
-    for (qint16 sample : buffer) {
-        sum += sample * sample;
+}
+
+/**
+ * @brief Pops fixed hops from the ring buffer and analyses them
+ *
+ * Sleeps for a fraction of a hop while less than one hop is queued, so a hop is analysed at most
+ * a quarter of a hop after it was captured. Every hop updates the level and the noise floor,
+ * only speech during an enabled period reaches the hop callback
+ */
+
+void AudioManager::analysisLoop()
+{
+
+    QVector<qint16> hop(m_hopSize);
+    const unsigned long idleUs = kHopMs * 1000 / 4;
+
+    while (m_analysing.load(std::memory_order_relaxed)) {
+        if (m_samples.size() < m_hopSize) {
+            QThread::usleep(idleUs);
+            continue;
+        }
+
+        m_samples.read(hop.data(), m_hopSize);
+        m_hops.fetch_add(1, std::memory_order_relaxed);
+
+        const qreal level = Dsp::rms(hop.constData(), m_hopSize);
+        const VoiceActivity activity = m_vad.process(hop.constData(), m_hopSize, level);
+        m_level.store(level, std::memory_order_relaxed);
+        m_threshold.store(m_vad.threshold(), std::memory_order_relaxed);
+
+        const bool enabled = m_hopCallback && m_processingEnabled.load(std::memory_order_relaxed);
+
+        if (m_forwarding && (!enabled || activity == VoiceActivity::End || activity == VoiceActivity::Silence)) {
+            forwardHop(hop.constData(), level, VoiceActivity::End);
+            m_forwarding = false;
+        } else if (m_forwarding) {
+            forwardHop(hop.constData(), level, activity);
+        } else if (enabled && activity == VoiceActivity::Speech) {
+            // Replays the quiet hops in front of the segment, oldest first
+            const int first = (m_preRollNext - m_preRollCount + kPreRollHops) % kPreRollHops;
+            for (int i = 0; i < m_preRollCount; ++i) {
+                const qint16 *quiet = m_preRoll.constData() + ((first + i) % kPreRollHops) * m_hopSize;
+                forwardHop(quiet, Dsp::rms(quiet, m_hopSize), VoiceActivity::Hangover);
+            }
+            m_preRollCount = 0;
+
+            forwardHop(hop.constData(), level, activity);
+            m_forwarding = true;
+        }
+
+        if (!m_forwarding && activity != VoiceActivity::Speech) {
+            std::memcpy(m_preRoll.data() + m_preRollNext * m_hopSize, hop.constData(), m_hopSize * sizeof(qint16));
+            m_preRollNext = (m_preRollNext + 1) % kPreRollHops;
+            m_preRollCount = qMin(m_preRollCount + 1, kPreRollHops);
+        }
+
+        emit audioLevelChanged(level);
+        if (level > m_vad.threshold()) {
+            emit noiseDetected(level);
+        }
     }
 
-    return std::sqrt(sum / buffer.size());
+}
+
+/**
+ * @brief Passes one hop to the callback and adds its cost to the gate's counters
+ */
+
+void AudioManager::forwardHop(const qint16 *samples, qreal level, VoiceActivity activity)
+{
+
+    ProfileScope scope(ProfileSection::Voice);
+    QElapsedTimer timer;
+    timer.start();
+
+    m_hopCallback(samples, m_hopSize, level, activity);
+
+    m_forwardedHops.fetch_add(1, std::memory_order_relaxed);
+    m_downstreamNs.fetch_add(timer.nsecsElapsed(), std::memory_order_relaxed);
+
 }
@@ -1,69 +1,174 @@
+/**
+ * @file audiomanager.h
+ * @brief Microphone capture and loudness analysis running off the GUI thread
+ * @author Kiet Tran, Steph Oh
+ */
+
 #ifndef AUDIOMANAGER_H
 #define AUDIOMANAGER_H
 
 #include <QObject>
-#include <QAudioInput>
-#include <QMediaCaptureSession>
 #include <QAudioDevice>
 #include <QAudioFormat>
-#include <QBuffer>
 #include <QVector>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include "spscringbuffer.h"
+#include "voiceactivitydetector.h"
+
+class QAudioSource;
+class QIODevice;
+class QThread;
+
+/**
+ * @brief Captures PCM from the default microphone and reports its loudness
+ *
+ * A QAudioSource living on a capture thread converts whatever format the device delivers to
+ * 16-bit mono and pushes it into a lock-free ring buffer. A separate analysis thread pops one
+ * fixed hop at a time, computes its RMS and emits audioLevelChanged() and noiseDetected(), so
+ * slow mic processing can never hold up a frame. Receivers on the GUI thread get the signals
+ * queued.
+ *
+ * A VoiceActivityDetector gates the hop callback: downstream speech processing is only woken
+ * while processing is enabled (a challenge is active) and the detector hears speech, and the
+ * time it would have spent on the other hops is reported as saved
+ */
+
+/**
+ * @brief Counters of the voice activity gate
+ */
+
+struct AudioGateStats {
+    quint64 hops = 0;           // Hops analysed
+    quint64 forwardedHops = 0;  // Hops passed to the hop callback
+    qint64 downstreamNs = 0;    // Time spent in the hop callback
+
+    // Fraction of hops the callback never saw
+    qreal skippedFraction() const { return hops ? 1.0 - qreal(forwardedHops) / hops : 0.0; }
+
+    // Callback time the skipped hops would have cost at the mean cost of a forwarded hop
+    qreal savedMs() const
+    {
+        return forwardedHops ? downstreamNs / 1e6 / forwardedHops * (hops - forwardedHops) : 0.0;
+    }
+};
 
 class AudioManager : public QObject
 {
     Q_OBJECT
 
 public:
+    // Samples per second captured when the device supports it
+    static const int kPreferredSampleRate = 16000;
+
+    // Length of one analysis hop in milliseconds
+    static const int kHopMs = 20;
+
+    // Hops replayed in front of the first speech hop, so the start of a word is not cut off
+    static const int kPreRollHops = 5;
+
+    // Called on the analysis thread with the hops of a speech segment, see setHopCallback()
+    using HopCallback = std::function<void(const qint16 *samples, int count, qreal level, VoiceActivity activity)>;
+
     explicit AudioManager(QObject *parent = nullptr);
     ~AudioManager();
 
-    // Initialize the audio system
+    // Picks the default input device and negotiates the capture format
     void initAudio();
+    bool isInitialized() const { return m_initialized; }
 
-    // Start and stop listening
+    // Starts and stops the capture and analysis threads
     void startListening();
     void stopListening();
+    bool isListening() const { return m_listening; }
 
-    // Check if audio is loud enough (above threshold)
-    bool isLoud();
+    // True if the last analysed hop was above the threshold
+    bool isLoud() const;
 
-    // Audio callback for processing audio data
-    void audioCallback(void* userdata, uint8_t* stream, int len);
+    // RMS of the last analysed hop, in 16-bit sample units
+    qreal level() const;
 
-    // Noise detection
-    void noiseDetected();
+    // RMS above which noiseDetected() is emitted, follows the ambient noise
+    qreal threshold() const { return m_threshold.load(std::memory_order_relaxed); }
 
-signals:
-    // Signal emitted when audio level changes
-    void audioLevelChanged(qreal level);
+    // Wakes the hop callback for speech, off by default
+    void setProcessingEnabled(bool enabled) { m_processingEnabled.store(enabled); }
+    bool isProcessingEnabled() const { return m_processingEnabled.load(); }
 
-    // Signal emitted when noise is detected
-    void noiseDetected(qreal level);
-
-private:
-    // Audio threshold for detection
-    int threshold;
+    // Counters of the gate since listening started
+    AudioGateStats gateStats() const;
 
-    // Audio specification
-    QAudioDevice audioDevice;
+    // Rate of the samples in the ring buffer and the size of one hop
+    int sampleRate() const { return m_format.sampleRate(); }
+    int hopSize() const { return m_hopSize; }
 
-    // Audio device ID
-    QString audioDeviceId;
+    // Passes speech on, for example to a KeywordSpotter. Only set while not listening
+    void setHopCallback(HopCallback callback);
 
-    // Audio buffer for processing
-    QVector<qint16> audioBuffer;
+    // Converts raw PCM in the capture format to mono and queues it for analysis, called on the
+    // capture thread
+    void audioCallback(void *userdata, uint8_t *stream, int len);
 
-    // Audio input for capturing
-    QAudioInput* audioInput;
+    // Samples lost because the analysis thread fell behind
+    quint64 droppedSamples() const { return m_droppedSamples.load(std::memory_order_relaxed); }
 
-    // Media capture session
-    QMediaCaptureSession captureSession;
+signals:
+    // Emitted once per hop from the analysis thread
+    void audioLevelChanged(qreal level);
 
-    // Whether audio system is initialized
-    bool initialized;
+    // Emitted for each hop whose level is above the threshold
+    void noiseDetected(qreal level);
 
-    // Calculate audio level from buffer
-    qreal calculateAudioLevel(const QVector<qint16>& buffer);
+private:
+    // About a second of 16 kHz audio
+    using SampleRing = SpscRingBuffer<qint16, 16384>;
+
+    // Opens the audio source, runs on the capture thread
+    void openSource();
+    void closeSource();
+
+    // Drains the audio source into the ring buffer, runs on the capture thread
+    void readSource();
+
+    // Pops and analyses hops until stopped, runs on the analysis thread
+    void analysisLoop();
+
+    // Passes a hop to the callback and accounts for its cost
+    void forwardHop(const qint16 *samples, qreal level, VoiceActivity activity);
+
+    QAudioDevice m_device;
+    QAudioFormat m_format;
+    bool m_initialized;
+    bool m_listening;
+    int m_hopSize;
+
+    QThread *m_captureThread;
+    QObject *m_captureContext;    // Lives on the capture thread, owns the source
+    QAudioSource *m_source;
+    QIODevice *m_sourceDevice;
+    QVector<char> m_readBuffer;
+    QVector<qint16> m_convertBuffer;
+
+    QThread *m_analysisThread;
+    HopCallback m_hopCallback;
+    std::atomic<bool> m_analysing;
+    std::atomic<bool> m_processingEnabled;
+
+    // Only touched by the analysis thread
+    VoiceActivityDetector m_vad;
+    QVector<qint16> m_preRoll;    // Ring of the last kPreRollHops quiet hops
+    int m_preRollNext;
+    int m_preRollCount;
+    bool m_forwarding;            // The callback is inside a segment
+
+    SampleRing m_samples;
+    std::atomic<qreal> m_threshold;
+    std::atomic<qreal> m_level;
+    std::atomic<quint64> m_droppedSamples;
+    std::atomic<quint64> m_hops;
+    std::atomic<quint64> m_forwardedHops;
+    std::atomic<qint64> m_downstreamNs;
 };
 
 #endif // AUDIOMANAGER_H
@@ -5,7 +5,18 @@
  */
 
 #include "audiosystem.h"
-#include <QDebug>
+#include "assetpack.h"
+#include "musicstream.h"
+#include "profiler.h"
+#include "logger.h"
+#include <QThread>
+
+namespace {
+
+// Fade out of the music when it is stopped, long enough not to click
+const int kStopFadeMs = 150;
+
+}
 
 /**
  * @brief Constructs an AudioSystem object
@@ -29,13 +40,26 @@ AudioSystem::AudioSystem(QObject *parent) : QObject(parent)
 
 AudioSystem::~AudioSystem()
 {
-    backgroundPlayer->stop();
-    effectsPlayer->stop();
-
-    delete backgroundPlayer;
-    delete backgroundOutput;
-    delete effectsPlayer;
-    delete effectsOutput;
+    streamPlayer->stop();
+
+    // The mixer thread reads the bank's clips and the music rings until it stops
+    mixer->stop();
+
+    // Streams are deleted on their own thread, which owns their decoders and timers
+    QMetaObject::invokeMethod(musicContext, [this]() {
+        for (MusicStream *stream : musicStreams) {
+            delete stream;
+        }
+    }, Qt::BlockingQueuedConnection);
+    musicThread->quit();
+    musicThread->wait();
+    delete musicContext;
+    delete musicThread;
+
+    delete streamPlayer;
+    delete streamOutput;
+    delete mixer;
+    delete effectsBank;
 }
 
 /**
@@ -47,84 +71,95 @@ AudioSystem::~AudioSystem()
 void AudioSystem::initializePlayers()
 {
 
-    // Sets up the background audio
-    backgroundPlayer = new QMediaPlayer(this);
-    backgroundOutput = new QAudioOutput(this);
-    backgroundPlayer->setAudioOutput(backgroundOutput);
-    backgroundOutput->setVolume(0.5f);
-
-    // Connects the playback state change signal
-    connect(backgroundPlayer, &QMediaPlayer::playbackStateChanged, this, &AudioSystem::handleBackgroundMusicStateChange);
-
-    // Sets up the sound effects
-    effectsPlayer = new QMediaPlayer(this);
-    effectsOutput = new QAudioOutput(this);
-    effectsPlayer->setAudioOutput(effectsOutput);
-    effectsOutput->setVolume(0.7f);
-
-    // Condcuts error handling for both players
-    connect(backgroundPlayer, &QMediaPlayer::errorOccurred, this, [this](){
-        qDebug() << "Background music error:" << backgroundPlayer->errorString();
-    });
-
-    connect(effectsPlayer, &QMediaPlayer::errorOccurred, this, [this](){
-        qDebug() << "Sound effect error:" << effectsPlayer->errorString();
+    // Sets up the mixer playing both the music and the sound effects
+    mixer = new SoundMixer(this);
+    mixer->setMusicGain(0.5f);
+    mixer->setMasterGain(effectsVolume);
+    mixer->start();
+    connect(mixer, &SoundMixer::streamDetached, this, &AudioSystem::handleStreamDetached);
+
+    // Decodes the effects once, at the mixer's rate
+    const int effectsRate = mixer->isInitialized() ? mixer->sampleRate() : SoundMixer::kPreferredSampleRate;
+    effectsBank = new SoundBank(effectsRate, SoundBank::kDefaultBudgetBytes, this);
+    connect(effectsBank, &SoundBank::loaded, this, &AudioSystem::handleEffectLoaded);
+
+    // Sets up the music decks, decoded ahead on their own thread
+    musicThread = new QThread();
+    musicThread->setObjectName("MusicStreaming");
+    musicContext = new QObject();
+    for (MusicStream *&stream : musicStreams) {
+        stream = new MusicStream(effectsRate);
+        stream->moveToThread(musicThread);
+    }
+    musicContext->moveToThread(musicThread);
+    musicThread->start();
+
+    // Sets up the player of effects too long for the bank
+    streamPlayer = new QMediaPlayer(this);
+    streamOutput = new QAudioOutput(this);
+    streamPlayer->setAudioOutput(streamOutput);
+    streamOutput->setVolume(effectsVolume);
+
+    // Condcuts error handling for the streaming player
+    connect(streamPlayer, &QMediaPlayer::errorOccurred, this, [this](){
+        LOG_WARNING("audio", "Sound effect error: %1", streamPlayer->errorString());
     });
 
 }
 
 /**
- * @brief Handles state changes to the background music
- * @param state represents the new playback state
+ * @brief Plays background music
+ * @param filePath represents the Path to the audio file
+ * @param loop represents whether to loop the music continuously or not
+ * @param crossfadeMs represents how long the current track fades into the new one
  *
- * Automatically restarts the playback if stopped while in loop mode
+ * The new track is opened on the free deck and fades in while the current one fades out, over
+ * the same frames of the mixer's clock. Asking for the track already playing changes nothing
  */
 
-void AudioSystem::handleBackgroundMusicStateChange(QMediaPlayer::PlaybackState state)
+void AudioSystem::playBackgroundMusic(const QString &filePath, bool loop, int crossfadeMs)
 {
 
-    if (state == QMediaPlayer::StoppedState && shouldLoop && !currentBackgroundMusic.isEmpty()) {
-
-        // Rewinds to start
-        backgroundPlayer->setPosition(0);
+    ProfileScope scope(ProfileSection::Audio);
 
-        // Restarts playback
-        backgroundPlayer->play();
+    if (currentMusicDeck >= 0 && filePath == currentBackgroundMusic) return;
 
-    }
+    const int previous = currentMusicDeck;
+    const int deck = previous < 0 ? 0 : (previous + 1) % SoundMixer::kMusicDecks;
+    const int fadeMs = previous < 0 ? 0 : crossfadeMs;
+    ++musicDeckUses[deck];
 
-}
+    // Blocks until the old track of this deck is closed, so the mixer never reads past the new start mark
+    MusicStream *stream = musicStreams[deck];
+    QMetaObject::invokeMethod(stream, [stream, filePath, loop]() { stream->open(filePath, loop); }, Qt::BlockingQueuedConnection);
 
-/**
- * @brief Plays background music
- * @param filePath represents the Path to the audio file
- * @param loop represents whether to loop the music continuously or not
- *
- * Stops any background music that is currently playing before starting a new playback
- */
+    if (musicPaused) {
+        mixer->pauseStreams(false);
+        musicPaused = false;
+    }
 
-void AudioSystem::playBackgroundMusic(const QString &filePath, bool loop)
-{
+    mixer->playStream(deck, stream, 1.0f, fadeMs, musicDeckUses[deck]);
+    if (previous >= 0) {
+        fadeOutMusicDeck(previous, fadeMs);
+    }
 
-    shouldLoop = loop;
+    currentMusicDeck = deck;
     currentBackgroundMusic = filePath;
 
-    backgroundPlayer->stop();
-    backgroundPlayer->setSource(QUrl(filePath));
-    backgroundPlayer->play();
-
 }
 
 /**
  * @brief Pauses background music playback
  *
- * Saves the current playback position for later resuming
+ * The decks hold their position, their rings stay full while paused
  */
 
 void AudioSystem::pauseBackgroundMusic()
 {
 
-    backgroundPlayer->pause();
+    ProfileScope scope(ProfileSection::Audio);
+    mixer->pauseStreams(true);
+    musicPaused = true;
 
 }
 
@@ -137,21 +172,29 @@ void AudioSystem::pauseBackgroundMusic()
 void AudioSystem::resumeBackgroundMusic()
 {
 
-    backgroundPlayer->play();
+    ProfileScope scope(ProfileSection::Audio);
+    mixer->pauseStreams(false);
+    musicPaused = false;
 
 }
 
 /**
  * @brief Stops the background music
  *
- * Resets the playback position and disables looping
+ * Fades the current track out quickly and closes it
  */
 
 void AudioSystem::stopBackgroundMusic()
 {
 
-    shouldLoop = false;
-    backgroundPlayer->stop();
+    ProfileScope scope(ProfileSection::Audio);
+
+    if (currentMusicDeck < 0) return;
+
+    const int deck = currentMusicDeck;
+    currentMusicDeck = -1;
+    fadeOutMusicDeck(deck, kStopFadeMs);
+    currentBackgroundMusic.clear();
 
 }
 
@@ -163,23 +206,185 @@ void AudioSystem::stopBackgroundMusic()
 void AudioSystem::setBackgroundVolume(float volume)
 {
 
-    backgroundOutput->setVolume(volume);
+    mixer->setMusicGain(volume);
+
+}
+
+/**
+ * @brief Fades a deck out and detaches it from the mixer
+ * @param deck represents the deck fading out
+ * @param fadeMs represents the length of the fade
+ *
+ * The stream is closed when the mixer reports the deck detached, however long the fade takes or
+ * the mixer stalls. Without a running mixer nothing reads the stream and it is closed at once
+ */
+
+void AudioSystem::fadeOutMusicDeck(int deck, int fadeMs)
+{
+
+    if (!mixer->isRunning()) {
+        closeMusicDeck(deck);
+        return;
+    }
+
+    mixer->fadeStream(deck, 0.0f, fadeMs, true);
+
+}
+
+/**
+ * @brief Closes the stream of a deck the mixer has detached
+ * @param deck represents the detached deck
+ * @param tag represents the attachment that was detached
+ *
+ * Skipped if the deck was given another track since, the mixer reads that one
+ */
+
+void AudioSystem::handleStreamDetached(int deck, int tag)
+{
+
+    if (musicDeckUses[deck] != tag || deck == currentMusicDeck) return;
+
+    closeMusicDeck(deck);
+
+}
+
+/**
+ * @brief Stops decoding a deck's track on the music thread
+ */
+
+void AudioSystem::closeMusicDeck(int deck)
+{
+
+    MusicStream *stream = musicStreams[deck];
+    QMetaObject::invokeMethod(stream, [stream]() { stream->close(); });
+
+}
+
+/**
+ * @brief Decodes a sound effect ahead of its first use
+ * @param filePath represents the path to the audio file
+ *
+ * Decodes into the effect bank on its worker thread, effects already loaded are ignored
+ */
+
+void AudioSystem::preloadSoundEffect(const QString &filePath)
+{
+
+    effectsBank->load(filePath);
 
 }
 
 /**
  * @brief Plays a sound effect
  * @param filePath represents the path to the audio file
+ * @param volume represents the gain of this effect, on top of the effects volume
  *
- * Stops any currently playing effect before starting a new playback
+ * Starts on a free mixer voice, so it layers over any effect already playing. An effect that is
+ * not loaded yet is loaded first and starts as soon as it is ready, one too long for the bank is
+ * streamed instead
+ */
+
+void AudioSystem::playSoundEffect(const QString &filePath, float volume)
+{
+
+    SoundEmitter emitter;
+    emitter.source = filePath;
+    emitter.volume = volume;
+    playSoundEffectAt(emitter);
+
+}
+
+/**
+ * @brief Plays a sound effect placed in the scene
+ * @param emitter represents the effect, its position, range and volume
+ *
+ * The mixer pans and attenuates it every block from the listener's position. Effects streamed
+ * because they are too long for the bank play once and unpanned
+ */
+
+void AudioSystem::playSoundEffectAt(const SoundEmitter &emitter)
+{
+
+    ProfileScope scope(ProfileSection::Audio);
+    startEmitter(emitter, -1);
+
+}
+
+/**
+ * @brief Sets the position positional effects are heard from
+ * @param position represents the listener, normally the centre of the player
+ *
+ * Only publishes the position for the mixer thread, cheap enough for every frame
+ */
+
+void AudioSystem::setListenerPosition(const QPointF &position)
+{
+
+    mixer->setListener(float(position.x()), float(position.y()));
+
+}
+
+/**
+ * @brief Replaces the emitters of the current room
+ * @param emitters represents the emitters that play while the player is in the room
+ *
+ * Stops every voice started by the previous call, including looping ones, and drops the ones
+ * still waiting for their effect to load
+ */
+
+void AudioSystem::setRoomEmitters(const QVector<SoundEmitter> &emitters)
+{
+
+    ProfileScope scope(ProfileSection::Audio);
+
+    for (SoundMixer::VoiceId voice : roomVoices) {
+        mixer->stopVoice(voice);
+    }
+    roomVoices.clear();
+    ++roomEmitterUses;
+
+    for (const SoundEmitter &emitter : emitters) {
+        startEmitter(emitter, roomEmitterUses);
+    }
+
+}
+
+/**
+ * @brief Starts an emitter on the mixer, or queues it until its effect is loaded
+ * @param emitter represents the effect
+ * @param room represents the room emitters it belongs to, -1 for a one-off effect
  */
 
-void AudioSystem::playSoundEffect(const QString &filePath)
+void AudioSystem::startEmitter(const SoundEmitter &emitter, int room)
 {
 
-    effectsPlayer->stop();
-    effectsPlayer->setSource(QUrl(filePath));
-    effectsPlayer->play();
+    switch (effectsBank->state(emitter.source)) {
+    case SoundBank::State::Ready: {
+        const SoundClip clip = effectsBank->clip(emitter.source);
+        const SoundMixer::VoiceId voice = emitter.radius > 0.0
+            ? mixer->playAt(clip, float(emitter.position.x()), float(emitter.position.y()), float(emitter.radius),
+                            emitter.volume, emitter.loop)
+            : mixer->play(clip, emitter.volume);
+        if (room >= 0 && voice != 0) {
+            roomVoices.append(voice);
+        }
+        break;
+    }
+    case SoundBank::State::Streamed:
+        streamSoundEffect(emitter.source, emitter.volume);
+        break;
+    case SoundBank::State::Unknown:
+    case SoundBank::State::Decoding: {
+        effectsBank->load(emitter.source);
+        WaitingEffect waiting;
+        waiting.emitter = emitter;
+        waiting.room = room;
+        waitingEffects.insert(emitter.source, waiting);
+        break;
+    }
+    case SoundBank::State::Failed:
+        break;
+    }
 
 }
 
@@ -190,7 +395,11 @@ void AudioSystem::playSoundEffect(const QString &filePath)
 void AudioSystem::stopSoundEffects()
 {
 
-    effectsPlayer->stop();
+    ProfileScope scope(ProfileSection::Audio);
+    mixer->stopAll();
+    streamPlayer->stop();
+    waitingEffects.clear();
+    roomVoices.clear();
 
 }
 
@@ -202,6 +411,67 @@ void AudioSystem::stopSoundEffects()
 void AudioSystem::setEffectsVolume(float volume)
 {
 
-    effectsOutput->setVolume(volume);
+    effectsVolume = volume;
+    mixer->setMasterGain(volume);
+    streamOutput->setVolume(volume);
+
+}
+
+/**
+ * @brief Starts an effect that was played while the bank was still loading it
+ * @param filePath represents the effect
+ * @param state represents how it was loaded
+ */
+
+void AudioSystem::handleEffectLoaded(const QString &filePath, SoundBank::State state)
+{
+
+    const QList<WaitingEffect> waiting = waitingEffects.values(filePath);
+    waitingEffects.remove(filePath);
+
+    if (state != SoundBank::State::Ready && state != SoundBank::State::Streamed) return;
+
+    for (const WaitingEffect &effect : waiting) {
+        // Room emitters of a room the player has left are dropped
+        if (effect.room >= 0 && effect.room != roomEmitterUses) continue;
+        startEmitter(effect.emitter, effect.room);
+    }
+
+}
+
+/**
+ * @brief Plays an effect through the streaming player
+ * @param filePath represents the path to the audio file
+ * @param volume represents the gain of this effect
+ *
+ * The streaming player plays one effect at a time, a new one replaces the last
+ */
+
+void AudioSystem::streamSoundEffect(const QString &filePath, float volume)
+{
+
+    streamPlayer->stop();
+    streamOutput->setVolume(effectsVolume * volume);
+
+    // The player cannot open ":/" paths, resources and the external pack are handed over as a
+    // device like the bank's decoders get them. The URL only tells the backend the file type
+    QIODevice *previous = streamDevice;
+    streamDevice = nullptr;
+    if (AssetPack::isResource(filePath)) {
+        streamDevice = AssetPack::open(filePath, this);
+        if (!streamDevice) {
+            LOG_WARNING("audio", "Sound effect %1 could not be opened", filePath);
+            streamPlayer->setSource(QUrl());
+            delete previous;
+            return;
+        }
+        streamPlayer->setSourceDevice(streamDevice, QUrl(filePath.startsWith(":/") ? "qrc" + filePath : filePath));
+    } else {
+        const QUrl url(filePath);
+        streamPlayer->setSource(url.isRelative() ? QUrl::fromLocalFile(filePath) : url);
+    }
+    delete previous;
+
+    streamPlayer->play();
 
 }
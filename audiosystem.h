@@ -4,7 +4,25 @@
 #include <QObject>
 #include <QMediaPlayer>
 #include <QAudioOutput>
+#include <QHash>
+#include <QPointF>
 #include <QUrl>
+#include <QVector>
+#include "soundbank.h"
+#include "soundmixer.h"
+
+class MusicStream;
+class QIODevice;
+class QThread;
+
+// Sound placed in the scene, heard relative to the listener
+struct SoundEmitter {
+    QString source;
+    QPointF position;
+    qreal radius = 0.0;     // Distance at which it falls silent, 0 plays it unpanned everywhere
+    float volume = 1.0f;
+    bool loop = false;
+};
 
 class AudioSystem : public QObject
 {
@@ -14,30 +32,72 @@ public:
     explicit AudioSystem(QObject *parent = nullptr);
     ~AudioSystem();
 
-    // Background music control
-    void playBackgroundMusic(const QString &filePath, bool loop = true);
+    // Length of the crossfade when one track replaces another
+    static const int kCrossfadeMs = 2000;
+
+    // Background music control, tracks loop without a gap and crossfade into each other
+    void playBackgroundMusic(const QString &filePath, bool loop = true, int crossfadeMs = kCrossfadeMs);
     void pauseBackgroundMusic();
     void resumeBackgroundMusic();
     void stopBackgroundMusic();
     void setBackgroundVolume(float volume);
 
-    // Sound effects control
-    void playSoundEffect(const QString &filePath);
+    // Sound effects control, effects are decoded once and mixed so they can overlap
+    void preloadSoundEffect(const QString &filePath);
+    void playSoundEffect(const QString &filePath, float volume = 1.0f);
     void stopSoundEffects();
     void setEffectsVolume(float volume);
 
-private slots:
-    void handleBackgroundMusicStateChange(QMediaPlayer::PlaybackState state);
+    // Positional effects, panned and attenuated by the mixer from the listener's position
+    void playSoundEffectAt(const SoundEmitter &emitter);
+    void setListenerPosition(const QPointF &position);
+
+    // Replaces the emitters of the current room, stopping the previous room's
+    void setRoomEmitters(const QVector<SoundEmitter> &emitters);
 
 private:
-    QMediaPlayer *backgroundPlayer;
-    QAudioOutput *backgroundOutput;
+    // Fades a deck out, its stream is closed once the mixer has let go of it
+    void fadeOutMusicDeck(int deck, int fadeMs);
+
+    // Closes a deck's stream the mixer detached, unless the deck was reused meanwhile
+    void handleStreamDetached(int deck, int tag);
+    void closeMusicDeck(int deck);
+
+    // Music decks, streamed on their own thread and mixed by the mixer
+    QThread *musicThread;
+    QObject *musicContext;          // Lives on the music thread
+    MusicStream *musicStreams[SoundMixer::kMusicDecks];
+    int musicDeckUses[SoundMixer::kMusicDecks] = {};   // Tags the decks' streams are attached with
+    int currentMusicDeck = -1;      // -1 while no music plays
+    bool musicPaused = false;
+
+    // Effect played before the bank finished loading it
+    struct WaitingEffect {
+        SoundEmitter emitter;
+        int room = -1;      // Room emitters: the room it belongs to, see roomEmitterUses
+    };
+
+    // Plays effects that were played before the bank finished loading them
+    void handleEffectLoaded(const QString &filePath, SoundBank::State state);
+
+    // Starts an emitter, or queues it until its effect is loaded
+    void startEmitter(const SoundEmitter &emitter, int room);
+
+    // Plays an effect too long for the bank through the streaming player
+    void streamSoundEffect(const QString &filePath, float volume);
+
+    SoundMixer *mixer;
+    SoundBank *effectsBank;
+    QMultiHash<QString, WaitingEffect> waitingEffects;
+    QVector<SoundMixer::VoiceId> roomVoices;    // Voices of the current room's emitters
+    int roomEmitterUses = 0;                    // Counts setRoomEmitters() calls
 
-    QMediaPlayer *effectsPlayer;
-    QAudioOutput *effectsOutput;
+    QMediaPlayer *streamPlayer;
+    QAudioOutput *streamOutput;
+    QIODevice *streamDevice = nullptr; // Resource the streaming player reads, null for files
+    float effectsVolume = 0.7f;
     QString currentBackgroundMusic; // Track current music file
 
-    bool shouldLoop = true;        // Loop control flag
     void initializePlayers();
 };
 
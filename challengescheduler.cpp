@@ -0,0 +1,194 @@
+/**
+ * @file challengescheduler.cpp
+ * @brief Implementation of the ChallengeScheduler class
+ * @author Steph Oh, Kiet Tran
+ */
+
+#include "challengescheduler.h"
+#include <QtMath>
+
+/**
+ * @brief Constructs a ChallengeScheduler with the default phrases
+ * @param seed represents the seed of the phrase sequence
+ * @param parent represents the parent QObject
+ *
+ * Defaults to a challenge every 30 seconds with 10 seconds to type it
+ */
+
+ChallengeScheduler::ChallengeScheduler(quint32 seed, QObject *parent)
+    : QObject(parent)
+    , m_random(seed)
+    , m_seed(seed)
+    , m_interval(30000)
+    , m_timeLimit(10000)
+    , m_damage(20)
+    , m_running(false)
+    , m_active(false)
+    , m_elapsed(0.0)
+    , m_lastCountdown(-1)
+    , m_passed(0)
+    , m_failed(0)
+{
+
+    m_phrases << "she sells seashells by the seashore"
+              << "peter piper picked a peck of peppers"
+              << "red lorry yellow lorry red lorry"
+              << "black bug bit a big black bear"
+              << "fred fed ted bread and ted fed fred"
+              << "how can a clam cram in a clean can"
+              << "six slippery snails slid slowly seaward"
+              << "truly rural truly rural truly rural"
+              << "brisk brave brigadiers brandish blades"
+              << "four fine fresh fish for you";
+
+}
+
+/**
+ * @brief Restarts the phrase sequence from a seed
+ */
+
+void ChallengeScheduler::setSeed(quint32 seed)
+{
+
+    m_seed = seed;
+    m_random.seed(seed);
+
+}
+
+/**
+ * @brief Starts waiting for the first challenge
+ *
+ * Begins a new session: the passed and failed counts and the last phrase are cleared, so a
+ * scheduler restarted with the same seed replays the same session
+ */
+
+void ChallengeScheduler::start()
+{
+
+    m_running = true;
+    m_active = false;
+    m_elapsed = 0.0;
+    m_lastCountdown = -1;
+    m_currentChallenge.clear();
+    m_passed = 0;
+    m_failed = 0;
+
+}
+
+/**
+ * @brief Stops the scheduler and drops the active challenge
+ */
+
+void ChallengeScheduler::stop()
+{
+
+    m_running = false;
+    m_active = false;
+    m_elapsed = 0.0;
+
+}
+
+/**
+ * @brief Moves the challenge clock forward
+ * @param dt represents the elapsed simulation time in seconds
+ *
+ * Starts a challenge once the interval has passed and fails it once its time limit has passed
+ */
+
+void ChallengeScheduler::advance(qreal dt)
+{
+
+    if (!m_running) return;
+
+    m_elapsed += dt;
+
+    if (!m_active) {
+        if (m_elapsed * 1000.0 >= m_interval) {
+            begin();
+        }
+        return;
+    }
+
+    if (m_elapsed * 1000.0 >= m_timeLimit) {
+        ++m_failed;
+        finish();
+        emit challengeFailed();
+        return;
+    }
+
+    const int seconds = secondsRemaining();
+    if (seconds != m_lastCountdown) {
+        m_lastCountdown = seconds;
+        emit countdownChanged(seconds);
+    }
+
+}
+
+/**
+ * @brief Checks typed input against the active challenge
+ * @param input represents the typed text, compared case insensitively
+ * @return true if the challenge was passed
+ */
+
+bool ChallengeScheduler::submit(const QString &input)
+{
+
+    emit inputSubmitted(input);
+
+    if (!m_active) return false;
+
+    if (input.toLower().trimmed() != m_currentChallenge.toLower().trimmed()) {
+        return false;
+    }
+
+    ++m_passed;
+    finish();
+    emit challengePassed();
+    return true;
+
+}
+
+/**
+ * @brief Returns the whole seconds left for the active challenge
+ */
+
+int ChallengeScheduler::secondsRemaining() const
+{
+
+    if (!m_active) return 0;
+
+    return qMax(0, qCeil((m_timeLimit - m_elapsed * 1000.0) / 1000.0));
+
+}
+
+/**
+ * @brief Starts a challenge with a phrase drawn from the seeded generator
+ */
+
+void ChallengeScheduler::begin()
+{
+
+    m_currentChallenge = m_phrases.isEmpty()
+                             ? QStringLiteral("please type this phrase")
+                             : m_phrases.at(m_random.bounded(m_phrases.size()));
+    m_active = true;
+    m_elapsed = 0.0;
+    m_lastCountdown = secondsRemaining();
+
+    emit challengeStarted(m_currentChallenge);
+    emit countdownChanged(m_lastCountdown);
+
+}
+
+/**
+ * @brief Ends the active challenge and waits for the next one
+ */
+
+void ChallengeScheduler::finish()
+{
+
+    m_active = false;
+    m_elapsed = 0.0;
+    m_lastCountdown = -1;
+
+}
@@ -0,0 +1,106 @@
+/**
+ * @file challengescheduler.h
+ * @brief Timing and checking of typed challenges, driven by simulation time
+ * @author Steph Oh, Kiet Tran
+ */
+
+#ifndef CHALLENGESCHEDULER_H
+#define CHALLENGESCHEDULER_H
+
+#include <QObject>
+#include <QRandomGenerator>
+#include <QStringList>
+
+/**
+ * @brief Decides when a challenge starts, which phrase it asks for and whether it was passed
+ *
+ * Holds no timers and no widgets: time only moves when advance() is called from the game loop's
+ * tick, and phrases are drawn from a seeded generator. The same seed and the same submissions at
+ * the same ticks therefore give the same challenges, in the game and in a headless replay
+ */
+
+class ChallengeScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ChallengeScheduler(quint32 seed = 0, QObject *parent = nullptr);
+
+    // Restarts the phrase sequence from a seed
+    void setSeed(quint32 seed);
+    quint32 seed() const { return m_seed; }
+
+    // Phrases a challenge is picked from
+    void setPhrases(const QStringList &phrases) { m_phrases = phrases; }
+    QStringList phrases() const { return m_phrases; }
+
+    // Time between challenges (milliseconds)
+    void setInterval(int ms) { m_interval = ms; }
+    int interval() const { return m_interval; }
+
+    // Time allowed for a challenge (milliseconds)
+    void setTimeLimit(int ms) { m_timeLimit = ms; }
+    int timeLimit() const { return m_timeLimit; }
+
+    // Health points lost on a failed challenge
+    int damage() const { return m_damage; }
+
+    // Start a new session, clearing the counts, or stop and drop the active one
+    void start();
+    void stop();
+    bool isRunning() const { return m_running; }
+
+    // Moves the challenge clock forward by dt seconds
+    void advance(qreal dt);
+
+    // Checks typed input against the active challenge, true if it matched
+    bool submit(const QString &input);
+
+    bool isActive() const { return m_active; }
+    QString currentChallenge() const { return m_currentChallenge; }
+
+    // Whole seconds left for the active challenge
+    int secondsRemaining() const;
+
+    int passedCount() const { return m_passed; }
+    int failedCount() const { return m_failed; }
+
+signals:
+    // A challenge asking for phrase has started
+    void challengeStarted(const QString &phrase);
+
+    // The whole seconds left for the active challenge changed
+    void countdownChanged(int seconds);
+
+    void challengePassed();
+    void challengeFailed();
+
+    // Input was submitted, whether or not it matched (used to record input logs)
+    void inputSubmitted(const QString &input);
+
+private:
+    // Starts a challenge with a new phrase
+    void begin();
+
+    // Ends the active challenge and waits for the next one
+    void finish();
+
+    QRandomGenerator m_random;
+    quint32 m_seed;
+    QStringList m_phrases;
+
+    int m_interval;
+    int m_timeLimit;
+    int m_damage;
+
+    bool m_running;
+    bool m_active;
+    qreal m_elapsed;  // Seconds since the last challenge ended, or since the active one started
+    int m_lastCountdown;
+
+    QString m_currentChallenge;
+    int m_passed;
+    int m_failed;
+};
+
+#endif // CHALLENGESCHEDULER_H
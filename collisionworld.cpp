@@ -0,0 +1,289 @@
+/**
+ * @file collisionworld.cpp
+ * @brief Implementation of the CollisionWorld class
+ * @author Kiet Tran
+ */
+
+#include "collisionworld.h"
+#include <QtGlobal>
+#include <cmath>
+
+/**
+ * @brief Constructs an empty CollisionWorld
+ * @param cellSize represents the edge length of a grid cell in scene units
+ */
+
+CollisionWorld::CollisionWorld(qreal cellSize)
+    : m_cellSize(cellSize > 0 ? cellSize : 64.0)
+    , m_originX(0)
+    , m_originY(0)
+    , m_columns(0)
+    , m_rows(0)
+{
+
+}
+
+/**
+ * @brief Removes every wall and empties the grid
+ */
+
+void CollisionWorld::clear()
+{
+
+    m_walls.clear();
+    m_cellStart.clear();
+    m_cellWalls.clear();
+    m_columns = 0;
+    m_rows = 0;
+
+}
+
+/**
+ * @brief Adds a static wall
+ * @param rect represents the wall bounds in scene coordinates
+ */
+
+void CollisionWorld::addWall(const QRectF &rect)
+{
+
+    if (rect.isEmpty()) return;
+
+    m_walls.append(toAabb(rect.normalized()));
+
+}
+
+/**
+ * @brief Returns the bounds of a wall
+ * @param index represents the wall index
+ */
+
+QRectF CollisionWorld::wall(int index) const
+{
+
+    const Aabb &w = m_walls.at(index);
+    return QRectF(QPointF(w.left, w.top), QPointF(w.right, w.bottom));
+
+}
+
+/**
+ * @brief Buckets the walls into the uniform grid
+ *
+ * Uses a counting pass followed by a fill pass so every cell list lives in one flat array
+ */
+
+void CollisionWorld::build()
+{
+
+    m_cellStart.clear();
+    m_cellWalls.clear();
+    m_columns = 0;
+    m_rows = 0;
+
+    if (m_walls.isEmpty()) return;
+
+    // Grid covers the union of all walls
+    Aabb bounds = m_walls.first();
+    for (const Aabb &w : m_walls) {
+        bounds.left = qMin(bounds.left, w.left);
+        bounds.top = qMin(bounds.top, w.top);
+        bounds.right = qMax(bounds.right, w.right);
+        bounds.bottom = qMax(bounds.bottom, w.bottom);
+    }
+
+    m_originX = bounds.left;
+    m_originY = bounds.top;
+    m_columns = qMax(1, int(std::ceil((bounds.right - bounds.left) / m_cellSize)));
+    m_rows = qMax(1, int(std::ceil((bounds.bottom - bounds.top) / m_cellSize)));
+
+    // Counts the walls per cell
+    QVector<int> counts(m_columns * m_rows, 0);
+    CellRange range;
+    for (const Aabb &w : m_walls) {
+        if (!cellRange(w, range)) continue;
+        for (int y = range.y0; y <= range.y1; ++y) {
+            for (int x = range.x0; x <= range.x1; ++x) {
+                ++counts[y * m_columns + x];
+            }
+        }
+    }
+
+    // Turns the counts into start offsets
+    m_cellStart.resize(m_columns * m_rows + 1);
+    m_cellStart[0] = 0;
+    for (int i = 0; i < counts.size(); ++i) {
+        m_cellStart[i + 1] = m_cellStart[i] + counts[i];
+    }
+
+    // Fills the cell lists
+    m_cellWalls.resize(m_cellStart.last());
+    QVector<int> cursor = m_cellStart;
+    for (int i = 0; i < m_walls.size(); ++i) {
+        if (!cellRange(m_walls[i], range)) continue;
+        for (int y = range.y0; y <= range.y1; ++y) {
+            for (int x = range.x0; x <= range.x1; ++x) {
+                m_cellWalls[cursor[y * m_columns + x]++] = i;
+            }
+        }
+    }
+
+}
+
+/**
+ * @brief Checks a box against the walls
+ * @param box represents the box in scene coordinates
+ * @return true on the first wall the box overlaps and false otherwise
+ */
+
+bool CollisionWorld::intersects(const QRectF &box) const
+{
+
+    const Aabb b = toAabb(box);
+    CellRange range;
+    if (!cellRange(b, range)) return false;
+
+    for (int y = range.y0; y <= range.y1; ++y) {
+        for (int x = range.x0; x <= range.x1; ++x) {
+            const int cell = y * m_columns + x;
+            for (int i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i) {
+                const Aabb &w = m_walls[m_cellWalls[i]];
+                if (b.left < w.right && b.right > w.left && b.top < w.bottom && b.bottom > w.top) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+
+}
+
+/**
+ * @brief Sweeps a box and resolves the movement against the walls
+ * @param box represents the box at its current position
+ * @param delta represents the desired movement
+ * @return Returns the movement that can be applied without entering a wall
+ *
+ * The horizontal axis is resolved first and the vertical sweep starts from the resolved
+ * horizontal position, so a diagonal move into a wall keeps its free component
+ */
+
+QPointF CollisionWorld::sweep(const QRectF &box, const QPointF &delta) const
+{
+
+    Aabb b = toAabb(box);
+
+    const qreal dx = sweepAxis(b, delta.x(), true);
+    b.left += dx;
+    b.right += dx;
+
+    const qreal dy = sweepAxis(b, delta.y(), false);
+
+    return QPointF(dx, dy);
+
+}
+
+/**
+ * @brief Returns the largest movement along one axis that does not enter a wall
+ * @param box represents the box before moving
+ * @param delta represents the desired movement along the axis
+ * @param horizontal represents whether the x axis (true) or y axis (false) is swept
+ *
+ * Walls the box already overlaps are ignored so a stuck box can always move out
+ */
+
+qreal CollisionWorld::sweepAxis(const Aabb &box, qreal delta, bool horizontal) const
+{
+
+    if (delta == 0) return 0;
+
+    // Region covered by the box over the whole movement
+    Aabb swept = box;
+    if (horizontal) {
+        if (delta > 0) swept.right += delta; else swept.left += delta;
+    } else {
+        if (delta > 0) swept.bottom += delta; else swept.top += delta;
+    }
+
+    CellRange range;
+    if (!cellRange(swept, range)) return delta;
+
+    qreal allowed = delta;
+    for (int y = range.y0; y <= range.y1; ++y) {
+        for (int x = range.x0; x <= range.x1; ++x) {
+            const int cell = y * m_columns + x;
+            for (int i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i) {
+                const Aabb &w = m_walls[m_cellWalls[i]];
+
+                if (horizontal) {
+                    // Only walls sharing the vertical band can block a horizontal move
+                    if (box.top >= w.bottom || box.bottom <= w.top) continue;
+                    if (allowed > 0 && box.right <= w.left) {
+                        allowed = qMin(allowed, w.left - box.right);
+                    } else if (allowed < 0 && box.left >= w.right) {
+                        allowed = qMax(allowed, w.right - box.left);
+                    }
+                } else {
+                    // Only walls sharing the horizontal band can block a vertical move
+                    if (box.left >= w.right || box.right <= w.left) continue;
+                    if (allowed > 0 && box.bottom <= w.top) {
+                        allowed = qMin(allowed, w.top - box.bottom);
+                    } else if (allowed < 0 && box.top >= w.bottom) {
+                        allowed = qMax(allowed, w.bottom - box.top);
+                    }
+                }
+
+                // Already flush against a wall, nothing left to test
+                if (allowed == 0) return 0;
+            }
+        }
+    }
+
+    return allowed;
+
+}
+
+/**
+ * @brief Returns the grid cells covered by a box
+ * @param box represents the box in scene coordinates
+ * @param range receives the inclusive cell range, clamped to the grid
+ * @return false if the box lies completely outside the grid
+ */
+
+bool CollisionWorld::cellRange(const Aabb &box, CellRange &range) const
+{
+
+    if (m_columns == 0 || m_rows == 0) return false;
+
+    range.x0 = int(std::floor((box.left - m_originX) / m_cellSize));
+    range.y0 = int(std::floor((box.top - m_originY) / m_cellSize));
+    range.x1 = int(std::floor((box.right - m_originX) / m_cellSize));
+    range.y1 = int(std::floor((box.bottom - m_originY) / m_cellSize));
+
+    if (range.x1 < 0 || range.y1 < 0 || range.x0 >= m_columns || range.y0 >= m_rows) {
+        return false;
+    }
+
+    range.x0 = qMax(0, range.x0);
+    range.y0 = qMax(0, range.y0);
+    range.x1 = qMin(m_columns - 1, range.x1);
+    range.y1 = qMin(m_rows - 1, range.y1);
+
+    return true;
+
+}
+
+/**
+ * @brief Converts a rectangle into a compact box
+ */
+
+CollisionWorld::Aabb CollisionWorld::toAabb(const QRectF &rect)
+{
+
+    Aabb box;
+    box.left = rect.left();
+    box.top = rect.top();
+    box.right = rect.right();
+    box.bottom = rect.bottom();
+    return box;
+
+}
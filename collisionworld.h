@@ -0,0 +1,93 @@
+/**
+ * @file collisionworld.h
+ * @brief Static collision geometry stored in a uniform grid
+ * @author Kiet Tran
+ */
+
+#ifndef COLLISIONWORLD_H
+#define COLLISIONWORLD_H
+
+#include <QRectF>
+#include <QPointF>
+#include <QVector>
+
+/**
+ * @brief Holds the static walls of a room and answers box queries against them
+ *
+ * Walls are kept in a compact array of axis aligned boxes and bucketed into a uniform grid
+ * stored as flat offset and index arrays. Queries only visit the cells a box touches, never
+ * allocate and stop at the first hit. Boxes that merely touch a wall do not collide, so a
+ * player standing against a wall can still slide along it
+ */
+
+class CollisionWorld
+{
+public:
+    explicit CollisionWorld(qreal cellSize = 64.0);
+
+    // Removes every wall
+    void clear();
+
+    // Adds a static wall, build() must be called before querying again
+    void addWall(const QRectF &rect);
+
+    // Buckets the walls into the grid
+    void build();
+
+    // Number of walls
+    int wallCount() const { return m_walls.size(); }
+
+    // Returns the bounds of a wall
+    QRectF wall(int index) const;
+
+    // Returns true if the box overlaps any wall
+    bool intersects(const QRectF &box) const;
+
+    // Sweeps the box by delta and returns the part of the movement that is free,
+    // resolved per axis so a blocked axis slides along the wall
+    QPointF sweep(const QRectF &box, const QPointF &delta) const;
+
+private:
+    // Compact axis aligned box
+    struct Aabb {
+        qreal left;
+        qreal top;
+        qreal right;
+        qreal bottom;
+    };
+
+    // Range of grid cells covered by a box
+    struct CellRange {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+
+    // Returns the cells covered by a box, false if it lies outside the grid
+    bool cellRange(const Aabb &box, CellRange &range) const;
+
+    // Returns the largest movement along one axis that does not enter a wall
+    qreal sweepAxis(const Aabb &box, qreal delta, bool horizontal) const;
+
+    static Aabb toAabb(const QRectF &rect);
+
+    qreal m_cellSize;
+
+    // Grid origin and size in cells
+    qreal m_originX;
+    qreal m_originY;
+    int m_columns;
+    int m_rows;
+
+    // Wall boxes
+    QVector<Aabb> m_walls;
+
+    // Per cell start offsets into m_cellWalls (size columns * rows + 1)
+    QVector<int> m_cellStart;
+
+    // Wall indices of all cells, laid out cell after cell
+    QVector<int> m_cellWalls;
+};
+
+#endif // COLLISIONWORLD_H
@@ -0,0 +1,164 @@
+/**
+ * @file dspbenchmark.cpp
+ * @brief Implementation of the DspBenchmark class
+ * @author Kiet Tran, Steph Oh
+ */
+
+#include "dspbenchmark.h"
+#include "dspkernels.h"
+#include "mfcc.h"
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QVector>
+#include <QtMath>
+
+namespace {
+
+// Keeps the optimiser from dropping kernel calls whose results are otherwise unused
+volatile quint64 g_sink = 0;
+
+// Fills a buffer with a noisy tone, loud enough to exercise every kernel
+QVector<qint16> makeSignal(int count)
+{
+
+    QVector<qint16> samples(count);
+    QRandomGenerator random(1234);
+
+    for (int i = 0; i < count; ++i) {
+        const qreal tone = std::sin(i * 0.07) * 8000.0;
+        const qreal noise = random.bounded(-2000, 2000);
+        samples[i] = qint16(tone + noise);
+    }
+
+    return samples;
+
+}
+
+// Hann window of a frame
+QVector<float> makeWindow(int count)
+{
+
+    QVector<float> window(count);
+    for (int i = 0; i < count; ++i) {
+        window[i] = float(0.5 - 0.5 * std::cos(2.0 * M_PI * i / qMax(1, count - 1)));
+    }
+
+    return window;
+
+}
+
+}
+
+/**
+ * @brief Handles the --bench-dsp command line
+ * @param arguments represents the application arguments
+ * @return Returns 0 on success and 2 if a path disagreed with the scalar kernels
+ *
+ * Splits --seconds of 16 kHz audio into --frame sample frames and runs each kernel over all of
+ * them --repeat times per path, then streams the same audio through the MFCC frontend in 20 ms
+ * hops and compares its speed with the real time rate
+ */
+
+int DspBenchmark::runFromCommandLine(const QStringList &arguments)
+{
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the throughput of the DSP kernels");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("bench-dsp", "Run the DSP kernel benchmark."));
+    parser.addOption(QCommandLineOption("frame", "Samples per analysed frame.", "samples", "512"));
+    parser.addOption(QCommandLineOption("seconds", "Seconds of 16 kHz audio per pass.", "seconds", "60"));
+    parser.addOption(QCommandLineOption("repeat", "Passes over the audio per kernel.", "count", "10"));
+    parser.process(arguments);
+
+    const int frame = qBound(16, parser.value("frame").toInt(), 1 << 16);
+    const int frames = qMax(1, parser.value("seconds").toInt() * 16000 / frame);
+    const int repeat = qMax(1, parser.value("repeat").toInt());
+
+    const QVector<qint16> signal = makeSignal(frames * frame);
+    const QVector<float> window = makeWindow(frame);
+    const DspKernels &scalar = *Dsp::kernelsFor(DspPath::Scalar);
+
+    out << "DSP kernels over " << frames << " frames of " << frame << " samples, " << repeat
+        << " pass(es), dispatch picks " << Dsp::pathName(Dsp::kernels().path) << '\n';
+
+    const char *kernelNames[] = { "rms", "peak", "zero crossings", "windowed energy" };
+    const DspPath paths[] = { DspPath::Scalar, DspPath::Sse2, DspPath::Avx2 };
+    bool mismatch = false;
+
+    for (DspPath path : paths) {
+        const DspKernels *kernels = Dsp::kernelsFor(path);
+        if (!kernels) {
+            out << "  " << Dsp::pathName(path) << ": not supported\n";
+            continue;
+        }
+
+        for (int kernel = 0; kernel < 4; ++kernel) {
+            QElapsedTimer timer;
+            timer.start();
+
+            for (int pass = 0; pass < repeat; ++pass) {
+                for (int f = 0; f < frames; ++f) {
+                    const qint16 *samples = signal.constData() + f * frame;
+                    switch (kernel) {
+                    case 0: g_sink = g_sink + kernels->sumOfSquares(samples, frame); break;
+                    case 1: g_sink = g_sink + kernels->peak(samples, frame); break;
+                    case 2: g_sink = g_sink + kernels->zeroCrossings(samples, frame); break;
+                    case 3: g_sink = g_sink + quint64(kernels->windowedEnergy(samples, window.constData(), frame)); break;
+                    }
+                }
+            }
+
+            const qreal seconds = qMax<qint64>(1, timer.nsecsElapsed()) / 1e9;
+            const qreal samplesPerSecond = qreal(frames) * frame * repeat / seconds;
+            out << "  " << Dsp::pathName(path) << ' ' << kernelNames[kernel] << ": "
+                << QString::number(samplesPerSecond / 1e6, 'f', 1) << " Msamples/s\n";
+        }
+
+        // Every path must agree with the scalar reference on the first frame
+        const qint16 *samples = signal.constData();
+        const float energy = kernels->windowedEnergy(samples, window.constData(), frame);
+        const float reference = scalar.windowedEnergy(samples, window.constData(), frame);
+        if (kernels->sumOfSquares(samples, frame) != scalar.sumOfSquares(samples, frame)
+            || kernels->peak(samples, frame) != scalar.peak(samples, frame)
+            || kernels->zeroCrossings(samples, frame) != scalar.zeroCrossings(samples, frame)
+            || std::fabs(energy - reference) > 1e-4f * reference) {
+            err << Dsp::pathName(path) << " results differ from the scalar kernels" << Qt::endl;
+            mismatch = true;
+        }
+    }
+
+    // Streaming features, fed in the hops the microphone's analysis thread produces
+    MfccStream stream(16000);
+    const int hop = 320;
+    const int maxFrames = hop / stream.extractor().hopSize() + 1;
+    QVector<float> coefficients(maxFrames * MfccExtractor::kCoefficientCount);
+    QVector<float> logMel(maxFrames * MfccExtractor::kFilterCount);
+    quint64 features = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int pass = 0; pass < repeat; ++pass) {
+        stream.reset();
+        for (int offset = 0; offset + hop <= signal.size(); offset += hop) {
+            features += stream.process(signal.constData() + offset, hop, coefficients.data(), maxFrames, logMel.data());
+        }
+    }
+
+    const qreal seconds = qMax<qint64>(1, timer.nsecsElapsed()) / 1e9;
+    const qreal audioSeconds = qreal(signal.size()) * repeat / 16000.0;
+    out << "  mfcc stream: " << QString::number(features / seconds / 1e3, 'f', 1) << " kframes/s, "
+        << QString::number(audioSeconds / seconds, 'f', 0) << "x real time\n";
+
+    out.flush();
+
+    return mismatch ? 2 : 0;
+
+}
@@ -0,0 +1,26 @@
+/**
+ * @file dspbenchmark.h
+ * @brief Command line microbenchmark of the DSP kernels
+ * @author Kiet Tran, Steph Oh
+ */
+
+#ifndef DSPBENCHMARK_H
+#define DSPBENCHMARK_H
+
+#include <QStringList>
+
+/**
+ * @brief Times every kernel on every path this CPU supports, and the MFCC frontend
+ *
+ * Runs on synthetic microphone-like frames, checks each path against the scalar results and
+ * prints the throughput in samples per second, so builds and machines can be compared
+ */
+
+class DspBenchmark
+{
+public:
+    // Handles the --bench-dsp command line, returns the process exit code
+    static int runFromCommandLine(const QStringList &arguments);
+};
+
+#endif // DSPBENCHMARK_H
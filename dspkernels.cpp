@@ -0,0 +1,420 @@
+/**
+ * @file dspkernels.cpp
+ * @brief Scalar, SSE2 and AVX2 implementations of the DSP kernels
+ * @author Kiet Tran, Steph Oh
+ */
+
+#include "dspkernels.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DSP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DSP_TARGET_SSE2
+#define DSP_TARGET_AVX2
+#else
+#define DSP_TARGET_SSE2 __attribute__((target("sse2")))
+#define DSP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+// Counts the set bits without relying on the POPCNT instruction
+inline int bitCount(quint32 value)
+{
+
+    value = value - ((value >> 1) & 0x55555555u);
+    value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+    value = (value + (value >> 4)) & 0x0F0F0F0Fu;
+    return int((value * 0x01010101u) >> 24);
+
+}
+
+quint64 sumOfSquaresScalar(const qint16 *samples, int count)
+{
+
+    quint64 sum = 0;
+    for (int i = 0; i < count; ++i) {
+        sum += quint64(qint32(samples[i]) * samples[i]);
+    }
+
+    return sum;
+
+}
+
+int peakScalar(const qint16 *samples, int count)
+{
+
+    int peak = 0;
+    for (int i = 0; i < count; ++i) {
+        peak = qMax(peak, qAbs(int(samples[i])));
+    }
+
+    return peak;
+
+}
+
+int zeroCrossingsScalar(const qint16 *samples, int count)
+{
+
+    int crossings = 0;
+    for (int i = 1; i < count; ++i) {
+        crossings += (samples[i - 1] < 0) != (samples[i] < 0);
+    }
+
+    return crossings;
+
+}
+
+float windowedEnergyScalar(const qint16 *samples, const float *window, int count)
+{
+
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        const float value = samples[i] * window[i];
+        sum += value * value;
+    }
+
+    return sum;
+
+}
+
+const DspKernels kScalarKernels = {
+    DspPath::Scalar, sumOfSquaresScalar, peakScalar, zeroCrossingsScalar, windowedEnergyScalar
+};
+
+#ifdef DSP_X86
+
+// The pairwise sums of _mm_madd_epi16 are never negative but reach 2^31 for two -32768 samples,
+// so they are widened to 64 bits as unsigned values
+
+DSP_TARGET_SSE2 quint64 sumOfSquaresSse2(const qint16 *samples, int count)
+{
+
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        const __m128i squares = _mm_madd_epi16(v, v);
+        sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(squares, zero));
+        sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(squares, zero));
+    }
+
+    quint64 lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), sum);
+
+    return lanes[0] + lanes[1] + sumOfSquaresScalar(samples + i, count - i);
+
+}
+
+DSP_TARGET_SSE2 int peakSse2(const qint16 *samples, int count)
+{
+
+    __m128i high = _mm_setzero_si128();
+    __m128i low = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        high = _mm_max_epi16(high, v);
+        low = _mm_min_epi16(low, v);
+    }
+
+    qint16 highs[8];
+    qint16 lows[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(highs), high);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lows), low);
+
+    int peak = peakScalar(samples + i, count - i);
+    for (int lane = 0; lane < 8; ++lane) {
+        peak = qMax(peak, qMax(int(highs[lane]), -int(lows[lane])));
+    }
+
+    return peak;
+
+}
+
+DSP_TARGET_SSE2 int zeroCrossingsSse2(const qint16 *samples, int count)
+{
+
+    const __m128i zero = _mm_setzero_si128();
+    int crossings = 0;
+
+    // Compares samples i..i+7 with i+1..i+8, the sign bit of the xor marks a crossing
+    int i = 0;
+    for (; i + 9 <= count; i += 8) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i + 1));
+        const __m128i signs = _mm_srai_epi16(_mm_xor_si128(a, b), 15);
+        crossings += bitCount(quint32(_mm_movemask_epi8(_mm_packs_epi16(signs, zero))));
+    }
+
+    return crossings + zeroCrossingsScalar(samples + i, count - i);
+
+}
+
+DSP_TARGET_SSE2 float windowedEnergySse2(const qint16 *samples, const float *window, int count)
+{
+
+    __m128 sum = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        const __m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+        const __m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+        const __m128 a = _mm_mul_ps(low, _mm_loadu_ps(window + i));
+        const __m128 b = _mm_mul_ps(high, _mm_loadu_ps(window + i + 4));
+        sum = _mm_add_ps(sum, _mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3]
+        + windowedEnergyScalar(samples + i, window + i, count - i);
+
+}
+
+DSP_TARGET_AVX2 quint64 sumOfSquaresAvx2(const qint16 *samples, int count)
+{
+
+    __m256i sum = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+        const __m256i squares = _mm256_madd_epi16(v, v);
+        sum = _mm256_add_epi64(sum, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(squares)));
+        sum = _mm256_add_epi64(sum, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(squares, 1)));
+    }
+
+    quint64 lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), sum);
+
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumOfSquaresScalar(samples + i, count - i);
+
+}
+
+DSP_TARGET_AVX2 int peakAvx2(const qint16 *samples, int count)
+{
+
+    __m256i high = _mm256_setzero_si256();
+    __m256i low = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+        high = _mm256_max_epi16(high, v);
+        low = _mm256_min_epi16(low, v);
+    }
+
+    qint16 highs[16];
+    qint16 lows[16];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(highs), high);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lows), low);
+
+    int peak = peakScalar(samples + i, count - i);
+    for (int lane = 0; lane < 16; ++lane) {
+        peak = qMax(peak, qMax(int(highs[lane]), -int(lows[lane])));
+    }
+
+    return peak;
+
+}
+
+DSP_TARGET_AVX2 int zeroCrossingsAvx2(const qint16 *samples, int count)
+{
+
+    int crossings = 0;
+
+    // Every crossing sets both bytes of its lane in the mask, hence the halving
+    int i = 0;
+    for (; i + 17 <= count; i += 16) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i + 1));
+        const __m256i signs = _mm256_srai_epi16(_mm256_xor_si256(a, b), 15);
+        crossings += bitCount(quint32(_mm256_movemask_epi8(signs))) / 2;
+    }
+
+    return crossings + zeroCrossingsScalar(samples + i, count - i);
+
+}
+
+DSP_TARGET_AVX2 float windowedEnergyAvx2(const qint16 *samples, const float *window, int count)
+{
+
+    __m256 sum = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i + 8));
+        const __m256 a = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(low)), _mm256_loadu_ps(window + i));
+        const __m256 b = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(high)), _mm256_loadu_ps(window + i + 8));
+        sum = _mm256_add_ps(sum, _mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)));
+    }
+
+    float lanes[8];
+    _mm256_storeu_ps(lanes, sum);
+
+    float total = 0.0f;
+    for (int lane = 0; lane < 8; ++lane) {
+        total += lanes[lane];
+    }
+
+    return total + windowedEnergyScalar(samples + i, window + i, count - i);
+
+}
+
+const DspKernels kSse2Kernels = {
+    DspPath::Sse2, sumOfSquaresSse2, peakSse2, zeroCrossingsSse2, windowedEnergySse2
+};
+
+const DspKernels kAvx2Kernels = {
+    DspPath::Avx2, sumOfSquaresAvx2, peakAvx2, zeroCrossingsAvx2, windowedEnergyAvx2
+};
+
+// Asks the CPU (and, for AVX2, the OS saving the ymm registers) which paths can run
+bool cpuSupports(DspPath path)
+{
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osAvx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osAvx) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    switch (path) {
+    case DspPath::Scalar:
+        return true;
+    case DspPath::Sse2:
+        return sse2;
+    case DspPath::Avx2:
+        return avx2;
+    }
+
+    return false;
+
+}
+
+#endif
+
+}
+
+/**
+ * @brief Returns the fastest kernel table this CPU supports
+ *
+ * Detection runs once, every later call returns the cached table
+ */
+
+const DspKernels &Dsp::kernels()
+{
+
+    static const DspKernels *best = []() {
+        const DspKernels *avx2 = kernelsFor(DspPath::Avx2);
+        if (avx2) return avx2;
+
+        const DspKernels *sse2 = kernelsFor(DspPath::Sse2);
+        return sse2 ? sse2 : &kScalarKernels;
+    }();
+
+    return *best;
+
+}
+
+/**
+ * @brief Returns the kernel table of a path
+ * @param path represents the instruction set
+ * @return Returns nullptr if the build or the CPU cannot run the path
+ */
+
+const DspKernels *Dsp::kernelsFor(DspPath path)
+{
+
+    switch (path) {
+    case DspPath::Scalar:
+        return &kScalarKernels;
+#ifdef DSP_X86
+    case DspPath::Sse2:
+        return cpuSupports(path) ? &kSse2Kernels : nullptr;
+    case DspPath::Avx2:
+        return cpuSupports(path) ? &kAvx2Kernels : nullptr;
+#else
+    default:
+        return nullptr;
+#endif
+    }
+
+    return nullptr;
+
+}
+
+/**
+ * @brief Returns the display name of a path
+ */
+
+const char *Dsp::pathName(DspPath path)
+{
+
+    switch (path) {
+    case DspPath::Scalar:
+        return "scalar";
+    case DspPath::Sse2:
+        return "sse2";
+    case DspPath::Avx2:
+        return "avx2";
+    }
+
+    return "unknown";
+
+}
+
+/**
+ * @brief Returns the root mean square of a frame
+ * @param samples represents the frame
+ * @param count represents the number of samples in the frame
+ */
+
+qreal Dsp::rms(const qint16 *samples, int count)
+{
+
+    if (count <= 0) return 0.0;
+
+    return std::sqrt(qreal(kernels().sumOfSquares(samples, count)) / count);
+
+}
+
+/**
+ * @brief Returns the fraction of neighbouring sample pairs that cross zero
+ *
+ * Zero counts as positive, so a frame of silence has a rate of 0
+ */
+
+qreal Dsp::zeroCrossingRate(const qint16 *samples, int count)
+{
+
+    if (count < 2) return 0.0;
+
+    return qreal(kernels().zeroCrossings(samples, count)) / (count - 1);
+
+}
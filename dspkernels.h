@@ -0,0 +1,72 @@
+/**
+ * @file dspkernels.h
+ * @brief Vectorised level and feature kernels over 16-bit PCM frames
+ * @author Kiet Tran, Steph Oh
+ */
+
+#ifndef DSPKERNELS_H
+#define DSPKERNELS_H
+
+#include <QtGlobal>
+
+/**
+ * @brief Instruction set a kernel table is written for
+ */
+
+enum class DspPath {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+/**
+ * @brief One implementation of every kernel
+ *
+ * All tables return the same results for the same input (the float energy kernel up to
+ * rounding), so callers never need to know which one they got
+ */
+
+struct DspKernels {
+    DspPath path;
+
+    // Sum of the squared samples, exact
+    quint64 (*sumOfSquares)(const qint16 *samples, int count);
+
+    // Largest absolute sample, 32768 for a full scale negative sample
+    int (*peak)(const qint16 *samples, int count);
+
+    // Number of neighbouring samples whose signs differ
+    int (*zeroCrossings)(const qint16 *samples, int count);
+
+    // Sum of (sample * window)^2, window holds count coefficients
+    float (*windowedEnergy)(const qint16 *samples, const float *window, int count);
+};
+
+namespace Dsp {
+
+// Fastest table the CPU supports, detected on first use
+const DspKernels &kernels();
+
+// Table for a specific path, nullptr if this CPU or build cannot run it
+const DspKernels *kernelsFor(DspPath path);
+
+const char *pathName(DspPath path);
+
+// Root mean square of a frame, in sample units
+qreal rms(const qint16 *samples, int count);
+
+// Fraction of neighbouring sample pairs that cross zero
+qreal zeroCrossingRate(const qint16 *samples, int count);
+
+// Largest absolute sample of a frame
+inline int peak(const qint16 *samples, int count) { return kernels().peak(samples, count); }
+
+// Energy of a frame after applying an analysis window
+inline float windowedEnergy(const qint16 *samples, const float *window, int count)
+{
+    return kernels().windowedEnergy(samples, window, count);
+}
+
+}
+
+#endif // DSPKERNELS_H
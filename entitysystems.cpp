@@ -0,0 +1,97 @@
+/**
+ * @file entitysystems.cpp
+ * @brief Implementation of the entity systems
+ * @author Kiet Tran
+ */
+
+#include "entitysystems.h"
+#include "collisionworld.h"
+#include <QGraphicsItem>
+
+/**
+ * @brief Creates the player's entity
+ * @param world represents the world to create it in
+ * @param position represents the top left of the player's sprite
+ * @return Returns the handle of the player
+ */
+
+Entity Systems::createPlayer(EntityWorld &world, const QPointF &position)
+{
+
+    const Entity player = world.create(EntityWorld::Position | EntityWorld::Velocity | EntityWorld::Collider
+                                       | EntityWorld::HealthPoints | EntityWorld::Sprite);
+    world.setPosition(player, position);
+    world.setCollider(player, kPlayerCollider);
+    world.health(player)->set(kPlayerHealth);
+
+    return player;
+
+}
+
+/**
+ * @brief Advances every moving entity by one fixed step
+ * @param world represents the entities
+ * @param walls represents the room's walls, or nullptr to move freely
+ * @param dt represents the step in seconds
+ *
+ * Walks the mask, position, velocity and collider arrays front to back and touches nothing else.
+ * Entities only collide with the walls, never with each other
+ */
+
+void Systems::integrate(EntityWorld &world, const CollisionWorld *walls, qreal dt)
+{
+
+    const int count = world.count();
+    const quint32 *masks = world.masks();
+    QPointF *positions = world.positions();
+    QPointF *previousPositions = world.previousPositions();
+    const QPointF *velocities = world.velocities();
+    const QRectF *colliders = world.colliders();
+
+    const quint32 moving = EntityWorld::Position | EntityWorld::Velocity;
+
+    for (int i = 0; i < count; ++i) {
+        if (!(masks[i] & EntityWorld::Position)) continue;
+
+        previousPositions[i] = positions[i];
+        if ((masks[i] & moving) != moving || velocities[i].isNull()) continue;
+
+        const QPointF delta = velocities[i] * dt;
+        if (walls && (masks[i] & EntityWorld::Collider)) {
+            positions[i] += walls->sweep(colliders[i].translated(positions[i]), delta);
+        } else {
+            positions[i] += delta;
+        }
+    }
+
+}
+
+/**
+ * @brief Places every sprite between the last two ticks
+ * @param world represents the entities
+ * @param alpha represents the interpolation factor reported by the game loop
+ *
+ * Items already at their position are not moved, which would make the scene repaint them
+ */
+
+void Systems::mirror(const EntityWorld &world, qreal alpha)
+{
+
+    const int count = world.count();
+    const quint32 *masks = world.masks();
+    const QPointF *positions = world.positions();
+    const QPointF *previousPositions = world.previousPositions();
+    QGraphicsItem *const *sprites = world.sprites();
+
+    const quint32 shown = EntityWorld::Position | EntityWorld::Sprite;
+
+    for (int i = 0; i < count; ++i) {
+        if ((masks[i] & shown) != shown || !sprites[i]) continue;
+
+        const QPointF rendered = previousPositions[i] + (positions[i] - previousPositions[i]) * alpha;
+        if (rendered != sprites[i]->pos()) {
+            sprites[i]->setPos(rendered);
+        }
+    }
+
+}
@@ -0,0 +1,35 @@
+/**
+ * @file entitysystems.h
+ * @brief Per-tick and per-frame passes over every entity of an EntityWorld
+ * @author Kiet Tran
+ */
+
+#ifndef ENTITYSYSTEMS_H
+#define ENTITYSYSTEMS_H
+
+#include <QPointF>
+#include "entityworld.h"
+
+class CollisionWorld;
+
+namespace Systems {
+
+// Collision box and health of the player, whose position is the top left of its 75 x 75 sprite
+const QRectF kPlayerCollider(0, 0, 75, 75);
+const int kPlayerHealth = 100;
+
+// Creates the player's entity at a position, the sprite is attached by the game window
+Entity createPlayer(EntityWorld &world, const QPointF &position);
+
+// Moves every entity with a velocity by one fixed step, sweeping the ones with a collider
+// against the walls so they slide along them. Every position is remembered for interpolation
+// first, including those of entities that do not move. walls may be null
+void integrate(EntityWorld &world, const CollisionWorld *walls, qreal dt);
+
+// Places the sprite of every entity between its last two positions, the only place the game
+// writes positions into the scene
+void mirror(const EntityWorld &world, qreal alpha);
+
+}
+
+#endif // ENTITYSYSTEMS_H
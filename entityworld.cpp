@@ -0,0 +1,325 @@
+/**
+ * @file entityworld.cpp
+ * @brief Implementation of the EntityWorld class
+ * @author Kiet Tran
+ */
+
+#include "entityworld.h"
+
+/**
+ * @brief Constructs an empty world
+ */
+
+EntityWorld::EntityWorld()
+{
+
+}
+
+/**
+ * @brief Creates an entity
+ * @param components represents the mask of components it has
+ * @return Returns the handle of the new entity
+ *
+ * Takes the most recently freed index if there is one, its generation was already advanced when
+ * the previous entity there was destroyed. The new row is appended to every array
+ */
+
+Entity EntityWorld::create(quint32 components)
+{
+
+    Entity entity;
+    if (!m_freeIndices.isEmpty()) {
+        entity.index = m_freeIndices.takeLast();
+    } else {
+        entity.index = quint32(m_generations.size());
+        m_generations.append(0);
+        m_rows.append(-1);
+    }
+    entity.generation = m_generations[entity.index];
+    m_rows[entity.index] = m_entities.size();
+
+    m_entities.append(entity);
+    m_masks.append(components);
+    m_positions.append(QPointF());
+    m_previousPositions.append(QPointF());
+    m_velocities.append(QPointF());
+    m_colliders.append(QRectF());
+    m_health.append(Health());
+    m_sprites.append(nullptr);
+
+    return entity;
+
+}
+
+/**
+ * @brief Destroys an entity
+ * @param entity represents the entity to destroy
+ * @return Returns false if the handle is stale
+ *
+ * The last row moves into the freed one, so the arrays stay packed and a destroy costs the same
+ * however many entities there are
+ */
+
+bool EntityWorld::destroy(Entity entity)
+{
+
+    const int freed = row(entity);
+    if (freed < 0) return false;
+
+    const int last = m_entities.size() - 1;
+    if (freed != last) {
+        m_entities[freed] = m_entities[last];
+        m_masks[freed] = m_masks[last];
+        m_positions[freed] = m_positions[last];
+        m_previousPositions[freed] = m_previousPositions[last];
+        m_velocities[freed] = m_velocities[last];
+        m_colliders[freed] = m_colliders[last];
+        m_health[freed] = m_health[last];
+        m_sprites[freed] = m_sprites[last];
+        m_rows[m_entities[freed].index] = freed;
+    }
+
+    m_entities.removeLast();
+    m_masks.removeLast();
+    m_positions.removeLast();
+    m_previousPositions.removeLast();
+    m_velocities.removeLast();
+    m_colliders.removeLast();
+    m_health.removeLast();
+    m_sprites.removeLast();
+
+    m_rows[entity.index] = -1;
+    ++m_generations[entity.index];
+    m_freeIndices.append(entity.index);
+
+    return true;
+
+}
+
+/**
+ * @brief Destroys every entity
+ *
+ * Advances the generation of every index in use, so no handle handed out before survives
+ */
+
+void EntityWorld::clear()
+{
+
+    for (const Entity &entity : m_entities) {
+        m_rows[entity.index] = -1;
+        ++m_generations[entity.index];
+        m_freeIndices.append(entity.index);
+    }
+
+    m_entities.clear();
+    m_masks.clear();
+    m_positions.clear();
+    m_previousPositions.clear();
+    m_velocities.clear();
+    m_colliders.clear();
+    m_health.clear();
+    m_sprites.clear();
+
+}
+
+/**
+ * @brief Returns the row of a live entity, or -1 for a stale or null handle
+ */
+
+int EntityWorld::row(Entity entity) const
+{
+
+    if (entity.index >= quint32(m_generations.size())) return -1;
+    if (m_generations[entity.index] != entity.generation) return -1;
+
+    return m_rows[entity.index];
+
+}
+
+/**
+ * @brief Returns the component mask of an entity, 0 for a stale handle
+ */
+
+quint32 EntityWorld::components(Entity entity) const
+{
+
+    const int index = row(entity);
+    return index >= 0 ? m_masks[index] : 0;
+
+}
+
+/**
+ * @brief Returns true if an entity is alive and has every component of a mask
+ */
+
+bool EntityWorld::has(Entity entity, quint32 components) const
+{
+
+    const int index = row(entity);
+    return index >= 0 && (m_masks[index] & components) == components;
+
+}
+
+/**
+ * @brief Teleports an entity
+ *
+ * Sets both the current and the previous position, so the move is not interpolated
+ */
+
+void EntityWorld::setPosition(Entity entity, const QPointF &position)
+{
+
+    const int index = rowWith(entity, Position);
+    if (index < 0) return;
+
+    m_positions[index] = position;
+    m_previousPositions[index] = position;
+
+}
+
+/**
+ * @brief Returns the position of an entity after the latest tick
+ */
+
+QPointF EntityWorld::position(Entity entity) const
+{
+
+    const int index = rowWith(entity, Position);
+    return index >= 0 ? m_positions[index] : QPointF();
+
+}
+
+/**
+ * @brief Returns the position of an entity between the last two ticks
+ * @param alpha represents the interpolation factor reported by the game loop
+ */
+
+QPointF EntityWorld::interpolated(Entity entity, qreal alpha) const
+{
+
+    const int index = rowWith(entity, Position);
+    if (index < 0) return QPointF();
+
+    const QPointF previous = m_previousPositions[index];
+    return previous + (m_positions[index] - previous) * alpha;
+
+}
+
+/**
+ * @brief Sets the velocity of an entity in pixels per second
+ */
+
+void EntityWorld::setVelocity(Entity entity, const QPointF &velocity)
+{
+
+    const int index = rowWith(entity, Velocity);
+    if (index >= 0) {
+        m_velocities[index] = velocity;
+    }
+
+}
+
+/**
+ * @brief Returns the velocity of an entity in pixels per second
+ */
+
+QPointF EntityWorld::velocity(Entity entity) const
+{
+
+    const int index = rowWith(entity, Velocity);
+    return index >= 0 ? m_velocities[index] : QPointF();
+
+}
+
+/**
+ * @brief Sets the collision box of an entity relative to its position
+ */
+
+void EntityWorld::setCollider(Entity entity, const QRectF &box)
+{
+
+    const int index = rowWith(entity, Collider);
+    if (index >= 0) {
+        m_colliders[index] = box;
+    }
+
+}
+
+/**
+ * @brief Returns the collision box of an entity in scene coordinates
+ */
+
+QRectF EntityWorld::bounds(Entity entity) const
+{
+
+    const int index = rowWith(entity, Collider);
+    if (index < 0) return QRectF();
+
+    return m_colliders[index].translated(m_positions[index]);
+
+}
+
+/**
+ * @brief Returns the health of an entity, nullptr if it has none
+ *
+ * The pointer goes into the health array, which moves when entities are created or destroyed
+ */
+
+Health *EntityWorld::health(Entity entity)
+{
+
+    const int index = rowWith(entity, HealthPoints);
+    return index >= 0 ? &m_health[index] : nullptr;
+
+}
+
+/**
+ * @brief Returns the health of an entity, nullptr if it has none
+ */
+
+const Health *EntityWorld::health(Entity entity) const
+{
+
+    const int index = rowWith(entity, HealthPoints);
+    return index >= 0 ? &m_health[index] : nullptr;
+
+}
+
+/**
+ * @brief Sets the scene item that shows an entity
+ * @param item represents the item, which stays owned by the caller
+ */
+
+void EntityWorld::setSprite(Entity entity, QGraphicsItem *item)
+{
+
+    const int index = rowWith(entity, Sprite);
+    if (index >= 0) {
+        m_sprites[index] = item;
+    }
+
+}
+
+/**
+ * @brief Returns the scene item that shows an entity, nullptr if it has none
+ */
+
+QGraphicsItem *EntityWorld::sprite(Entity entity) const
+{
+
+    const int index = rowWith(entity, Sprite);
+    return index >= 0 ? m_sprites[index] : nullptr;
+
+}
+
+/**
+ * @brief Returns the row of an entity that has a component, or -1
+ */
+
+int EntityWorld::rowWith(Entity entity, Component component) const
+{
+
+    const int index = row(entity);
+    return index >= 0 && (m_masks[index] & component) ? index : -1;
+
+}
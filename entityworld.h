@@ -0,0 +1,144 @@
+/**
+ * @file entityworld.h
+ * @brief Game objects stored as components in contiguous arrays behind stable handles
+ * @author Kiet Tran
+ */
+
+#ifndef ENTITYWORLD_H
+#define ENTITYWORLD_H
+
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+#include "health.h"
+
+class QGraphicsItem;
+
+/**
+ * @brief Handle of an entity
+ *
+ * The index names a slot of the world's handle table and the generation tells apart the
+ * entities that used the slot one after another, so a handle kept past destroy() never reaches
+ * the entity that reuses its slot
+ */
+
+struct Entity {
+    quint32 index = 0xffffffffu;
+    quint32 generation = 0;
+
+    bool isNull() const { return index == 0xffffffffu; }
+    bool operator==(const Entity &other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Entity &other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Owns the simulation state of every game object
+ *
+ * Each component is one array and entity i of the world has its components at row i of every
+ * array, so a system touches only the arrays it needs, front to back. Destroying an entity moves
+ * the last row into its place to keep the rows packed; the handle table maps a handle to its
+ * current row and is the only thing that follows the move. Rows are therefore not stable across
+ * destroy() and must not be kept, handles are.
+ *
+ * The world holds no scene items of its own. An entity with a Sprite points at the item that
+ * shows it, which Systems::mirror() places every frame, so the scene only ever mirrors the state
+ * kept here. The item stays owned by whoever created it
+ */
+
+class EntityWorld
+{
+public:
+    // Components an entity can have, combined into its mask
+    enum Component : quint32 {
+        Position = 1 << 0,  // Position after the latest tick and before it, for interpolation
+        Velocity = 1 << 1,  // Pixels per second, applied by Systems::integrate()
+        Collider = 1 << 2,  // Box relative to the position, swept against the walls
+        HealthPoints = 1 << 3,
+        Sprite = 1 << 4     // Scene item placed at the interpolated position
+    };
+
+    EntityWorld();
+
+    // Creates an entity with the components of a mask, all at their default values
+    Entity create(quint32 components);
+
+    // Destroys an entity, false if the handle is stale. Its sprite item is left to its owner
+    bool destroy(Entity entity);
+
+    // Destroys every entity, every handle handed out so far becomes stale
+    void clear();
+
+    bool isAlive(Entity entity) const { return row(entity) >= 0; }
+
+    // Number of live entities, which are rows 0 to count() - 1
+    int count() const { return m_entities.size(); }
+
+    // Row of a live entity, -1 for a stale handle
+    int row(Entity entity) const;
+
+    // Component mask of an entity, 0 for a stale handle
+    quint32 components(Entity entity) const;
+    bool has(Entity entity, quint32 components) const;
+
+    // Teleports an entity, which also resets its interpolation
+    void setPosition(Entity entity, const QPointF &position);
+    QPointF position(Entity entity) const;
+
+    // Position between the last two ticks
+    QPointF interpolated(Entity entity, qreal alpha) const;
+
+    void setVelocity(Entity entity, const QPointF &velocity);
+    QPointF velocity(Entity entity) const;
+
+    // Collision box relative to the position
+    void setCollider(Entity entity, const QRectF &box);
+
+    // Collision box in scene coordinates after the latest tick
+    QRectF bounds(Entity entity) const;
+
+    // Health of an entity, nullptr without one. Invalidated by the next create() or destroy()
+    Health *health(Entity entity);
+    const Health *health(Entity entity) const;
+
+    void setSprite(Entity entity, QGraphicsItem *item);
+    QGraphicsItem *sprite(Entity entity) const;
+
+    // Component arrays, count() rows each, for the systems
+    const Entity *entities() const { return m_entities.constData(); }
+    const quint32 *masks() const { return m_masks.constData(); }
+    QPointF *positions() { return m_positions.data(); }
+    const QPointF *positions() const { return m_positions.constData(); }
+    QPointF *previousPositions() { return m_previousPositions.data(); }
+    const QPointF *previousPositions() const { return m_previousPositions.constData(); }
+    const QPointF *velocities() const { return m_velocities.constData(); }
+    const QRectF *colliders() const { return m_colliders.constData(); }
+    QGraphicsItem *const *sprites() const { return m_sprites.constData(); }
+
+private:
+    EntityWorld(const EntityWorld &) = delete;
+    EntityWorld &operator=(const EntityWorld &) = delete;
+
+    // Row of an entity that must have a component, -1 otherwise
+    int rowWith(Entity entity, Component component) const;
+
+    // Handle of each row
+    QVector<Entity> m_entities;
+
+    // Component arrays, one row per live entity
+    QVector<quint32> m_masks;
+    QVector<QPointF> m_positions;
+    QVector<QPointF> m_previousPositions;
+    QVector<QPointF> m_velocities;
+    QVector<QRectF> m_colliders;
+    QVector<Health> m_health;
+    QVector<QGraphicsItem *> m_sprites;
+
+    // Handle table: current generation and row of each index, -1 for a free index
+    QVector<quint32> m_generations;
+    QVector<int> m_rows;
+
+    // Indices of destroyed entities, reused before the table grows
+    QVector<quint32> m_freeIndices;
+};
+
+#endif // ENTITYWORLD_H
@@ -0,0 +1,149 @@
+/**
+ * @file flowfield.cpp
+ * @brief Implementation of the FlowField class
+ * @author Kiet Tran
+ */
+
+#include "flowfield.h"
+#include "navgrid.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Constructs a field without a grid
+ */
+
+FlowField::FlowField()
+    : m_grid(nullptr)
+    , m_target(-1)
+    , m_rebuilds(0)
+{
+
+}
+
+/**
+ * @brief Uses a grid and forgets the target
+ * @param grid represents the grid agents move on
+ */
+
+void FlowField::reset(const NavGrid *grid)
+{
+
+    m_grid = grid;
+    m_target = -1;
+    m_rebuilds = 0;
+
+    const int count = grid ? grid->cellCount() : 0;
+    m_distance.fill(NavGrid::kUnreachable, count);
+    m_next.fill(-1, count);
+    m_open.clear();
+    m_open.reserve(count);
+
+}
+
+/**
+ * @brief Points the field at a target cell
+ * @param cell represents the target, a blocked cell is moved to its nearest walkable cell
+ * @return Returns true if the field was rebuilt
+ */
+
+bool FlowField::setTarget(int cell)
+{
+
+    if (!m_grid) return false;
+
+    cell = m_grid->nearestWalkable(cell);
+    if (cell == m_target) return false;
+
+    m_target = cell;
+    rebuild();
+    return true;
+
+}
+
+/**
+ * @brief Returns the path distance from a cell to the target in scene units
+ */
+
+float FlowField::distance(int cell) const
+{
+
+    if (cell < 0 || cell >= m_distance.size()) return NavGrid::kUnreachable;
+    return m_distance[cell];
+
+}
+
+/**
+ * @brief Returns the cell after a cell on its way to the target
+ */
+
+int FlowField::nextCell(int cell) const
+{
+
+    if (cell < 0 || cell >= m_next.size()) return -1;
+    return m_next[cell];
+
+}
+
+/**
+ * @brief Returns the unit step from a cell toward the target
+ */
+
+QPointF FlowField::direction(int cell) const
+{
+
+    const int next = nextCell(cell);
+    if (next < 0) return QPointF();
+
+    const QPointF step = m_grid->cellCenter(next) - m_grid->cellCenter(cell);
+    return step / std::hypot(step.x(), step.y());
+
+}
+
+/**
+ * @brief Rebuilds the distances and steps from the target
+ *
+ * Every cell settled from a neighbour points at that neighbour, so following the steps from
+ * any reachable cell walks a shortest path to the target
+ */
+
+void FlowField::rebuild()
+{
+
+    std::fill(m_distance.begin(), m_distance.end(), NavGrid::kUnreachable);
+    std::fill(m_next.begin(), m_next.end(), -1);
+    m_open.clear();
+    ++m_rebuilds;
+
+    if (m_target < 0) return;
+
+    auto later = [](const OpenEntry &a, const OpenEntry &b) { return a.distance > b.distance; };
+    const float scale = float(m_grid->cellSize());
+
+    m_distance[m_target] = 0.0f;
+    m_open.append({ 0.0f, m_target });
+
+    int next[8];
+    float stepCost[8];
+
+    while (!m_open.isEmpty()) {
+        std::pop_heap(m_open.begin(), m_open.end(), later);
+        const OpenEntry entry = m_open.last();
+        m_open.removeLast();
+
+        // Entries superseded by a shorter distance are skipped
+        if (entry.distance > m_distance[entry.cell]) continue;
+
+        const int count = m_grid->neighbours(entry.cell, next, stepCost);
+        for (int i = 0; i < count; ++i) {
+            const float distance = entry.distance + stepCost[i] * scale;
+            if (distance >= m_distance[next[i]]) continue;
+
+            m_distance[next[i]] = distance;
+            m_next[next[i]] = entry.cell;
+            m_open.append({ distance, next[i] });
+            std::push_heap(m_open.begin(), m_open.end(), later);
+        }
+    }
+
+}
@@ -0,0 +1,69 @@
+/**
+ * @file flowfield.h
+ * @brief Shared field of directions toward one target over a NavGrid
+ * @author Kiet Tran
+ */
+
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <QPointF>
+#include <QVector>
+
+class NavGrid;
+
+/**
+ * @brief Distance to a target cell and the step toward it, for every cell of a NavGrid
+ *
+ * Any number of agents chasing the same target read their next step from the field in constant
+ * time, instead of searching for a path each. The field is only rebuilt when the target moves
+ * to another cell, which for a walking player is every few ticks; in between, setTarget() is a
+ * comparison. A rebuild is one Dijkstra pass from the target over the walkable cells, into
+ * arrays sized with the grid
+ */
+
+class FlowField
+{
+public:
+    FlowField();
+
+    // Uses a grid, which must outlive the field and stay unchanged, and forgets the target
+    void reset(const NavGrid *grid);
+
+    // Points the field at a cell, rebuilding it only if the cell changed. True if it was rebuilt
+    bool setTarget(int cell);
+    int target() const { return m_target; }
+
+    // Path distance from a cell to the target in scene units, NavGrid::kUnreachable if none
+    float distance(int cell) const;
+
+    // Unit step from a cell toward the next cell on its way to the target, null at the target
+    // and on unreachable cells
+    QPointF direction(int cell) const;
+
+    // Cell after a cell on its way to the target, -1 at the target and on unreachable cells
+    int nextCell(int cell) const;
+
+    // Times the field was rebuilt since reset()
+    quint64 rebuilds() const { return m_rebuilds; }
+
+private:
+    // Open list entry of the rebuild
+    struct OpenEntry {
+        float distance;
+        int cell;
+    };
+
+    // Runs Dijkstra from the target
+    void rebuild();
+
+    const NavGrid *m_grid;
+    int m_target;
+    quint64 m_rebuilds;
+
+    QVector<float> m_distance;
+    QVector<int> m_next;
+    QVector<OpenEntry> m_open;
+};
+
+#endif // FLOWFIELD_H
@@ -0,0 +1,198 @@
+/**
+ * @file gameloop.cpp
+ * @brief Implementation of the GameLoop class
+ * @author Kiet Tran
+ */
+
+#include "gameloop.h"
+#include "profiler.h"
+#include <QtGlobal>
+
+namespace {
+
+// Longest frame delta that is simulated, avoids a spiral of death after a stall
+const qreal kMaxFrameDelta = 0.25;
+
+// Upper bound of simulation steps per frame, keeps input latency bounded
+const int kMaxTicksPerFrame = 5;
+
+}
+
+/**
+ * @brief Constructs a GameLoop running at 60 ticks and 60 frames per second
+ * @param parent represents the parent QObject
+ */
+
+GameLoop::GameLoop(QObject *parent)
+    : QObject(parent)
+    , m_running(false)
+    , m_tickRate(60)
+    , m_frameRate(60)
+    , m_nextFrameNs(0)
+    , m_lastFrameNs(0)
+    , m_accumulator(0.0)
+    , m_tickTime(0.0)
+    , m_frameTime(0.0)
+    , m_renderTime(0.0)
+    , m_tickCount(0)
+{
+
+    m_frameTimer.setTimerType(Qt::PreciseTimer);
+    m_frameTimer.setSingleShot(true);
+    connect(&m_frameTimer, &QTimer::timeout, this, &GameLoop::runFrame);
+
+}
+
+/**
+ * @brief Starts the loop
+ *
+ * Resets the accumulator so the time spent before starting is not simulated
+ */
+
+void GameLoop::start()
+{
+
+    m_clock.start();
+    m_lastFrameNs = 0;
+    m_accumulator = 0.0;
+    m_nextFrameNs = 0;
+    m_running = true;
+    scheduleNextFrame();
+
+}
+
+/**
+ * @brief Stops the loop
+ */
+
+void GameLoop::stop()
+{
+
+    m_running = false;
+    m_frameTimer.stop();
+
+}
+
+/**
+ * @brief Returns true if the loop is running
+ */
+
+bool GameLoop::isRunning() const
+{
+
+    return m_running;
+
+}
+
+/**
+ * @brief Sets the fixed simulation rate
+ * @param hz represents the number of ticks per second
+ */
+
+void GameLoop::setTickRate(int hz)
+{
+
+    m_tickRate = qMax(1, hz);
+
+}
+
+/**
+ * @brief Sets the rate at which frames are rendered
+ * @param hz represents the number of frames per second
+ *
+ * Takes effect from the frame after the one already scheduled
+ */
+
+void GameLoop::setFrameRate(int hz)
+{
+
+    m_frameRate = qMax(1, hz);
+
+}
+
+/**
+ * @brief Runs the pending simulation steps and renders one frame
+ *
+ * Consumes the accumulated wall time in fixed steps, then emits render() with the leftover
+ * fraction of a step so the scene can be drawn between the previous and current tick
+ */
+
+void GameLoop::runFrame()
+{
+
+    ProfileScope frameScope(ProfileSection::Frame);
+
+    const qint64 nowNs = m_clock.nsecsElapsed();
+    const qreal delta = qMin((nowNs - m_lastFrameNs) / 1e9, kMaxFrameDelta);
+    m_frameTime = smooth(m_frameTime, (nowNs - m_lastFrameNs) / 1e6);
+    m_lastFrameNs = nowNs;
+
+    const qreal step = tickDuration();
+    m_accumulator += delta;
+
+    int ticks = 0;
+    while (m_accumulator >= step && ticks < kMaxTicksPerFrame) {
+        const qint64 tickStartNs = m_clock.nsecsElapsed();
+        {
+            ProfileScope tickScope(ProfileSection::Tick);
+            emit tick(step);
+        }
+        m_tickTime = smooth(m_tickTime, (m_clock.nsecsElapsed() - tickStartNs) / 1e6);
+
+        m_accumulator -= step;
+        ++m_tickCount;
+        ++ticks;
+    }
+
+    // Drops time that could not be simulated this frame instead of catching up later
+    if (ticks == kMaxTicksPerFrame && m_accumulator >= step) {
+        m_accumulator = 0.0;
+    }
+
+    const qint64 renderStartNs = m_clock.nsecsElapsed();
+    emit render(m_accumulator / step);
+    m_renderTime = smooth(m_renderTime, (m_clock.nsecsElapsed() - renderStartNs) / 1e6);
+
+    // A tick or render handler may have stopped the loop
+    if (m_running) {
+        scheduleNextFrame();
+    }
+
+}
+
+/**
+ * @brief Advances the deadline of the next frame and arms the timer for it
+ *
+ * The deadline moves by the exact frame period from the previous deadline, not from now, so the
+ * milliseconds dropped when arming the timer are made up by the following frames. After a stall
+ * longer than a frame the deadline restarts from now instead of rendering the missed frames back
+ * to back
+ */
+
+void GameLoop::scheduleNextFrame()
+{
+
+    const qint64 nowNs = m_clock.nsecsElapsed();
+    m_nextFrameNs += frameIntervalNs();
+    if (m_nextFrameNs < nowNs) {
+        m_nextFrameNs = nowNs;
+    }
+
+    m_frameTimer.start(int((m_nextFrameNs - nowNs) / 1000000));
+
+}
+
+/**
+ * @brief Blends a new sample into a smoothed measurement
+ */
+
+qreal GameLoop::smooth(qreal current, qreal sample)
+{
+
+    if (current == 0.0) {
+        return sample;
+    }
+
+    return current * 0.9 + sample * 0.1;
+
+}
@@ -0,0 +1,104 @@
+/**
+ * @file gameloop.h
+ * @brief Fixed timestep game loop with interpolated rendering
+ * @author Kiet Tran
+ */
+
+#ifndef GAMELOOP_H
+#define GAMELOOP_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+/**
+ * @brief Drives the simulation at a fixed tick rate independent of the frame rate
+ *
+ * Every frame the elapsed wall time is added to an accumulator which is consumed in fixed
+ * steps through the tick() signal. The remainder is reported to render() as an interpolation
+ * factor so movement stays smooth when the frame and tick rates differ.
+ *
+ * Frames are paced against the clock rather than a millisecond interval: each one is due a
+ * whole frame period after the previous deadline, and a single shot timer is armed for it, so
+ * rates whose period is not a whole number of milliseconds (144 Hz) are kept on average
+ */
+
+class GameLoop : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GameLoop(QObject *parent = nullptr);
+
+    // Start and stop the loop
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    // Simulation rate in ticks per second (for example 60 or 144)
+    void setTickRate(int hz);
+    int tickRate() const { return m_tickRate; }
+
+    // Rate at which frames are rendered
+    void setFrameRate(int hz);
+    int frameRate() const { return m_frameRate; }
+
+    // Fixed simulation step in seconds
+    qreal tickDuration() const { return 1.0 / m_tickRate; }
+
+    // Measured time spent in one simulation tick (milliseconds, smoothed)
+    qreal tickTime() const { return m_tickTime; }
+
+    // Measured time between two rendered frames (milliseconds, smoothed)
+    qreal frameTime() const { return m_frameTime; }
+
+    // Measured time spent rendering one frame (milliseconds, smoothed)
+    qreal renderTime() const { return m_renderTime; }
+
+    // Number of simulation ticks run since start()
+    quint64 tickCount() const { return m_tickCount; }
+
+signals:
+    // Emitted once per fixed simulation step
+    void tick(qreal dt);
+
+    // Emitted once per frame with the interpolation factor between the last two ticks
+    void render(qreal alpha);
+
+private slots:
+    // Runs the pending simulation steps and renders one frame
+    void runFrame();
+
+private:
+    // Length of one frame at the frame rate (nanoseconds)
+    qint64 frameIntervalNs() const { return 1000000000LL / m_frameRate; }
+
+    // Advances the deadline of the next frame and arms the timer for it
+    void scheduleNextFrame();
+
+    // Blends a new sample into a smoothed measurement
+    static qreal smooth(qreal current, qreal sample);
+
+    QTimer m_frameTimer;
+    QElapsedTimer m_clock;
+
+    bool m_running;
+    int m_tickRate;
+    int m_frameRate;
+
+    // Wall time the next frame is due (nanoseconds)
+    qint64 m_nextFrameNs;
+
+    // Wall time of the previous frame (nanoseconds)
+    qint64 m_lastFrameNs;
+
+    // Unsimulated wall time (seconds)
+    qreal m_accumulator;
+
+    qreal m_tickTime;
+    qreal m_frameTime;
+    qreal m_renderTime;
+    quint64 m_tickCount;
+};
+
+#endif // GAMELOOP_H
@@ -0,0 +1,218 @@
+/**
+ * @file gameview.cpp
+ * @brief Implementation of the GameView class
+ * @author Kiet Tran
+ */
+
+#include "gameview.h"
+#include "gameloop.h"
+#include "profiler.h"
+#include <QKeyEvent>
+#include <QPainter>
+#include <QPolygonF>
+
+namespace {
+
+// Size and placement of the overlay panel
+const int kOverlayMargin = 10;
+const int kOverlayWidth = 360;
+const int kGraphHeight = 80;
+const int kLineHeight = 16;
+
+// Frame budget drawn as a reference line on the graph (60 frames per second)
+const qreal kFrameBudgetMs = 1000.0 / 60.0;
+
+// Sections listed in the overlay, in order
+const ProfileSection kListedSections[] = {
+    ProfileSection::Frame, ProfileSection::Tick, ProfileSection::Input, ProfileSection::Movement,
+    ProfileSection::Monsters, ProfileSection::Challenges, ProfileSection::Audio, ProfileSection::Render, ProfileSection::Voice,
+    ProfileSection::Mixer
+};
+
+}
+
+/**
+ * @brief Constructs a GameView showing a scene
+ * @param scene represents the scene to show
+ * @param parent represents the parent widget
+ */
+
+GameView::GameView(QGraphicsScene *scene, QWidget *parent)
+    : QGraphicsView(scene, parent)
+    , m_gameLoop(nullptr)
+    , m_overlayVisible(false)
+    , m_profilerPinned(false)
+{
+
+}
+
+/**
+ * @brief Shows or hides the profiling overlay
+ *
+ * The profiler only records while the overlay is visible, unless it is pinned for exporting
+ */
+
+void GameView::setOverlayVisible(bool visible)
+{
+
+    if (visible == m_overlayVisible) return;
+
+    m_overlayVisible = visible;
+    Profiler::instance().setEnabled(visible || m_profilerPinned);
+    viewport()->update(overlayRect());
+
+}
+
+/**
+ * @brief Repaints the overlay area
+ */
+
+void GameView::refreshOverlay()
+{
+
+    if (m_overlayVisible) {
+        viewport()->update(overlayRect());
+    }
+
+}
+
+/**
+ * @brief Paints the scene, timed as the Render section
+ */
+
+void GameView::paintEvent(QPaintEvent *event)
+{
+
+    ProfileScope scope(ProfileSection::Render);
+    QGraphicsView::paintEvent(event);
+
+}
+
+/**
+ * @brief Draws the overlay above the scene
+ */
+
+void GameView::drawForeground(QPainter *painter, const QRectF &rect)
+{
+
+    QGraphicsView::drawForeground(painter, rect);
+
+    if (!m_overlayVisible) return;
+
+    painter->save();
+    painter->resetTransform();
+    drawOverlay(painter);
+    painter->restore();
+
+}
+
+/**
+ * @brief Toggles the overlay with F3, other keys go to the scene
+ */
+
+void GameView::keyPressEvent(QKeyEvent *event)
+{
+
+    if (event->key() == Qt::Key_F3 && !event->isAutoRepeat()) {
+        setOverlayVisible(!m_overlayVisible);
+        event->accept();
+        return;
+    }
+
+    QGraphicsView::keyPressEvent(event);
+
+}
+
+/**
+ * @brief Draws the frame time graph and the per-section statistics
+ *
+ * The graph shows the cost of the latest frames against the 60 fps budget, the table the mean,
+ * 50th, 95th and 99th percentile of every section over the same window
+ */
+
+void GameView::drawOverlay(QPainter *painter)
+{
+
+    const Profiler &profiler = Profiler::instance();
+    const QRect panel = overlayRect();
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(QColor(0, 0, 0, 180));
+    painter->drawRect(panel);
+
+    QFont font = painter->font();
+    font.setFamily("monospace");
+    font.setStyleHint(QFont::Monospace);
+    font.setPixelSize(12);
+    painter->setFont(font);
+    painter->setPen(Qt::white);
+
+    int y = panel.top() + kLineHeight;
+    const int x = panel.left() + 8;
+
+    if (m_gameLoop) {
+        const qreal frameMs = m_gameLoop->frameTime();
+        painter->drawText(x, y, QString("%1 fps  frame %2 ms  ticks %3")
+                                    .arg(frameMs > 0 ? 1000.0 / frameMs : 0.0, 0, 'f', 0)
+                                    .arg(frameMs, 0, 'f', 2)
+                                    .arg(m_gameLoop->tickCount()));
+        y += kLineHeight;
+    }
+
+    // Frame cost graph, scaled so twice the budget fills the height
+    const QRectF graph(x, y, panel.width() - 16, kGraphHeight);
+    const qreal scaleMs = kFrameBudgetMs * 2.0;
+    painter->setPen(QColor(255, 255, 255, 60));
+    painter->drawRect(graph);
+
+    const qreal budgetY = graph.bottom() - graph.height() * (kFrameBudgetMs / scaleMs);
+    painter->setPen(QColor(255, 80, 80, 160));
+    painter->drawLine(QPointF(graph.left(), budgetY), QPointF(graph.right(), budgetY));
+
+    const QVector<qreal> frames = profiler.history(ProfileSection::Frame);
+    if (frames.size() > 1) {
+        QPolygonF line;
+        line.reserve(frames.size());
+        const qreal step = graph.width() / (Profiler::kHistorySize - 1);
+        const qreal offset = graph.width() - step * (frames.size() - 1);
+        for (int i = 0; i < frames.size(); ++i) {
+            const qreal height = qMin(frames.at(i) / scaleMs, 1.0) * graph.height();
+            line.append(QPointF(graph.left() + offset + i * step, graph.bottom() - height));
+        }
+        painter->setPen(QColor(120, 220, 120));
+        painter->drawPolyline(line);
+    }
+    y += kGraphHeight + kLineHeight;
+
+    painter->setPen(Qt::white);
+    painter->drawText(x, y, QString("%1 %2 %3 %4 %5").arg("section", -11).arg("mean", 7).arg("p50", 7).arg("p95", 7).arg("p99", 7));
+    y += kLineHeight;
+
+    for (ProfileSection section : kListedSections) {
+        painter->drawText(x, y, QString("%1 %2 %3 %4 %5")
+                                    .arg(Profiler::sectionName(section), -11)
+                                    .arg(profiler.average(section), 7, 'f', 3)
+                                    .arg(profiler.percentile(section, 50), 7, 'f', 3)
+                                    .arg(profiler.percentile(section, 95), 7, 'f', 3)
+                                    .arg(profiler.percentile(section, 99), 7, 'f', 3));
+        y += kLineHeight;
+    }
+
+    if (profiler.droppedSamples() > 0) {
+        painter->setPen(QColor(255, 165, 0));
+        painter->drawText(x, y, QString("dropped %1 samples").arg(profiler.droppedSamples()));
+    }
+
+}
+
+/**
+ * @brief Returns the area of the viewport covered by the overlay
+ */
+
+QRect GameView::overlayRect() const
+{
+
+    const int rows = int(sizeof(kListedSections) / sizeof(kListedSections[0])) + 4;
+    return QRect(kOverlayMargin, kOverlayMargin, kOverlayWidth, kGraphHeight + rows * kLineHeight + 8);
+
+}
@@ -0,0 +1,59 @@
+/**
+ * @file gameview.h
+ * @brief Graphics view of the game scene with a toggleable profiling overlay
+ * @author Kiet Tran
+ */
+
+#ifndef GAMEVIEW_H
+#define GAMEVIEW_H
+
+#include <QGraphicsView>
+
+class GameLoop;
+
+/**
+ * @brief QGraphicsView that times its own painting and can draw the profiler on top
+ *
+ * F3 toggles an overlay with the frame time graph and the mean and percentile cost of every
+ * profiled subsystem. The overlay is drawn in viewport coordinates, so it stays in place
+ * whatever part of the scene is shown
+ */
+
+class GameView : public QGraphicsView
+{
+    Q_OBJECT
+
+public:
+    explicit GameView(QGraphicsScene *scene, QWidget *parent = nullptr);
+
+    // Shows or hides the profiling overlay
+    void setOverlayVisible(bool visible);
+    bool isOverlayVisible() const { return m_overlayVisible; }
+
+    // Loop whose frame rate and tick count are shown in the overlay
+    void setGameLoop(GameLoop *gameLoop) { m_gameLoop = gameLoop; }
+
+    // Repaints the overlay area, called once per frame while it is visible
+    void refreshOverlay();
+
+    // Keeps the profiler running while the overlay is hidden, for exporting on exit
+    void setProfilerPinned(bool pinned) { m_profilerPinned = pinned; }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void drawForeground(QPainter *painter, const QRectF &rect) override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+private:
+    // Draws the overlay panel in viewport coordinates
+    void drawOverlay(QPainter *painter);
+
+    // Area of the viewport covered by the overlay
+    QRect overlayRect() const;
+
+    GameLoop *m_gameLoop;
+    bool m_overlayVisible;
+    bool m_profilerPinned;
+};
+
+#endif // GAMEVIEW_H
@@ -9,6 +9,7 @@
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QGraphicsPixmapItem>
+#include <QGraphicsEllipseItem>
 #include <QGraphicsTextItem>
 #include <QTimer>
 #include <QPushButton>
@@ -18,49 +19,122 @@
 #include "movement.h"
 #include "inputhandler.h"
 #include "voicechallenge.h"
+#include "spritecache.h"
+#include "gameloop.h"
+#include "entitysystems.h"
+#include "roommanager.h"
+#include "challengescheduler.h"
+#include "gameview.h"
+#include "profiler.h"
+#include "logger.h"
+#include "audiomanager.h"
+#include "keywordspotter.h"
+#include <QCoreApplication>
+#include <QRadialGradient>
+#include <QRandomGenerator>
+
+namespace {
+
+// Places a room's audio cue in the scene, heard up to its radius away
+SoundEmitter soundEmitter(const LevelCue &cue)
+{
+
+    SoundEmitter emitter;
+    emitter.source = cue.source;
+    emitter.position = cue.position;
+    emitter.radius = cue.radius;
+    emitter.volume = float(cue.volume);
+    emitter.loop = cue.loop;
+    return emitter;
+
+}
+
+// Shadow with glowing eyes drawn for a monster, centred on its position
+QGraphicsItem *createMonsterItem()
+{
+
+    const QSizeF size = MonsterAI::kBodySize;
+
+    QRadialGradient shadow(0, 0, size.width() / 2);
+    shadow.setColorAt(0.0, QColor(10, 0, 0, 240));
+    shadow.setColorAt(0.7, QColor(25, 0, 0, 200));
+    shadow.setColorAt(1.0, QColor(0, 0, 0, 0));
+
+    QGraphicsEllipseItem *body = new QGraphicsEllipseItem(-size.width() / 2, -size.height() / 2, size.width(), size.height());
+    body->setBrush(shadow);
+    body->setPen(Qt::NoPen);
+
+    for (qreal x : { -10.0, 10.0 }) {
+        QGraphicsEllipseItem *eye = new QGraphicsEllipseItem(x - 4, -10, 8, 5, body);
+        eye->setBrush(QColor(220, 20, 20));
+        eye->setPen(Qt::NoPen);
+    }
+
+    return body;
+
+}
+
+}
 
 /**
  * @brief Constructs the GameWindow
+ * @param audioSystem represents the menu's audio system to take over, or nullptr
  * @param parent represents the parent widget
  *
  * Initializes the game scene, background graphics, sprite, movement system, collision walls, audio system, and voice challenges
  *
  */
 
-GameWindow::GameWindow(QWidget *parent) : QMainWindow(parent), m_voiceChallenge(nullptr), m_audioSystem(nullptr)
+GameWindow::GameWindow(AudioSystem *audioSystem, QWidget *parent) : QMainWindow(parent), m_voiceChallenge(nullptr), m_challenges(nullptr), m_audioSystem(nullptr), m_microphone(nullptr), m_keywordSpotter(nullptr), m_passedByVoice(false), m_gameLoop(nullptr), m_movement(nullptr), m_roomManager(nullptr), m_background(nullptr), m_player(nullptr), m_monsters(&m_entities)
 {
 
     // Creates a scene and sets its size
     scene = new QGraphicsScene(this);
     scene->setSceneRect(0, 0, 1440, 900);
 
-    // Loads the background image
-    QGraphicsPixmapItem *background = new QGraphicsPixmapItem(QPixmap(":/images/room1_bg.png"));
-    background->setPos(0, 0);
-    background->setZValue(-1);
-    scene->addItem(background);
+    // Creates the background item, the image is set by the room
+    m_background = new QGraphicsPixmapItem();
+    m_background->setPos(0, 0);
+    m_background->setZValue(-1);
+    scene->addItem(m_background);
 
     // Creates a view to display the scene
-    view = new QGraphicsView(scene, this);
+    view = new GameView(scene, this);
     view->setFixedSize(1440, 900);
     view->setFocusPolicy(Qt::StrongFocus);
     view->setFocus();
     setCentralWidget(view);
 
     // Initializes the audio system
-    setupAudio();
+    setupAudio(audioSystem);
     m_audioSystem->playBackgroundMusic("qrc:/horror_music/background_music1.mp3", true);
 
-    // Creates and configures the player
+    // Decodes and scales the directional sprites off the GUI thread, the player shows them once ready
+    SpriteCache::instance().preload(QSize(75, 75), this, [this]() {
+        if (m_player) m_player->refreshSprite();
+    });
+
+    // Creates the player's entity and the item that shows it
+    const Entity playerEntity = Systems::createPlayer(m_entities, QPointF(695, 800));
     Player *player = new Player();
+    m_player = player;
     player->setPos(695, 800);
     player->setZValue(1);
     player->setFlag(QGraphicsItem::ItemIsFocusable);
+    player->setEntity(&m_entities, playerEntity);
+    m_entities.setSprite(playerEntity, player);
     scene->addItem(player);
 
+    // Plays the idle and walk cycles once the sheets are sliced, the static sprites are shown until then
+    m_animationClock.add(player->animation());
+    AnimationSet::loadPlayer(this, [this](QSharedPointer<const AnimationSet> set) {
+        if (m_player) m_player->setAnimationSet(set);
+    });
+
     // Creates the movement handler for the player
-    Movement *movement = new Movement(player);
-    player->setMovement(movement);
+    m_movement = new Movement(&m_entities, playerEntity, player, this);
+    m_movement->setCollisionWorld(&m_collisionWorld);
+    player->setMovement(m_movement);
 
     // Set focus to the view first, then to the player
     view->setFocus();
@@ -68,12 +142,28 @@ GameWindow::GameWindow(QWidget *parent) : QMainWindow(parent), m_voiceChallenge(
         player->setFocus();
     });
 
-    // Adds collision walls
-    addWalls();
+    // Loads the first room, which adds its collision walls and moves the player to the spawn point
+    m_roomManager = new RoomManager(this);
+    connect(m_roomManager, &RoomManager::backgroundReady, this, [this](const QString &name, const QPixmap &background) {
+        if (m_level && m_level->name() == name) {
+            m_background->setPixmap(background);
+        }
+    });
+    loadRoom("room1");
 
     // Creates an input handler and connects to the player
     m_inputHandler = new InputHandler(this);
     m_inputHandler->setPlayer(player);
+    player->setInputHandler(m_inputHandler);
+
+    // Challenges are timed by the game loop and seeded so a recorded session can be replayed
+    m_challenges = new ChallengeScheduler(QRandomGenerator::global()->generate(), this);
+
+    // Starts moving the player from the held keys every tick, no tick runs before the event loop
+    setupGameLoop();
+    setupRecording();
+    setupProfiling();
+    setupVoiceInput();
 
     // Initializes a text challenge system with a short delay
     QTimer::singleShot(500, [this]() {
@@ -91,66 +181,105 @@ GameWindow::GameWindow(QWidget *parent) : QMainWindow(parent), m_voiceChallenge(
 GameWindow::~GameWindow()
 {
 
+    m_recorder.close(m_gameLoop ? m_gameLoop->tickCount() : 0);
+
+    // Joins the analysis thread before the spotter it feeds is destroyed
+    if (m_microphone) {
+        m_microphone->stopListening();
+    }
+
+    if (!m_profilePath.isEmpty()) {
+        QString error;
+        Profiler::instance().collect();
+        if (!Profiler::instance().write(m_profilePath, &error)) {
+            LOG_WARNING("game", "Cannot write profile: %1", error);
+        }
+    }
+
     delete m_audioSystem;
 
 }
 
 /**
- * @brief Adds collision walls to the game scene
+ * @brief Loads a room
+ * @param name represents the room name, for example "room1"
+ * @return true if the room was loaded
+ *
+ * Takes the room from the room manager, which has normally prefetched it already, then swaps in
+ * the background, collision walls, trigger zones and monsters and moves the player to the spawn point
+ */
+
+bool GameWindow::loadRoom(const QString &name)
+{
+
+    QString error;
+    const Room *room = m_roomManager->enterRoom(name, &error);
+    if (!room) {
+        LOG_WARNING("room", "Failed to load room %1: %2", name, error);
+        return false;
+    }
+
+    m_level = room->level;
+
+    const QSizeF size = m_level->sceneSize();
+    scene->setSceneRect(0, 0, size.width(), size.height());
+    // A room entered before its background finished decoding shows it once backgroundReady() fires
+    m_background->setPixmap(room->background);
+
+    // The collision grid was built by the room manager, copying it only shares its arrays
+    m_collisionWorld = room->collision;
+
+    m_triggers.reset(m_level->triggerCount());
+    spawnMonsters();
+
+    // Decodes the room's effects now, so the first trigger does not wait for them, and places
+    // the looping and on-enter cues in the room
+    if (m_audioSystem) {
+        QVector<SoundEmitter> emitters;
+        for (int i = 0; i < m_level->cueCount(); ++i) {
+            const LevelCue cue = m_level->cue(i);
+            m_audioSystem->preloadSoundEffect(cue.source);
+            if (cue.loop || cue.onEnter) {
+                emitters.append(soundEmitter(cue));
+            }
+        }
+        m_audioSystem->setRoomEmitters(emitters);
+    }
+
+    if (m_movement) {
+        m_movement->setPosition(m_level->spawnPoint());
+    }
+
+    return true;
+
+}
+
+/**
+ * @brief Places the current room's monsters
  *
- * Creates transparent rectangular collision objects to mimic walls and other objects within the game scene
+ * Builds the monsters' navigation grid from the room's collision walls and replaces the scene
+ * items of the previous room's monsters, which are deleted before their entities
  */
 
-void GameWindow::addWalls()
+void GameWindow::spawnMonsters()
 {
 
-    // Wall object for collision
-    QGraphicsRectItem *wall1 = new QGraphicsRectItem(0, 310, 480, 40);
-    wall1->setBrush(Qt::transparent);
-    wall1->setPen(Qt::NoPen);
-    scene->addItem(wall1);
-
-    // Wall object for collision
-    QGraphicsRectItem *wall2 = new QGraphicsRectItem(450, 280, 1000, 40);
-    wall2->setBrush(Qt::transparent);
-    wall2->setPen(Qt::NoPen);
-    scene->addItem(wall2);
-
-    // Wall object for collision
-    QGraphicsRectItem *wall3 = new QGraphicsRectItem(0, 348, 40, 600);
-    wall3->setBrush(Qt::transparent);
-    wall3->setPen(Qt::NoPen);
-    scene->addItem(wall3);
-
-    // Wall object for collision
-    QGraphicsRectItem *wall4 = new QGraphicsRectItem(0, 860, 590, 40);
-    wall4->setBrush(Qt::transparent);
-    wall4->setPen(Qt::NoPen);
-    scene->addItem(wall4);
-
-    // Wall object for collision
-    QGraphicsRectItem *wall5 = new QGraphicsRectItem(850, 860, 600, 40);
-    wall5->setBrush(Qt::transparent);
-    wall5->setPen(Qt::NoPen);
-    scene->addItem(wall5);
-
-    // Wall object for collision
-    QGraphicsRectItem *wall6 = new QGraphicsRectItem(1400, 330, 40, 600);
-    wall6->setBrush(Qt::transparent);
-    wall6->setPen(Qt::NoPen);
-    scene->addItem(wall6);
-
-    // Wall object for collision
-    QGraphicsRectItem *wall7 = new QGraphicsRectItem(218, 532, 280, 138);
-    wall7->setBrush(Qt::transparent);
-    wall7->setPen(Qt::NoPen);
-    scene->addItem(wall7);
-
-    // Wall object for collision
-    QGraphicsRectItem *wall8 = new QGraphicsRectItem(923, 532, 280, 138);
-    wall8->setBrush(Qt::transparent);
-    wall8->setPen(Qt::NoPen);
-    scene->addItem(wall8);
+    for (int i = 0; i < m_monsters.count(); ++i) {
+        delete m_entities.sprite(m_monsters.monster(i).entity);
+    }
+
+    m_monsters.reset(&m_collisionWorld, QRectF(QPointF(0, 0), m_level->sceneSize()));
+
+    for (int i = 0; i < m_level->monsterCount(); ++i) {
+        const LevelMonster monster = m_level->monster(i);
+        const Entity entity = m_monsters.spawn(monster.position, monster.speed);
+
+        QGraphicsItem *item = createMonsterItem();
+        item->setPos(monster.position);
+        item->setZValue(1);
+        scene->addItem(item);
+        m_entities.setSprite(entity, item);
+    }
 
 }
 
@@ -173,43 +302,260 @@ void GameWindow::initVoiceChallenge()
         }
     }
 
-    // Create text challenge with our scene and player
-    m_voiceChallenge = new VoiceChallenge(scene, player, this);
+    // Create text challenge with our scene and player, shown whenever the scheduler starts one
+    m_voiceChallenge = new VoiceChallenge(scene, player, m_challenges, this);
     m_voiceChallenge->setJumpscareFolder(":/jumpscares");
+    m_voiceChallenge->setVoiceInputEnabled(m_keywordSpotter != nullptr);
+
+    // The scheduler was started with the game loop (30 secs in between challenges, 10 secs to
+    // complete one), starting it again here would shift the challenges off the recorded ticks
+    LOG_DEBUG("challenge", "Text challenge system initialized with resource path");
+
+}
+
+/**
+ * @brief Initializes the audio system for the game
+ * @param audioSystem represents the menu's audio system, or nullptr
+ *
+ * Takes ownership of the menu's AudioSystem so its music keeps playing into the game's, or
+ * creates a new AudioSystem instance
+ */
+
+void GameWindow::setupAudio(AudioSystem *audioSystem)
+{
+
+    if (audioSystem) {
+        audioSystem->setParent(this);
+        m_audioSystem = audioSystem;
+        return;
+    }
+
+    m_audioSystem = new AudioSystem(this);
+
+}
+
+/**
+ * @brief Starts listening for the challenge phrases
+ *
+ * The spotter runs on the microphone's analysis thread and only knows phrases the player has
+ * said before: whenever a challenge is passed by typing, the utterance heard during it becomes a
+ * template of its phrase. A recognised phrase is submitted like typed input, so it is recorded
+ * in the input log and a replay does not need the microphone
+ */
+
+void GameWindow::setupVoiceInput()
+{
+
+    m_microphone = new AudioManager(this);
+    if (!m_microphone->isInitialized()) {
+        LOG_INFO("voice", "No microphone, challenges are typed only");
+        return;
+    }
+
+    m_keywordSpotter = new KeywordSpotter(m_microphone->sampleRate(), this);
+
+    QString error;
+    if (!m_keywordSpotter->load(KeywordSpotter::defaultPath(), &error)) {
+        LOG_DEBUG("voice", "No keyword templates loaded: %1", error);
+    }
+
+    KeywordSpotter *spotter = m_keywordSpotter;
+    m_microphone->setHopCallback([spotter](const qint16 *samples, int count, qreal, VoiceActivity activity) {
+        spotter->processHop(samples, count, activity);
+    });
+
+    // Speech is only processed while a challenge is waiting for it
+    connect(m_challenges, &ChallengeScheduler::challengeStarted, this, [this]() {
+        m_passedByVoice = false;
+        m_keywordSpotter->clearLastUtterance();
+        m_microphone->setProcessingEnabled(true);
+    });
+
+    connect(m_challenges, &ChallengeScheduler::challengeFailed, this, [this]() {
+        m_microphone->setProcessingEnabled(false);
+    });
+
+    connect(m_keywordSpotter, &KeywordSpotter::phraseDetected, this, [this](const QString &phrase, qreal distance) {
+        if (!m_challenges->isActive()) return;
+        if (phrase != m_challenges->currentChallenge().toLower().trimmed()) return;
+
+        LOG_DEBUG("voice", "Heard \"%1\" at distance %2", phrase, distance);
+        m_passedByVoice = true;
+        m_challenges->submit(phrase);
+    });
+
+    connect(m_challenges, &ChallengeScheduler::challengePassed, this, [this]() {
+        const AudioGateStats stats = m_microphone->gateStats();
+        LOG_DEBUG("voice", "Voice gate skipped %1% of hops so far, saving about %2 ms",
+                  qRound(stats.skippedFraction() * 100), qRound(stats.savedMs()));
+
+        if (m_passedByVoice) {
+            m_microphone->setProcessingEnabled(false);
+            return;
+        }
+
+        // Keeps listening until the phrase the player may still be saying has ended, disabling
+        // processing now would end the utterance early
+        m_keywordSpotter->enrollUtterance(m_challenges->currentChallenge());
+    });
+
+    connect(m_keywordSpotter, &KeywordSpotter::enrollmentFinished, this, [this](const QString &, bool enrolled) {
+        if (!m_challenges->isActive()) {
+            m_microphone->setProcessingEnabled(false);
+        }
+
+        if (!enrolled) return;
+
+        QString error;
+        if (!m_keywordSpotter->save(KeywordSpotter::defaultPath(), &error)) {
+            LOG_WARNING("voice", "Cannot save keyword templates: %1", error);
+        }
+    });
+
+    m_microphone->startListening();
+
+}
+
+/**
+ * @brief Starts the fixed timestep game loop
+ *
+ * Every tick samples the held keys, steers the monsters, moves every entity, steps every sprite
+ * animation and the challenge clock. Every frame mirrors the entities into their scene items
+ * between the last two ticks so movement is smooth at any display rate. The tick only uses state
+ * that the headless simulation replays
+ */
+
+void GameWindow::setupGameLoop()
+{
+
+    m_gameLoop = new GameLoop(this);
+    m_gameLoop->setTickRate(60);
+    m_gameLoop->setFrameRate(60);
+
+    connect(m_gameLoop, &GameLoop::tick, this, [this](qreal dt) {
+        m_recorder.recordKeys(m_gameLoop->tickCount(), m_inputHandler->heldKeys());
+
+        const QPointF direction = m_inputHandler->direction();
+        m_movement->update(direction);
+        {
+            ProfileScope scope(ProfileSection::Monsters);
+            const int damage = m_monsters.update(m_movement->bounds(), dt);
+            if (damage > 0) {
+                m_player->decreaseHealth(damage);
+            }
+        }
+        {
+            ProfileScope scope(ProfileSection::Movement);
+            Systems::integrate(m_entities, &m_collisionWorld, dt);
+            m_player->setWalking(!direction.isNull());
+            m_animationClock.advance(dt);
+            checkTriggers();
+        }
+        {
+            ProfileScope scope(ProfileSection::Challenges);
+            m_challenges->advance(dt);
+        }
+    });
+
+    connect(m_gameLoop, &GameLoop::render, this, [this](qreal alpha) {
+        Systems::mirror(m_entities, alpha);
+
+        // The mixer pans and attenuates the room's sounds from here on its next block
+        m_audioSystem->setListenerPosition(m_player->sceneBoundingRect().center());
 
-    // Log available images for debugging
-    qDebug() << "Checking for jumpscare images:";
-    for (int i = 1; i <= 12; i++) {
-        QString path = QString(":/jumpscares/image%1.jpg").arg(i);
-        QFile file(path);
-        if (file.exists()) {
-            qDebug() << "  Found image:" << path;
-        } else {
-            qDebug() << "  Missing image:" << path;
+        // Moves the samples recorded since the last frame into the overlay's history
+        if (Profiler::instance().isEnabled()) {
+            Profiler::instance().collect();
+            view->refreshOverlay();
         }
+    });
+
+    view->setGameLoop(m_gameLoop);
+
+    m_challenges->start();
+    m_gameLoop->start();
+
+}
+
+/**
+ * @brief Starts recording the session's input
+ *
+ * Enabled with --record <file>. The log holds the challenge seed, the held keys whenever they
+ * change and every submitted challenge input, each stamped with its tick
+ */
+
+void GameWindow::setupRecording()
+{
+
+    const QStringList arguments = QCoreApplication::arguments();
+    const int index = arguments.indexOf("--record");
+    if (index < 0 || index + 1 >= arguments.size()) return;
+
+    QString error;
+    if (!m_recorder.open(arguments.at(index + 1), m_challenges->seed(), m_gameLoop->tickRate(), m_level ? m_level->name() : QString("room1"), &error)) {
+        LOG_WARNING("game", "Cannot record input: %1", error);
+        return;
     }
 
-    // Sets the challenge parameters (30 secs in between challenges)
-    m_voiceChallenge->setChallengeInterval(30000);
+    // Submissions happen between ticks and are replayed before the next one
+    connect(m_challenges, &ChallengeScheduler::inputSubmitted, this, [this](const QString &input) {
+        m_recorder.recordSubmit(m_gameLoop ? m_gameLoop->tickCount() : 0, input);
+    });
 
-    // 10 secs to complete a challenge
-    m_voiceChallenge->setChallengeTime(10000);
+}
 
-    // Starts the challenge
-    m_voiceChallenge->start();
-    qDebug() << "Text challenge system initialized with resource path.";
+/**
+ * @brief Keeps every profiler sample for writing on exit
+ *
+ * Enabled with --profile <file>, the samples are written as a Chrome trace when the file ends in
+ * .json and as CSV otherwise. F3 shows the overlay with or without this option
+ */
+
+void GameWindow::setupProfiling()
+{
+
+    const QStringList arguments = QCoreApplication::arguments();
+    const int index = arguments.indexOf("--profile");
+    if (index < 0 || index + 1 >= arguments.size()) return;
+
+    m_profilePath = arguments.at(index + 1);
+    Profiler::instance().setRetainSamples(true);
+    Profiler::instance().setEnabled(true);
+    view->setProfilerPinned(true);
 
 }
 
 /**
- * @brief Initializes the audio system for the game
+ * @brief Fires the trigger zones the player has just entered
  *
- * Creates a new AudioSystem instance
+ * Plays the audio cue attached to a trigger on entry, once-only triggers fire a single time per visit.
+ * A trigger with a target room is a door and moves the player into that room
  */
 
-void GameWindow::setupAudio()
+void GameWindow::checkTriggers()
 {
 
-    m_audioSystem = new AudioSystem(this);
+    if (!m_player || !m_movement || !m_level) return;
+
+    QString door;
+    const QVector<int> entered = m_triggers.update(*m_level, m_movement->bounds());
+
+    for (int index : entered) {
+        const LevelTrigger trigger = m_level->trigger(index);
+
+        if (trigger.cue >= 0 && m_audioSystem) {
+            m_audioSystem->playSoundEffectAt(soundEmitter(m_level->cue(trigger.cue)));
+        }
+
+        if (!trigger.target.isEmpty()) {
+            door = trigger.target;
+            break;
+        }
+    }
+
+    // Switches rooms after the loop, loading replaces the trigger data being iterated
+    if (!door.isEmpty()) {
+        loadRoom(door);
+    }
 
 }
@@ -3,37 +3,93 @@
 
 #include <QMainWindow>
 #include "audiosystem.h"
+#include "collisionworld.h"
+#include "entityworld.h"
+#include "level.h"
+#include "monsterai.h"
+#include "spriteanimation.h"
+#include "inputlog.h"
+#include "triggertracker.h"
+#include <QSharedPointer>
+#include <QVector>
 
 class QGraphicsScene;
-class QGraphicsView;
+class GameView;
+class QGraphicsPixmapItem;
 class InputHandler;
 class VoiceChallenge;
+class GameLoop;
+class Movement;
+class Player;
+class RoomManager;
+class ChallengeScheduler;
+class AudioManager;
+class KeywordSpotter;
 
 class GameWindow : public QMainWindow
 {
     Q_OBJECT
 public:
-    explicit GameWindow(QWidget *parent = nullptr);
+    // Takes over audioSystem if given, so the music playing in the menu crossfades into the game's
+    explicit GameWindow(AudioSystem *audioSystem = nullptr, QWidget *parent = nullptr);
     ~GameWindow();
 
     AudioSystem* audioSystem() const { return m_audioSystem; }  // Getter for audio system
+    GameLoop* gameLoop() const { return m_gameLoop; }  // Getter for the game loop (tick and frame times)
+    RoomManager* roomManager() const { return m_roomManager; }  // Getter for the room streaming manager
+    ChallengeScheduler* challengeScheduler() const { return m_challenges; }  // Getter for the challenge timing
+
+    // Loads a room by name and places the player at its spawn point
+    bool loadRoom(const QString &name);
 
 private:
-    // Helper function to add walls to the scene
-    void addWalls();
+    // Plays the cues of trigger zones the player has just entered and follows doors
+    void checkTriggers();
 
     // Initialize the voice challenge system
     void initVoiceChallenge();
 
-    // declare audio system
-    void setupAudio();
+    // declare audio system, taking over the menu's if there is one
+    void setupAudio(AudioSystem *audioSystem);
+
+    // Listens to the microphone for the challenge phrases, learning them from typed answers
+    void setupVoiceInput();
+
+    // Places the current room's monsters and gives each a scene item
+    void spawnMonsters();
+
+    // Starts the fixed timestep loop that moves the player
+    void setupGameLoop();
+
+    // Starts recording the session's input when the game was run with --record <file>
+    void setupRecording();
+
+    // Keeps every profiler sample for writing on exit when the game was run with --profile <file>
+    void setupProfiling();
 
 private:
     QGraphicsScene *scene;
-    QGraphicsView *view;
+    GameView *view;
     InputHandler *m_inputHandler;
     VoiceChallenge *m_voiceChallenge;
+    ChallengeScheduler *m_challenges;  // Challenge timing, advanced on the game loop's tick
     AudioSystem *m_audioSystem;  // Add audio system member
+    AudioManager *m_microphone;  // Captures and analyses the microphone off the GUI thread
+    KeywordSpotter *m_keywordSpotter;  // Recognises spoken challenge phrases, null without a microphone
+    bool m_passedByVoice;  // The last challenge was passed by speaking, so it is not enrolled again
+    GameLoop *m_gameLoop;
+    Movement *m_movement;
+    AnimationClock m_animationClock;  // Advances every sprite animation on the game loop's tick
+    CollisionWorld m_collisionWorld;  // Static walls of the room
+    RoomManager *m_roomManager;  // Keeps the current room resident and prefetches its neighbours
+    QSharedPointer<Level> m_level;  // Memory mapped data of the current room
+    QGraphicsPixmapItem *m_background;
+    EntityWorld m_entities;  // Positions, velocities, colliders and health of the player and monsters
+    Player *m_player;  // Scene item of the player, placed from its entity every frame
+    TriggerTracker m_triggers;  // Trigger zones the player is inside or has fired
+    MonsterAI m_monsters;  // Monsters of the current room, steered on the game loop's tick
+    InputRecorder m_recorder;  // Writes the input log replayed by --headless
+    QString m_profilePath;  // CSV or Chrome trace written on exit, empty when not profiling
 };
 
 #endif // GAMEWINDOW_H
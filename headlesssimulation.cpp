@@ -0,0 +1,349 @@
+/**
+ * @file headlesssimulation.cpp
+ * @brief Implementation of the HeadlessSimulation class
+ * @author Kiet Tran
+ */
+
+#include "headlesssimulation.h"
+#include "entitysystems.h"
+#include "inputhandler.h"
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+namespace {
+
+// FNV-1a offset basis and prime for the state checksum
+const quint64 kFnvOffset = 14695981039346656037ULL;
+const quint64 kFnvPrime = 1099511628211ULL;
+
+// Folds raw bytes into a running FNV-1a hash
+quint64 fnv1a(quint64 hash, const void *data, size_t size)
+{
+
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= kFnvPrime;
+    }
+
+    return hash;
+
+}
+
+}
+
+/**
+ * @brief Constructs a HeadlessSimulation with no room loaded
+ *
+ * The player is an entity without a sprite and collides with the simulation's own grid
+ */
+
+HeadlessSimulation::HeadlessSimulation()
+    : m_player(Systems::createPlayer(m_entities, QPointF()))
+    , m_movement(&m_entities, m_player, nullptr)
+    , m_monsters(&m_entities)
+    , m_crowd(0)
+    , m_heldKeys(0)
+    , m_triggersFired(0)
+    , m_roomChanges(0)
+    , m_monsterDamage(0)
+{
+
+    m_movement.setCollisionWorld(&m_collision);
+
+}
+
+/**
+ * @brief Replays a recorded session
+ * @param log represents the recorded inputs and session settings
+ * @param report receives the final state and the cost of the ticks
+ * @param error receives a description of the problem on failure
+ * @return false if a room of the session could not be loaded
+ *
+ * Inputs recorded for a tick are applied before that tick is simulated, exactly as the game
+ * window sampled them
+ */
+
+bool HeadlessSimulation::run(const InputLog &log, SimulationReport *report, QString *error)
+{
+
+    *report = SimulationReport();
+    report->checksum = kFnvOffset;
+
+    if (!loadRoom(log.room, error)) {
+        return false;
+    }
+
+    m_movement.setPosition(m_level.spawnPoint());
+    m_movement.update(QPointF());
+    m_triggers.reset(m_level.triggerCount());
+    spawnMonsters();
+    m_entities.health(m_player)->set(Systems::kPlayerHealth);
+    m_challenges.setSeed(log.seed);
+    m_challenges.start();
+    m_heldKeys = 0;
+    m_triggersFired = 0;
+    m_roomChanges = 0;
+    m_monsterDamage = 0;
+
+    const qreal dt = 1.0 / log.tickRate;
+    int nextEvent = 0;
+    QElapsedTimer clock;
+    clock.start();
+
+    for (quint64 tick = 0; tick < log.endTick; ++tick) {
+        const qint64 startNs = clock.nsecsElapsed();
+
+        while (nextEvent < log.events.size() && log.events.at(nextEvent).tick <= tick) {
+            const InputEvent &event = log.events.at(nextEvent++);
+            if (event.type == InputEvent::Keys) {
+                m_heldKeys = event.keys;
+            } else {
+                m_challenges.submit(event.text);
+            }
+        }
+
+        step(dt);
+
+        const qint64 costNs = clock.nsecsElapsed() - startNs;
+        report->elapsedNs += costNs;
+        report->maxTickNs = qMax(report->maxTickNs, costNs);
+        ++report->ticks;
+
+        hashState(report);
+    }
+
+    report->room = m_level.name();
+    report->position = m_movement.position();
+    report->health = m_entities.health(m_player)->current();
+    report->passed = m_challenges.passedCount();
+    report->failed = m_challenges.failedCount();
+    report->triggersFired = m_triggersFired;
+    report->roomChanges = m_roomChanges;
+    report->monsterDamage = m_monsterDamage;
+
+    return true;
+
+}
+
+/**
+ * @brief Maps a room and builds its collision grid
+ *
+ * Repeated replays of the same room reuse the mapping and the grid
+ */
+
+bool HeadlessSimulation::loadRoom(const QString &name, QString *error)
+{
+
+    if (m_level.isValid() && m_level.name() == name) {
+        return true;
+    }
+
+    if (!m_level.load(name, error)) {
+        return false;
+    }
+
+    m_collision.clear();
+    for (int i = 0; i < m_level.wallCount(); ++i) {
+        m_collision.addWall(m_level.wall(i));
+    }
+    m_collision.build();
+
+    return true;
+
+}
+
+/**
+ * @brief Places the current room's monsters at their spawn points
+ *
+ * The crowd is spread evenly over the walkable cells in row order, so the same room always gets
+ * the same crowd
+ */
+
+void HeadlessSimulation::spawnMonsters()
+{
+
+    m_monsters.reset(&m_collision, QRectF(QPointF(0, 0), m_level.sceneSize()));
+    for (int i = 0; i < m_level.monsterCount(); ++i) {
+        const LevelMonster monster = m_level.monster(i);
+        m_monsters.spawn(monster.position, monster.speed);
+    }
+
+    const NavGrid &grid = m_monsters.grid();
+    if (m_crowd <= 0 || grid.walkableCount() == 0) return;
+
+    int walkable = 0;
+    int spawned = 0;
+    for (int cell = 0; cell < grid.cellCount() && spawned < m_crowd; ++cell) {
+        if (!grid.isWalkable(cell)) continue;
+
+        // Spawns at the walkable cells whose rank crosses the next multiple of the spacing
+        if (qint64(walkable) * m_crowd >= qint64(spawned) * grid.walkableCount()) {
+            m_monsters.spawn(grid.cellCenter(cell));
+            ++spawned;
+        }
+        ++walkable;
+    }
+
+}
+
+/**
+ * @brief Runs one fixed simulation step
+ * @param dt represents the step in seconds
+ *
+ * Mirrors the game window's tick: the player's and the monsters' velocities, moving every entity,
+ * trigger zones and doors, then the challenge clock
+ */
+
+void HeadlessSimulation::step(qreal dt)
+{
+
+    m_movement.update(InputHandler::directionFromKeys(m_heldKeys));
+
+    const int damage = m_monsters.update(m_movement.bounds(), dt);
+    if (damage > 0) {
+        m_entities.health(m_player)->decrease(damage);
+        m_monsterDamage += damage;
+    }
+
+    Systems::integrate(m_entities, &m_collision, dt);
+
+    QString door;
+    const QVector<int> entered = m_triggers.update(m_level, m_movement.bounds());
+    for (int index : entered) {
+        ++m_triggersFired;
+
+        const QString target = m_level.trigger(index).target;
+        if (!target.isEmpty()) {
+            door = target;
+            break;
+        }
+    }
+
+    if (!door.isEmpty() && loadRoom(door, nullptr)) {
+        m_movement.setPosition(m_level.spawnPoint());
+        m_triggers.reset(m_level.triggerCount());
+        spawnMonsters();
+        ++m_roomChanges;
+    }
+
+    const int failedBefore = m_challenges.failedCount();
+    m_challenges.advance(dt);
+    if (m_challenges.failedCount() != failedBefore) {
+        m_entities.health(m_player)->decrease(m_challenges.damage());
+    }
+
+}
+
+/**
+ * @brief Folds the state after a tick into the checksum
+ */
+
+void HeadlessSimulation::hashState(SimulationReport *report) const
+{
+
+    const QPointF position = m_movement.position();
+    const double coordinates[2] = { position.x(), position.y() };
+    const int counters[4] = { m_entities.health(m_player)->current(), m_challenges.passedCount(), m_challenges.failedCount(), m_roomChanges };
+
+    quint64 hash = report->checksum;
+    hash = fnv1a(hash, coordinates, sizeof(coordinates));
+    hash = fnv1a(hash, counters, sizeof(counters));
+    for (int i = 0; i < m_monsters.count(); ++i) {
+        const QPointF monster = m_monsters.position(i);
+        const double center[2] = { monster.x(), monster.y() };
+        hash = fnv1a(hash, center, sizeof(center));
+    }
+
+    report->checksum = hash;
+
+}
+
+/**
+ * @brief Handles the --headless command line
+ * @param arguments represents the application arguments
+ * @return Returns 0 on success, 1 on bad input and 2 if repeated replays diverged
+ *
+ * Replays --replay <log> (or an idle session of --ticks ticks) --repeat times, twice by default,
+ * on the same simulation. Every run must end with the same checksum, which catches state that
+ * leaks from one run into the next as well as nondeterminism. Prints the per-tick cost for
+ * comparing builds. --crowd adds monsters to every room to measure the entity systems under load
+ */
+
+int HeadlessSimulation::runFromCommandLine(const QStringList &arguments)
+{
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays recorded sessions without a window or audio device");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("headless", "Run the simulation without a window."));
+    parser.addOption(QCommandLineOption("replay", "Input log to replay.", "log"));
+    parser.addOption(QCommandLineOption("ticks", "Length of an idle session when no log is given.", "ticks", "3600"));
+    parser.addOption(QCommandLineOption("seed", "Challenge seed of an idle session.", "seed", "0"));
+    parser.addOption(QCommandLineOption("repeat", "Number of times the session is replayed.", "count", "2"));
+    parser.addOption(QCommandLineOption("crowd", "Extra monsters spawned in every room.", "count", "0"));
+    parser.process(arguments);
+
+    InputLog log;
+    QString error;
+    if (parser.isSet("replay")) {
+        if (!log.load(parser.value("replay"), &error)) {
+            err << "Cannot read input log: " << error << Qt::endl;
+            return 1;
+        }
+    } else {
+        log.endTick = parser.value("ticks").toULongLong();
+        log.seed = parser.value("seed").toUInt();
+    }
+
+    const int repeat = qMax(1, parser.value("repeat").toInt());
+
+    HeadlessSimulation simulation;
+    simulation.setCrowd(parser.value("crowd").toInt());
+    SimulationReport first;
+    SimulationReport report;
+    qint64 tickNs = 0;
+    qint64 maxTickNs = 0;
+
+    QElapsedTimer wall;
+    wall.start();
+
+    for (int i = 0; i < repeat; ++i) {
+        if (!simulation.run(log, &report, &error)) {
+            err << "Replay failed: " << error << Qt::endl;
+            return 1;
+        }
+
+        tickNs += report.elapsedNs;
+        maxTickNs = qMax(maxTickNs, report.maxTickNs);
+
+        if (i == 0) {
+            first = report;
+        } else if (report.checksum != first.checksum) {
+            err << "Replay " << i + 1 << " diverged from the first run: position (" << report.position.x() << ", "
+                << report.position.y() << ") vs (" << first.position.x() << ", " << first.position.y() << "), health "
+                << report.health << " vs " << first.health << ", challenges passed " << report.passed << " vs "
+                << first.passed << ", failed " << report.failed << " vs " << first.failed << Qt::endl;
+            return 2;
+        }
+    }
+
+    const qreal wallMs = wall.nsecsElapsed() / 1e6;
+    const quint64 totalTicks = first.ticks * repeat;
+
+    out << "Replayed " << repeat << " session(s) of " << first.ticks << " ticks in " << wallMs << " ms\n"
+        << "  mean tick " << (totalTicks ? tickNs / 1000.0 / totalTicks : 0.0) << " us, max tick "
+        << maxTickNs / 1000.0 << " us, " << (wallMs > 0 ? repeat * 60000.0 / wallMs : 0.0) << " sessions/min\n"
+        << "  room " << first.room << ", position (" << first.position.x() << ", " << first.position.y()
+        << "), health " << first.health << ", challenges passed " << first.passed << " failed " << first.failed
+        << ", triggers " << first.triggersFired << ", room changes " << first.roomChanges
+        << ", monster damage " << first.monsterDamage << '\n'
+        << "  checksum " << QString::number(first.checksum, 16) << Qt::endl;
+
+    return 0;
+
+}
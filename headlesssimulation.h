@@ -0,0 +1,100 @@
+/**
+ * @file headlesssimulation.h
+ * @brief Runs the game rules without a window or audio device from a recorded input log
+ * @author Kiet Tran
+ */
+
+#ifndef HEADLESSSIMULATION_H
+#define HEADLESSSIMULATION_H
+
+#include <QPointF>
+#include <QString>
+#include <QStringList>
+#include "challengescheduler.h"
+#include "collisionworld.h"
+#include "entityworld.h"
+#include "inputlog.h"
+#include "level.h"
+#include "monsterai.h"
+#include "movement.h"
+#include "triggertracker.h"
+
+/**
+ * @brief Outcome and cost of one replayed session
+ */
+
+struct SimulationReport {
+    quint64 ticks = 0;
+    qint64 elapsedNs = 0;   // Wall time of the whole replay
+    qint64 maxTickNs = 0;   // Slowest single tick
+    QString room;
+    QPointF position;
+    int health = 0;
+    int passed = 0;
+    int failed = 0;
+    int triggersFired = 0;
+    int roomChanges = 0;
+    int monsterDamage = 0;  // Health taken by monsters
+    quint64 checksum = 0;   // Hash of the state after every tick, equal for identical runs
+
+    // Mean wall time of one tick (microseconds)
+    qreal meanTickUs() const { return ticks ? elapsedNs / 1000.0 / ticks : 0.0; }
+};
+
+/**
+ * @brief Replays an InputLog through the same EntityWorld, entity systems, Movement,
+ * ChallengeScheduler, TriggerTracker and MonsterAI the game uses, without scene items, timers or
+ * audio
+ *
+ * Time is virtual: every tick advances the systems by exactly 1 / tickRate seconds and the next
+ * tick starts immediately, so a session runs as fast as the CPU allows and the same log always
+ * ends in the same state
+ */
+
+class HeadlessSimulation
+{
+public:
+    HeadlessSimulation();
+
+    // Replays a session from its first room
+    bool run(const InputLog &log, SimulationReport *report, QString *error = nullptr);
+
+    // Monsters added to every room on top of its own, spread over its walkable cells
+    void setCrowd(int monsters) { m_crowd = qMax(0, monsters); }
+
+    // Handles the --headless command line, returns the process exit code
+    static int runFromCommandLine(const QStringList &arguments);
+
+private:
+    HeadlessSimulation(const HeadlessSimulation &) = delete;
+    HeadlessSimulation &operator=(const HeadlessSimulation &) = delete;
+
+    // Maps a room and builds its collision grid, keeping the room if it is already loaded
+    bool loadRoom(const QString &name, QString *error);
+
+    // Places the current room's monsters
+    void spawnMonsters();
+
+    // Runs one fixed simulation step
+    void step(qreal dt);
+
+    // Folds the state after a tick into the report's checksum
+    void hashState(SimulationReport *report) const;
+
+    Level m_level;
+    CollisionWorld m_collision;
+    EntityWorld m_entities;
+    Entity m_player;  // Position, collider and health of the player
+    Movement m_movement;
+    ChallengeScheduler m_challenges;
+    TriggerTracker m_triggers;
+    MonsterAI m_monsters;
+
+    int m_crowd;
+    int m_heldKeys;
+    int m_triggersFired;
+    int m_roomChanges;
+    int m_monsterDamage;
+};
+
+#endif // HEADLESSSIMULATION_H
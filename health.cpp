@@ -0,0 +1,62 @@
+/**
+ * @file health.cpp
+ * @brief Implementation of the Health class
+ * @author Kiet Tran, Steph Oh
+ */
+
+#include "health.h"
+#include <QtGlobal>
+
+/**
+ * @brief Constructs a Health at its maximum
+ * @param maximum represents the maximum health points
+ */
+
+Health::Health(int maximum) : m_maximum(qMax(1, maximum)), m_current(m_maximum)
+{
+
+}
+
+/**
+ * @brief Returns the fraction of the maximum health that is left
+ */
+
+float Health::fraction() const
+{
+
+    return static_cast<float>(m_current) / m_maximum;
+
+}
+
+/**
+ * @brief Reduces the health by an amount, stopping at 0
+ */
+
+void Health::decrease(int amount)
+{
+
+    m_current = qMax(0, m_current - amount);
+
+}
+
+/**
+ * @brief Increases the health by an amount, stopping at the maximum
+ */
+
+void Health::increase(int amount)
+{
+
+    m_current = qMin(m_maximum, m_current + amount);
+
+}
+
+/**
+ * @brief Sets the health, clamped between 0 and the maximum
+ */
+
+void Health::set(int value)
+{
+
+    m_current = qBound(0, value, m_maximum);
+
+}
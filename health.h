@@ -0,0 +1,39 @@
+/**
+ * @file health.h
+ * @brief Health points of a character, independent of how they are displayed
+ * @author Kiet Tran, Steph Oh
+ */
+
+#ifndef HEALTH_H
+#define HEALTH_H
+
+/**
+ * @brief Current and maximum health with clamping
+ *
+ * Holds no scene items, so the same rules run in the game and in the headless simulation
+ */
+
+class Health
+{
+public:
+    explicit Health(int maximum = 100);
+
+    int current() const { return m_current; }
+    int maximum() const { return m_maximum; }
+
+    // Fraction of the maximum that is left, between 0 and 1
+    float fraction() const;
+
+    // Changes the health, the result is kept between 0 and the maximum
+    void decrease(int amount);
+    void increase(int amount);
+    void set(int value);
+
+    bool isAlive() const { return m_current > 0; }
+
+private:
+    int m_maximum;
+    int m_current;
+};
+
+#endif // HEALTH_H
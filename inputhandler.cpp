@@ -6,7 +6,9 @@
 
 #include "inputhandler.h"
 #include "movement.h"
-#include <QDebug>
+#include "spritecache.h"
+#include "profiler.h"
+#include "logger.h"
 
 /**
  * @brief Constructs an InputHandler with default key bindings
@@ -15,7 +17,7 @@
  * Initializes the default WASD key binds
  */
 
-InputHandler::InputHandler(QObject *parent) : QObject(parent), m_player(nullptr), m_step(15)
+InputHandler::InputHandler(QObject *parent) : QObject(parent), m_player(nullptr), m_step(15), m_heldKeys(0)
 {
 
     // Initializes the key bindings
@@ -24,65 +26,159 @@ InputHandler::InputHandler(QObject *parent) : QObject(parent), m_player(nullptr)
     m_keyBindings[Qt::Key_A] = "left";
     m_keyBindings[Qt::Key_D] = "right";
 
-    qDebug() << "InputHandler initialized";
+    LOG_DEBUG("input", "InputHandler initialized");
 }
 
 /**
  * @brief Handles keyboard input events for player movement
  * @param event represents the QKeyEvent containing key press information
  *
- * Processes WASD keys to move the player in the corresponding direction and to change the sprite's direction
+ * Records WASD keys as held so the game loop can move the player continuously, and turns the
+ * sprite to face the pressed direction. Auto-repeated presses are ignored
  */
 
 void InputHandler::handleKeyPress(QKeyEvent *event)
 {
 
+    ProfileScope scope(ProfileSection::Input);
+
     if (!m_player) {
-        qWarning() << "No player set for input handler";
+        LOG_WARNING("input", "No player set for input handler");
         return;
     }
 
-    // Handles key press for movement
-    int step = 15;
-    QPixmap originalSprite;
-
-    Movement* movement = m_player->getMovement();
+    const int flag = heldFlag(event->key());
+    if (!flag) {
+        event->ignore();
+        return;
+    }
 
-    // Error handling if no movement component is found
-    if (!movement) {
-        qWarning() << "No movement component found for player";
+    event->accept();
+    if (event->isAutoRepeat()) {
         return;
     }
 
+    m_heldKeys |= flag;
+
     // Switch statement to handle sprite changes
-    switch (event->key()) {
-    case Qt::Key_W:
-        movement->moveUp(step);
-        originalSprite.load(":/images/sprite_forward.png");
+    SpriteDirection direction = SpriteDirection::Down;
+    switch (flag) {
+    case HeldUp:
+        direction = SpriteDirection::Up;
         break;
-    case Qt::Key_S:
-        movement->moveDown(step);
-        originalSprite.load(":/images/sprite_back.png");
+    case HeldDown:
+        direction = SpriteDirection::Down;
         break;
-    case Qt::Key_A:
-        movement->moveLeft(step);
-        originalSprite.load(":/images/sprite_left.png");
+    case HeldLeft:
+        direction = SpriteDirection::Left;
         break;
-    case Qt::Key_D:
-        movement->moveRight(step);
-        originalSprite.load(":/images/sprite_right.png");
+    case HeldRight:
+        direction = SpriteDirection::Right;
         break;
-    default:
+    }
+
+    m_player->setFacing(direction);
+
+}
+
+/**
+ * @brief Handles keyboard release events for player movement
+ * @param event represents the QKeyEvent containing key release information
+ */
+
+void InputHandler::handleKeyRelease(QKeyEvent *event)
+{
+
+    ProfileScope scope(ProfileSection::Input);
+
+    const int flag = heldFlag(event->key());
+    if (!flag) {
+        event->ignore();
         return;
     }
 
-    if (!originalSprite.isNull()) {
-        QPixmap scaledSprite = originalSprite.scaled(75, 75, Qt::KeepAspectRatio);
-        m_player->setPixmap(scaledSprite);
+    event->accept();
+    if (!event->isAutoRepeat()) {
+        m_heldKeys &= ~flag;
     }
 
 }
 
+/**
+ * @brief Forgets every held key
+ *
+ * Prevents the player from walking on by itself when focus moves away while a key is held
+ */
+
+void InputHandler::releaseAll()
+{
+
+    m_heldKeys = 0;
+
+}
+
+/**
+ * @brief Returns the movement direction of the held keys
+ * @return Returns a unit vector, or a null point when no movement key is held
+ *
+ * Opposite keys cancel each other and diagonals are normalized so they are not faster
+ */
+
+QPointF InputHandler::direction() const
+{
+
+    return directionFromKeys(m_heldKeys);
+
+}
+
+/**
+ * @brief Returns the movement direction of a set of held keys
+ * @param heldKeys represents a combination of HeldKey flags
+ *
+ * Shared with the headless simulation, which replays recorded key states without an InputHandler
+ */
+
+QPointF InputHandler::directionFromKeys(int heldKeys)
+{
+
+    qreal dx = 0;
+    qreal dy = 0;
+
+    if (heldKeys & HeldUp) dy -= 1;
+    if (heldKeys & HeldDown) dy += 1;
+    if (heldKeys & HeldLeft) dx -= 1;
+    if (heldKeys & HeldRight) dx += 1;
+
+    if (dx != 0 && dy != 0) {
+        const qreal diagonal = 0.70710678118654752;
+        dx *= diagonal;
+        dy *= diagonal;
+    }
+
+    return QPointF(dx, dy);
+
+}
+
+/**
+ * @brief Returns the held key flag bound to a key code
+ * @param key represents the Qt key code
+ * @return Returns the flag, or 0 if the key is not a movement key
+ */
+
+int InputHandler::heldFlag(int key) const
+{
+
+    const QString binding = m_keyBindings.value(key);
+
+    if (binding == "up") return HeldUp;
+    if (binding == "down") return HeldDown;
+    if (binding == "left") return HeldLeft;
+    if (binding == "right") return HeldRight;
+
+    return 0;
+
+}
+
 /**
  * @brief Sets the player to be controlled by this input handler
  * @param player represents the pointer to the Player object
@@ -92,7 +188,7 @@ void InputHandler::setPlayer(Player *player)
 {
 
     m_player = player;
-    qDebug() << "Player set for input handler";
+    LOG_DEBUG("input", "Player set for input handler");
 
 }
 
@@ -104,6 +200,6 @@ void InputHandler::setPlayer(Player *player)
 void InputHandler::onVoiceError(const QString& error)
 {
 
-    qWarning() << "Voice recognition error: " << error;
+    LOG_WARNING("input", "Voice recognition error: %1", error);
 
 }
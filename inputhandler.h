@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QMap>
 #include <QKeyEvent>
+#include <QPointF>
 #include "player.h"
 
 class InputHandler : public QObject
@@ -11,11 +12,34 @@ class InputHandler : public QObject
     Q_OBJECT
 
 public:
+    // Bit flags of the held movement keys
+    enum HeldKey {
+        HeldUp = 0x1,
+        HeldDown = 0x2,
+        HeldLeft = 0x4,
+        HeldRight = 0x8
+    };
+
     explicit InputHandler(QObject *parent = nullptr);
 
     // Handle key press events
     void handleKeyPress(QKeyEvent *event);
 
+    // Handle key release events
+    void handleKeyRelease(QKeyEvent *event);
+
+    // Forget every held key (for example when focus is lost)
+    void releaseAll();
+
+    // Normalized movement direction from the keys currently held
+    QPointF direction() const;
+
+    // HeldKey flags of the keys currently held, as recorded in input logs
+    int heldKeys() const { return m_heldKeys; }
+
+    // Normalized movement direction of a set of HeldKey flags
+    static QPointF directionFromKeys(int heldKeys);
+
     // Set the player that this input handler controls
     void setPlayer(Player *player);
 
@@ -24,6 +48,9 @@ private slots:
     void onVoiceError(const QString& error);
 
 private:
+    // Returns the held key flag bound to a key code (0 if unbound)
+    int heldFlag(int key) const;
+
     // The player controlled by this input handler
     Player *m_player;
 
@@ -32,6 +59,9 @@ private:
 
     // Step size for movement
     int m_step;
+
+    // Movement keys currently held down
+    int m_heldKeys;
 };
 
 #endif // INPUTHANDLER_H
@@ -0,0 +1,194 @@
+/**
+ * @file inputlog.cpp
+ * @brief Implementation of the InputLog and InputRecorder classes
+ * @author Kiet Tran
+ */
+
+#include "inputlog.h"
+#include <algorithm>
+
+/**
+ * @brief Constructs an empty log at 60 ticks per second
+ */
+
+InputLog::InputLog() : seed(0), tickRate(60), room(QStringLiteral("room1")), endTick(0)
+{
+
+}
+
+/**
+ * @brief Reads a recorded session
+ * @param path represents the log file
+ * @param error receives a description of the problem on failure
+ * @return true if the log was read
+ */
+
+bool InputLog::load(const QString &path, QString *error)
+{
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    events.clear();
+    endTick = 0;
+
+    QTextStream stream(&file);
+    int lineNumber = 0;
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine();
+        ++lineNumber;
+
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        const QString command = line.section(' ', 0, 0);
+        const QString argument = line.section(' ', 1);
+        bool ok = true;
+
+        if (command == "seed") {
+            seed = argument.toUInt(&ok);
+        } else if (command == "tickrate") {
+            tickRate = argument.toInt(&ok);
+            ok = ok && tickRate > 0;
+        } else if (command == "room") {
+            room = argument.trimmed();
+            ok = !room.isEmpty();
+        } else if (command == "end") {
+            endTick = argument.toULongLong(&ok);
+        } else if (command == "k" || command == "s") {
+            InputEvent event;
+            event.tick = argument.section(' ', 0, 0).toULongLong(&ok);
+            event.type = command == "k" ? InputEvent::Keys : InputEvent::Submit;
+            event.keys = 0;
+            if (event.type == InputEvent::Keys) {
+                bool keysOk = false;
+                event.keys = argument.section(' ', 1, 1).toInt(&keysOk);
+                ok = ok && keysOk;
+            } else {
+                event.text = argument.section(' ', 1);
+            }
+            events.append(event);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            if (error) *error = QString("%1:%2: malformed line").arg(path).arg(lineNumber);
+            return false;
+        }
+    }
+
+    // Keeps the recorded order of inputs that share a tick
+    std::stable_sort(events.begin(), events.end(), [](const InputEvent &a, const InputEvent &b) {
+        return a.tick < b.tick;
+    });
+
+    if (endTick == 0 && !events.isEmpty()) {
+        endTick = events.last().tick + 1;
+    }
+
+    return true;
+
+}
+
+/**
+ * @brief Constructs a closed recorder
+ */
+
+InputRecorder::InputRecorder() : m_lastKeys(0)
+{
+
+}
+
+/**
+ * @brief Flushes a log that was never closed
+ */
+
+InputRecorder::~InputRecorder()
+{
+
+    if (isOpen()) {
+        m_stream.flush();
+        m_file.close();
+    }
+
+}
+
+/**
+ * @brief Starts a log
+ * @param path represents the file to write
+ * @param seed represents the challenge seed of the session
+ * @param tickRate represents the simulation rate of the session
+ * @param room represents the room the session starts in
+ * @param error receives a description of the problem on failure
+ */
+
+bool InputRecorder::open(const QString &path, quint32 seed, int tickRate, const QString &room, QString *error)
+{
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_lastKeys = 0;
+
+    m_stream << "# haunted input log\n"
+             << "seed " << seed << '\n'
+             << "tickrate " << tickRate << '\n'
+             << "room " << room << '\n';
+
+    return true;
+
+}
+
+/**
+ * @brief Records the held keys at the start of a tick
+ */
+
+void InputRecorder::recordKeys(quint64 tick, int keys)
+{
+
+    if (!isOpen() || keys == m_lastKeys) return;
+
+    m_lastKeys = keys;
+    m_stream << "k " << tick << ' ' << keys << '\n';
+
+}
+
+/**
+ * @brief Records submitted text
+ *
+ * Line breaks are replaced so the entry stays on one line
+ */
+
+void InputRecorder::recordSubmit(quint64 tick, const QString &text)
+{
+
+    if (!isOpen()) return;
+
+    QString line = text;
+    line.replace('\n', ' ').replace('\r', ' ');
+    m_stream << "s " << tick << ' ' << line << '\n';
+
+}
+
+/**
+ * @brief Ends the log
+ * @param endTick represents the number of ticks the session ran
+ */
+
+void InputRecorder::close(quint64 endTick)
+{
+
+    if (!isOpen()) return;
+
+    m_stream << "end " << endTick << '\n';
+    m_stream.flush();
+    m_file.close();
+
+}
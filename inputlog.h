@@ -0,0 +1,89 @@
+/**
+ * @file inputlog.h
+ * @brief Recorded player input for replaying a session tick by tick
+ * @author Kiet Tran
+ */
+
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include <QFile>
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+
+/**
+ * @brief One recorded input, applied before the simulation step of its tick
+ */
+
+struct InputEvent {
+    enum Type {
+        Keys,    // The held movement keys changed to keys
+        Submit   // text was submitted to the active challenge
+    };
+
+    quint64 tick;
+    Type type;
+    int keys;
+    QString text;
+};
+
+/**
+ * @brief Session recorded by InputRecorder
+ *
+ * Plain text, one line per entry:
+ *
+ *     seed <challenge seed>
+ *     tickrate <ticks per second>
+ *     room <first room>
+ *     k <tick> <held key flags>
+ *     s <tick> <submitted text>
+ *     end <tick>
+ *
+ * Key lines are only written when the held keys change. Lines starting with # are comments
+ */
+
+struct InputLog
+{
+    InputLog();
+
+    // Reads a log, returns false and sets error if it is malformed
+    bool load(const QString &path, QString *error = nullptr);
+
+    quint32 seed;
+    int tickRate;
+    QString room;
+    quint64 endTick;  // Number of ticks the session ran
+    QVector<InputEvent> events;  // Sorted by tick
+};
+
+/**
+ * @brief Writes an InputLog while the game is played
+ */
+
+class InputRecorder
+{
+public:
+    InputRecorder();
+    ~InputRecorder();
+
+    // Starts a log, returns false and sets error if the file cannot be written
+    bool open(const QString &path, quint32 seed, int tickRate, const QString &room, QString *error = nullptr);
+    bool isOpen() const { return m_file.isOpen(); }
+
+    // Records the held keys at the start of a tick, nothing is written if they did not change
+    void recordKeys(quint64 tick, int keys);
+
+    // Records text submitted to a challenge before the given tick runs
+    void recordSubmit(quint64 tick, const QString &text);
+
+    // Ends the log after the given number of ticks
+    void close(quint64 endTick);
+
+private:
+    QFile m_file;
+    QTextStream m_stream;
+    int m_lastKeys;
+};
+
+#endif // INPUTLOG_H
@@ -0,0 +1,466 @@
+/**
+ * @file keywordspotter.cpp
+ * @brief Implementation of the KeywordSpotter class
+ * @author Kiet Tran, Steph Oh
+ */
+
+#include "keywordspotter.h"
+#include "logger.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Shorter bursts (clicks, bumps) are not matched
+const int kMinSpeechMs = 250;
+
+// Longer utterances are cut and matched at this length
+const int kMaxUtteranceMs = 4000;
+
+// Average per frame distance of normalised features accepted by default
+const qreal kDefaultMatchThreshold = 3.0;
+
+// The best phrase must beat the runner up by this factor
+const qreal kSecondBestMargin = 0.9;
+
+const quint32 kFileMagic = 0x4B575354;  // "KWST"
+const quint32 kFileVersion = 1;
+
+const int kCoefficients = MfccExtractor::kCoefficientCount;
+
+// Euclidean distance of two feature frames
+inline float frameDistance(const float *a, const float *b)
+{
+
+    float sum = 0.0f;
+    for (int i = 0; i < kCoefficients; ++i) {
+        const float d = a[i] - b[i];
+        sum += d * d;
+    }
+
+    return std::sqrt(sum);
+
+}
+
+}
+
+/**
+ * @brief Constructs a KeywordSpotter for audio of a sample rate
+ * @param sampleRate represents the rate of the hops passed to processHop()
+ * @param parent represents the parent QObject
+ *
+ * Every buffer of the analysis thread is allocated here, at its largest size
+ */
+
+KeywordSpotter::KeywordSpotter(int sampleRate, QObject *parent)
+    : QObject(parent)
+    , m_mfcc(sampleRate)
+    , m_utteranceLength(0)
+    , m_maxUtteranceLength(0)
+    , m_frames(0)
+    , m_speaking(false)
+    , m_silentSamples(0)
+    , m_matchThreshold(kDefaultMatchThreshold)
+    , m_utteranceOpen(false)
+{
+
+    const MfccExtractor &extractor = m_mfcc.extractor();
+    const int rate = extractor.sampleRate();
+    m_maxUtteranceLength = rate * kMaxUtteranceMs / 1000;
+
+    const int maxFrames = extractor.frameCount(m_maxUtteranceLength);
+    m_features.resize(maxFrames * kCoefficients);
+    m_previousRow.resize(maxFrames + 1);
+    m_currentRow.resize(maxFrames + 1);
+
+}
+
+/**
+ * @brief Feeds one hop of a speech segment
+ * @param samples represents mono samples at the spotter's sample rate
+ * @param count represents the number of samples
+ * @param activity represents the gate's classification, End closes the utterance
+ *
+ * Hangover hops (including the pre-roll in front of a segment) are kept in the utterance but
+ * count as trailing silence, which is trimmed before matching
+ */
+
+void KeywordSpotter::processHop(const qint16 *samples, int count, VoiceActivity activity)
+{
+
+    if (activity == VoiceActivity::Silence) return;
+
+    if (activity == VoiceActivity::End) {
+        if (m_speaking) endUtterance();
+        return;
+    }
+
+    if (!m_speaking) {
+        m_speaking = true;
+        m_utteranceOpen.store(true);
+        m_utteranceLength = 0;
+        m_frames = 0;
+        m_silentSamples = 0;
+        m_mfcc.reset();
+    }
+
+    appendSpeech(samples, count);
+    m_silentSamples = activity == VoiceActivity::Speech ? 0 : m_silentSamples + count;
+
+    if (m_utteranceLength >= m_maxUtteranceLength) {
+        endUtterance();
+    }
+
+}
+
+/**
+ * @brief Forgets the last utterance
+ */
+
+void KeywordSpotter::clearLastUtterance()
+{
+
+    QMutexLocker locker(&m_mutex);
+    m_lastUtterance.clear();
+    m_pendingEnrollment.clear();
+
+}
+
+/**
+ * @brief Stores the utterance a phrase was said in as a template
+ * @param phrase represents the phrase the player said
+ *
+ * A player who is still talking when the typed answer is accepted is saying the phrase right
+ * now, so the open utterance is enrolled when the gate's End hop closes it instead of the
+ * previous one or a truncated one. Otherwise the last utterance heard since
+ * clearLastUtterance() is enrolled immediately
+ */
+
+void KeywordSpotter::enrollUtterance(const QString &phrase)
+{
+
+    QMutexLocker locker(&m_mutex);
+
+    // endUtterance() clears the flag under the lock, so an open utterance sees the request
+    if (m_utteranceOpen.load()) {
+        m_pendingEnrollment = phrase;
+        return;
+    }
+
+    const bool enrolled = storeTemplate(phrase);
+    locker.unlock();
+
+    emit enrollmentFinished(phrase, enrolled);
+
+}
+
+/**
+ * @brief Stores the last utterance as a template of a phrase
+ * @param phrase represents the phrase the player said
+ * @return Returns false if no utterance was heard since clearLastUtterance()
+ */
+
+bool KeywordSpotter::storeTemplate(const QString &phrase)
+{
+
+    if (m_lastUtterance.isEmpty()) return false;
+
+    QVector<Features> &templates = m_templates[phrase.toLower().trimmed()];
+    if (templates.size() >= kMaxTemplatesPerPhrase) {
+        templates.removeFirst();
+    }
+    templates.append(m_lastUtterance);
+    m_lastUtterance.clear();
+
+    LOG_DEBUG("voice", "Enrolled a template for \"%1\", %2 in total", phrase, templates.size());
+    return true;
+
+}
+
+/**
+ * @brief Returns the number of templates of a phrase
+ */
+
+int KeywordSpotter::templateCount(const QString &phrase) const
+{
+
+    QMutexLocker locker(&m_mutex);
+    return m_templates.value(phrase.toLower().trimmed()).size();
+
+}
+
+/**
+ * @brief Returns the number of templates of all phrases
+ */
+
+int KeywordSpotter::templateCount() const
+{
+
+    QMutexLocker locker(&m_mutex);
+
+    int count = 0;
+    for (auto it = m_templates.constBegin(); it != m_templates.constEnd(); ++it) {
+        count += it.value().size();
+    }
+
+    return count;
+
+}
+
+/**
+ * @brief Reads templates written by save()
+ * @param path represents the templates file
+ * @param error represents where to store the reason of a failure
+ *
+ * Templates recorded at another sample rate than the spotter's are discarded, they are
+ * replaced by new ones as the player passes challenges on this microphone
+ */
+
+bool KeywordSpotter::load(const QString &path, QString *error)
+{
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 sampleRate = 0;
+    QHash<QString, QVector<Features>> templates;
+    stream >> magic >> version >> sampleRate >> templates;
+
+    if (stream.status() != QDataStream::Ok || magic != kFileMagic || version != kFileVersion) {
+        if (error) *error = QString("%1 is not a keyword templates file").arg(path);
+        return false;
+    }
+
+    // Features of another rate have other frame lengths and filter banks and never match
+    const int rate = m_mfcc.extractor().sampleRate();
+    if (sampleRate != rate) {
+        LOG_WARNING("voice", "Discarding keyword templates recorded at %1 Hz, the microphone runs at %2 Hz", sampleRate, rate);
+        if (error) *error = QString("%1 was recorded at %2 Hz, not %3 Hz").arg(path).arg(sampleRate).arg(rate);
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_templates = templates;
+    return true;
+
+}
+
+/**
+ * @brief Writes the templates
+ * @param path represents the templates file, its folder is created if needed
+ * @param error represents where to store the reason of a failure
+ */
+
+bool KeywordSpotter::save(const QString &path, QString *error) const
+{
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    QMutexLocker locker(&m_mutex);
+    stream << kFileMagic << kFileVersion << qint32(m_mfcc.extractor().sampleRate()) << m_templates;
+
+    return stream.status() == QDataStream::Ok;
+
+}
+
+/**
+ * @brief Returns the templates file in the application's data folder
+ */
+
+QString KeywordSpotter::defaultPath()
+{
+
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/keywords.dat";
+
+}
+
+/**
+ * @brief Computes the features of the samples that continue the utterance
+ *
+ * The stream carries the overlap between hops, so every sample is transformed once per frame
+ * it belongs to and nothing is recomputed when the utterance ends
+ */
+
+void KeywordSpotter::appendSpeech(const qint16 *samples, int count)
+{
+
+    const int accepted = qMin(count, m_maxUtteranceLength - m_utteranceLength);
+    const int maxFrames = m_features.size() / kCoefficients;
+
+    m_frames += m_mfcc.process(samples, accepted, m_features.data() + m_frames * kCoefficients, maxFrames - m_frames);
+    m_utteranceLength += accepted;
+
+}
+
+/**
+ * @brief Matches the finished utterance against every template
+ *
+ * The trailing silence is dropped before matching. A phrase is reported if its closest template
+ * is within the match threshold and clearly closer than any other phrase
+ */
+
+void KeywordSpotter::endUtterance()
+{
+
+    m_speaking = false;
+
+    const int speechSamples = m_utteranceLength - m_silentSamples;
+    if (speechSamples * 1000 < kMinSpeechMs * m_mfcc.extractor().sampleRate()) {
+        // Too short to be the phrase, an enrollment waiting for it stores nothing
+        QMutexLocker locker(&m_mutex);
+        m_utteranceOpen.store(false);
+        const QString pending = m_pendingEnrollment;
+        m_pendingEnrollment.clear();
+        locker.unlock();
+
+        if (!pending.isEmpty()) emit enrollmentFinished(pending, false);
+        return;
+    }
+
+    const int frames = qMin(m_frames, m_mfcc.extractor().frameCount(speechSamples) + 1);
+    Features utterance(m_features.constBegin(), m_features.constBegin() + frames * kCoefficients);
+    normalise(utterance);
+
+    const qreal infinity = std::numeric_limits<qreal>::infinity();
+    QString best;
+    qreal bestDistance = infinity;
+    qreal secondDistance = infinity;
+
+    QMutexLocker locker(&m_mutex);
+    m_lastUtterance = utterance;
+    m_utteranceOpen.store(false);
+
+    for (auto it = m_templates.constBegin(); it != m_templates.constEnd(); ++it) {
+        qreal phraseDistance = infinity;
+        for (const Features &features : it.value()) {
+            phraseDistance = qMin(phraseDistance, distance(utterance, features));
+        }
+
+        if (phraseDistance < bestDistance) {
+            secondDistance = bestDistance;
+            bestDistance = phraseDistance;
+            best = it.key();
+        } else if (phraseDistance < secondDistance) {
+            secondDistance = phraseDistance;
+        }
+    }
+
+    // Enrolled after matching, so the utterance is not compared with itself
+    const QString pending = m_pendingEnrollment;
+    m_pendingEnrollment.clear();
+    const bool enrolled = !pending.isEmpty() && storeTemplate(pending);
+    locker.unlock();
+
+    if (!pending.isEmpty()) {
+        emit enrollmentFinished(pending, enrolled);
+    }
+
+    LOG_TRACE("voice", "Utterance of %1 frames, closest \"%2\" at %3", frames, best, bestDistance);
+
+    if (!best.isEmpty() && bestDistance <= matchThreshold() && bestDistance < secondDistance * kSecondBestMargin) {
+        emit phraseDetected(best, bestDistance);
+    }
+
+}
+
+/**
+ * @brief Normalises every coefficient to zero mean and unit deviation over the utterance
+ *
+ * Removes the microphone's colouring and the speaking volume, so templates recorded on one day
+ * still match the next
+ */
+
+void KeywordSpotter::normalise(Features &features)
+{
+
+    const int frames = features.size() / kCoefficients;
+    if (frames == 0) return;
+
+    for (int c = 0; c < kCoefficients; ++c) {
+        float mean = 0.0f;
+        for (int i = 0; i < frames; ++i) {
+            mean += features[i * kCoefficients + c];
+        }
+        mean /= frames;
+
+        float variance = 0.0f;
+        for (int i = 0; i < frames; ++i) {
+            const float d = features[i * kCoefficients + c] - mean;
+            variance += d * d;
+        }
+        const float deviation = std::sqrt(variance / frames);
+        const float scale = deviation > 1e-6f ? 1.0f / deviation : 1.0f;
+
+        for (int i = 0; i < frames; ++i) {
+            features[i * kCoefficients + c] = (features[i * kCoefficients + c] - mean) * scale;
+        }
+    }
+
+}
+
+/**
+ * @brief Returns the DTW distance of two feature sequences
+ *
+ * The warping path is kept within a band around the diagonal, which bounds the cost to a
+ * fraction of the full grid and rules out absurd alignments. Sequences more than twice as long
+ * as each other never match
+ */
+
+qreal KeywordSpotter::distance(const Features &a, const Features &b)
+{
+
+    const int n = a.size() / kCoefficients;
+    const int m = b.size() / kCoefficients;
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    if (n == 0 || m == 0 || n > 2 * m || m > 2 * n) return std::numeric_limits<qreal>::infinity();
+
+    if (m_previousRow.size() < m + 1) {
+        m_previousRow.resize(m + 1);
+        m_currentRow.resize(m + 1);
+    }
+
+    float *previous = m_previousRow.data();
+    float *current = m_currentRow.data();
+    std::fill(previous, previous + m + 1, infinity);
+    previous[0] = 0.0f;
+
+    const int band = qMax(qAbs(n - m), qMax(n, m) / 5) + 1;
+
+    for (int i = 1; i <= n; ++i) {
+        std::fill(current, current + m + 1, infinity);
+
+        const int centre = i * m / n;
+        const int first = qMax(1, centre - band);
+        const int last = qMin(m, centre + band);
+        const float *frame = a.constData() + (i - 1) * kCoefficients;
+
+        for (int j = first; j <= last; ++j) {
+            const float step = qMin(previous[j - 1], qMin(previous[j], current[j - 1]));
+            current[j] = step + frameDistance(frame, b.constData() + (j - 1) * kCoefficients);
+        }
+
+        std::swap(previous, current);
+    }
+
+    return previous[m] / (n + m);
+
+}
@@ -0,0 +1,118 @@
+/**
+ * @file keywordspotter.h
+ * @brief Offline spotting of the challenge phrases in microphone audio
+ * @author Kiet Tran, Steph Oh
+ */
+
+#ifndef KEYWORDSPOTTER_H
+#define KEYWORDSPOTTER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "mfcc.h"
+#include "voiceactivitydetector.h"
+
+/**
+ * @brief Matches spoken utterances against recorded templates of the challenge phrases
+ *
+ * Fed the speech segments of the AudioManager's voice activity gate, one hop at a time on the
+ * analysis thread. MFCCs are computed while the player is still speaking, and when the segment
+ * ends it is compared by dynamic time warping against the templates of every phrase. The
+ * decision is made about 80 ms (the gate's hangover) after the player stops talking.
+ *
+ * Templates are the player's own utterances, stored whenever a challenge is passed by typing
+ * while the phrase was being said, so no model files or network services are needed. An
+ * utterance still open when the answer is accepted is enrolled once the gate ends it, never cut
+ */
+
+class KeywordSpotter : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Templates kept per phrase, the oldest is replaced by a new one
+    static const int kMaxTemplatesPerPhrase = 3;
+
+    explicit KeywordSpotter(int sampleRate = 16000, QObject *parent = nullptr);
+
+    // Feeds one hop of a speech segment, called from the analysis thread only
+    void processHop(const qint16 *samples, int count, VoiceActivity activity);
+
+    // Largest DTW distance accepted as a match
+    void setMatchThreshold(qreal distance) { m_matchThreshold.store(distance); }
+    qreal matchThreshold() const { return m_matchThreshold.load(); }
+
+    // Forgets the last utterance, so only speech after this call can be enrolled
+    void clearLastUtterance();
+
+    // Stores the utterance phrase was said in as a template: the open one once the gate ends it,
+    // otherwise the last one. enrollmentFinished() reports the outcome either way
+    void enrollUtterance(const QString &phrase);
+
+    // Number of templates of a phrase, and of all phrases
+    int templateCount(const QString &phrase) const;
+    int templateCount() const;
+
+    // Reads and writes the templates
+    bool load(const QString &path, QString *error = nullptr);
+    bool save(const QString &path, QString *error = nullptr) const;
+
+    // Templates file in the application's data folder
+    static QString defaultPath();
+
+signals:
+    // A phrase was recognised, emitted from the analysis thread
+    void phraseDetected(const QString &phrase, qreal distance);
+
+    // An enrollment requested by enrollUtterance() is done, emitted from the analysis thread
+    // when it waited for the utterance to end
+    void enrollmentFinished(const QString &phrase, bool enrolled);
+
+private:
+    using Features = QVector<float>;
+
+    // Computes the features of the samples that continue the current utterance
+    void appendSpeech(const qint16 *samples, int count);
+
+    // Matches the finished utterance and resets for the next one
+    void endUtterance();
+
+    // Stores the last utterance as a template of phrase, false if there was none. m_mutex must
+    // be held
+    bool storeTemplate(const QString &phrase);
+
+    // Subtracts the mean and divides by the deviation of every coefficient
+    static void normalise(Features &features);
+
+    // Length normalised DTW distance of two feature sequences
+    qreal distance(const Features &a, const Features &b);
+
+    MfccStream m_mfcc;
+
+    // Utterance state, only touched by the analysis thread
+    int m_utteranceLength;      // Samples fed to m_mfcc since the utterance started
+    int m_maxUtteranceLength;
+    Features m_features;        // Room for the frames of the longest utterance
+    int m_frames;
+    bool m_speaking;
+    int m_silentSamples;
+    QVector<float> m_previousRow;
+    QVector<float> m_currentRow;
+
+    std::atomic<qreal> m_matchThreshold;
+
+    // An utterance is being fed, cleared under m_mutex when it ends
+    std::atomic<bool> m_utteranceOpen;
+
+    // Shared between the analysis thread and the GUI thread
+    mutable QMutex m_mutex;
+    QHash<QString, QVector<Features>> m_templates;
+    Features m_lastUtterance;
+    QString m_pendingEnrollment;  // Phrase the open utterance is enrolled as when it ends
+};
+
+#endif // KEYWORDSPOTTER_H
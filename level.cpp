@@ -0,0 +1,350 @@
+/**
+ * @file level.cpp
+ * @brief Implementation of the Level class
+ * @author Kiet Tran
+ */
+
+#include "level.h"
+#include "levelcompiler.h"
+#include <QFileInfo>
+#include <cstring>
+
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "Compiled rooms are read in place and must be little endian");
+
+namespace {
+
+// Returns true if an array of count records of a given size fits in the file at offset
+bool fits(quint32 offset, quint32 count, quint32 recordSize, quint32 fileSize)
+{
+
+    if (offset % 4 != 0) return false;
+    const quint64 end = quint64(offset) + quint64(count) * recordSize;
+    return end <= fileSize;
+
+}
+
+}
+
+/**
+ * @brief Constructs an empty Level
+ */
+
+Level::Level()
+    : m_data(nullptr)
+    , m_header(nullptr)
+    , m_walls(nullptr)
+    , m_triggers(nullptr)
+    , m_cues(nullptr)
+    , m_monsters(nullptr)
+    , m_strings(nullptr)
+{
+
+}
+
+/**
+ * @brief Destroys the Level and unmaps the file
+ */
+
+Level::~Level()
+{
+
+    close();
+
+}
+
+/**
+ * @brief Maps a compiled room file
+ * @param path represents the path of the compiled file
+ * @param error receives a description of the failure if not null
+ * @return true if the file was mapped and its header is valid
+ */
+
+bool Level::open(const QString &path, QString *error)
+{
+
+    using namespace LevelFormat;
+
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString("Cannot open %1: %2").arg(path, m_file.errorString());
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    if (size < qint64(sizeof(LevelHeader))) {
+        if (error) *error = QString("%1 is too small to be a compiled room").arg(path);
+        m_file.close();
+        return false;
+    }
+
+    m_data = m_file.map(0, size);
+    if (!m_data) {
+        if (error) *error = QString("Cannot map %1: %2").arg(path, m_file.errorString());
+        m_file.close();
+        return false;
+    }
+
+    const LevelHeader *header = reinterpret_cast<const LevelHeader *>(m_data);
+    const quint32 fileSize = quint32(size);
+
+    const bool valid = std::memcmp(header->magic, kMagic, 4) == 0
+                       && header->version == kVersion
+                       && header->fileSize == fileSize
+                       && fits(header->wallOffset, header->wallCount, sizeof(WallRecord), fileSize)
+                       && fits(header->triggerOffset, header->triggerCount, sizeof(TriggerRecord), fileSize)
+                       && fits(header->cueOffset, header->cueCount, sizeof(CueRecord), fileSize)
+                       && fits(header->monsterOffset, header->monsterCount, sizeof(MonsterRecord), fileSize)
+                       && quint64(header->stringOffset) + header->stringSize <= fileSize;
+
+    if (!valid) {
+        if (error) *error = QString("%1 is not a valid compiled room").arg(path);
+        close();
+        return false;
+    }
+
+    m_header = header;
+    m_walls = reinterpret_cast<const WallRecord *>(m_data + header->wallOffset);
+    m_triggers = reinterpret_cast<const TriggerRecord *>(m_data + header->triggerOffset);
+    m_cues = reinterpret_cast<const CueRecord *>(m_data + header->cueOffset);
+    m_monsters = reinterpret_cast<const MonsterRecord *>(m_data + header->monsterOffset);
+    m_strings = reinterpret_cast<const char *>(m_data + header->stringOffset);
+    m_name = QFileInfo(path).completeBaseName();
+
+    return true;
+
+}
+
+/**
+ * @brief Loads a room by name
+ * @param name represents the room name, for example "room1"
+ * @param error receives a description of the failure if not null
+ * @return true if the room is ready to be read
+ *
+ * The JSON source in ":/rooms" is compiled into the cache directory the first time the room
+ * is visited (or when the source changed) and the compiled file is then mapped
+ */
+
+bool Level::load(const QString &name, QString *error)
+{
+
+    const QString compiledPath = LevelCompiler::compiledPath(name);
+    if (!LevelCompiler::ensureCompiled(LevelCompiler::sourcePath(name), compiledPath, error)) {
+        return false;
+    }
+
+    return open(compiledPath, error);
+
+}
+
+/**
+ * @brief Unmaps the file and invalidates the view
+ */
+
+void Level::close()
+{
+
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+
+    m_data = nullptr;
+    m_header = nullptr;
+    m_walls = nullptr;
+    m_triggers = nullptr;
+    m_cues = nullptr;
+    m_monsters = nullptr;
+    m_strings = nullptr;
+    m_name.clear();
+
+}
+
+/**
+ * @brief Returns the scene size of the room
+ */
+
+QSizeF Level::sceneSize() const
+{
+
+    if (!m_header) return QSizeF();
+    return QSizeF(m_header->sceneWidth, m_header->sceneHeight);
+
+}
+
+/**
+ * @brief Returns the path of the background image
+ */
+
+QString Level::background() const
+{
+
+    if (!m_header) return QString();
+    return string(m_header->background);
+
+}
+
+/**
+ * @brief Returns the player spawn point
+ */
+
+QPointF Level::spawnPoint() const
+{
+
+    if (!m_header) return QPointF();
+    return QPointF(m_header->spawnX, m_header->spawnY);
+
+}
+
+/**
+ * @brief Returns the number of collision rectangles
+ */
+
+int Level::wallCount() const
+{
+
+    return m_header ? int(m_header->wallCount) : 0;
+
+}
+
+/**
+ * @brief Returns a collision rectangle
+ * @param index represents the wall index
+ */
+
+QRectF Level::wall(int index) const
+{
+
+    const LevelFormat::WallRecord &w = m_walls[index];
+    return QRectF(w.x, w.y, w.width, w.height);
+
+}
+
+/**
+ * @brief Returns the number of trigger zones
+ */
+
+int Level::triggerCount() const
+{
+
+    return m_header ? int(m_header->triggerCount) : 0;
+
+}
+
+/**
+ * @brief Returns a trigger zone
+ * @param index represents the trigger index
+ */
+
+LevelTrigger Level::trigger(int index) const
+{
+
+    const LevelFormat::TriggerRecord &t = m_triggers[index];
+
+    LevelTrigger trigger;
+    trigger.rect = QRectF(t.x, t.y, t.width, t.height);
+    trigger.name = string(t.name);
+    trigger.target = string(t.target);
+    trigger.cue = (t.cue >= 0 && quint32(t.cue) < m_header->cueCount) ? t.cue : -1;
+    trigger.once = t.flags & LevelFormat::kTriggerOnce;
+    return trigger;
+
+}
+
+/**
+ * @brief Returns only the bounds of a trigger zone
+ * @param index represents the trigger index
+ *
+ * Cheap enough to be called for every trigger on every tick
+ */
+
+QRectF Level::triggerRect(int index) const
+{
+
+    const LevelFormat::TriggerRecord &t = m_triggers[index];
+    return QRectF(t.x, t.y, t.width, t.height);
+
+}
+
+/**
+ * @brief Returns the number of audio cues
+ */
+
+int Level::cueCount() const
+{
+
+    return m_header ? int(m_header->cueCount) : 0;
+
+}
+
+/**
+ * @brief Returns an audio cue
+ * @param index represents the cue index
+ */
+
+LevelCue Level::cue(int index) const
+{
+
+    const LevelFormat::CueRecord &c = m_cues[index];
+
+    LevelCue cue;
+    cue.position = QPointF(c.x, c.y);
+    cue.radius = c.radius;
+    cue.volume = c.volume;
+    cue.name = string(c.name);
+    cue.source = string(c.source);
+    cue.loop = c.flags & LevelFormat::kCueLoop;
+    cue.onEnter = c.flags & LevelFormat::kCueOnEnter;
+    return cue;
+
+}
+
+/**
+ * @brief Returns the number of monsters
+ */
+
+int Level::monsterCount() const
+{
+
+    return m_header ? int(m_header->monsterCount) : 0;
+
+}
+
+/**
+ * @brief Returns a monster spawn point
+ * @param index represents the monster index
+ */
+
+LevelMonster Level::monster(int index) const
+{
+
+    const LevelFormat::MonsterRecord &m = m_monsters[index];
+
+    LevelMonster monster;
+    monster.position = QPointF(m.x, m.y);
+    monster.speed = m.speed;
+    return monster;
+
+}
+
+/**
+ * @brief Resolves a string reference into the string table
+ * @param reference represents the byte offset of the string entry
+ */
+
+QString Level::string(quint32 reference) const
+{
+
+    if (!m_header || reference == LevelFormat::kNoString) return QString();
+    if (quint64(reference) + sizeof(quint32) > m_header->stringSize) return QString();
+
+    quint32 length = 0;
+    std::memcpy(&length, m_strings + reference, sizeof(length));
+    if (quint64(reference) + sizeof(quint32) + length > m_header->stringSize) return QString();
+
+    return QString::fromUtf8(m_strings + reference + sizeof(quint32), int(length));
+
+}
@@ -0,0 +1,117 @@
+/**
+ * @file level.h
+ * @brief Memory mapped reader for compiled room files
+ * @author Kiet Tran
+ */
+
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <QFile>
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+#include "levelformat.h"
+
+/**
+ * @brief Trigger zone of a room
+ */
+
+struct LevelTrigger {
+    QRectF rect;
+    QString name;
+    QString target;
+    int cue;
+    bool once;
+};
+
+/**
+ * @brief Audio cue placed in a room
+ */
+
+struct LevelCue {
+    QPointF position;
+    qreal radius;
+    qreal volume;
+    QString name;
+    QString source;
+    bool loop;
+    bool onEnter;
+};
+
+/**
+ * @brief Monster placed in a room
+ */
+
+struct LevelMonster {
+    QPointF position;
+    qreal speed;        // 0 for the default speed
+};
+
+/**
+ * @brief Read only view of a compiled room
+ *
+ * The file is memory mapped and every accessor reads the records in place, so opening a room
+ * costs a header check rather than a parse. The view stays valid until close() is called or
+ * the Level is destroyed
+ */
+
+class Level
+{
+public:
+    Level();
+    ~Level();
+
+    // Maps a compiled room file and validates its header
+    bool open(const QString &path, QString *error = nullptr);
+
+    // Compiles the JSON room if needed and maps the compiled file
+    bool load(const QString &name, QString *error = nullptr);
+
+    // Unmaps the file
+    void close();
+
+    bool isValid() const { return m_header != nullptr; }
+
+    QString name() const { return m_name; }
+    QSizeF sceneSize() const;
+    QString background() const;
+    QPointF spawnPoint() const;
+
+    // Static collision rectangles
+    int wallCount() const;
+    QRectF wall(int index) const;
+
+    // Trigger zones
+    int triggerCount() const;
+    LevelTrigger trigger(int index) const;
+    QRectF triggerRect(int index) const;
+
+    // Audio cues
+    int cueCount() const;
+    LevelCue cue(int index) const;
+
+    // Monster spawn points
+    int monsterCount() const;
+    LevelMonster monster(int index) const;
+
+private:
+    Level(const Level &) = delete;
+    Level &operator=(const Level &) = delete;
+
+    // Resolves a string reference into the string table
+    QString string(quint32 reference) const;
+
+    QFile m_file;
+    QString m_name;
+    const uchar *m_data;
+    const LevelFormat::LevelHeader *m_header;
+    const LevelFormat::WallRecord *m_walls;
+    const LevelFormat::TriggerRecord *m_triggers;
+    const LevelFormat::CueRecord *m_cues;
+    const LevelFormat::MonsterRecord *m_monsters;
+    const char *m_strings;
+};
+
+#endif // LEVEL_H
@@ -0,0 +1,360 @@
+/**
+ * @file levelcompiler.cpp
+ * @brief Implementation of the LevelCompiler class
+ * @author Kiet Tran
+ */
+
+#include "levelcompiler.h"
+#include "assetpack.h"
+#include "levelformat.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief Collects strings into the string table, sharing repeated strings
+ */
+
+class StringTable
+{
+public:
+    quint32 add(const QString &text)
+    {
+
+        if (text.isEmpty()) return LevelFormat::kNoString;
+
+        auto it = m_offsets.constFind(text);
+        if (it != m_offsets.constEnd()) return it.value();
+
+        const QByteArray utf8 = text.toUtf8();
+        const quint32 offset = quint32(m_data.size());
+        const quint32 length = quint32(utf8.size());
+        m_data.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        m_data.append(utf8);
+        m_data.append('\0');
+
+        m_offsets.insert(text, offset);
+        return offset;
+
+    }
+
+    const QByteArray &data() const { return m_data; }
+
+private:
+    QByteArray m_data;
+    QHash<QString, quint32> m_offsets;
+};
+
+// Reads [x, y, width, height]
+bool readRect(const QJsonValue &value, float *out)
+{
+
+    const QJsonArray array = value.toArray();
+    if (array.size() != 4) return false;
+    for (int i = 0; i < 4; ++i) {
+        if (!array.at(i).isDouble()) return false;
+        out[i] = float(array.at(i).toDouble());
+    }
+    return true;
+
+}
+
+// Reads [x, y]
+bool readPoint(const QJsonValue &value, float *out)
+{
+
+    const QJsonArray array = value.toArray();
+    if (array.size() != 2 || !array.at(0).isDouble() || !array.at(1).isDouble()) return false;
+    out[0] = float(array.at(0).toDouble());
+    out[1] = float(array.at(1).toDouble());
+    return true;
+
+}
+
+// Appends raw records and pads to 4 bytes, returns their offset
+template <typename T>
+quint32 appendRecords(QByteArray &out, const QVector<T> &records)
+{
+
+    const quint32 offset = quint32(out.size());
+    if (!records.isEmpty()) {
+        out.append(reinterpret_cast<const char *>(records.constData()), int(records.size() * sizeof(T)));
+    }
+    while (out.size() % 4 != 0) out.append('\0');
+    return offset;
+
+}
+
+}
+
+/**
+ * @brief Compiles the JSON form of a room
+ * @param json represents the JSON source
+ * @param binary receives the compiled room
+ * @param error receives a description of the failure if not null
+ * @return true on success
+ */
+
+bool LevelCompiler::compile(const QByteArray &json, QByteArray *binary, QString *error)
+{
+
+    using namespace LevelFormat;
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (document.isNull() || !document.isObject()) {
+        if (error) *error = QString("Invalid room JSON: %1").arg(parseError.errorString());
+        return false;
+    }
+
+    const QJsonObject root = document.object();
+    StringTable strings;
+
+    LevelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, 4);
+    header.version = kVersion;
+    header.sourceHash = sourceHash(json);
+
+    float size[2] = { 1440, 900 };
+    if (root.contains("size") && !readPoint(root.value("size"), size)) {
+        if (error) *error = "\"size\" must be [width, height]";
+        return false;
+    }
+    header.sceneWidth = size[0];
+    header.sceneHeight = size[1];
+
+    float spawn[2] = { 0, 0 };
+    if (!readPoint(root.value("spawn"), spawn)) {
+        if (error) *error = "\"spawn\" must be [x, y]";
+        return false;
+    }
+    header.spawnX = spawn[0];
+    header.spawnY = spawn[1];
+    header.background = strings.add(root.value("background").toString());
+
+    // Walls
+    QVector<WallRecord> walls;
+    const QJsonArray wallArray = root.value("walls").toArray();
+    for (const QJsonValue &value : wallArray) {
+        float r[4];
+        if (!readRect(value, r)) {
+            if (error) *error = "Every wall must be [x, y, width, height]";
+            return false;
+        }
+        WallRecord wall = { r[0], r[1], r[2], r[3] };
+        walls.append(wall);
+    }
+
+    // Audio cues, compiled before triggers so triggers can refer to them by name
+    QVector<CueRecord> cues;
+    QHash<QString, int> cueIndex;
+    const QJsonArray cueArray = root.value("cues").toArray();
+    for (const QJsonValue &value : cueArray) {
+        const QJsonObject object = value.toObject();
+        CueRecord cue;
+        std::memset(&cue, 0, sizeof(cue));
+
+        float position[2] = { 0, 0 };
+        if (object.contains("position") && !readPoint(object.value("position"), position)) {
+            if (error) *error = "Cue \"position\" must be [x, y]";
+            return false;
+        }
+        if (object.value("source").toString().isEmpty()) {
+            if (error) *error = "Every cue needs a \"source\"";
+            return false;
+        }
+
+        cue.x = position[0];
+        cue.y = position[1];
+        cue.radius = float(object.value("radius").toDouble(0.0));
+        cue.volume = float(object.value("volume").toDouble(1.0));
+        cue.name = strings.add(object.value("name").toString());
+        cue.source = strings.add(object.value("source").toString());
+        if (object.value("loop").toBool()) cue.flags |= kCueLoop;
+        if (object.value("onEnter").toBool()) cue.flags |= kCueOnEnter;
+
+        cueIndex.insert(object.value("name").toString(), cues.size());
+        cues.append(cue);
+    }
+
+    // Trigger zones
+    QVector<TriggerRecord> triggers;
+    const QJsonArray triggerArray = root.value("triggers").toArray();
+    for (const QJsonValue &value : triggerArray) {
+        const QJsonObject object = value.toObject();
+        TriggerRecord trigger;
+        std::memset(&trigger, 0, sizeof(trigger));
+
+        float r[4];
+        if (!readRect(object.value("rect"), r)) {
+            if (error) *error = "Trigger \"rect\" must be [x, y, width, height]";
+            return false;
+        }
+
+        trigger.x = r[0];
+        trigger.y = r[1];
+        trigger.width = r[2];
+        trigger.height = r[3];
+        trigger.name = strings.add(object.value("name").toString());
+        trigger.target = strings.add(object.value("target").toString());
+        trigger.cue = -1;
+
+        const QString cueName = object.value("cue").toString();
+        if (!cueName.isEmpty()) {
+            if (!cueIndex.contains(cueName)) {
+                if (error) *error = QString("Trigger refers to unknown cue \"%1\"").arg(cueName);
+                return false;
+            }
+            trigger.cue = cueIndex.value(cueName);
+        }
+        if (object.value("once").toBool()) trigger.flags |= kTriggerOnce;
+
+        triggers.append(trigger);
+    }
+
+    // Monster spawn points
+    QVector<MonsterRecord> monsters;
+    const QJsonArray monsterArray = root.value("monsters").toArray();
+    for (const QJsonValue &value : monsterArray) {
+        const QJsonObject object = value.toObject();
+        MonsterRecord monster;
+        std::memset(&monster, 0, sizeof(monster));
+
+        float position[2];
+        if (!readPoint(object.value("position"), position)) {
+            if (error) *error = "Monster \"position\" must be [x, y]";
+            return false;
+        }
+
+        monster.x = position[0];
+        monster.y = position[1];
+        monster.speed = float(object.value("speed").toDouble(0.0));
+        monsters.append(monster);
+    }
+
+    // Lays out header, records and string table
+    QByteArray out(int(sizeof(LevelHeader)), '\0');
+    header.wallCount = quint32(walls.size());
+    header.wallOffset = appendRecords(out, walls);
+    header.triggerCount = quint32(triggers.size());
+    header.triggerOffset = appendRecords(out, triggers);
+    header.cueCount = quint32(cues.size());
+    header.cueOffset = appendRecords(out, cues);
+    header.monsterCount = quint32(monsters.size());
+    header.monsterOffset = appendRecords(out, monsters);
+    header.stringOffset = quint32(out.size());
+    header.stringSize = quint32(strings.data().size());
+    out.append(strings.data());
+    while (out.size() % 4 != 0) out.append('\0');
+    header.fileSize = quint32(out.size());
+
+    std::memcpy(out.data(), &header, sizeof(header));
+    *binary = out;
+    return true;
+
+}
+
+/**
+ * @brief Makes sure a compiled room matches its JSON source
+ * @param sourcePath represents the JSON source
+ * @param targetPath represents the compiled file
+ * @param error receives a description of the failure if not null
+ * @return true if targetPath is up to date afterwards
+ *
+ * Only the header of an existing compiled file is read to compare the source hash
+ */
+
+bool LevelCompiler::ensureCompiled(const QString &sourcePath, const QString &targetPath, QString *error)
+{
+
+    bool readable = false;
+    const QByteArray json = AssetPack::read(sourcePath, &readable);
+    if (!readable) {
+        // A shipped compiled room without its source is fine
+        if (QFile::exists(targetPath)) return true;
+        if (error) *error = QString("Cannot open %1").arg(sourcePath);
+        return false;
+    }
+    const quint32 hash = sourceHash(json);
+
+    QFile existing(targetPath);
+    if (existing.open(QIODevice::ReadOnly)) {
+        LevelFormat::LevelHeader header;
+        if (existing.read(reinterpret_cast<char *>(&header), sizeof(header)) == qint64(sizeof(header))
+            && std::memcmp(header.magic, LevelFormat::kMagic, 4) == 0
+            && header.version == LevelFormat::kVersion
+            && header.sourceHash == hash) {
+            return true;
+        }
+        existing.close();
+    }
+
+    QByteArray binary;
+    if (!compile(json, &binary, error)) {
+        if (error) *error = QString("%1: %2").arg(sourcePath, *error);
+        return false;
+    }
+
+    QDir().mkpath(QFileInfo(targetPath).absolutePath());
+    QSaveFile target(targetPath);
+    if (!target.open(QIODevice::WriteOnly) || target.write(binary) != binary.size() || !target.commit()) {
+        if (error) *error = QString("Cannot write %1: %2").arg(targetPath, target.errorString());
+        return false;
+    }
+
+    return true;
+
+}
+
+/**
+ * @brief Returns the location of the JSON source of a room
+ * @param name represents the room name
+ */
+
+QString LevelCompiler::sourcePath(const QString &name)
+{
+
+    return QString(":/rooms/%1.json").arg(name);
+
+}
+
+/**
+ * @brief Returns the location of the compiled file of a room
+ * @param name represents the room name
+ */
+
+QString LevelCompiler::compiledPath(const QString &name)
+{
+
+    const QString cache = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return QDir(cache).filePath(QString("rooms/%1.hrlv").arg(name));
+
+}
+
+/**
+ * @brief Hashes the JSON source with 32 bit FNV-1a
+ * @param json represents the JSON source
+ */
+
+quint32 LevelCompiler::sourceHash(const QByteArray &json)
+{
+
+    quint32 hash = 2166136261u;
+    for (char c : json) {
+        hash ^= quint8(c);
+        hash *= 16777619u;
+    }
+    return hash;
+
+}
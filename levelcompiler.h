@@ -0,0 +1,50 @@
+/**
+ * @file levelcompiler.h
+ * @brief Compiles JSON room descriptions into the binary room format
+ * @author Kiet Tran
+ */
+
+#ifndef LEVELCOMPILER_H
+#define LEVELCOMPILER_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @brief Turns the JSON authoring form of a room into the compact format read by Level
+ *
+ * A room is authored as JSON:
+ *
+ *     {
+ *         "size": [1440, 900],
+ *         "background": ":/images/room1_bg.png",
+ *         "spawn": [695, 800],
+ *         "walls": [[x, y, width, height], ...],
+ *         "triggers": [{ "name": "...", "rect": [x, y, width, height],
+ *                        "target": "room2", "cue": "cueName", "once": true }, ...],
+ *         "cues": [{ "name": "...", "source": "qrc:/...", "position": [x, y],
+ *                    "radius": 400, "volume": 0.7, "loop": false, "onEnter": false }, ...],
+ *         "monsters": [{ "position": [x, y], "speed": 110 }, ...]
+ *     }
+ */
+
+class LevelCompiler
+{
+public:
+    // Compiles JSON source into a compiled room
+    static bool compile(const QByteArray &json, QByteArray *binary, QString *error = nullptr);
+
+    // Compiles sourcePath into targetPath unless targetPath is already up to date
+    static bool ensureCompiled(const QString &sourcePath, const QString &targetPath, QString *error = nullptr);
+
+    // Location of the JSON source of a room
+    static QString sourcePath(const QString &name);
+
+    // Location of the compiled file of a room
+    static QString compiledPath(const QString &name);
+
+    // Hash stored in compiled files to detect a changed source
+    static quint32 sourceHash(const QByteArray &json);
+};
+
+#endif // LEVELCOMPILER_H
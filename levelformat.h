@@ -0,0 +1,102 @@
+/**
+ * @file levelformat.h
+ * @brief On-disk layout of compiled room files
+ * @author Kiet Tran
+ */
+
+#ifndef LEVELFORMAT_H
+#define LEVELFORMAT_H
+
+#include <QtGlobal>
+
+/**
+ * @brief Compiled room layout
+ *
+ * A compiled room is a single little endian file that is memory mapped and read in place.
+ * It starts with a LevelHeader followed by 4 byte aligned record arrays and a string table.
+ * Strings are referenced by their byte offset into the string table, where each entry is a
+ * 32 bit length followed by UTF-8 bytes and a terminating zero. The value kNoString means
+ * a string is absent
+ */
+
+namespace LevelFormat {
+
+// File magic "HRLV"
+const char kMagic[4] = { 'H', 'R', 'L', 'V' };
+
+// Bumped whenever the layout below changes
+const quint32 kVersion = 2;
+
+// Marks an absent string reference
+const quint32 kNoString = 0xffffffffu;
+
+// Trigger flags
+const quint32 kTriggerOnce = 0x1;
+
+// Audio cue flags
+const quint32 kCueLoop = 0x1;
+const quint32 kCueOnEnter = 0x2;
+
+struct LevelHeader {
+    char magic[4];
+    quint32 version;
+    quint32 sourceHash;       // Hash of the JSON source, used to detect stale compiled files
+    quint32 fileSize;
+
+    float sceneWidth;
+    float sceneHeight;
+    quint32 background;       // String reference to the background image
+    float spawnX;
+    float spawnY;
+
+    quint32 wallCount;
+    quint32 wallOffset;
+    quint32 triggerCount;
+    quint32 triggerOffset;
+    quint32 cueCount;
+    quint32 cueOffset;
+    quint32 monsterCount;
+    quint32 monsterOffset;
+    quint32 stringOffset;
+    quint32 stringSize;
+};
+
+struct WallRecord {
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
+struct TriggerRecord {
+    float x;
+    float y;
+    float width;
+    float height;
+    quint32 name;             // String reference
+    quint32 target;           // String reference to the room this trigger leads to
+    qint32 cue;               // Index of the audio cue played on enter, -1 for none
+    quint32 flags;
+};
+
+struct CueRecord {
+    float x;
+    float y;
+    float radius;
+    float volume;
+    quint32 name;             // String reference
+    quint32 source;           // String reference to the audio file
+    quint32 flags;
+    quint32 reserved;
+};
+
+struct MonsterRecord {
+    float x;                  // Spawn point, centre of the body
+    float y;
+    float speed;              // Chasing speed in pixels per second
+    quint32 reserved;
+};
+
+}
+
+#endif // LEVELFORMAT_H
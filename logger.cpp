@@ -0,0 +1,344 @@
+/**
+ * @file logger.cpp
+ * @brief Implementation of the Logger class
+ * @author Kiet Tran
+ */
+
+#include "logger.h"
+#include <QThread>
+#include <cstdio>
+
+namespace {
+
+// Longest time flush() waits for the drain thread (milliseconds)
+const int kFlushTimeoutMs = 1000;
+
+// Time the drain thread sleeps when the ring is empty (milliseconds)
+const int kDrainIntervalMs = 5;
+
+const char *levelName(int level)
+{
+
+    switch (LogLevel(level)) {
+    case LogLevel::Trace: return "TRACE";
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info: return "INFO ";
+    case LogLevel::Warning: return "WARN ";
+    case LogLevel::Error: return "ERROR";
+    }
+
+    return "?????";
+
+}
+
+}
+
+/**
+ * @brief Returns the application wide logger
+ */
+
+Logger &Logger::instance()
+{
+
+    static Logger logger;
+    return logger;
+
+}
+
+/**
+ * @brief Constructs the logger and starts its drain thread
+ */
+
+Logger::Logger()
+    : m_level(GAME_LOG_LEVEL)
+    , m_dropped(0)
+    , m_pushed(0)
+    , m_written(0)
+    , m_running(true)
+    , m_thread(nullptr)
+{
+
+    m_clock.start();
+
+    m_thread = QThread::create([this]() { drain(); });
+    m_thread->setObjectName("Logger");
+    m_thread->start(QThread::LowPriority);
+
+}
+
+/**
+ * @brief Stops the drain thread after writing every queued record
+ */
+
+Logger::~Logger()
+{
+
+    m_running.store(false, std::memory_order_release);
+    m_thread->wait();
+    delete m_thread;
+
+    writePending();
+
+}
+
+/**
+ * @brief Blocks until every queued record has been written
+ *
+ * Gives up after a second so a stalled stderr cannot hang the caller
+ */
+
+void Logger::flush()
+{
+
+    const quint64 target = m_pushed.load(std::memory_order_acquire);
+    QElapsedTimer waited;
+    waited.start();
+
+    while (m_written.load(std::memory_order_acquire) < target && waited.elapsed() < kFlushTimeoutMs) {
+        QThread::msleep(1);
+    }
+
+}
+
+/**
+ * @brief Stores an integer argument
+ */
+
+void Logger::addInteger(LogRecord &record, qint64 value)
+{
+
+    LogRecord::Argument &argument = record.arguments[record.argumentCount++];
+    argument.type = LogRecord::Argument::Int;
+    argument.integer = value;
+
+}
+
+/**
+ * @brief Stores a floating point argument
+ */
+
+void Logger::addReal(LogRecord &record, double value)
+{
+
+    LogRecord::Argument &argument = record.arguments[record.argumentCount++];
+    argument.type = LogRecord::Argument::Double;
+    argument.real = value;
+
+}
+
+/**
+ * @brief Stores a boolean argument
+ */
+
+void Logger::addArgument(LogRecord &record, bool value)
+{
+
+    LogRecord::Argument &argument = record.arguments[record.argumentCount++];
+    argument.type = LogRecord::Argument::Bool;
+    argument.boolean = value;
+
+}
+
+/**
+ * @brief Stores a text argument, encoded to UTF-8 in place without allocating
+ */
+
+void Logger::addArgument(LogRecord &record, const QString &value)
+{
+
+    char buffer[LogRecord::kTextSize];
+    int length = 0;
+    const int capacity = LogRecord::kTextSize - 4;
+
+    for (int i = 0; i < value.size() && length < capacity; ++i) {
+        uint code = value.at(i).unicode();
+
+        if (QChar::isHighSurrogate(code) && i + 1 < value.size() && value.at(i + 1).isLowSurrogate()) {
+            code = QChar::surrogateToUcs4(ushort(code), value.at(i + 1).unicode());
+            ++i;
+        }
+
+        if (code < 0x80) {
+            buffer[length++] = char(code);
+        } else if (code < 0x800) {
+            buffer[length++] = char(0xC0 | (code >> 6));
+            buffer[length++] = char(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            buffer[length++] = char(0xE0 | (code >> 12));
+            buffer[length++] = char(0x80 | ((code >> 6) & 0x3F));
+            buffer[length++] = char(0x80 | (code & 0x3F));
+        } else {
+            buffer[length++] = char(0xF0 | (code >> 18));
+            buffer[length++] = char(0x80 | ((code >> 12) & 0x3F));
+            buffer[length++] = char(0x80 | ((code >> 6) & 0x3F));
+            buffer[length++] = char(0x80 | (code & 0x3F));
+        }
+    }
+
+    addText(record, buffer, length);
+
+}
+
+/**
+ * @brief Stores a text argument given as a null terminated UTF-8 string
+ */
+
+void Logger::addArgument(LogRecord &record, const char *value)
+{
+
+    int length = 0;
+    while (value && value[length] && length < LogRecord::kTextSize) {
+        ++length;
+    }
+
+    addText(record, value, length);
+
+}
+
+/**
+ * @brief Appends text to the record's inline buffer
+ *
+ * Text that does not fit is cut, on a UTF-8 character boundary, so every argument keeps a null
+ * terminator
+ */
+
+void Logger::addText(LogRecord &record, const char *utf8, int length)
+{
+
+    LogRecord::Argument &argument = record.arguments[record.argumentCount++];
+    argument.type = LogRecord::Argument::Text;
+
+    // A full buffer leaves the argument pointing at the last terminator
+    if (record.textUsed >= LogRecord::kTextSize) {
+        argument.textOffset = LogRecord::kTextSize - 1;
+        return;
+    }
+    argument.textOffset = record.textUsed;
+
+    int available = LogRecord::kTextSize - record.textUsed - 1;
+    if (length > available) {
+        length = qMax(0, available);
+        while (length > 0 && (uchar(utf8[length]) & 0xC0) == 0x80) {
+            --length;
+        }
+    }
+
+    for (int i = 0; i < length; ++i) {
+        record.text[record.textUsed + i] = utf8[i];
+    }
+    record.textUsed += length;
+    if (record.textUsed < LogRecord::kTextSize) {
+        record.text[record.textUsed++] = '\0';
+    }
+
+}
+
+/**
+ * @brief Queues a record, dropping it if the ring is full
+ */
+
+void Logger::push(const LogRecord &record)
+{
+
+    if (m_queue.push(record)) {
+        m_pushed.fetch_add(1, std::memory_order_release);
+    } else {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+}
+
+/**
+ * @brief Writes queued records until the logger is destroyed
+ */
+
+void Logger::drain()
+{
+
+    while (m_running.load(std::memory_order_acquire)) {
+        if (writePending() == 0) {
+            QThread::msleep(kDrainIntervalMs);
+        }
+    }
+
+}
+
+/**
+ * @brief Writes every queued record to stderr
+ * @return Returns the number of records written
+ *
+ * Also reports records dropped since the previous batch
+ */
+
+int Logger::writePending()
+{
+
+    static quint64 reportedDrops = 0;
+
+    LogRecord record;
+    int count = 0;
+
+    while (m_queue.pop(record)) {
+        const QByteArray line = format(record).toUtf8();
+        std::fwrite(line.constData(), 1, size_t(line.size()), stderr);
+        ++count;
+    }
+
+    const quint64 dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped != reportedDrops) {
+        std::fprintf(stderr, "[logger] dropped %llu records, the queue was full\n",
+                     static_cast<unsigned long long>(dropped - reportedDrops));
+        reportedDrops = dropped;
+    }
+
+    if (count > 0) {
+        std::fflush(stderr);
+        m_written.fetch_add(quint64(count), std::memory_order_release);
+    }
+
+    return count;
+
+}
+
+/**
+ * @brief Turns a record into a line of text
+ *
+ * Placeholders are substituted in one pass, so %n sequences inside text arguments are kept as is
+ */
+
+QString Logger::format(const LogRecord &record)
+{
+
+    QString values[LogRecord::kMaxArguments];
+    for (int i = 0; i < record.argumentCount; ++i) {
+        const LogRecord::Argument &argument = record.arguments[i];
+        switch (argument.type) {
+        case LogRecord::Argument::Int:
+            values[i] = QString::number(argument.integer);
+            break;
+        case LogRecord::Argument::Double:
+            values[i] = QString::number(argument.real);
+            break;
+        case LogRecord::Argument::Bool:
+            values[i] = argument.boolean ? QStringLiteral("true") : QStringLiteral("false");
+            break;
+        case LogRecord::Argument::Text:
+            values[i] = QString::fromUtf8(record.text + argument.textOffset);
+            break;
+        }
+    }
+
+    QString message = QString::fromUtf8(record.format);
+    switch (record.argumentCount) {
+    case 1: message = message.arg(values[0]); break;
+    case 2: message = message.arg(values[0], values[1]); break;
+    case 3: message = message.arg(values[0], values[1], values[2]); break;
+    case 4: message = message.arg(values[0], values[1], values[2], values[3]); break;
+    default: break;
+    }
+
+    return QString("%1 %2 %3: %4\n")
+        .arg(record.timeNs / 1e9, 10, 'f', 3)
+        .arg(QLatin1String(levelName(record.level)), QLatin1String(record.category), message);
+
+}
@@ -0,0 +1,183 @@
+/**
+ * @file logger.h
+ * @brief Levelled logging that is stripped at compile time and written off the calling thread
+ * @author Kiet Tran
+ */
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <atomic>
+#include <type_traits>
+#include "mpscringbuffer.h"
+
+class QThread;
+
+/**
+ * @brief Severity of a log record
+ */
+
+enum class LogLevel {
+    Trace = 0,
+    Debug = 1,
+    Info = 2,
+    Warning = 3,
+    Error = 4
+};
+
+// Lowest level compiled in: records below it are removed by the compiler together with their
+// arguments. Defaults to Debug, and to Info in release builds (QT_NO_DEBUG). Override with
+// DEFINES += GAME_LOG_LEVEL=<0-4>
+#ifndef GAME_LOG_LEVEL
+#ifdef QT_NO_DEBUG
+#define GAME_LOG_LEVEL 2
+#else
+#define GAME_LOG_LEVEL 1
+#endif
+#endif
+
+// Logs a record with up to four %1 to %4 arguments. The format and category must be string
+// literals, the arguments are only evaluated when the level is compiled in
+#define GAME_LOG(level, category, ...) \
+    do { \
+        if (int(level) >= GAME_LOG_LEVEL) { \
+            Logger::instance().write(level, category, __VA_ARGS__); \
+        } \
+    } while (false)
+
+#define LOG_TRACE(category, ...) GAME_LOG(LogLevel::Trace, category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) GAME_LOG(LogLevel::Debug, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) GAME_LOG(LogLevel::Info, category, __VA_ARGS__)
+#define LOG_WARNING(category, ...) GAME_LOG(LogLevel::Warning, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) GAME_LOG(LogLevel::Error, category, __VA_ARGS__)
+
+/**
+ * @brief Fixed size binary log entry
+ *
+ * Holds pointers to the static format and category, the raw argument values and a small inline
+ * buffer for text arguments, so recording copies bytes and never allocates. Formatting happens
+ * on the drain thread
+ */
+
+struct LogRecord {
+    static const int kMaxArguments = 4;
+    static const int kTextSize = 112;
+
+    struct Argument {
+        enum Type : quint8 { Int, Double, Bool, Text };
+
+        Type type;
+        union {
+            qint64 integer;
+            double real;
+            bool boolean;
+            quint16 textOffset;  // Start of the UTF-8 text in LogRecord::text
+        };
+    };
+
+    qint64 timeNs;
+    const char *category;
+    const char *format;
+    quint8 level;
+    quint8 argumentCount;
+    quint8 textUsed;
+    Argument arguments[kMaxArguments];
+    char text[kTextSize];
+};
+
+/**
+ * @brief Queues log records from any thread and writes them to stderr on a background thread
+ *
+ * Producers push fixed size records into a lock-free multi-producer ring buffer and return
+ * immediately. When the ring is full the record is dropped and counted rather than waiting,
+ * so logging never blocks the GUI or audio threads
+ */
+
+class Logger
+{
+public:
+    // Returns the application wide logger, starting its drain thread on first use
+    static Logger &instance();
+
+    // Runtime filter on top of GAME_LOG_LEVEL
+    void setLevel(LogLevel level) { m_level.store(int(level), std::memory_order_relaxed); }
+    LogLevel level() const { return LogLevel(m_level.load(std::memory_order_relaxed)); }
+
+    // Queues a record, use the LOG_* macros so disabled levels are compiled out
+    template <typename... Args>
+    void write(LogLevel level, const char *category, const char *format, const Args &... args)
+    {
+        static_assert(sizeof...(Args) <= LogRecord::kMaxArguments, "Too many log arguments");
+
+        if (int(level) < m_level.load(std::memory_order_relaxed)) return;
+
+        LogRecord record;
+        record.timeNs = m_clock.nsecsElapsed();
+        record.category = category;
+        record.format = format;
+        record.level = quint8(level);
+        record.argumentCount = 0;
+        record.textUsed = 0;
+
+        // Expands to one addArgument call per argument, in order
+        int expand[] = { 0, (addArgument(record, args), 0)... };
+        Q_UNUSED(expand);
+
+        push(record);
+    }
+
+    // Blocks until every queued record has been written
+    void flush();
+
+    // Records lost because the ring was full
+    quint64 droppedRecords() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    Logger();
+    ~Logger();
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    // Packs one argument into a record, integers of any width are stored as qint64
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type
+    addArgument(LogRecord &record, T value) { addInteger(record, qint64(value)); }
+
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value>::type
+    addArgument(LogRecord &record, T value) { addReal(record, double(value)); }
+
+    static void addArgument(LogRecord &record, bool value);
+    static void addArgument(LogRecord &record, const QString &value);
+    static void addArgument(LogRecord &record, const char *value);
+
+    static void addInteger(LogRecord &record, qint64 value);
+    static void addReal(LogRecord &record, double value);
+
+    // Appends UTF-8 text to the record's inline buffer, truncating when it is full
+    static void addText(LogRecord &record, const char *utf8, int length);
+
+    void push(const LogRecord &record);
+
+    // Writes queued records until the logger is destroyed
+    void drain();
+
+    // Writes every queued record, returns the number written
+    int writePending();
+
+    // Turns a record into a line of text
+    static QString format(const LogRecord &record);
+
+    QElapsedTimer m_clock;
+    std::atomic<int> m_level;
+    std::atomic<quint64> m_dropped;
+    std::atomic<quint64> m_pushed;
+    std::atomic<quint64> m_written;
+    std::atomic<bool> m_running;
+    MpscRingBuffer<LogRecord, 1024> m_queue;
+    QThread *m_thread;
+};
+
+#endif // LOGGER_H
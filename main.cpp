@@ -5,7 +5,30 @@
  */
 
 #include "mainwindow.h"
+#include "assetpack.h"
+#include "dspbenchmark.h"
+#include "headlesssimulation.h"
+#include "startupbenchmark.h"
 #include <QApplication>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+namespace {
+
+// Mounts the external asset pack if the build uses one, reports why it could not be on stderr
+bool mountAssets()
+{
+
+    QString error;
+    if (AssetPack::mount(&error)) return true;
+
+    QTextStream(stderr) << error << Qt::endl;
+    return false;
+
+}
+
+}
 
 /**
  * @brief Entry point for the application
@@ -13,15 +36,42 @@
  * @param argv represents the argument values
  * @return Exit status code
  *
- * Initializes the QApplication instance and sets up the main window
+ * Initializes the QApplication instance and sets up the main window. With --headless the
+ * game rules are replayed from an input log instead, without a window or audio device,
+ * --bench-dsp times the audio analysis kernels and --bench-startup the time to the main menu
  */
 
 int main(int argc, char *argv[])
 {
 
+    // Startup is timed from here by --bench-startup
+    QElapsedTimer launch;
+    launch.start();
+
+    // Runs the headless simulation on a QCoreApplication, so no display is needed
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--headless") == 0) {
+            QCoreApplication app(argc, argv);
+            if (!mountAssets()) return 1;
+            return HeadlessSimulation::runFromCommandLine(app.arguments());
+        }
+        if (qstrcmp(argv[i], "--bench-dsp") == 0) {
+            QCoreApplication app(argc, argv);
+            return DspBenchmark::runFromCommandLine(app.arguments());
+        }
+        if (qstrcmp(argv[i], "--bench-startup") == 0) {
+            QApplication app(argc, argv);
+            if (!mountAssets()) return 1;
+            return StartupBenchmark::runFromCommandLine(app.arguments(), launch);
+        }
+    }
+
     // Initialize Qt application
     QApplication a(argc, argv);
 
+    // Resources come from assets.rcc in builds made with CONFIG+=external_assets
+    if (!mountAssets()) return 1;
+
     // Creates the main window
     MainWindow w;
     w.show();
@@ -7,6 +7,7 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "gamewindow.h"
+#include "assetloader.h"
 #include <QPixmap>
 #include <QLabel>
 #include <QPushButton>
@@ -36,12 +37,13 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     setupAudio();
     m_audioSystem_main->playBackgroundMusic("qrc:/horror_music/background_main.mp3", true);
 
-    // Creates and configures the background image
+    // Creates and configures the background image, decoded off the GUI thread so the menu paints right away
     QLabel *background = new QLabel(this);
-    QPixmap bgImage(":/images/main_menu.png");
-    background->setPixmap(bgImage);
     background->setGeometry(0, 0, 1440, 900);
     background->lower();
+    AssetLoader::instance().loadPixmap(":/images/main_menu.png", background, [background](const QPixmap &bgImage) {
+        background->setPixmap(bgImage);
+    }, AssetLoader::Critical);
 
     // Creates and configures the "New Game" button
     QPushButton *newGameButton = new QPushButton(this);
@@ -88,8 +90,9 @@ MainWindow::~MainWindow()
 /**
  * @brief Handles New Game button click events
  *
- * This function logs the button press, hides the main window, stops background music, and creates
- * a new game window for the actual gameplay itself
+ * This function logs the button press, hides the main window, and creates a new game window for
+ * the actual gameplay itself. The game window takes over the audio system, so the menu music
+ * crossfades into the game music instead of stopping
  */
 
 void MainWindow::onNewGameButtonClicked()
@@ -98,11 +101,12 @@ void MainWindow::onNewGameButtonClicked()
     // Hides the main menu
     this->hide();
 
-    // Stops background music
-    m_audioSystem_main->stopBackgroundMusic();
+    // Hands the audio system over to the game window
+    AudioSystem *audioSystem = m_audioSystem_main;
+    m_audioSystem_main = nullptr;
 
     // Creates the game window that contains the game scene
-    GameWindow *gameWindow = new GameWindow();
+    GameWindow *gameWindow = new GameWindow(audioSystem);
     gameWindow->show();
 
 }
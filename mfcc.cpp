@@ -0,0 +1,308 @@
+/**
+ * @file mfcc.cpp
+ * @brief Implementation of the MfccExtractor and MfccStream classes
+ * @author Kiet Tran, Steph Oh
+ */
+
+#include "mfcc.h"
+#include <QtMath>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Boost of the high frequencies before the spectrum is taken
+const float kPreEmphasis = 0.97f;
+
+// Floor of the filter energies, keeps the log finite during digital silence
+const float kEnergyFloor = 1e-10f;
+
+qreal hzToMel(qreal hz)
+{
+
+    return 2595.0 * std::log10(1.0 + hz / 700.0);
+
+}
+
+qreal melToHz(qreal mel)
+{
+
+    return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+
+}
+
+}
+
+/**
+ * @brief Builds the window, FFT, filter bank and DCT tables of a sample rate
+ * @param sampleRate represents the rate of the samples passed in, in Hz
+ */
+
+MfccExtractor::MfccExtractor(int sampleRate)
+    : m_sampleRate(qMax(8000, sampleRate))
+    , m_frameSize(m_sampleRate / 40)
+    , m_hopSize(m_sampleRate / 100)
+    , m_fftSize(4)
+{
+
+    while (m_fftSize < m_frameSize) {
+        m_fftSize *= 2;
+    }
+    const int half = m_fftSize / 2;
+
+    m_window.resize(m_frameSize);
+    for (int i = 0; i < m_frameSize; ++i) {
+        m_window[i] = float(0.54 - 0.46 * std::cos(2.0 * M_PI * i / (m_frameSize - 1)));
+    }
+
+    m_cos.resize(half);
+    m_sin.resize(half);
+    for (int i = 0; i < half; ++i) {
+        m_cos[i] = float(std::cos(2.0 * M_PI * i / m_fftSize));
+        m_sin[i] = float(-std::sin(2.0 * M_PI * i / m_fftSize));
+    }
+
+    int bits = 0;
+    while ((1 << bits) < half) {
+        ++bits;
+    }
+    m_bitReverse.resize(half);
+    for (int i = 0; i < half; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bitReverse[i] = reversed;
+    }
+
+    // Filter edges are spaced evenly on the mel scale and rounded to FFT bins
+    const qreal lowMel = hzToMel(20.0);
+    const qreal highMel = hzToMel(qMin(8000.0, m_sampleRate / 2.0));
+    QVector<qreal> edges(kFilterCount + 2);
+    for (int i = 0; i < edges.size(); ++i) {
+        const qreal hz = melToHz(lowMel + (highMel - lowMel) * i / (kFilterCount + 1));
+        edges[i] = hz * m_fftSize / m_sampleRate;
+    }
+
+    m_filterStart.resize(kFilterCount);
+    m_filterLength.resize(kFilterCount);
+    for (int f = 0; f < kFilterCount; ++f) {
+        const qreal left = edges[f];
+        const qreal centre = edges[f + 1];
+        const qreal right = edges[f + 2];
+        const int first = int(std::ceil(left));
+        const int last = qMin(int(std::floor(right)), half);
+
+        m_filterStart[f] = first;
+        m_filterLength[f] = qMax(0, last - first + 1);
+        for (int bin = first; bin <= last; ++bin) {
+            const qreal weight = bin <= centre ? (bin - left) / qMax(1e-9, centre - left)
+                                               : (right - bin) / qMax(1e-9, right - centre);
+            m_filterWeights.append(float(qMax(0.0, weight)));
+        }
+    }
+
+    m_dct.resize(kCoefficientCount * kFilterCount);
+    for (int c = 0; c < kCoefficientCount; ++c) {
+        for (int f = 0; f < kFilterCount; ++f) {
+            m_dct[c * kFilterCount + f] = float(std::cos(M_PI * c * (f + 0.5) / kFilterCount));
+        }
+    }
+
+    m_real.resize(half);
+    m_imag.resize(half);
+    m_power.resize(half + 1);
+    m_energies.resize(kFilterCount);
+
+}
+
+/**
+ * @brief Returns the number of whole frames in a block of samples
+ */
+
+int MfccExtractor::frameCount(int samples) const
+{
+
+    return samples < m_frameSize ? 0 : 1 + (samples - m_frameSize) / m_hopSize;
+
+}
+
+/**
+ * @brief Computes the features of one frame
+ * @param frame represents frameSize() pre-emphasised samples
+ * @param logMel represents room for kFilterCount values, or nullptr
+ * @param coefficients represents room for kCoefficientCount values
+ */
+
+void MfccExtractor::transform(const float *frame, float *logMel, float *coefficients)
+{
+
+    powerSpectrum(frame);
+
+    const float *weight = m_filterWeights.constData();
+    for (int f = 0; f < kFilterCount; ++f) {
+        float energy = 0.0f;
+        const float *power = m_power.constData() + m_filterStart[f];
+        for (int i = 0; i < m_filterLength[f]; ++i) {
+            energy += power[i] * weight[i];
+        }
+        weight += m_filterLength[f];
+        m_energies[f] = std::log(qMax(energy, kEnergyFloor));
+    }
+
+    if (logMel) {
+        std::memcpy(logMel, m_energies.constData(), kFilterCount * sizeof(float));
+    }
+
+    for (int c = 0; c < kCoefficientCount; ++c) {
+        const float *row = m_dct.constData() + c * kFilterCount;
+        float sum = 0.0f;
+        for (int f = 0; f < kFilterCount; ++f) {
+            sum += row[f] * m_energies[f];
+        }
+        coefficients[c] = sum;
+    }
+
+}
+
+/**
+ * @brief Computes the power spectrum of a windowed real frame
+ *
+ * The real frame is packed into a complex sequence of half the length (even samples real, odd
+ * samples imaginary), transformed with a radix 2 FFT and split back into the spectrum of the
+ * real frame, which halves the work of a plain complex FFT
+ */
+
+void MfccExtractor::powerSpectrum(const float *frame)
+{
+
+    const int half = m_fftSize / 2;
+    float *real = m_real.data();
+    float *imag = m_imag.data();
+
+    for (int n = 0; n < half; ++n) {
+        const int even = 2 * n;
+        const int odd = even + 1;
+        const int target = m_bitReverse[n];
+        real[target] = even < m_frameSize ? frame[even] * m_window[even] : 0.0f;
+        imag[target] = odd < m_frameSize ? frame[odd] * m_window[odd] : 0.0f;
+    }
+
+    // Twiddles of the half size transform are every other one of the full size table
+    for (int size = 2; size <= half; size *= 2) {
+        const int step = size / 2;
+        const int stride = 2 * (half / size);
+
+        for (int start = 0; start < half; start += size) {
+            for (int k = 0; k < step; ++k) {
+                const float wr = m_cos[k * stride];
+                const float wi = m_sin[k * stride];
+                const int a = start + k;
+                const int b = a + step;
+
+                const float tr = real[b] * wr - imag[b] * wi;
+                const float ti = real[b] * wi + imag[b] * wr;
+                real[b] = real[a] - tr;
+                imag[b] = imag[a] - ti;
+                real[a] += tr;
+                imag[a] += ti;
+            }
+        }
+    }
+
+    for (int k = 0; k <= half; ++k) {
+        const int index = k % half;
+        const int mirror = (half - k) % half;
+
+        // Spectra of the even and odd samples
+        const float evenReal = 0.5f * (real[index] + real[mirror]);
+        const float evenImag = 0.5f * (imag[index] - imag[mirror]);
+        const float oddReal = 0.5f * (imag[index] + imag[mirror]);
+        const float oddImag = -0.5f * (real[index] - real[mirror]);
+
+        const float wr = k < half ? m_cos[k] : -1.0f;
+        const float wi = k < half ? m_sin[k] : 0.0f;
+        const float outReal = evenReal + wr * oddReal - wi * oddImag;
+        const float outImag = evenImag + wr * oddImag + wi * oddReal;
+        m_power[k] = outReal * outReal + outImag * outImag;
+    }
+
+}
+
+/**
+ * @brief Constructs a stream for audio of a sample rate
+ * @param sampleRate represents the rate of the samples passed to process()
+ */
+
+MfccStream::MfccStream(int sampleRate)
+    : m_extractor(sampleRate)
+    , m_buffered(0)
+    , m_previousSample(0.0f)
+    , m_framesProcessed(0)
+{
+
+    m_buffer.resize(m_extractor.frameSize());
+
+}
+
+/**
+ * @brief Drops the buffered samples and the pre-emphasis state
+ */
+
+void MfccStream::reset()
+{
+
+    m_buffered = 0;
+    m_previousSample = 0.0f;
+    m_framesProcessed = 0;
+
+}
+
+/**
+ * @brief Feeds samples and computes the frames they complete
+ * @param samples represents mono samples at the stream's sample rate
+ * @param count represents the number of samples
+ * @param coefficients represents room for maxFrames * kCoefficientCount values
+ * @param maxFrames represents the number of frames there is room for
+ * @param logMel represents room for maxFrames * kFilterCount values, or nullptr
+ * @return Returns the number of frames written
+ */
+
+int MfccStream::process(const qint16 *samples, int count, float *coefficients, int maxFrames, float *logMel)
+{
+
+    const int frameSize = m_extractor.frameSize();
+    const int hopSize = m_extractor.hopSize();
+    float *buffer = m_buffer.data();
+    int written = 0;
+
+    while (count > 0) {
+        const int take = qMin(count, frameSize - m_buffered);
+        float *out = buffer + m_buffered;
+        for (int i = 0; i < take; ++i) {
+            const float sample = samples[i];
+            out[i] = sample - kPreEmphasis * m_previousSample;
+            m_previousSample = sample;
+        }
+        m_buffered += take;
+        samples += take;
+        count -= take;
+
+        if (m_buffered < frameSize) break;
+
+        if (written < maxFrames) {
+            m_extractor.transform(buffer,
+                                  logMel ? logMel + written * MfccExtractor::kFilterCount : nullptr,
+                                  coefficients + written * MfccExtractor::kCoefficientCount);
+            ++written;
+        }
+        ++m_framesProcessed;
+
+        // Slides to the start of the next frame, the overlap is kept as it is
+        std::memmove(buffer, buffer + hopSize, (frameSize - hopSize) * sizeof(float));
+        m_buffered -= hopSize;
+    }
+
+    return written;
+
+}
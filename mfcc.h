@@ -0,0 +1,107 @@
+/**
+ * @file mfcc.h
+ * @brief Streaming log mel and cepstral features of 16-bit PCM
+ * @author Kiet Tran, Steph Oh
+ */
+
+#ifndef MFCC_H
+#define MFCC_H
+
+#include <QVector>
+
+/**
+ * @brief Turns one frame of audio into log mel energies and cepstral coefficients
+ *
+ * Frames are 25 ms long with a Hamming window, the power spectrum goes through a bank of
+ * triangular mel filters and the log filter energies are decorrelated with a DCT. Frame and
+ * FFT sizes follow the sample rate, so features of a 16 kHz and a 48 kHz microphone are
+ * comparable. All tables and scratch buffers are built once in the constructor
+ */
+
+class MfccExtractor
+{
+public:
+    // Coefficients per frame, including c0
+    static const int kCoefficientCount = 13;
+
+    // Triangular filters between 20 Hz and 8 kHz (or the Nyquist frequency)
+    static const int kFilterCount = 26;
+
+    explicit MfccExtractor(int sampleRate = 16000);
+
+    int sampleRate() const { return m_sampleRate; }
+
+    // Samples per analysis frame and between frame starts
+    int frameSize() const { return m_frameSize; }
+    int hopSize() const { return m_hopSize; }
+
+    // Number of whole frames in a block of samples
+    int frameCount(int samples) const;
+
+    // Transforms frameSize() pre-emphasised samples, logMel may be nullptr
+    void transform(const float *frame, float *logMel, float *coefficients);
+
+private:
+    MfccExtractor(const MfccExtractor &) = delete;
+    MfccExtractor &operator=(const MfccExtractor &) = delete;
+
+    // Power spectrum of the windowed frame into m_power, bins 0 to fftSize / 2
+    void powerSpectrum(const float *frame);
+
+    int m_sampleRate;
+    int m_frameSize;
+    int m_hopSize;
+    int m_fftSize;
+
+    QVector<float> m_window;        // Hamming window, frameSize values
+    QVector<float> m_cos;           // Twiddle factors of the full FFT size, fftSize / 2 values each
+    QVector<float> m_sin;
+    QVector<int> m_bitReverse;      // Input permutation of the half size complex FFT
+    QVector<int> m_filterStart;     // First FFT bin of each mel filter
+    QVector<int> m_filterLength;    // Number of bins of each mel filter
+    QVector<float> m_filterWeights; // Weights of all filters, back to back
+    QVector<float> m_dct;           // kCoefficientCount rows of kFilterCount values
+
+    // Scratch buffers of one frame
+    QVector<float> m_real;
+    QVector<float> m_imag;
+    QVector<float> m_power;
+    QVector<float> m_energies;
+};
+
+/**
+ * @brief Computes features hop by hop as audio arrives
+ *
+ * Samples are pre-emphasised once on arrival, with the filter state carried across calls, and
+ * kept in a buffer of one frame. Each completed frame is transformed straight away and the
+ * buffer slides by one hop, so no sample is converted twice and the steady state allocates
+ * nothing
+ */
+
+class MfccStream
+{
+public:
+    explicit MfccStream(int sampleRate = 16000);
+
+    MfccExtractor &extractor() { return m_extractor; }
+    const MfccExtractor &extractor() const { return m_extractor; }
+
+    // Drops the buffered samples and the pre-emphasis state
+    void reset();
+
+    // Feeds samples and writes the features of every frame they complete, up to maxFrames
+    // (later frames are dropped). Returns the number of frames written
+    int process(const qint16 *samples, int count, float *coefficients, int maxFrames, float *logMel = nullptr);
+
+    // Frames completed since the last reset()
+    quint64 framesProcessed() const { return m_framesProcessed; }
+
+private:
+    MfccExtractor m_extractor;
+    QVector<float> m_buffer;    // Pre-emphasised samples from the start of the next frame
+    int m_buffered;
+    float m_previousSample;
+    quint64 m_framesProcessed;
+};
+
+#endif // MFCC_H
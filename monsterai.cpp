@@ -0,0 +1,229 @@
+/**
+ * @file monsterai.cpp
+ * @brief Implementation of the MonsterAI class
+ * @author Kiet Tran
+ */
+
+#include "monsterai.h"
+#include "collisionworld.h"
+#include <cmath>
+
+namespace {
+
+// Cells of the navigation grid, a third of the body so paths hug corners closely
+const qreal kCellSize = 20.0;
+
+// Patrols stay this close to home and walk at this fraction of the chasing speed
+const qreal kPatrolRadius = 240.0;
+const qreal kPatrolSpeedFactor = 0.45;
+
+// Random cells tried when picking the next patrol point
+const int kPatrolTries = 8;
+
+// A path point closer than this counts as reached
+const qreal kArriveDistance = kCellSize * 0.5;
+
+// Scales a vector to unit length, null vectors stay null
+QPointF normalized(const QPointF &vector)
+{
+
+    const qreal length = std::hypot(vector.x(), vector.y());
+    return length > 1e-6 ? vector / length : QPointF();
+
+}
+
+}
+
+const QSizeF MonsterAI::kBodySize(60.0, 60.0);
+const qreal MonsterAI::kDefaultSpeed = 120.0;
+const qreal MonsterAI::kChaseRange = 520.0;
+const qreal MonsterAI::kGiveUpRange = 800.0;
+const qreal MonsterAI::kAttackInterval = 1.0;
+
+/**
+ * @brief Constructs a MonsterAI without a room
+ * @param entities represents the world the monsters' bodies are created in
+ * @param seed represents the seed of the patrol points, reapplied by every reset()
+ */
+
+MonsterAI::MonsterAI(EntityWorld *entities, quint32 seed)
+    : m_entities(entities)
+    , m_grid(kCellSize)
+    , m_random(seed)
+    , m_seed(seed)
+{
+
+}
+
+/**
+ * @brief Builds the navigation grid of a room and removes every monster
+ * @param world represents the room's walls
+ * @param bounds represents the area monsters may move in
+ *
+ * The monsters' entities are destroyed, their sprite items must be taken from the EntityWorld
+ * before
+ */
+
+void MonsterAI::reset(const CollisionWorld *world, const QRectF &bounds)
+{
+
+    for (const Monster &monster : m_monsters) {
+        m_entities->destroy(monster.entity);
+    }
+    m_monsters.clear();
+    m_random.seed(m_seed);
+
+    if (world) {
+        m_grid.build(*world, bounds, kBodySize);
+    } else {
+        m_grid = NavGrid(kCellSize);
+    }
+    m_field.reset(&m_grid);
+
+}
+
+/**
+ * @brief Places a monster
+ * @param position represents the centre of its body
+ * @param speed represents its chasing speed, 0 for kDefaultSpeed
+ * @return Returns the entity of the monster's body
+ */
+
+Entity MonsterAI::spawn(const QPointF &position, qreal speed)
+{
+
+    Monster monster;
+    monster.entity = m_entities->create(EntityWorld::Position | EntityWorld::Velocity
+                                        | EntityWorld::Collider | EntityWorld::Sprite);
+    monster.home = position;
+    monster.speed = speed > 0 ? speed : kDefaultSpeed;
+
+    m_entities->setPosition(monster.entity, position);
+    m_entities->setCollider(monster.entity, QRectF(-kBodySize.width() / 2, -kBodySize.height() / 2,
+                                                   kBodySize.width(), kBodySize.height()));
+
+    m_monsters.append(monster);
+    return monster.entity;
+
+}
+
+/**
+ * @brief Decides every monster's velocity for the next fixed step
+ * @param playerBox represents the player's collision box
+ * @param dt represents the step in seconds
+ * @return Returns the damage dealt to the player by the monsters touching it
+ *
+ * Contact is checked on the positions of the latest tick, before Systems::integrate() moves
+ * anything. Switching between patrolling and chasing uses two ranges, so a player walking along
+ * the edge of one does not make monsters flip every tick
+ */
+
+int MonsterAI::update(const QRectF &playerBox, qreal dt)
+{
+
+    if (m_monsters.isEmpty() || !m_grid.isValid()) return 0;
+
+    const QPointF player = playerBox.center();
+    m_field.setTarget(m_grid.cellAt(player));
+
+    int damage = 0;
+
+    for (Monster &monster : m_monsters) {
+        const QPointF position = m_entities->position(monster.entity);
+        monster.attackCooldown = qMax<qreal>(0.0, monster.attackCooldown - dt);
+
+        if (monster.attackCooldown <= 0.0 && m_entities->bounds(monster.entity).intersects(playerBox)) {
+            damage += kContactDamage;
+            monster.attackCooldown = kAttackInterval;
+        }
+
+        const qreal distance = m_field.distance(m_grid.nearestWalkable(m_grid.cellAt(position)));
+        if (monster.state == Monster::Patrolling && distance <= kChaseRange) {
+            monster.state = Monster::Chasing;
+        } else if (monster.state == Monster::Chasing && distance > kGiveUpRange) {
+            monster.state = Monster::Patrolling;
+            monster.path.clear();
+        }
+
+        if (monster.state == Monster::Chasing) {
+            m_entities->setVelocity(monster.entity, chaseHeading(position, player) * monster.speed);
+        } else {
+            m_entities->setVelocity(monster.entity, patrolHeading(monster, position) * monster.speed * kPatrolSpeedFactor);
+        }
+    }
+
+    return damage;
+
+}
+
+/**
+ * @brief Returns the number of monsters chasing the player
+ */
+
+int MonsterAI::chasingCount() const
+{
+
+    int chasing = 0;
+    for (const Monster &monster : m_monsters) {
+        if (monster.state == Monster::Chasing) ++chasing;
+    }
+
+    return chasing;
+
+}
+
+/**
+ * @brief Returns the unit step of a chasing monster
+ *
+ * Heads for the centre of the next cell the flow field gives, which also pulls a monster that
+ * drifted off its cell's centre back onto the field. In the player's cell it goes straight for
+ * the player
+ */
+
+QPointF MonsterAI::chaseHeading(const QPointF &position, const QPointF &player) const
+{
+
+    const int cell = m_grid.nearestWalkable(m_grid.cellAt(position));
+    const int next = m_field.nextCell(cell);
+    if (next < 0) {
+        return normalized(player - position);
+    }
+
+    return normalized(m_grid.cellCenter(next) - position);
+
+}
+
+/**
+ * @brief Returns the unit step of a patrolling monster
+ *
+ * A finished path is replaced by an A* path to a random walkable point near home. When no point
+ * can be reached the monster waits and tries again on the next tick
+ */
+
+QPointF MonsterAI::patrolHeading(Monster &monster, const QPointF &position)
+{
+
+    while (monster.pathIndex < monster.path.size()) {
+        const QPointF offset = monster.path.at(monster.pathIndex) - position;
+        if (std::hypot(offset.x(), offset.y()) > kArriveDistance) {
+            return normalized(offset);
+        }
+        ++monster.pathIndex;
+    }
+
+    monster.path.clear();
+    monster.pathIndex = 0;
+
+    for (int attempt = 0; attempt < kPatrolTries; ++attempt) {
+        const QPointF point = monster.home + QPointF(m_random.bounded(2.0) - 1.0, m_random.bounded(2.0) - 1.0) * kPatrolRadius;
+        const int cell = m_grid.cellAt(point);
+        if (!m_grid.isWalkable(cell)) continue;
+
+        if (m_grid.findPath(position, m_grid.cellCenter(cell), &monster.path)) {
+            return QPointF();
+        }
+    }
+
+    return QPointF();
+
+}
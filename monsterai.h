@@ -0,0 +1,116 @@
+/**
+ * @file monsterai.h
+ * @brief Monsters that patrol their part of a room and hunt the player through it
+ * @author Kiet Tran
+ */
+
+#ifndef MONSTERAI_H
+#define MONSTERAI_H
+
+#include <QPointF>
+#include <QRandomGenerator>
+#include <QRectF>
+#include <QSizeF>
+#include <QVector>
+#include "entityworld.h"
+#include "flowfield.h"
+#include "navgrid.h"
+
+class CollisionWorld;
+
+/**
+ * @brief Decision state of one monster, its body is an entity of the EntityWorld
+ */
+
+struct Monster {
+    enum State : quint8 {
+        Patrolling,     // Walking between random points around home
+        Chasing         // Following the flow field to the player
+    };
+
+    Entity entity;              // Position, velocity and collider, centred on the position
+    QPointF home;               // Spawn point, patrols stay around it
+    qreal speed = 0.0;          // Chasing speed in pixels per second
+    State state = Patrolling;
+    QVector<QPointF> path;      // Patrol path found by A*
+    int pathIndex = 0;          // Next point of the path
+    qreal attackCooldown = 0.0; // Seconds until the monster can hurt the player again
+};
+
+/**
+ * @brief Moves every monster of a room by one fixed step at a time
+ *
+ * The room's walls become a NavGrid for the monsters' body size when the room is entered.
+ * Monsters farther from the player than kChaseRange, measured along the walkable cells, patrol
+ * around their spawn point on paths found by A*. Closer ones chase: every tick the player's cell
+ * is handed to one shared FlowField, which only rebuilds when that cell changes, and each chaser
+ * steers toward the next cell the field gives for its own. A crowd of chasers therefore costs
+ * one field rebuild every few ticks and a lookup per monster, not a search per monster.
+ *
+ * Each monster's body is an entity: update() only decides its velocity, and Systems::integrate()
+ * sweeps it against the CollisionWorld together with the player's, so monsters slide along walls
+ * they brush. The random patrol points come from a seeded generator and the steps only depend
+ * on dt, so the headless simulation replays monsters exactly
+ */
+
+class MonsterAI
+{
+public:
+    // Size of a monster's collision box
+    static const QSizeF kBodySize;
+
+    // Chasing speed of monsters placed without one, in pixels per second
+    static const qreal kDefaultSpeed;
+
+    // Path distance under which a monster starts chasing, and over which it gives up
+    static const qreal kChaseRange;
+    static const qreal kGiveUpRange;
+
+    // Damage of one hit and seconds between two hits of the same monster
+    static const int kContactDamage = 10;
+    static const qreal kAttackInterval;
+
+    // Creates the monsters' bodies in entities, which must outlive the MonsterAI
+    explicit MonsterAI(EntityWorld *entities, quint32 seed = 0);
+
+    // Builds the navigation grid of a room from its walls and destroys every monster's entity.
+    // bounds is usually the scene rect
+    void reset(const CollisionWorld *world, const QRectF &bounds);
+
+    // Places a monster with its body centred on position, returns its entity. The entity has a
+    // Sprite slot for the game window to fill
+    Entity spawn(const QPointF &position, qreal speed = 0.0);
+
+    // Hits the player with the monsters touching it, then turns every monster toward or around
+    // the player. Returns the damage dealt, the monsters move in the next Systems::integrate()
+    int update(const QRectF &playerBox, qreal dt);
+
+    int count() const { return m_monsters.size(); }
+    const Monster &monster(int index) const { return m_monsters.at(index); }
+
+    // Centre and collision box of a monster after the latest tick
+    QPointF position(int index) const { return m_entities->position(m_monsters.at(index).entity); }
+    QRectF bounds(int index) const { return m_entities->bounds(m_monsters.at(index).entity); }
+
+    // Monsters currently chasing the player
+    int chasingCount() const;
+
+    const NavGrid &grid() const { return m_grid; }
+    const FlowField &field() const { return m_field; }
+
+private:
+    // Unit step of a chasing monster
+    QPointF chaseHeading(const QPointF &position, const QPointF &player) const;
+
+    // Unit step of a patrolling monster, picking a new patrol point when the path is done
+    QPointF patrolHeading(Monster &monster, const QPointF &position);
+
+    EntityWorld *m_entities;
+    NavGrid m_grid;
+    FlowField m_field;
+    QRandomGenerator m_random;
+    quint32 m_seed;
+    QVector<Monster> m_monsters;
+};
+
+#endif // MONSTERAI_H
@@ -6,16 +6,25 @@
 
 #include "movement.h"
 #include "player.h"
+#include "collisionworld.h"
 #include <QGraphicsItem>
 #include <QList>
 #include <QDebug>
 
 
-Movement::Movement(Player* player, QObject* parent)
+Movement::Movement(EntityWorld *world, Entity entity, Player *player, QObject *parent)
     : QObject(parent)
+    , m_world(world)
+    , m_entity(entity)
     , m_player(player)
+    , m_collisionWorld(nullptr)
+    , m_speed(300.0)
 {
 
+    if (m_player) {
+        m_world->setPosition(m_entity, m_player->pos());
+    }
+
 }
 
 /**
@@ -30,13 +39,8 @@ void Movement::moveUp(int step)
 
     // Moves the player upward
     if (!m_player) return;
-    QPointF oldPos = m_player->pos();
-    m_player->setPos(m_player->x(), m_player->y() - step);
-
-    // Checks collisions with non-background items
-    if (hasCollision()) {
-        m_player->setPos(oldPos);
-    }
+    tryMove(0, -step);
+    m_player->setPos(position());
 
 }
 
@@ -52,13 +56,8 @@ void Movement::moveDown(int step)
 
     // Moves the player downward
     if (!m_player) return;
-    QPointF oldPos = m_player->pos();
-    m_player->setPos(m_player->x(), m_player->y() + step);
-
-    // Checks collisions with non-background items
-    if (hasCollision()) {
-        m_player->setPos(oldPos);
-    }
+    tryMove(0, step);
+    m_player->setPos(position());
 
 }
 
@@ -74,13 +73,8 @@ void Movement::moveLeft(int step)
 
     // Moves the player leftward
     if (!m_player) return;
-    QPointF oldPos = m_player->pos();
-    m_player->setPos(m_player->x() - step, m_player->y());
-
-    // Checks collisions with non-background items
-    if (hasCollision()) {
-        m_player->setPos(oldPos);
-    }
+    tryMove(-step, 0);
+    m_player->setPos(position());
 }
 
 /**
@@ -95,14 +89,83 @@ void Movement::moveRight(int step)
 
     // Moves the player rightward
     if (!m_player) return;
-    QPointF oldPos = m_player->pos();
-    m_player->setPos(m_player->x() + step, m_player->y());
+    tryMove(step, 0);
+    m_player->setPos(position());
+
+}
+
+/**
+ * @brief Sets the velocity of the player for the next tick
+ * @param direction represents the normalized movement direction (zero when idle)
+ *
+ * Systems::integrate() then moves the player together with every other entity, sweeping each
+ * axis on its own so diagonal movement keeps sliding along a wall when only one axis is blocked
+ */
+
+void Movement::update(const QPointF &direction)
+{
+
+    m_world->setVelocity(m_entity, direction * m_speed);
+
+}
+
+/**
+ * @brief Teleports the player to a position
+ * @param position represents the new scene position
+ */
+
+void Movement::setPosition(const QPointF &position)
+{
+
+    m_world->setPosition(m_entity, position);
+    if (m_player) {
+        m_player->setPos(position);
+    }
+
+}
+
+/**
+ * @brief Moves the simulated position by an offset
+ * @return true if the move was applied in full and false if it was blocked
+ *
+ * Without a collision world the player item is placed at the candidate position only for the collision query
+ */
+
+bool Movement::tryMove(qreal dx, qreal dy)
+{
+
+    if (dx == 0 && dy == 0) return true;
+
+    const QPointF candidate = position() + QPointF(dx, dy);
+
+    // Sweeps against the static walls directly, moving up to the wall instead of rejecting the step
+    if (m_collisionWorld) {
+        const QPointF delta(dx, dy);
+        const QPointF allowed = m_collisionWorld->sweep(bounds(), delta);
+        m_world->setPosition(m_entity, position() + allowed);
+        return allowed == delta;
+    }
+
+    // Nothing to collide with without a collision world or a scene item
+    if (!m_player) {
+        m_world->setPosition(m_entity, candidate);
+        return true;
+    }
+
+    const QPointF renderedPos = m_player->pos();
+    m_player->setPos(candidate);
 
     // Checks collisions with non-background items
-    if (hasCollision()) {
-        m_player->setPos(oldPos);
+    const bool blocked = hasCollision();
+    m_player->setPos(renderedPos);
+
+    if (blocked) {
+        return false;
     }
 
+    m_world->setPosition(m_entity, candidate);
+    return true;
+
 }
 
 /**
@@ -117,6 +180,10 @@ bool Movement::hasCollision()
 
     if (!m_player) return false;
 
+    if (m_collisionWorld) {
+        return m_collisionWorld->intersects(bounds().translated(m_player->pos() - position()));
+    }
+
     QList<QGraphicsItem*> collisions = m_player->collidingItems();
 
     // Filters out non-collidable items
@@ -2,14 +2,20 @@
 #define MOVEMENT_H
 
 #include <QObject>
+#include <QPointF>
+#include <QRectF>
+#include "entityworld.h"
 
 class Player;
+class CollisionWorld;
 
 class Movement : public QObject
 {
     Q_OBJECT
 public:
-    explicit Movement(Player *player, QObject *parent = nullptr);
+    // Drives the player's entity, whose position, velocity and collider live in world. The
+    // player item may be null, the entity then moves without one
+    Movement(EntityWorld *world, Entity entity, Player *player, QObject *parent = nullptr);
 
     // Movement actions
     void moveUp(int step);
@@ -18,8 +24,35 @@ public:
     void moveRight(int step);
     bool hasCollision();
 
+    // Sets the velocity Systems::integrate() moves the player with on the next tick
+    void update(const QPointF &direction);
+
+    // Teleports the player, resetting interpolation
+    void setPosition(const QPointF &position);
+    QPointF position() const { return m_world->position(m_entity); }
+
+    // Entity of the player
+    Entity entity() const { return m_entity; }
+
+    // Static walls used for collision, falls back to scene items when not set
+    void setCollisionWorld(const CollisionWorld *world) { m_collisionWorld = world; }
+
+    // Collision box at the current simulated position
+    QRectF bounds() const { return m_world->bounds(m_entity); }
+
+    // Movement speed in pixels per second
+    void setSpeed(qreal pixelsPerSecond) { m_speed = pixelsPerSecond; }
+    qreal speed() const { return m_speed; }
+
 private:
+    // Moves the simulated position by an offset, rejecting the move on collision
+    bool tryMove(qreal dx, qreal dy);
+
+    EntityWorld *m_world;  // Holds the simulated position and collision box
+    Entity m_entity;
     Player *m_player;  // Pointer to the player we'll move
+    const CollisionWorld *m_collisionWorld;
+    qreal m_speed;
 };
 
 #endif // MOVEMENT_H
@@ -0,0 +1,93 @@
+/**
+ * @file mpscringbuffer.h
+ * @brief Fixed size lock-free queue for many producer threads and one consumer thread
+ * @author Kiet Tran
+ */
+
+#ifndef MPSCRINGBUFFER_H
+#define MPSCRINGBUFFER_H
+
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * @brief Bounded ring buffer any number of threads can push into and one thread pops from
+ *
+ * Every slot carries a sequence number telling whether it is free for the producer claiming it
+ * or filled for the consumer. Producers claim a slot with one compare-and-swap on the shared
+ * head and never wait for each other to finish writing, so a push never blocks. A push onto a
+ * full buffer fails instead of overwriting. Capacity must be a power of two
+ */
+
+template <typename T, int Capacity>
+class MpscRingBuffer
+{
+    static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    MpscRingBuffer() : m_head(0), m_tail(0)
+    {
+        for (int i = 0; i < Capacity; ++i) {
+            m_slots[i].sequence.store(quint64(i), std::memory_order_relaxed);
+        }
+    }
+
+    // Producer side, safe from any thread: appends a value, false if the buffer is full
+    bool push(const T &value)
+    {
+        quint64 head = m_head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = m_slots[head & (Capacity - 1)];
+            const qint64 state = qint64(slot.sequence.load(std::memory_order_acquire)) - qint64(head);
+
+            if (state == 0) {
+                // The slot is free for this position, claim it
+                if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(head + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (state < 0) {
+                // The consumer has not freed the slot yet, the buffer is full
+                return false;
+            } else {
+                // Another producer claimed this position first
+                head = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer side, one thread only: removes the oldest value, false if none is ready
+    bool pop(T &value)
+    {
+        const quint64 tail = m_tail.load(std::memory_order_relaxed);
+        Slot &slot = m_slots[tail & (Capacity - 1)];
+
+        if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+            return false;
+        }
+
+        value = slot.value;
+        slot.sequence.store(tail + Capacity, std::memory_order_release);
+        m_tail.store(tail + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    static constexpr int capacity() { return Capacity; }
+
+private:
+    MpscRingBuffer(const MpscRingBuffer &) = delete;
+    MpscRingBuffer &operator=(const MpscRingBuffer &) = delete;
+
+    struct Slot {
+        std::atomic<quint64> sequence;
+        T value;
+    };
+
+    // Kept on separate cache lines so producers and the consumer do not contend on one line
+    alignas(64) std::atomic<quint64> m_head;
+    alignas(64) std::atomic<quint64> m_tail;
+    alignas(64) Slot m_slots[Capacity];
+};
+
+#endif // MPSCRINGBUFFER_H
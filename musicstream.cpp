@@ -0,0 +1,264 @@
+/**
+ * @file musicstream.cpp
+ * @brief Implementation of the MusicStream class
+ * @author Cherie Duong
+ */
+
+#include "musicstream.h"
+#include "logger.h"
+#include "soundbank.h"
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QTimer>
+#include <cstring>
+
+namespace {
+
+// How often the ring is topped up when the decoder has no new buffer to announce
+const int kFillIntervalMs = 20;
+
+}
+
+/**
+ * @brief Constructs an idle stream for a mixer rate
+ * @param sampleRate represents the rate the mixer reads at
+ * @param parent represents the parent QObject
+ */
+
+MusicStream::MusicStream(int sampleRate, QObject *parent)
+    : QObject(parent)
+    , m_sampleRate(qMax(1, sampleRate))
+    , m_loop(false)
+    , m_finished(false)
+    , m_decoder(nullptr)
+    , m_fillTimer(new QTimer(this))
+    , m_pendingOffset(0)
+    , m_resamplePhase(1.0)
+    , m_produced(0)
+    , m_consumed(0)
+    , m_trackStart(0)
+{
+
+    m_lastFrame[0] = 0.0f;
+    m_lastFrame[1] = 0.0f;
+
+    m_fillTimer->setInterval(kFillIntervalMs);
+    connect(m_fillTimer, &QTimer::timeout, this, [this]() { fill(); });
+
+}
+
+/**
+ * @brief Stops the decoder
+ */
+
+MusicStream::~MusicStream()
+{
+
+    close();
+
+}
+
+/**
+ * @brief Starts decoding a track from its beginning
+ * @param filePath represents the path to the audio file
+ * @param loop represents whether the track repeats without end
+ *
+ * Everything the ring still holds of the previous track is skipped by read()
+ */
+
+void MusicStream::open(const QString &filePath, bool loop)
+{
+
+    close();
+
+    m_filePath = filePath;
+    m_loop = loop;
+    m_pending.clear();
+    m_pendingOffset = 0;
+    m_lastFrame[0] = 0.0f;
+    m_lastFrame[1] = 0.0f;
+    m_resamplePhase = 1.0;
+    m_trackStart.store(m_produced, std::memory_order_release);
+
+    startDecoder();
+    m_fillTimer->start();
+
+}
+
+/**
+ * @brief Stops decoding the current track
+ */
+
+void MusicStream::close()
+{
+
+    m_fillTimer->stop();
+
+    if (m_decoder) {
+        m_decoder->stop();
+        m_decoder->deleteLater();
+        m_decoder = nullptr;
+    }
+
+}
+
+/**
+ * @brief Takes decoded frames of the current track
+ * @param samples represents room for frames interleaved stereo frames
+ * @param frames represents the number of frames wanted
+ * @return Returns the number of frames read, fewer if the decoder fell behind
+ *
+ * First discards whatever the ring holds from before the current track was opened
+ */
+
+int MusicStream::read(qint16 *samples, int frames)
+{
+
+    const quint64 trackStart = m_trackStart.load(std::memory_order_acquire);
+    while (m_consumed < trackStart) {
+        const int skip = int(qMin<quint64>(trackStart - m_consumed, quint64(frames) * kChannels));
+        const int skipped = m_ring.read(samples, skip);
+        m_consumed += skipped;
+        if (skipped == 0) return 0;
+    }
+
+    const int read = m_ring.read(samples, frames * kChannels);
+    m_consumed += read;
+    return read / kChannels;
+
+}
+
+/**
+ * @brief Creates a decoder at the start of the track
+ *
+ * Restarting for a loop keeps the resampler state, so the loop point is as smooth as any other
+ * pair of samples
+ */
+
+void MusicStream::startDecoder()
+{
+
+    if (m_decoder) {
+        m_decoder->deleteLater();
+    }
+
+    m_finished = false;
+    m_decoder = new QAudioDecoder(this);
+
+    QAudioFormat format;
+    format.setSampleRate(m_sampleRate);
+    format.setChannelCount(kChannels);
+    format.setSampleFormat(QAudioFormat::Int16);
+    m_decoder->setAudioFormat(format);
+
+    if (!SoundBank::setDecoderSource(m_decoder, m_filePath)) {
+        LOG_WARNING("audio", "Music %1 could not be opened", m_filePath);
+        m_finished = true;
+        m_loop = false;
+        return;
+    }
+
+    QAudioDecoder *decoder = m_decoder;
+    connect(decoder, &QAudioDecoder::bufferReady, this, [this]() { fill(); });
+    connect(decoder, &QAudioDecoder::finished, this, [this, decoder]() {
+        if (decoder != m_decoder) return;
+        m_finished = true;
+        fill();
+    });
+    connect(decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), this, [this, decoder]() {
+        if (decoder != m_decoder) return;
+        LOG_WARNING("audio", "Music error: %1", decoder->errorString());
+        m_finished = true;
+        m_loop = false;
+    });
+
+    decoder->start();
+
+}
+
+/**
+ * @brief Tops up the ring from the decoder
+ *
+ * A new buffer is only read once the previous one is fully in the ring, which keeps the decoder
+ * about one ring ahead of the mixer. At the end of a looping track the decoder is restarted
+ */
+
+void MusicStream::fill()
+{
+
+    if (!m_decoder) return;
+
+    for (;;) {
+        if (m_pendingOffset < m_pending.size()) {
+            const int written = m_ring.write(m_pending.constData() + m_pendingOffset, m_pending.size() - m_pendingOffset);
+            m_pendingOffset += written;
+            m_produced += written;
+            if (m_pendingOffset < m_pending.size()) return;
+        }
+
+        if (m_decoder->bufferAvailable()) {
+            convert(m_decoder->read());
+            continue;
+        }
+
+        if (m_finished && m_loop) {
+            startDecoder();
+        }
+        return;
+    }
+
+}
+
+/**
+ * @brief Converts a decoded buffer into m_pending
+ *
+ * Buffers already in the requested format are copied. Others are mapped to stereo (mono is
+ * doubled, extra channels are dropped) and resampled linearly, carrying the last frame and the
+ * phase from one buffer to the next
+ */
+
+void MusicStream::convert(const QAudioBuffer &buffer)
+{
+
+    m_pending.resize(0);
+    m_pendingOffset = 0;
+
+    const QAudioFormat format = buffer.format();
+    const int channels = format.channelCount();
+    const int frames = buffer.frameCount();
+    if (!buffer.isValid() || channels <= 0 || format.sampleRate() <= 0 || frames <= 0) return;
+
+    if (format.sampleFormat() == QAudioFormat::Int16 && channels == kChannels && format.sampleRate() == m_sampleRate) {
+        m_pending.resize(frames * kChannels);
+        std::memcpy(m_pending.data(), buffer.constData<qint16>(), frames * kChannels * sizeof(qint16));
+        return;
+    }
+
+    const char *data = buffer.constData<char>();
+    const int sampleBytes = format.bytesPerSample();
+    m_frame.resize(frames * kChannels);
+    for (int i = 0; i < frames; ++i) {
+        const char *frame = data + i * channels * sampleBytes;
+        m_frame[i * kChannels] = format.normalizedSampleValue(frame);
+        m_frame[i * kChannels + 1] = format.normalizedSampleValue(frame + (channels > 1 ? sampleBytes : 0));
+    }
+
+    // Position 0 is the last frame of the previous buffer, position k the frame k - 1 of this one
+    const double step = double(format.sampleRate()) / m_sampleRate;
+    m_pending.reserve(int(frames / step + 2) * kChannels);
+    while (m_resamplePhase < frames) {
+        const int index = int(m_resamplePhase);
+        const float fraction = float(m_resamplePhase - index);
+        for (int c = 0; c < kChannels; ++c) {
+            const float a = index == 0 ? m_lastFrame[c] : m_frame[(index - 1) * kChannels + c];
+            const float b = m_frame[index * kChannels + c];
+            m_pending.append(qint16(qBound(-1.0f, a + (b - a) * fraction, 1.0f) * 32767.0f));
+        }
+        m_resamplePhase += step;
+    }
+
+    m_resamplePhase -= frames;
+    m_lastFrame[0] = m_frame[(frames - 1) * kChannels];
+    m_lastFrame[1] = m_frame[(frames - 1) * kChannels + 1];
+
+}
@@ -0,0 +1,86 @@
+/**
+ * @file musicstream.h
+ * @brief Music track decoded a little ahead of the mixer and looped without a gap
+ * @author Cherie Duong
+ */
+
+#ifndef MUSICSTREAM_H
+#define MUSICSTREAM_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "spscringbuffer.h"
+
+class QAudioBuffer;
+class QAudioDecoder;
+class QTimer;
+
+/**
+ * @brief Streams one music track into a lock-free ring read by the SoundMixer
+ *
+ * Lives on a streaming thread, where a QAudioDecoder turns the track into 16-bit stereo at the
+ * mixer's rate. A decoded buffer is only taken from the decoder once the ring has room for it,
+ * so about a second is decoded ahead and the rest of the track is never held in memory.
+ *
+ * A looping track's decoder is restarted as soon as the last buffer is queued, while the ring
+ * still holds the end of the track, so the mixer reads the first sample straight after the last
+ * one. Opening another track marks where it starts in the ring; the mixer skips everything
+ * before that mark, so no sample of the old track leaks into the new one
+ */
+
+class MusicStream : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int kChannels = 2;
+
+    explicit MusicStream(int sampleRate, QObject *parent = nullptr);
+    ~MusicStream();
+
+    // Starts decoding a track, replacing the current one. Streaming thread only
+    void open(const QString &filePath, bool loop);
+
+    // Stops decoding, the ring is left to drain. Streaming thread only
+    void close();
+
+    // Takes up to frames interleaved stereo frames of the current track. Mixer thread only
+    int read(qint16 *samples, int frames);
+
+    int sampleRate() const { return m_sampleRate; }
+
+private:
+    // Creates a decoder for the start of the track
+    void startDecoder();
+
+    // Moves decoded audio into the ring until it is full or the decoder has nothing ready
+    void fill();
+
+    // Converts a decoded buffer to interleaved stereo at the mixer's rate into m_pending
+    void convert(const QAudioBuffer &buffer);
+
+    int m_sampleRate;
+
+    // Streaming thread only
+    QString m_filePath;
+    bool m_loop;
+    bool m_finished;                // The decoder reached the end of the track
+    QAudioDecoder *m_decoder;
+    QTimer *m_fillTimer;
+    QVector<qint16> m_pending;      // Converted audio that did not fit the ring yet
+    int m_pendingOffset;
+    QVector<float> m_frame;         // Stereo frames at the decoder's rate, before resampling
+    float m_lastFrame[kChannels];   // Last source frame, carried between buffers when resampling
+    double m_resamplePhase;
+    quint64 m_produced;             // Samples written to the ring
+
+    // Mixer thread only
+    quint64 m_consumed;             // Samples read from the ring
+
+    std::atomic<quint64> m_trackStart;      // Ring position of the current track's first sample
+    SpscRingBuffer<qint16, 131072> m_ring;  // About 1.4 s of 48 kHz stereo
+};
+
+#endif // MUSICSTREAM_H
@@ -0,0 +1,327 @@
+/**
+ * @file navgrid.cpp
+ * @brief Implementation of the NavGrid class
+ * @author Kiet Tran
+ */
+
+#include "navgrid.h"
+#include "collisionworld.h"
+#include <QtGlobal>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Column and row offsets of the eight neighbours, orthogonal ones first
+const int kStepX[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+const int kStepY[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+// Rings searched around a blocked cell for a walkable one
+const int kNearestRadius = 4;
+
+}
+
+const float NavGrid::kStraightCost = 1.0f;
+const float NavGrid::kDiagonalCost = 1.41421356f;
+const float NavGrid::kUnreachable = std::numeric_limits<float>::max();
+
+/**
+ * @brief Constructs an empty NavGrid
+ * @param cellSize represents the edge length of a cell in scene units
+ */
+
+NavGrid::NavGrid(qreal cellSize)
+    : m_cellSize(cellSize > 0 ? cellSize : 20.0)
+    , m_originX(0)
+    , m_originY(0)
+    , m_columns(0)
+    , m_rows(0)
+    , m_walkableCount(0)
+    , m_search(0)
+    , m_lastExpanded(0)
+{
+
+}
+
+/**
+ * @brief Marks the cells a body can stand on
+ * @param world represents the room's walls
+ * @param bounds represents the area bodies may move in
+ * @param bodySize represents the size of the bodies that follow the grid
+ */
+
+void NavGrid::build(const CollisionWorld &world, const QRectF &bounds, const QSizeF &bodySize)
+{
+
+    m_originX = bounds.left();
+    m_originY = bounds.top();
+    m_columns = qMax(0, int(std::ceil(bounds.width() / m_cellSize)));
+    m_rows = qMax(0, int(std::ceil(bounds.height() / m_cellSize)));
+    m_walkableCount = 0;
+
+    const int count = m_columns * m_rows;
+    m_walkable.fill(0, count);
+    m_cost.resize(count);
+    m_parent.resize(count);
+    m_stamp.fill(0, count);
+    m_closed.resize(count);
+    m_open.reserve(count);
+    m_search = 0;
+
+    for (int cell = 0; cell < count; ++cell) {
+        const QPointF center = cellCenter(cell);
+        const QRectF body(center.x() - bodySize.width() / 2, center.y() - bodySize.height() / 2,
+                          bodySize.width(), bodySize.height());
+
+        if (bounds.contains(body) && !world.intersects(body)) {
+            m_walkable[cell] = 1;
+            ++m_walkableCount;
+        }
+    }
+
+}
+
+/**
+ * @brief Returns the cell under a point, or -1 outside the grid
+ */
+
+int NavGrid::cellAt(const QPointF &point) const
+{
+
+    const int column = int(std::floor((point.x() - m_originX) / m_cellSize));
+    const int row = int(std::floor((point.y() - m_originY) / m_cellSize));
+    if (column < 0 || row < 0 || column >= m_columns || row >= m_rows) return -1;
+
+    return row * m_columns + column;
+
+}
+
+/**
+ * @brief Returns the centre of a cell in scene coordinates
+ */
+
+QPointF NavGrid::cellCenter(int cell) const
+{
+
+    const int column = cell % qMax(1, m_columns);
+    const int row = cell / qMax(1, m_columns);
+    return QPointF(m_originX + (column + 0.5) * m_cellSize, m_originY + (row + 0.5) * m_cellSize);
+
+}
+
+/**
+ * @brief Returns the closest walkable cell to a cell
+ *
+ * Searches square rings of growing size, so a body pushed slightly off the walkable area
+ * still finds its way back
+ */
+
+int NavGrid::nearestWalkable(int cell) const
+{
+
+    if (isWalkable(cell)) return cell;
+    if (cell < 0 || cell >= cellCount()) return -1;
+
+    const int column = cell % m_columns;
+    const int row = cell / m_columns;
+
+    for (int radius = 1; radius <= kNearestRadius; ++radius) {
+        int best = -1;
+        int bestDistance = std::numeric_limits<int>::max();
+
+        for (int dy = -radius; dy <= radius; ++dy) {
+            for (int dx = -radius; dx <= radius; ++dx) {
+                if (qAbs(dx) != radius && qAbs(dy) != radius) continue;
+
+                const int x = column + dx;
+                const int y = row + dy;
+                if (x < 0 || y < 0 || x >= m_columns || y >= m_rows) continue;
+
+                const int candidate = y * m_columns + x;
+                const int distance = dx * dx + dy * dy;
+                if (m_walkable[candidate] && distance < bestDistance) {
+                    best = candidate;
+                    bestDistance = distance;
+                }
+            }
+        }
+
+        if (best >= 0) return best;
+    }
+
+    return -1;
+
+}
+
+/**
+ * @brief Lists the walkable neighbours of a cell
+ * @param cell represents the cell
+ * @param neighbours receives up to 8 cells
+ * @param costs receives the cost of stepping to each of them
+ * @return Returns the number of neighbours written
+ */
+
+int NavGrid::neighbours(int cell, int *neighbours, float *costs) const
+{
+
+    const int column = cell % m_columns;
+    const int row = cell / m_columns;
+    bool open[4] = { false, false, false, false };
+    int count = 0;
+
+    for (int i = 0; i < 8; ++i) {
+        const int x = column + kStepX[i];
+        const int y = row + kStepY[i];
+        if (x < 0 || y < 0 || x >= m_columns || y >= m_rows) continue;
+
+        const int next = y * m_columns + x;
+        if (!m_walkable[next]) continue;
+
+        if (i < 4) {
+            open[i] = true;
+        } else {
+            // Diagonals need both cells they pass between, which were visited first
+            const bool horizontal = open[kStepX[i] > 0 ? 0 : 1];
+            const bool vertical = open[kStepY[i] > 0 ? 2 : 3];
+            if (!horizontal || !vertical) continue;
+        }
+
+        neighbours[count] = next;
+        costs[count] = i < 4 ? kStraightCost : kDiagonalCost;
+        ++count;
+    }
+
+    return count;
+
+}
+
+/**
+ * @brief Returns true if a straight move between two points stays on walkable cells
+ *
+ * Samples the segment every quarter cell, which cannot step over a blocked cell
+ */
+
+bool NavGrid::hasLineOfSight(const QPointF &from, const QPointF &to) const
+{
+
+    const QPointF delta = to - from;
+    const qreal length = std::hypot(delta.x(), delta.y());
+    const int steps = qMax(1, int(std::ceil(length / (m_cellSize * 0.25))));
+
+    for (int i = 0; i <= steps; ++i) {
+        if (!isWalkable(cellAt(from + delta * (qreal(i) / steps)))) return false;
+    }
+
+    return true;
+
+}
+
+/**
+ * @brief Finds the shortest path between two points
+ * @param from represents the start, usually the centre of a body
+ * @param to represents the goal
+ * @param path receives the points to move through, ending with to
+ * @return Returns false if either point is off the grid or the goal cannot be reached
+ *
+ * Points slightly off the walkable area are moved to their nearest walkable cell. The cell path
+ * is then shortened to the cells where a straight line would leave the walkable area
+ */
+
+bool NavGrid::findPath(const QPointF &from, const QPointF &to, QVector<QPointF> *path)
+{
+
+    path->clear();
+    m_lastExpanded = 0;
+
+    const int start = nearestWalkable(cellAt(from));
+    const int goal = nearestWalkable(cellAt(to));
+    if (start < 0 || goal < 0) return false;
+
+    if (start == goal) {
+        path->append(to);
+        return true;
+    }
+
+    // Stamps start at 1, wrapping around clears them once
+    if (++m_search == 0) {
+        m_stamp.fill(0);
+        m_search = 1;
+    }
+
+    const int goalColumn = goal % m_columns;
+    const int goalRow = goal / m_columns;
+    auto heuristic = [this, goalColumn, goalRow](int cell) {
+        const int dx = qAbs(cell % m_columns - goalColumn);
+        const int dy = qAbs(cell / m_columns - goalRow);
+        return kStraightCost * qAbs(dx - dy) + kDiagonalCost * qMin(dx, dy);
+    };
+    auto later = [](const OpenEntry &a, const OpenEntry &b) { return a.priority > b.priority; };
+
+    m_open.clear();
+    m_stamp[start] = m_search;
+    m_cost[start] = 0.0f;
+    m_parent[start] = -1;
+    m_closed[start] = 0;
+    m_open.append({ heuristic(start), start });
+
+    int next[8];
+    float stepCost[8];
+    bool found = false;
+
+    while (!m_open.isEmpty()) {
+        std::pop_heap(m_open.begin(), m_open.end(), later);
+        const int cell = m_open.last().cell;
+        m_open.removeLast();
+
+        // Cells are pushed again when a cheaper way is found, the older entries are skipped
+        if (m_closed[cell]) continue;
+        m_closed[cell] = 1;
+        ++m_lastExpanded;
+
+        if (cell == goal) {
+            found = true;
+            break;
+        }
+
+        const int count = neighbours(cell, next, stepCost);
+        for (int i = 0; i < count; ++i) {
+            const int neighbour = next[i];
+            const float cost = m_cost[cell] + stepCost[i];
+
+            if (m_stamp[neighbour] != m_search) {
+                m_stamp[neighbour] = m_search;
+                m_closed[neighbour] = 0;
+            } else if (m_closed[neighbour] || cost >= m_cost[neighbour]) {
+                continue;
+            }
+
+            m_cost[neighbour] = cost;
+            m_parent[neighbour] = cell;
+            m_open.append({ cost + heuristic(neighbour), neighbour });
+            std::push_heap(m_open.begin(), m_open.end(), later);
+        }
+    }
+
+    if (!found) return false;
+
+    m_cells.clear();
+    for (int cell = goal; cell >= 0; cell = m_parent[cell]) {
+        m_cells.append(cell);
+    }
+    std::reverse(m_cells.begin(), m_cells.end());
+
+    // Keeps only the cells where the straight line from the last kept point breaks
+    QPointF anchor = from;
+    for (int i = 1; i < m_cells.size(); ++i) {
+        const QPointF target = i + 1 < m_cells.size() ? cellCenter(m_cells[i + 1]) : to;
+        if (!hasLineOfSight(anchor, target)) {
+            anchor = cellCenter(m_cells[i]);
+            path->append(anchor);
+        }
+    }
+    path->append(to);
+
+    return true;
+
+}
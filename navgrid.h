@@ -0,0 +1,102 @@
+/**
+ * @file navgrid.h
+ * @brief Walkable cells of a room derived from its collision walls, with A* path search
+ * @author Kiet Tran
+ */
+
+#ifndef NAVGRID_H
+#define NAVGRID_H
+
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QVector>
+
+class CollisionWorld;
+
+/**
+ * @brief Uniform grid of the cells a body of a given size can stand on
+ *
+ * Built once per room from the CollisionWorld: a cell is walkable when a body centred on it
+ * lies inside the room and touches no wall, so any path through walkable cell centres is clear
+ * for that body. Cells are stored as a flat byte array and connect to their eight neighbours,
+ * diagonals only where both orthogonal neighbours are walkable so paths never cut a corner.
+ *
+ * findPath() runs A* with the octile heuristic. Its scratch arrays are sized with the grid and
+ * stamped per search, so a search neither allocates nor clears anything
+ */
+
+class NavGrid
+{
+public:
+    // Cost of moving to a neighbour cell, scaled by the cell size, and of an unreachable cell
+    static const float kStraightCost;
+    static const float kDiagonalCost;
+    static const float kUnreachable;
+
+    explicit NavGrid(qreal cellSize = 20.0);
+
+    // Marks the cells where a body of bodySize fits, bounds is usually the scene rect
+    void build(const CollisionWorld &world, const QRectF &bounds, const QSizeF &bodySize);
+
+    bool isValid() const { return m_columns > 0 && m_rows > 0; }
+    qreal cellSize() const { return m_cellSize; }
+    int columns() const { return m_columns; }
+    int rows() const { return m_rows; }
+    int cellCount() const { return m_columns * m_rows; }
+    int walkableCount() const { return m_walkableCount; }
+
+    // Cell under a point, -1 outside the grid
+    int cellAt(const QPointF &point) const;
+
+    // Centre of a cell in scene coordinates
+    QPointF cellCenter(int cell) const;
+
+    bool isWalkable(int cell) const { return cell >= 0 && cell < m_walkable.size() && m_walkable[cell]; }
+
+    // Closest walkable cell within a few cells of a cell, -1 if there is none
+    int nearestWalkable(int cell) const;
+
+    // Fills neighbours with the walkable cells reachable in one step and costs with the step
+    // costs, returns how many there are (at most 8)
+    int neighbours(int cell, int *neighbours, float *costs) const;
+
+    // True if a body moving in a straight line between two points stays on walkable cells
+    bool hasLineOfSight(const QPointF &from, const QPointF &to) const;
+
+    // Shortest path between two points as cell centres, shortened to the turns where the line of
+    // sight breaks. The last point is to itself. False if to cannot be reached from from
+    bool findPath(const QPointF &from, const QPointF &to, QVector<QPointF> *path);
+
+    // Cells expanded by the last findPath(), for profiling
+    int lastExpanded() const { return m_lastExpanded; }
+
+private:
+    // Open list entry of A*
+    struct OpenEntry {
+        float priority;
+        int cell;
+    };
+
+    qreal m_cellSize;
+    qreal m_originX;
+    qreal m_originY;
+    int m_columns;
+    int m_rows;
+    int m_walkableCount;
+
+    // 1 for walkable cells, row by row
+    QVector<quint8> m_walkable;
+
+    // A* scratch, valid for a cell only while its stamp matches m_search
+    QVector<float> m_cost;
+    QVector<int> m_parent;
+    QVector<quint32> m_stamp;
+    QVector<quint8> m_closed;
+    QVector<OpenEntry> m_open;
+    QVector<int> m_cells;
+    quint32 m_search;
+    int m_lastExpanded;
+};
+
+#endif // NAVGRID_H
@@ -6,8 +6,10 @@
 
 #include "player.h"
 #include "movement.h"
+#include "spritecache.h"
+#include "inputhandler.h"
+#include "logger.h"
 #include <QPixmap>
-#include <QDebug>
 #include <QBrush>
 #include <QPen>
 
@@ -17,17 +19,12 @@
  * Initializes the sprite, health system, movement controls, and visual elements
  */
 
-Player::Player() : m_movement(nullptr), maxHealth(100), currentHealth(100), healthBarVisible(true)
+Player::Player() : m_movement(nullptr), m_inputHandler(nullptr), m_facing(SpriteDirection::Down), m_animation(this), m_walking(false), m_world(nullptr), healthBarVisible(true)
 {
 
-    // Loads the sprite image from the resource file
-    QPixmap originalSprite(":/images/sprite_back.png");
-
-    // Scales the sprite to 75 x 75 pixels
-    QPixmap scaledSprite = originalSprite.scaled(75, 75, Qt::KeepAspectRatio);
-
-    // Sets the scaled pixmap for the player
-    setPixmap(scaledSprite);
+    // Sets the packed 75 x 75 pixels sprite for the player, or an empty sprite of the
+    // same size while the sprites are still being decoded
+    refreshSprite();
 
     // Ensures we can receive key events
     setFlag(QGraphicsItem::ItemIsFocusable);
@@ -61,7 +58,141 @@ void Player::setMovement(Movement *movement)
 {
 
     m_movement = movement;
-    qDebug() << "Movement set for player:" << (m_movement != nullptr);
+    LOG_DEBUG("player", "Movement set for player: %1", m_movement != nullptr);
+
+}
+
+/**
+ * @brief Attaches the player to its entity
+ * @param world represents the world holding the entity
+ * @param entity represents the player's entity, which needs health points
+ *
+ * The health bar shows the entity's health from then on
+ */
+
+void Player::setEntity(EntityWorld *world, Entity entity)
+{
+
+    m_world = world;
+    m_entity = entity;
+    updateHealthBar();
+
+}
+
+/**
+ * @brief Turns the player to face a direction
+ * @param direction represents the new facing direction
+ *
+ * Switches to the cycle of the new direction, or swaps to the packed static sprite while the
+ * animation set is not loaded yet. Neither decodes nor scales anything
+ */
+
+void Player::setFacing(SpriteDirection direction)
+{
+
+    m_facing = direction;
+    m_animation.setAnimation(animationState());
+
+    if (!m_animation.hasFrames()) {
+        setRegion(SpriteCache::instance().sprite(direction, QSize(75, 75)));
+    }
+
+}
+
+/**
+ * @brief Plays the idle and walk cycles from a shared animation set
+ * @param set represents the frames, shared with every other item using the same set
+ */
+
+void Player::setAnimationSet(QSharedPointer<const AnimationSet> set)
+{
+
+    m_animation.setAnimation(animationState());
+    m_animation.setAnimationSet(set);
+
+}
+
+/**
+ * @brief Switches between the walk and idle cycle of the current facing
+ * @param walking represents whether the player is moving this tick
+ */
+
+void Player::setWalking(bool walking)
+{
+
+    if (walking == m_walking) return;
+
+    m_walking = walking;
+    m_animation.setAnimation(animationState());
+
+}
+
+/**
+ * @brief Returns the animation state of the current facing and walk state
+ */
+
+AnimationState Player::animationState() const
+{
+
+    switch (m_facing) {
+    case SpriteDirection::Up:
+        return m_walking ? AnimationState::WalkUp : AnimationState::IdleUp;
+    case SpriteDirection::Left:
+        return m_walking ? AnimationState::WalkLeft : AnimationState::IdleLeft;
+    case SpriteDirection::Right:
+        return m_walking ? AnimationState::WalkRight : AnimationState::IdleRight;
+    case SpriteDirection::Down:
+        break;
+    }
+
+    return m_walking ? AnimationState::WalkDown : AnimationState::IdleDown;
+
+}
+
+/**
+ * @brief Returns the health of the player's entity, nullptr before setEntity()
+ */
+
+Health *Player::health() const
+{
+
+    return m_world ? m_world->health(m_entity) : nullptr;
+
+}
+
+/**
+ * @brief Re-applies the sprite of the current facing direction
+ *
+ * Draws nothing while the sprite is not packed yet, the player keeps its 75 x 75 collision box
+ * without blocking on a decode. Once the animation set is loaded the cycles take over
+ */
+
+void Player::refreshSprite()
+{
+
+    if (m_animation.hasFrames()) return;
+
+    if (SpriteCache::instance().contains(m_facing, QSize(75, 75))) {
+        setRegion(SpriteCache::instance().sprite(m_facing, QSize(75, 75)));
+        return;
+    }
+
+    setRegion(AtlasRegion());
+    setSize(QSizeF(75, 75));
+
+}
+
+/**
+ * @brief Sets the input handler that receives this player's key events
+ *
+ * Once set, movement is driven by the game loop from the held key state instead of
+ * by individual key presses
+ */
+
+void Player::setInputHandler(InputHandler *inputHandler)
+{
+
+    m_inputHandler = inputHandler;
 
 }
 
@@ -74,7 +205,8 @@ void Player::setMovement(Movement *movement)
 int Player::getHealth() const
 {
 
-    return currentHealth;
+    const Health *points = health();
+    return points ? points->current() : 0;
 
 }
 
@@ -87,11 +219,14 @@ int Player::getHealth() const
 void Player::decreaseHealth(int amount)
 {
 
-    currentHealth = qMax(0, currentHealth - amount);
+    Health *points = health();
+    if (!points) return;
+
+    points->decrease(amount);
     updateHealthBar();
 
-    if (currentHealth <= 0) {
-        qDebug() << "Player has died!";
+    if (!points->isAlive()) {
+        LOG_INFO("player", "Player has died");
     }
 
 }
@@ -105,7 +240,10 @@ void Player::decreaseHealth(int amount)
 void Player::increaseHealth(int amount)
 {
 
-    currentHealth = qMin(maxHealth, currentHealth + amount);
+    Health *points = health();
+    if (!points) return;
+
+    points->increase(amount);
     updateHealthBar();
 
 }
@@ -119,7 +257,10 @@ void Player::increaseHealth(int amount)
 void Player::setHealth(int value)
 {
 
-    currentHealth = qBound(0, value, maxHealth);
+    Health *points = health();
+    if (!points) return;
+
+    points->set(value);
     updateHealthBar();
 
 }
@@ -133,7 +274,8 @@ void Player::setHealth(int value)
 bool Player::isAlive() const
 {
 
-    return currentHealth > 0;
+    const Health *points = health();
+    return points && points->isAlive();
 
 }
 
@@ -146,10 +288,11 @@ bool Player::isAlive() const
 void Player::updateHealthBar()
 {
 
-    if (!healthBarVisible) return;
+    const Health *points = health();
+    if (!healthBarVisible || !points) return;
 
     // Calculates the health percentage
-    float healthPercentage = static_cast<float>(currentHealth) / maxHealth;
+    float healthPercentage = points->fraction();
 
     // Updates the health bar width
     healthBar->setRect(0, -15, 75 * healthPercentage, 10);
@@ -189,39 +332,78 @@ void Player::setHealthBarVisible(bool visible)
 void Player::keyPressEvent(QKeyEvent *event)
 {
 
-    // Sets the step distance to 15px
-    int step = 15;
-    QPixmap originalSprite;
-    QPixmap scaledSprite;
+    // Held keys are sampled by the game loop when an input handler is attached
+    if (m_inputHandler) {
+        m_inputHandler->handleKeyPress(event);
+        return;
+    }
 
     if (!m_movement) {
-        QGraphicsPixmapItem::keyPressEvent(event);
+        AtlasSpriteItem::keyPressEvent(event);
         return;
     }
 
+    // Sets the step distance to 15px
+    int step = 15;
+    SpriteDirection direction = SpriteDirection::Down;
+
     // Swtich statement to change sprite direction
     switch (event->key()) {
     case Qt::Key_W:
         m_movement->moveUp(step);
-        originalSprite.load(":/images/sprite_forward.png");
+        direction = SpriteDirection::Up;
         break;
     case Qt::Key_S:
         m_movement->moveDown(step);
-        originalSprite.load(":/images/sprite_back.png");
+        direction = SpriteDirection::Down;
         break;
     case Qt::Key_A:
         m_movement->moveLeft(step);
-        originalSprite.load(":/images/sprite_left.png");
+        direction = SpriteDirection::Left;
         break;
     case Qt::Key_D:
         m_movement->moveRight(step);
-        originalSprite.load(":/images/sprite_right.png");
+        direction = SpriteDirection::Right;
         break;
     default:
         return;
     }
 
-    scaledSprite = originalSprite.scaled(75, 75, Qt::KeepAspectRatio);
-    setPixmap(scaledSprite);
+    setFacing(direction);
+
+}
+
+/**
+ * @brief Handles keyboard release events
+ *
+ * Forwards the release to the input handler so the key stops moving the player
+ */
+
+void Player::keyReleaseEvent(QKeyEvent *event)
+{
+
+    if (m_inputHandler) {
+        m_inputHandler->handleKeyRelease(event);
+        return;
+    }
+
+    AtlasSpriteItem::keyReleaseEvent(event);
+
+}
+
+/**
+ * @brief Handles the player losing keyboard focus
+ *
+ * Releases every held key, otherwise the player would keep walking while a challenge has focus
+ */
+
+void Player::focusOutEvent(QFocusEvent *event)
+{
+
+    if (m_inputHandler) {
+        m_inputHandler->releaseAll();
+    }
+
+    AtlasSpriteItem::focusOutEvent(event);
 
 }
@@ -1,13 +1,17 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
-#include <QGraphicsPixmapItem>
+#include "atlasspriteitem.h"
 #include <QKeyEvent>
 #include <QGraphicsRectItem>
+#include "spritecache.h"
+#include "spriteanimation.h"
+#include "entityworld.h"
 
 class Movement;
+class InputHandler;
 
-class Player : public QGraphicsPixmapItem
+class Player : public AtlasSpriteItem
 {
 public:
     Player();
@@ -15,6 +19,28 @@ public:
     void setMovement(Movement *movement);
     Movement* getMovement() const { return m_movement; }
 
+    // Shows the health of the player's entity, the item keeps no game state of its own
+    void setEntity(EntityWorld *world, Entity entity);
+    Entity entity() const { return m_entity; }
+
+    // Turns the player to face a direction
+    void setFacing(SpriteDirection direction);
+    SpriteDirection facing() const { return m_facing; }
+
+    // Re-applies the sprite of the current facing, for example once preloading finished
+    void refreshSprite();
+
+    // Plays the idle and walk cycles from a shared animation set
+    void setAnimationSet(QSharedPointer<const AnimationSet> set);
+    SpriteAnimation *animation() { return &m_animation; }
+
+    // Switches between the walk and idle cycle of the current facing
+    void setWalking(bool walking);
+    bool isWalking() const { return m_walking; }
+
+    // Routes key presses and releases to the input handler
+    void setInputHandler(InputHandler *inputHandler);
+
     // Health bar related functions
     int getHealth() const;
     void decreaseHealth(int amount);
@@ -28,14 +54,25 @@ public:
 
 protected:
     void keyPressEvent(QKeyEvent *event) override;
+    void keyReleaseEvent(QKeyEvent *event) override;
+    void focusOutEvent(QFocusEvent *event) override;
 
 private:
+    // Returns the animation state of the current facing and walk state
+    AnimationState animationState() const;
+
+    // Health of the player's entity, nullptr before setEntity()
+    Health *health() const;
+
     Movement *m_movement;
-    QPixmap sprite;  // Store the sprite image
+    InputHandler *m_inputHandler;
+    SpriteDirection m_facing;  // Direction the sprite faces
+    SpriteAnimation m_animation;  // Idle and walk cycles, advanced by the game's animation clock
+    bool m_walking;
 
-    // Health properties
-    int maxHealth;
-    int currentHealth;
+    // Entity holding the health points, so the rules can run headless
+    EntityWorld *m_world;
+    Entity m_entity;
 
     // Healh bar visuals
     QGraphicsRectItem *healthBarBackground;
@@ -0,0 +1,349 @@
+/**
+ * @file profiler.cpp
+ * @brief Implementation of the Profiler class
+ * @author Kiet Tran
+ */
+
+#include "profiler.h"
+#include <QFile>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <algorithm>
+
+/**
+ * @brief Returns the application wide profiler
+ */
+
+Profiler &Profiler::instance()
+{
+
+    static Profiler profiler;
+    return profiler;
+
+}
+
+/**
+ * @brief Constructs a disabled profiler and starts its clock
+ */
+
+Profiler::Profiler()
+    : m_enabled(false)
+    , m_dropped(0)
+    , m_retain(false)
+    , m_retainLimit(0)
+{
+
+    m_clock.start();
+
+    for (int i = 0; i < int(ProfileSection::Count); ++i) {
+        m_history[i].reserve(kHistorySize);
+        m_historyNext[i] = 0;
+    }
+
+}
+
+/**
+ * @brief Frees the ring of every thread that recorded
+ */
+
+Profiler::~Profiler()
+{
+
+    qDeleteAll(m_threads);
+
+}
+
+/**
+ * @brief Turns recording on or off
+ */
+
+void Profiler::setEnabled(bool enabled)
+{
+
+    m_enabled.store(enabled, std::memory_order_relaxed);
+
+}
+
+/**
+ * @brief Records a finished scope
+ * @param section represents the timed subsystem
+ * @param startNs represents the start of the scope from now()
+ * @param durationNs represents the length of the scope
+ *
+ * Lock free after the calling thread's first sample
+ */
+
+void Profiler::record(ProfileSection section, qint64 startNs, qint64 durationNs)
+{
+
+    ThreadBuffer *buffer = threadBuffer();
+
+    ProfileSample sample;
+    sample.startNs = startNs;
+    sample.durationNs = durationNs;
+    sample.section = quint16(section);
+    sample.thread = buffer->index;
+
+    if (!buffer->ring.push(sample)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+}
+
+/**
+ * @brief Drains the ring of every thread into the history
+ *
+ * Called once per frame on the GUI thread, the only consumer of the rings
+ */
+
+void Profiler::collect()
+{
+
+    QVector<ThreadBuffer *> threads;
+    {
+        QMutexLocker locker(&m_threadsMutex);
+        threads = m_threads;
+    }
+
+    ProfileSample sample;
+    for (ThreadBuffer *buffer : threads) {
+        while (buffer->ring.pop(sample)) {
+            const int section = sample.section;
+            const qreal ms = sample.durationNs / 1e6;
+
+            if (m_history[section].size() < kHistorySize) {
+                m_history[section].append(ms);
+            } else {
+                m_history[section][m_historyNext[section]] = ms;
+            }
+            m_historyNext[section] = (m_historyNext[section] + 1) % kHistorySize;
+
+            if (m_retain) {
+                if (m_retained.size() < m_retainLimit) {
+                    m_retained.append(sample);
+                } else {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+}
+
+/**
+ * @brief Returns the recent durations of a section, oldest first
+ */
+
+QVector<qreal> Profiler::history(ProfileSection section) const
+{
+
+    const QVector<qreal> &samples = m_history[int(section)];
+    if (samples.size() < kHistorySize) {
+        return samples;
+    }
+
+    // The slot about to be overwritten holds the oldest sample
+    const int oldest = m_historyNext[int(section)];
+    QVector<qreal> ordered;
+    ordered.reserve(samples.size());
+    ordered += samples.mid(oldest);
+    ordered += samples.mid(0, oldest);
+    return ordered;
+
+}
+
+/**
+ * @brief Returns the mean of the recent durations of a section (milliseconds)
+ */
+
+qreal Profiler::average(ProfileSection section) const
+{
+
+    const QVector<qreal> &samples = m_history[int(section)];
+    if (samples.isEmpty()) return 0.0;
+
+    qreal sum = 0.0;
+    for (qreal sample : samples) {
+        sum += sample;
+    }
+    return sum / samples.size();
+
+}
+
+/**
+ * @brief Returns a percentile of the recent durations of a section (milliseconds)
+ * @param percent represents the percentile between 0 and 100, for example 99
+ */
+
+qreal Profiler::percentile(ProfileSection section, qreal percent) const
+{
+
+    QVector<qreal> samples = m_history[int(section)];
+    if (samples.isEmpty()) return 0.0;
+
+    const int rank = qBound(0, int(percent / 100.0 * (samples.size() - 1) + 0.5), samples.size() - 1);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples.at(rank);
+
+}
+
+/**
+ * @brief Keeps every collected sample for writing on exit
+ * @param retain represents whether samples are kept
+ * @param limit represents the most samples kept, later ones are counted as dropped
+ */
+
+void Profiler::setRetainSamples(bool retain, int limit)
+{
+
+    m_retain = retain;
+    m_retainLimit = limit;
+    if (!retain) {
+        m_retained.clear();
+    }
+
+}
+
+/**
+ * @brief Writes the retained samples, as a Chrome trace for .json paths and as CSV otherwise
+ */
+
+bool Profiler::write(const QString &path, QString *error) const
+{
+
+    if (path.endsWith(".json", Qt::CaseInsensitive)) {
+        return writeChromeTrace(path, error);
+    }
+
+    return writeCsv(path, error);
+
+}
+
+/**
+ * @brief Writes the retained samples as CSV, one scope per line
+ */
+
+bool Profiler::writeCsv(const QString &path, QString *error) const
+{
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "section,thread,start_us,duration_us\n";
+    for (const ProfileSample &sample : m_retained) {
+        out << sectionName(ProfileSection(sample.section)) << ',' << sample.thread << ','
+            << sample.startNs / 1000.0 << ',' << sample.durationNs / 1000.0 << '\n';
+    }
+
+    return true;
+
+}
+
+/**
+ * @brief Writes the retained samples in the Chrome trace event format
+ *
+ * The file opens in chrome://tracing or Perfetto with one track per recording thread
+ */
+
+bool Profiler::writeChromeTrace(const QString &path, QString *error) const
+{
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "{\"traceEvents\":[";
+    for (int i = 0; i < m_retained.size(); ++i) {
+        const ProfileSample &sample = m_retained.at(i);
+        out << (i ? ",\n" : "\n")
+            << "{\"name\":\"" << sectionName(ProfileSection(sample.section)) << "\",\"cat\":\"game\",\"ph\":\"X\""
+            << ",\"ts\":" << sample.startNs / 1000.0 << ",\"dur\":" << sample.durationNs / 1000.0
+            << ",\"pid\":1,\"tid\":" << sample.thread << '}';
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return true;
+
+}
+
+/**
+ * @brief Returns the display name of a section
+ */
+
+const char *Profiler::sectionName(ProfileSection section)
+{
+
+    switch (section) {
+    case ProfileSection::Frame: return "Frame";
+    case ProfileSection::Tick: return "Tick";
+    case ProfileSection::Input: return "Input";
+    case ProfileSection::Movement: return "Movement";
+    case ProfileSection::Monsters: return "Monsters";
+    case ProfileSection::Challenges: return "Challenges";
+    case ProfileSection::Audio: return "Audio";
+    case ProfileSection::Render: return "Render";
+    case ProfileSection::Voice: return "Voice";
+    case ProfileSection::Mixer: return "Mixer";
+    case ProfileSection::Count: break;
+    }
+
+    return "Unknown";
+
+}
+
+/**
+ * @brief Returns the calling thread's ring, registering it on first use
+ *
+ * A thread takes over the ring of a thread that has exited before a new one is allocated, so
+ * thread pools and short-lived decoding threads do not grow the profiler. Samples the previous
+ * owner left in the ring are still collected, the new owner appends after them and records
+ * under the same thread index
+ */
+
+Profiler::ThreadBuffer *Profiler::threadBuffer()
+{
+
+    static thread_local ThreadOwner owner;
+    if (owner.buffer) return owner.buffer;
+
+    QMutexLocker locker(&m_threadsMutex);
+    for (int i = 0; i < m_threads.size(); ++i) {
+        ThreadBuffer *buffer = m_threads.at(i);
+        if (!buffer->inUse.load(std::memory_order_acquire)) {
+            buffer->inUse.store(true, std::memory_order_relaxed);
+            owner.buffer = buffer;
+            return buffer;
+        }
+    }
+
+    ThreadBuffer *buffer = new ThreadBuffer();
+    buffer->index = quint16(m_threads.size());
+    buffer->inUse.store(true, std::memory_order_relaxed);
+    m_threads.append(buffer);
+    owner.buffer = buffer;
+    return buffer;
+
+}
+
+/**
+ * @brief Gives the ring back when its thread exits
+ *
+ * The release pairs with the acquire of the thread taking the ring over, which then sees every
+ * sample pushed before. Recording threads must exit before the profiler is destroyed
+ */
+
+Profiler::ThreadOwner::~ThreadOwner()
+{
+
+    if (buffer) {
+        buffer->inUse.store(false, std::memory_order_release);
+    }
+
+}
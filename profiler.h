@@ -0,0 +1,168 @@
+/**
+ * @file profiler.h
+ * @brief Scoped timings of the game's subsystems collected through lock-free ring buffers
+ * @author Kiet Tran
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "spscringbuffer.h"
+
+/**
+ * @brief Subsystems timed by the profiler
+ */
+
+enum class ProfileSection {
+    Frame,       // One pass of the game loop (ticks and interpolation)
+    Tick,        // One fixed simulation step
+    Input,       // Key press and release handling
+    Movement,    // Moving every entity, collision and trigger zones
+    Monsters,    // Monster patrols, flow field rebuilds and steering
+    Challenges,  // Challenge clock and input checks
+    Audio,       // Calls into the audio system
+    Render,      // QGraphicsView painting the scene
+    Voice,       // Speech processing woken by the voice activity gate (analysis thread)
+    Mixer,       // Sound effect blocks rendered for the audio output (mixer thread)
+    Count
+};
+
+/**
+ * @brief One finished scope
+ */
+
+struct ProfileSample {
+    qint64 startNs = 0;     // Start time since the profiler was created
+    qint64 durationNs = 0;
+    quint16 section = 0;    // ProfileSection
+    quint16 thread = 0;     // Index of the recording thread
+};
+
+/**
+ * @brief Collects scoped timings from any thread and keeps recent history for the overlay
+ *
+ * Each thread records into its own single-producer ring buffer, so recording never takes a
+ * lock or allocates. The GUI thread drains every ring once per frame with collect(), which feeds
+ * the per-section history used for graphs and percentiles and, when exporting, keeps every
+ * sample for the CSV or Chrome trace written on exit
+ */
+
+class Profiler
+{
+public:
+    // Number of recent samples kept per section for graphs and percentiles
+    static const int kHistorySize = 240;
+
+    // Returns the application wide profiler
+    static Profiler &instance();
+
+    // Recording is off until the overlay is shown or an export is requested
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // Time since the profiler was created (nanoseconds), safe on any thread
+    qint64 now() const { return m_clock.nsecsElapsed(); }
+
+    // Records a finished scope on the calling thread's ring, dropped if the ring is full
+    void record(ProfileSection section, qint64 startNs, qint64 durationNs);
+
+    // Moves the samples of every thread into the history, GUI thread only
+    void collect();
+
+    // Recent durations of a section in milliseconds, oldest first
+    QVector<qreal> history(ProfileSection section) const;
+
+    // Mean and percentile (0 to 100) of the recent durations in milliseconds
+    qreal average(ProfileSection section) const;
+    qreal percentile(ProfileSection section, qreal percent) const;
+
+    // Samples lost because a ring or the export buffer was full
+    quint64 droppedSamples() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    // Keeps every collected sample (up to limit) for writing on exit
+    void setRetainSamples(bool retain, int limit = 1000000);
+
+    // Writes the retained samples as CSV or, for a .json path, as a Chrome trace
+    bool write(const QString &path, QString *error = nullptr) const;
+    bool writeCsv(const QString &path, QString *error = nullptr) const;
+    bool writeChromeTrace(const QString &path, QString *error = nullptr) const;
+
+    static const char *sectionName(ProfileSection section);
+
+private:
+    // Ring buffer owned by one recording thread at a time
+    struct ThreadBuffer {
+        SpscRingBuffer<ProfileSample, 4096> ring;
+        quint16 index = 0;
+        std::atomic<bool> inUse{false};  // Cleared when the owning thread exits
+    };
+
+    // Thread local handle of the calling thread's ring, gives the ring back on thread exit
+    struct ThreadOwner {
+        ThreadBuffer *buffer = nullptr;
+        ~ThreadOwner();
+    };
+
+    Profiler();
+    ~Profiler();
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    // Returns the calling thread's ring, taking a free one or registering a new one on first use
+    ThreadBuffer *threadBuffer();
+
+    QElapsedTimer m_clock;
+    std::atomic<bool> m_enabled;
+    std::atomic<quint64> m_dropped;
+
+    // Registered rings, the lock is only taken when a thread records for the first time. Rings
+    // of exited threads are reused, so there are only ever as many as threads alive at once
+    mutable QMutex m_threadsMutex;
+    QVector<ThreadBuffer *> m_threads;
+
+    // Circular history of recent durations per section (milliseconds)
+    QVector<qreal> m_history[int(ProfileSection::Count)];
+    int m_historyNext[int(ProfileSection::Count)];
+
+    bool m_retain;
+    int m_retainLimit;
+    QVector<ProfileSample> m_retained;
+};
+
+/**
+ * @brief Times the enclosing block into a profiler section
+ *
+ * Costs one flag check when the profiler is disabled
+ */
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(ProfileSection section)
+        : m_section(section)
+        , m_startNs(Profiler::instance().isEnabled() ? Profiler::instance().now() : -1)
+    {
+    }
+
+    ~ProfileScope()
+    {
+        if (m_startNs >= 0) {
+            Profiler &profiler = Profiler::instance();
+            profiler.record(m_section, m_startNs, profiler.now() - m_startNs);
+        }
+    }
+
+private:
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+    ProfileSection m_section;
+    qint64 m_startNs;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,344 @@
+/**
+ * @file roommanager.cpp
+ * @brief Implementation of the RoomManager class
+ * @author Kiet Tran
+ */
+
+#include "roommanager.h"
+#include "levelcompiler.h"
+#include "logger.h"
+#include <QMetaObject>
+#include <QQueue>
+#include <climits>
+
+/**
+ * @brief Constructs a RoomManager with a 256 MB budget and a prefetch depth of one door
+ * @param parent represents the parent QObject
+ */
+
+RoomManager::RoomManager(QObject *parent)
+    : QObject(parent)
+    , m_memoryBudget(256ll * 1024 * 1024)
+    , m_prefetchDepth(1)
+    , m_useCounter(0)
+{
+
+    // A single worker keeps prefetching from competing with the game for cores
+    m_pool.setMaxThreadCount(1);
+
+}
+
+/**
+ * @brief Destroys the RoomManager
+ *
+ * Drops queued prefetches and waits for the running one, its result is discarded
+ */
+
+RoomManager::~RoomManager()
+{
+
+    m_pool.clear();
+    m_pool.waitForDone();
+
+}
+
+/**
+ * @brief Sets the memory budget for resident rooms
+ * @param bytes represents the budget in bytes
+ */
+
+void RoomManager::setMemoryBudget(qint64 bytes)
+{
+
+    m_memoryBudget = qMax<qint64>(0, bytes);
+    evict();
+
+}
+
+/**
+ * @brief Returns the estimated memory held by resident rooms in bytes
+ */
+
+qint64 RoomManager::memoryUsage() const
+{
+
+    qint64 total = 0;
+    for (const QSharedPointer<Room> &room : m_rooms) {
+        total += room->bytes;
+    }
+    return total;
+
+}
+
+/**
+ * @brief Sets how many doors away from the current room are prefetched
+ * @param depth represents the number of doors (0 disables prefetching)
+ */
+
+void RoomManager::setPrefetchDepth(int depth)
+{
+
+    m_prefetchDepth = qMax(0, depth);
+
+}
+
+/**
+ * @brief Makes a room current
+ * @param name represents the room name
+ * @param error receives a description of the failure if not null
+ * @return Returns the room, or null if it could not be loaded
+ *
+ * A prefetched room is returned immediately. Otherwise the room is prepared on the calling
+ * thread, which only happens for the first room or when walking faster than the prefetcher
+ */
+
+const Room *RoomManager::enterRoom(const QString &name, QString *error)
+{
+
+    // Current before finish(), whose background callback evicts right away when the pixmap is
+    // already cached. Distances are then measured from this room and it is never the victim
+    const QString previous = m_current;
+    m_current = name;
+
+    QSharedPointer<Room> room = m_rooms.value(name);
+
+    if (!room) {
+        const Prepared prepared = prepare(name);
+        if (!prepared.ok) {
+            m_current = previous;
+            if (error) *error = prepared.error;
+            return nullptr;
+        }
+        room = finish(prepared, AssetLoader::Critical);
+        if (!room) {
+            m_current = previous;
+            if (error) *error = QString("Cannot map room %1").arg(name);
+            return nullptr;
+        }
+    }
+
+    room->lastUsed = ++m_useCounter;
+
+    evict();
+    prefetchNeighbours();
+
+    return room.data();
+
+}
+
+/**
+ * @brief Returns the current room or null before the first enterRoom()
+ */
+
+const Room *RoomManager::currentRoom() const
+{
+
+    return m_rooms.value(m_current).data();
+
+}
+
+/**
+ * @brief Returns true if a room is loaded and ready to enter
+ */
+
+bool RoomManager::isResident(const QString &name) const
+{
+
+    return m_rooms.contains(name);
+
+}
+
+/**
+ * @brief Prepares a room for entering
+ * @param name represents the room name
+ *
+ * Safe to call from any thread, touches no GUI state
+ */
+
+RoomManager::Prepared RoomManager::prepare(const QString &name)
+{
+
+    Prepared prepared;
+    prepared.name = name;
+
+    const QString compiledPath = LevelCompiler::compiledPath(name);
+    if (!LevelCompiler::ensureCompiled(LevelCompiler::sourcePath(name), compiledPath, &prepared.error)) {
+        return prepared;
+    }
+
+    Level level;
+    if (!level.open(compiledPath, &prepared.error)) {
+        return prepared;
+    }
+
+    for (int i = 0; i < level.wallCount(); ++i) {
+        prepared.collision.addWall(level.wall(i));
+    }
+    prepared.collision.build();
+
+    for (int i = 0; i < level.triggerCount(); ++i) {
+        const QString target = level.trigger(i).target;
+        if (!target.isEmpty() && !prepared.neighbours.contains(target)) {
+            prepared.neighbours.append(target);
+        }
+    }
+
+    prepared.backgroundPath = level.background();
+
+    prepared.ok = true;
+    return prepared;
+
+}
+
+/**
+ * @brief Turns prepared data into a resident room
+ * @param prepared represents the data produced by prepare()
+ * @param priority represents how urgently the background is needed
+ * @return Returns the room, or null if the compiled file could not be mapped
+ *
+ * The background is decoded by the AssetLoader and attached to the room when it arrives
+ */
+
+QSharedPointer<Room> RoomManager::finish(const Prepared &prepared, AssetLoader::Priority priority)
+{
+
+    QSharedPointer<Room> room(new Room);
+    room->name = prepared.name;
+    room->level.reset(new Level);
+
+    QString error;
+    if (!room->level->open(LevelCompiler::compiledPath(prepared.name), &error)) {
+        LOG_WARNING("room", "Failed to map room %1: %2", prepared.name, error);
+        return QSharedPointer<Room>();
+    }
+
+    room->collision = prepared.collision;
+    room->neighbours = prepared.neighbours;
+    room->bytes = qint64(room->collision.wallCount()) * 64;
+    room->lastUsed = ++m_useCounter;
+
+    m_rooms.insert(room->name, room);
+    m_adjacency.insert(room->name, room->neighbours);
+
+    // Only attaches the background if the room was not evicted or reloaded in the meantime
+    QWeakPointer<Room> weakRoom = room;
+    AssetLoader::instance().loadPixmap(prepared.backgroundPath, this, [this, weakRoom](const QPixmap &pixmap) {
+        QSharedPointer<Room> loaded = weakRoom.toStrongRef();
+        if (!loaded || pixmap.isNull()) return;
+
+        loaded->background = pixmap;
+        loaded->bytes += qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+        emit backgroundReady(loaded->name, pixmap);
+        evict();
+    }, priority);
+
+    return room;
+
+}
+
+/**
+ * @brief Queues the rooms within the prefetch depth that are not resident yet
+ */
+
+void RoomManager::prefetchNeighbours()
+{
+
+    const QHash<QString, int> distance = distances();
+
+    for (auto it = distance.constBegin(); it != distance.constEnd(); ++it) {
+        const QString name = it.key();
+        if (it.value() == 0 || it.value() > m_prefetchDepth) continue;
+        if (m_rooms.contains(name) || m_pending.contains(name)) continue;
+
+        m_pending.insert(name);
+
+        // Closer rooms are prepared first
+        m_pool.start([this, name]() {
+            const Prepared prepared = prepare(name);
+            QMetaObject::invokeMethod(this, [this, prepared]() {
+                m_pending.remove(prepared.name);
+                if (!prepared.ok) {
+                    LOG_WARNING("room", "Failed to prefetch room %1: %2", prepared.name, prepared.error);
+                    return;
+                }
+                if (m_rooms.contains(prepared.name)) return;
+
+                if (!finish(prepared, AssetLoader::Low)) return;
+
+                // A room evicted right away does not fit the budget, so stop streaming further
+                evict();
+                if (!m_rooms.contains(prepared.name)) return;
+
+                emit roomPrefetched(prepared.name);
+
+                // The new room may have revealed rooms within the prefetch depth
+                prefetchNeighbours();
+            }, Qt::QueuedConnection);
+        }, m_prefetchDepth - it.value());
+    }
+
+}
+
+/**
+ * @brief Drops the furthest rooms until the memory budget is met
+ *
+ * The current room is never evicted. Among rooms at the same distance the least recently
+ * used one goes first
+ */
+
+void RoomManager::evict()
+{
+
+    const QHash<QString, int> distance = distances();
+
+    while (memoryUsage() > m_memoryBudget) {
+        QString victim;
+        int victimDistance = -1;
+        quint64 victimUse = 0;
+
+        for (const QSharedPointer<Room> &room : m_rooms) {
+            if (room->name == m_current) continue;
+
+            const int d = distance.value(room->name, INT_MAX);
+            if (d > victimDistance || (d == victimDistance && room->lastUsed < victimUse)) {
+                victim = room->name;
+                victimDistance = d;
+                victimUse = room->lastUsed;
+            }
+        }
+
+        if (victim.isEmpty()) break;
+        m_rooms.remove(victim);
+    }
+
+}
+
+/**
+ * @brief Returns the door distance of every known room from the current room
+ *
+ * Breadth first search over the doors of the rooms loaded so far
+ */
+
+QHash<QString, int> RoomManager::distances() const
+{
+
+    QHash<QString, int> distance;
+    if (m_current.isEmpty()) return distance;
+
+    QQueue<QString> queue;
+    distance.insert(m_current, 0);
+    queue.enqueue(m_current);
+
+    while (!queue.isEmpty()) {
+        const QString name = queue.dequeue();
+        const int next = distance.value(name) + 1;
+        for (const QString &neighbour : m_adjacency.value(name)) {
+            if (distance.contains(neighbour)) continue;
+            distance.insert(neighbour, next);
+            queue.enqueue(neighbour);
+        }
+    }
+
+    return distance;
+
+}
@@ -0,0 +1,114 @@
+/**
+ * @file roommanager.h
+ * @brief Keeps the current room resident and streams in its neighbours
+ * @author Kiet Tran
+ */
+
+#ifndef ROOMMANAGER_H
+#define ROOMMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QPixmap>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include "collisionworld.h"
+#include "level.h"
+#include "assetloader.h"
+
+/**
+ * @brief Everything needed to show a room without touching the disk
+ */
+
+struct Room {
+    QString name;
+    QSharedPointer<Level> level;
+    QPixmap background;
+    CollisionWorld collision;
+    QStringList neighbours;  // Rooms reachable through this room's trigger zones
+    qint64 bytes = 0;        // Estimated memory held by the room
+    quint64 lastUsed = 0;
+};
+
+/**
+ * @brief Manages which rooms of the house are resident in memory
+ *
+ * Entering a room makes it current and queues its neighbours (the targets of its trigger zones)
+ * for prefetching on a worker thread, where the room is compiled and its collision grid is built.
+ * Backgrounds are decoded by the AssetLoader, only the QPixmap conversion happens on the GUI
+ * thread, once per prefetched room, so walking through a door just swaps prepared data.
+ * Rooms furthest from the current room are evicted first when the memory budget is exceeded
+ */
+
+class RoomManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RoomManager(QObject *parent = nullptr);
+    ~RoomManager();
+
+    // Memory budget for resident rooms in bytes
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const { return m_memoryBudget; }
+    qint64 memoryUsage() const;
+
+    // How many doors away from the current room are prefetched
+    void setPrefetchDepth(int depth);
+    int prefetchDepth() const { return m_prefetchDepth; }
+
+    // Makes a room current, loading it synchronously only if it was not prefetched
+    const Room *enterRoom(const QString &name, QString *error = nullptr);
+
+    // Returns the current room or null before the first enterRoom()
+    const Room *currentRoom() const;
+
+    // Returns true if a room is loaded and ready to enter
+    bool isResident(const QString &name) const;
+
+signals:
+    // Emitted when a room finished prefetching
+    void roomPrefetched(const QString &name);
+
+    // Emitted when the background of a resident room has been decoded
+    void backgroundReady(const QString &name, const QPixmap &background);
+
+private:
+    // Data prepared on the worker thread
+    struct Prepared {
+        QString name;
+        QString backgroundPath;
+        CollisionWorld collision;
+        QStringList neighbours;
+        QString error;
+        bool ok = false;
+    };
+
+    // Compiles the room and builds its collision grid
+    static Prepared prepare(const QString &name);
+
+    // Maps the room and requests its background, runs on the GUI thread
+    QSharedPointer<Room> finish(const Prepared &prepared, AssetLoader::Priority priority);
+
+    // Queues the rooms within the prefetch depth that are not resident yet
+    void prefetchNeighbours();
+
+    // Drops the furthest rooms until the memory budget is met
+    void evict();
+
+    // Door distance of every known room from the current room
+    QHash<QString, int> distances() const;
+
+    QThreadPool m_pool;
+    QHash<QString, QSharedPointer<Room>> m_rooms;
+    QHash<QString, QStringList> m_adjacency;  // Known doors between rooms
+    QSet<QString> m_pending;
+    QString m_current;
+    qint64 m_memoryBudget;
+    int m_prefetchDepth;
+    quint64 m_useCounter;
+};
+
+#endif // ROOMMANAGER_H
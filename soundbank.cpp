@@ -0,0 +1,331 @@
+/**
+ * @file soundbank.cpp
+ * @brief Implementation of the SoundBank class
+ * @author Cherie Duong
+ */
+
+#include "soundbank.h"
+#include "assetpack.h"
+#include "logger.h"
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QThread>
+#include <QUrl>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Samples this close to zero at either end of an effect are trimmed
+const int kSilenceLevel = 16;
+
+// Resamples mono samples linearly into out, which must hold the resampled length
+void resample(const QVector<qint16> &samples, int fromRate, int toRate, qint16 *out, int frames)
+{
+
+    for (int i = 0; i < frames; ++i) {
+        const qreal position = qreal(i) * fromRate / toRate;
+        const int index = qMin(int(position), samples.size() - 1);
+        const qreal fraction = position - index;
+        const qint16 next = index + 1 < samples.size() ? samples[index + 1] : samples[index];
+        out[i] = qint16(samples[index] + (next - samples[index]) * fraction);
+    }
+
+}
+
+}
+
+/**
+ * @brief Constructs a bank for a mixer rate and starts its worker thread
+ * @param sampleRate represents the rate clips are stored at, the mixer's
+ * @param budgetBytes represents the size of the arena
+ * @param parent represents the parent QObject
+ *
+ * The arena is allocated without being initialised, so the memory of the budget is only
+ * committed as effects are decoded into it
+ */
+
+SoundBank::SoundBank(int sampleRate, qint64 budgetBytes, QObject *parent)
+    : QObject(parent)
+    , m_sampleRate(qMax(1, sampleRate))
+    , m_maxEffectFrames(int(qint64(m_sampleRate) * kMaxEffectMs / 1000))
+    , m_arena(new qint16[size_t(qMax<qint64>(0, budgetBytes) / qint64(sizeof(qint16)))])
+    , m_capacity(qMax<qint64>(0, budgetBytes) / qint64(sizeof(qint16)))
+    , m_used(0)
+    , m_thread(new QThread())
+    , m_context(new QObject())
+{
+
+    m_thread->setObjectName("SoundBank");
+    m_context->moveToThread(m_thread);
+    m_thread->start();
+
+}
+
+/**
+ * @brief Cancels the decoders and stops the worker thread
+ *
+ * Clips handed out before stay valid until the bank is deleted, the mixer must stop first
+ */
+
+SoundBank::~SoundBank()
+{
+
+    QMetaObject::invokeMethod(m_context, [this]() { stopJobs(); }, Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+    delete m_context;
+    delete m_thread;
+
+}
+
+/**
+ * @brief Starts decoding an effect on the worker thread
+ * @param filePath represents the path to the audio file, also its name in the bank
+ */
+
+void SoundBank::load(const QString &filePath)
+{
+
+    if (m_index.contains(filePath)) return;
+
+    Entry entry;
+    entry.state = State::Decoding;
+    m_index.insert(filePath, entry);
+
+    QMetaObject::invokeMethod(m_context, [this, filePath]() { startJob(filePath); });
+
+}
+
+/**
+ * @brief Returns the state of an effect
+ */
+
+SoundBank::State SoundBank::state(const QString &filePath) const
+{
+
+    return m_index.value(filePath).state;
+
+}
+
+/**
+ * @brief Returns the PCM of a Ready effect, an invalid clip otherwise
+ */
+
+SoundClip SoundBank::clip(const QString &filePath) const
+{
+
+    SoundClip clip;
+    const auto entry = m_index.constFind(filePath);
+    if (entry == m_index.constEnd() || entry->state != State::Ready) return clip;
+
+    clip.samples = m_arena.get() + entry->offset;
+    clip.frames = entry->frames;
+    return clip;
+
+}
+
+/**
+ * @brief Points a decoder at a file or resource path
+ * @param decoder represents the decoder, it owns the file opened for resources
+ * @param filePath represents a local path, a URL, or a qrc: or : resource path
+ * @return Returns false if the resource could not be opened
+ *
+ * Resources are read through AssetPack, straight from their mapping when they are stored
+ * uncompressed, decoders only take file and network URLs
+ */
+
+bool SoundBank::setDecoderSource(QAudioDecoder *decoder, const QString &filePath)
+{
+
+    if (!AssetPack::isResource(filePath)) {
+        const QUrl url(filePath);
+        decoder->setSource(url.isRelative() ? QUrl::fromLocalFile(filePath) : url);
+        return true;
+    }
+
+    QIODevice *device = AssetPack::open(filePath, decoder);
+    if (!device) return false;
+
+    decoder->setSourceDevice(device);
+    return true;
+
+}
+
+/**
+ * @brief Creates the decoder of an effect, runs on the worker thread
+ *
+ * Asks the backend for mono 16-bit at the bank's rate, buffers in any other format are converted
+ * in readBuffer()
+ */
+
+void SoundBank::startJob(const QString &filePath)
+{
+
+    QAudioDecoder *decoder = new QAudioDecoder(m_context);
+    QAudioFormat format;
+    format.setSampleRate(m_sampleRate);
+    format.setChannelCount(1);
+    format.setSampleFormat(QAudioFormat::Int16);
+    decoder->setAudioFormat(format);
+
+    if (!setDecoderSource(decoder, filePath)) {
+        LOG_WARNING("audio", "Sound effect %1 could not be opened", filePath);
+        delete decoder;
+        QMetaObject::invokeMethod(this, [this, filePath]() { publish(filePath, State::Failed, 0, 0); });
+        return;
+    }
+
+    Job job;
+    job.decoder = decoder;
+    m_jobs.insert(filePath, job);
+
+    connect(decoder, &QAudioDecoder::bufferReady, m_context, [this, filePath]() { readBuffer(filePath); });
+    connect(decoder, &QAudioDecoder::finished, m_context, [this, filePath]() { finishJob(filePath, false); });
+    connect(decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), m_context, [this, decoder, filePath]() {
+        LOG_WARNING("audio", "Sound effect error: %1", decoder->errorString());
+        finishJob(filePath, true);
+    });
+
+    decoder->start();
+
+}
+
+/**
+ * @brief Appends a decoded buffer to its job, downmixed to mono
+ *
+ * Stops the decoder as soon as the effect is known to be too long to keep, the rest of the file
+ * is never decoded
+ */
+
+void SoundBank::readBuffer(const QString &filePath)
+{
+
+    auto job = m_jobs.find(filePath);
+    if (job == m_jobs.end()) return;
+
+    const QAudioBuffer buffer = job->decoder->read();
+    const QAudioFormat format = buffer.format();
+    const int channels = format.channelCount();
+    const int frames = buffer.frameCount();
+    if (!buffer.isValid() || channels <= 0 || format.sampleRate() <= 0) return;
+
+    job->sampleRate = format.sampleRate();
+    const int start = job->samples.size();
+    if (qint64(start + frames) * m_sampleRate / job->sampleRate > m_maxEffectFrames) {
+        job->tooLong = true;
+        job->decoder->stop();
+        finishJob(filePath, false);
+        return;
+    }
+
+    job->samples.resize(start + frames);
+    qint16 *out = job->samples.data() + start;
+
+    if (format.sampleFormat() == QAudioFormat::Int16 && channels == 1) {
+        std::memcpy(out, buffer.constData<qint16>(), frames * sizeof(qint16));
+        return;
+    }
+
+    const char *data = buffer.constData<char>();
+    const int sampleBytes = format.bytesPerSample();
+    for (int i = 0; i < frames; ++i) {
+        float sum = 0.0f;
+        for (int c = 0; c < channels; ++c) {
+            sum += format.normalizedSampleValue(data + (i * channels + c) * sampleBytes);
+        }
+        out[i] = qint16(qBound(-1.0f, sum / channels, 1.0f) * 32767.0f);
+    }
+
+}
+
+/**
+ * @brief Moves a decoded effect into the arena, runs on the worker thread
+ * @param filePath represents the effect
+ * @param failed represents whether the decoder reported an error
+ *
+ * Trims silence off both ends and resamples straight into the arena if the backend ignored the
+ * requested rate. The arena only grows, so clips already handed out are never moved
+ */
+
+void SoundBank::finishJob(const QString &filePath, bool failed)
+{
+
+    auto found = m_jobs.find(filePath);
+    if (found == m_jobs.end()) return;
+
+    Job job = found.value();
+    m_jobs.erase(found);
+    job.decoder->deleteLater();
+
+    State state = State::Failed;
+    qint64 offset = 0;
+    int frames = 0;
+
+    int first = 0;
+    int last = job.samples.size();
+    while (first < last && qAbs(int(job.samples[first])) < kSilenceLevel) ++first;
+    while (last > first && qAbs(int(job.samples[last - 1])) < kSilenceLevel) --last;
+
+    if (job.tooLong) {
+        state = State::Streamed;
+    } else if (!failed && last > first) {
+        const QVector<qint16> trimmed = job.samples.mid(first, last - first);
+        frames = int(qint64(trimmed.size()) * m_sampleRate / job.sampleRate);
+        offset = m_used.load(std::memory_order_relaxed);
+
+        if (offset + frames > m_capacity) {
+            LOG_INFO("audio", "Sound effect %1 is over the %2 KB budget, it will be streamed", filePath, budgetBytes() / 1024);
+            state = State::Streamed;
+        } else {
+            qint16 *out = m_arena.get() + offset;
+            if (job.sampleRate == m_sampleRate) {
+                std::copy(trimmed.constBegin(), trimmed.constEnd(), out);
+            } else {
+                resample(trimmed, job.sampleRate, m_sampleRate, out, frames);
+            }
+            m_used.store(offset + frames, std::memory_order_release);
+            state = State::Ready;
+        }
+    }
+
+    // The queued call orders the arena writes before any reader on the bank's thread
+    QMetaObject::invokeMethod(this, [this, filePath, state, offset, frames]() { publish(filePath, state, offset, frames); });
+
+}
+
+/**
+ * @brief Deletes every running decoder, runs on the worker thread
+ */
+
+void SoundBank::stopJobs()
+{
+
+    for (Job &job : m_jobs) {
+        job.decoder->stop();
+        delete job.decoder;
+    }
+    m_jobs.clear();
+
+}
+
+/**
+ * @brief Records the outcome of a job in the index and reports it
+ */
+
+void SoundBank::publish(const QString &filePath, SoundBank::State state, qint64 offset, int frames)
+{
+
+    Entry &entry = m_index[filePath];
+    entry.state = state;
+    entry.offset = offset;
+    entry.frames = frames;
+
+    if (state == State::Ready) {
+        LOG_DEBUG("audio", "Decoded sound effect %1, %2 frames, bank at %3 of %4 KB",
+                  filePath, frames, usedBytes() / 1024, budgetBytes() / 1024);
+    }
+
+    emit loaded(filePath, state);
+
+}
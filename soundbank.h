@@ -0,0 +1,117 @@
+/**
+ * @file soundbank.h
+ * @brief Sound effects decoded once into one contiguous block of PCM
+ * @author Cherie Duong
+ */
+
+#ifndef SOUNDBANK_H
+#define SOUNDBANK_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include "soundmixer.h"
+
+class QAudioDecoder;
+class QThread;
+
+/**
+ * @brief Decodes sound effects on a worker thread and keeps their PCM in an arena
+ *
+ * Every effect is decoded once with QAudioDecoder to mono 16-bit at the mixer's rate, its
+ * silent head and tail are trimmed, and it is appended to a single arena allocated up front at
+ * the memory budget. The index maps each effect to its offset and length in the arena, so a
+ * SoundClip handed to the mixer is just a pointer into it and playback never decodes or
+ * allocates. Nothing is ever removed, clips stay valid for the lifetime of the bank.
+ *
+ * Effects longer than kMaxEffectMs, or that no longer fit the budget, are not kept; they are
+ * reported as Streamed and left to a media player that decodes them while playing
+ */
+
+class SoundBank : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Arena size, decoded PCM never takes more than this
+    static const qint64 kDefaultBudgetBytes = 16 * 1024 * 1024;
+
+    // Effects longer than this are streamed instead of decoded. Just above the longest looping
+    // room emitter (checking territory, 30.5 s), which has to be in the bank to be placed in the
+    // room, while the music-length tracks keep streaming
+    static const int kMaxEffectMs = 35000;
+
+    enum class State {
+        Unknown,    // Never loaded
+        Decoding,
+        Ready,      // In the arena, see clip()
+        Streamed,   // Too long or over budget, play it with a streaming player
+        Failed
+    };
+
+    explicit SoundBank(int sampleRate, qint64 budgetBytes = kDefaultBudgetBytes, QObject *parent = nullptr);
+    ~SoundBank();
+
+    // Starts decoding an effect, loaded() follows. Ignored if it was loaded before
+    void load(const QString &filePath);
+
+    // State of an effect and its PCM once Ready
+    State state(const QString &filePath) const;
+    SoundClip clip(const QString &filePath) const;
+
+    int sampleRate() const { return m_sampleRate; }
+
+    // Points a decoder at a file, URL or qrc: resource
+    static bool setDecoderSource(QAudioDecoder *decoder, const QString &filePath);
+
+    // Bytes of the arena in use and in total
+    qint64 usedBytes() const { return m_used.load(std::memory_order_relaxed) * qint64(sizeof(qint16)); }
+    qint64 budgetBytes() const { return m_capacity * qint64(sizeof(qint16)); }
+
+signals:
+    // An effect finished loading as Ready, Streamed or Failed
+    void loaded(const QString &filePath, SoundBank::State state);
+
+private:
+    struct Entry {
+        State state = State::Unknown;
+        qint64 offset = 0;      // First sample in the arena
+        int frames = 0;
+    };
+
+    // Decoder of one effect, only touched by the worker thread
+    struct Job {
+        QAudioDecoder *decoder = nullptr;
+        QVector<qint16> samples;    // Mono at the decoder's rate
+        int sampleRate = 0;
+        bool tooLong = false;
+    };
+
+    // Run on the worker thread
+    void startJob(const QString &filePath);
+    void readBuffer(const QString &filePath);
+    void finishJob(const QString &filePath, bool failed);
+    void stopJobs();
+
+    // Records the outcome of a job, runs on the bank's thread
+    void publish(const QString &filePath, SoundBank::State state, qint64 offset, int frames);
+
+    int m_sampleRate;
+    int m_maxEffectFrames;
+
+    // Written only by the worker thread, behind m_used
+    std::unique_ptr<qint16[]> m_arena;
+    qint64 m_capacity;
+    std::atomic<qint64> m_used;
+
+    QThread *m_thread;
+    QObject *m_context;             // Lives on the worker thread, owns the decoders
+    QHash<QString, Job> m_jobs;     // Worker thread only
+
+    QHash<QString, Entry> m_index;  // Bank's thread only
+};
+
+#endif // SOUNDBANK_H
@@ -0,0 +1,884 @@
+/**
+ * @file soundmixer.cpp
+ * @brief Implementation of the SoundMixer class
+ * @author Cherie Duong
+ */
+
+#include "soundmixer.h"
+#include "logger.h"
+#include "musicstream.h"
+#include "profiler.h"
+#include <QAudioSink>
+#include <QIODevice>
+#include <QMediaDevices>
+#include <QThread>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Largest block rendered at once, longer requests are rendered in several blocks
+const int kMaxBlockFrames = 4096;
+
+// Distance over which an emitter swings from the centre towards one side, keeps an emitter
+// right on top of the listener from jumping between the speakers
+const float kPanDistance = 120.0f;
+
+// Packs a position into one word, so the mixer never reads x of one update and y of another
+quint64 packPosition(float x, float y)
+{
+
+    quint32 bits[2];
+    std::memcpy(&bits[0], &x, sizeof(float));
+    std::memcpy(&bits[1], &y, sizeof(float));
+    return quint64(bits[0]) | (quint64(bits[1]) << 32);
+
+}
+
+void unpackPosition(quint64 packed, float &x, float &y)
+{
+
+    const quint32 low = quint32(packed);
+    const quint32 high = quint32(packed >> 32);
+    std::memcpy(&x, &low, sizeof(float));
+    std::memcpy(&y, &high, sizeof(float));
+
+}
+
+/**
+ * @brief Sequential device the sink pulls mixed blocks from
+ */
+
+class MixerDevice : public QIODevice
+{
+public:
+    explicit MixerDevice(SoundMixer *mixer, int bytesPerFrame, QObject *parent = nullptr)
+        : QIODevice(parent)
+        , m_mixer(mixer)
+        , m_bytesPerFrame(bytesPerFrame)
+    {
+    }
+
+    bool isSequential() const override { return true; }
+
+    // The mix never runs dry, silence is rendered while no voice plays
+    qint64 bytesAvailable() const override { return qint64(kMaxBlockFrames) * m_bytesPerFrame + QIODevice::bytesAvailable(); }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        const qint64 frames = maxSize / m_bytesPerFrame;
+        qint64 done = 0;
+        while (done < frames) {
+            const int block = int(qMin<qint64>(frames - done, kMaxBlockFrames));
+            m_mixer->render(data + done * m_bytesPerFrame, block);
+            done += block;
+        }
+        return done * m_bytesPerFrame;
+    }
+
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    SoundMixer *m_mixer;
+    int m_bytesPerFrame;
+};
+
+}
+
+/**
+ * @brief Constructs the SoundMixer and negotiates the output format
+ * @param parent represents the parent QObject
+ */
+
+SoundMixer::SoundMixer(QObject *parent)
+    : QObject(parent)
+    , m_initialized(false)
+    , m_running(false)
+    , m_nextVoiceId(1)
+    , m_thread(nullptr)
+    , m_context(nullptr)
+    , m_sink(nullptr)
+    , m_source(nullptr)
+    , m_streamsPaused(false)
+    , m_appliedMasterGain(1.0f)
+    , m_appliedMusicGain(1.0f)
+    , m_listenerX(0.0f)
+    , m_listenerY(0.0f)
+    , m_clock(0)
+    , m_frameClock(0)
+    , m_masterGain(1.0f)
+    , m_musicGain(1.0f)
+    , m_listener(packPosition(0.0f, 0.0f))
+    , m_activeVoices(0)
+    , m_started(0)
+    , m_stolen(0)
+    , m_dropped(0)
+    , m_blocks(0)
+    , m_musicUnderruns(0)
+{
+
+    m_mix.resize(kMaxBlockFrames * MusicStream::kChannels);
+    m_effects.resize(kMaxBlockFrames * MusicStream::kChannels);
+    m_streamBuffer.resize(kMaxBlockFrames * MusicStream::kChannels);
+    initAudio();
+
+}
+
+/**
+ * @brief Stops the mixer thread before the voices go away
+ */
+
+SoundMixer::~SoundMixer()
+{
+
+    stop();
+
+}
+
+/**
+ * @brief Picks the default output device and negotiates the format
+ *
+ * Asks for 16-bit stereo at kPreferredSampleRate. A device that refuses it keeps its own rate
+ * and channel count, and its own sample format if 16-bit is not supported at all
+ */
+
+void SoundMixer::initAudio()
+{
+
+    const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+    if (device.isNull()) {
+        LOG_WARNING("audio", "No audio output device found, effects and music are disabled");
+        return;
+    }
+
+    QAudioFormat format;
+    format.setSampleRate(kPreferredSampleRate);
+    format.setChannelCount(2);
+    format.setSampleFormat(QAudioFormat::Int16);
+
+    if (!device.isFormatSupported(format)) {
+        const QAudioFormat preferred = device.preferredFormat();
+        format.setSampleRate(preferred.sampleRate());
+        format.setChannelCount(preferred.channelCount());
+        if (!device.isFormatSupported(format)) {
+            format = preferred;
+        }
+    }
+
+    if (format.sampleFormat() != QAudioFormat::Int16 && format.sampleFormat() != QAudioFormat::Float) {
+        LOG_WARNING("audio", "Unsupported output sample format %1, effects and music are disabled", int(format.sampleFormat()));
+        return;
+    }
+
+    m_device = device;
+    m_format = format;
+    m_initialized = true;
+
+    LOG_INFO("audio", "Mixer output %1 at %2 Hz, %3 channel(s)",
+             device.description(), format.sampleRate(), format.channelCount());
+
+}
+
+/**
+ * @brief Starts the mixer thread and opens the sink on it
+ * @return Returns false if the output could not be opened
+ */
+
+bool SoundMixer::start()
+{
+
+    if (!m_initialized) return false;
+    if (m_running) return true;
+
+    for (Voice &voice : m_voices) {
+        voice = Voice();
+    }
+    for (Deck &deck : m_decks) {
+        deck = Deck();
+    }
+    m_streamsPaused = false;
+    Command discard;
+    while (m_commands.pop(discard)) {}
+
+    m_clock = 0;
+    m_frameClock.store(0);
+    m_appliedMasterGain = masterGain();
+    m_appliedMusicGain = musicGain();
+    m_activeVoices.store(0);
+    m_started.store(0);
+    m_stolen.store(0);
+    m_dropped.store(0);
+    m_blocks.store(0);
+    m_musicUnderruns.store(0);
+
+    m_thread = new QThread();
+    m_thread->setObjectName("AudioMixer");
+    m_context = new QObject();
+    m_context->moveToThread(m_thread);
+    m_thread->start();
+    QMetaObject::invokeMethod(m_context, [this]() { openSink(); }, Qt::BlockingQueuedConnection);
+
+    m_running = m_sink != nullptr;
+    if (!m_running) {
+        stop();
+        return false;
+    }
+
+    return true;
+
+}
+
+/**
+ * @brief Closes the sink and waits for the mixer thread to finish
+ */
+
+void SoundMixer::stop()
+{
+
+    if (!m_thread) return;
+
+    QMetaObject::invokeMethod(m_context, [this]() { closeSink(); }, Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+    delete m_context;
+    delete m_thread;
+    m_context = nullptr;
+    m_thread = nullptr;
+
+    if (m_running) {
+        const SoundMixerStats counters = stats();
+        LOG_INFO("audio", "Mixer stopped after %1 blocks, %2 voices started, %3 stolen, %4 dropped, %5 music underruns",
+                 counters.blocks, counters.started, counters.stolen, counters.dropped, counters.musicUnderruns);
+    }
+    m_running = false;
+
+}
+
+/**
+ * @brief Queues a clip to play
+ * @param clip represents the samples, at sampleRate()
+ * @param gain represents the linear gain of the voice
+ * @param priority represents how important the effect is when voices run out
+ * @param startFrame represents the frameClock() frame to start on, a passed frame starts with the next block
+ * @return Returns the voice's id, or 0 if the request was not queued
+ */
+
+SoundMixer::VoiceId SoundMixer::play(const SoundClip &clip, float gain, int priority, qint64 startFrame)
+{
+
+    if (!m_running || !clip.isValid()) return 0;
+
+    Command command;
+    command.type = Command::Play;
+    command.voice = m_nextVoiceId++;
+    command.clip = clip;
+    command.gain = gain;
+    command.priority = priority;
+    command.startFrame = startFrame;
+
+    if (m_nextVoiceId == 0) m_nextVoiceId = 1;
+
+    return send(command) ? command.voice : 0;
+
+}
+
+/**
+ * @brief Queues a clip to play at a position
+ * @param clip represents the samples, at sampleRate()
+ * @param x represents the emitter's horizontal position
+ * @param y represents the emitter's vertical position
+ * @param radius represents the distance from the listener at which the emitter falls silent
+ * @param gain represents the linear gain of the voice next to the listener
+ * @param loop represents whether the clip repeats until the voice is stopped
+ * @param priority represents how important the effect is when voices run out
+ * @param startFrame represents the frameClock() frame to start on, a passed frame starts with the next block
+ * @return Returns the voice's id, or 0 if the request was not queued
+ */
+
+SoundMixer::VoiceId SoundMixer::playAt(const SoundClip &clip, float x, float y, float radius, float gain, bool loop,
+                                       int priority, qint64 startFrame)
+{
+
+    if (!m_running || !clip.isValid()) return 0;
+
+    Command command;
+    command.type = Command::Play;
+    command.voice = m_nextVoiceId++;
+    command.clip = clip;
+    command.gain = gain;
+    command.priority = priority;
+    command.startFrame = startFrame;
+    command.positional = true;
+    command.loop = loop;
+    command.x = x;
+    command.y = y;
+    command.radius = qMax(1.0f, radius);
+
+    if (m_nextVoiceId == 0) m_nextVoiceId = 1;
+
+    return send(command) ? command.voice : 0;
+
+}
+
+/**
+ * @brief Ramps a playing voice to a new gain over the next block
+ */
+
+void SoundMixer::setVoiceGain(VoiceId voice, float gain)
+{
+
+    Command command;
+    command.type = Command::SetGain;
+    command.voice = voice;
+    command.gain = gain;
+    send(command);
+
+}
+
+/**
+ * @brief Moves a positional voice's emitter, heard from the next block on
+ */
+
+void SoundMixer::setVoicePosition(VoiceId voice, float x, float y)
+{
+
+    Command command;
+    command.type = Command::SetPosition;
+    command.voice = voice;
+    command.x = x;
+    command.y = y;
+    send(command);
+
+}
+
+/**
+ * @brief Sets the position positional voices are heard from
+ *
+ * A single atomic store, cheap enough to call every frame from the GUI thread
+ */
+
+void SoundMixer::setListener(float x, float y)
+{
+
+    m_listener.store(packPosition(x, y), std::memory_order_relaxed);
+
+}
+
+/**
+ * @brief Cuts off a voice, ignored if it already finished or was stolen
+ */
+
+void SoundMixer::stopVoice(VoiceId voice)
+{
+
+    Command command;
+    command.type = Command::Stop;
+    command.voice = voice;
+    send(command);
+
+}
+
+/**
+ * @brief Cuts off every voice
+ */
+
+void SoundMixer::stopAll()
+{
+
+    Command command;
+    command.type = Command::StopAll;
+    send(command);
+
+}
+
+/**
+ * @brief Attaches a stream to a deck and fades it in
+ * @param deck represents the deck, 0 to kMusicDecks - 1
+ * @param stream represents the stream, already opened on its track
+ * @param gain represents the gain reached at the end of the fade
+ * @param fadeMs represents the length of the fade, 0 starts at full gain
+ * @param tag represents the attachment, reported back by streamDetached()
+ *
+ * Whatever the deck was playing is replaced at once
+ */
+
+void SoundMixer::playStream(int deck, MusicStream *stream, float gain, int fadeMs, int tag)
+{
+
+    if (deck < 0 || deck >= kMusicDecks) return;
+
+    Command command;
+    command.type = Command::PlayStream;
+    command.deck = deck;
+    command.stream = stream;
+    command.gain = gain;
+    command.fadeFrames = qMax(0, int(qint64(sampleRate()) * fadeMs / 1000));
+    command.tag = tag;
+    send(command);
+
+}
+
+/**
+ * @brief Fades a deck to a gain
+ * @param deck represents the deck, 0 to kMusicDecks - 1
+ * @param gain represents the gain reached at the end of the fade
+ * @param fadeMs represents the length of the fade
+ * @param detach represents whether the deck lets go of its stream once the fade is over, which
+ * streamDetached() reports
+ */
+
+void SoundMixer::fadeStream(int deck, float gain, int fadeMs, bool detach)
+{
+
+    if (deck < 0 || deck >= kMusicDecks) return;
+
+    Command command;
+    command.type = Command::FadeStream;
+    command.deck = deck;
+    command.gain = gain;
+    command.fadeFrames = qMax(0, int(qint64(sampleRate()) * fadeMs / 1000));
+    command.flag = detach;
+    send(command);
+
+}
+
+/**
+ * @brief Stops or resumes reading every deck
+ */
+
+void SoundMixer::pauseStreams(bool paused)
+{
+
+    Command command;
+    command.type = Command::PauseStreams;
+    command.flag = paused;
+    send(command);
+
+}
+
+/**
+ * @brief Returns the counters since start()
+ */
+
+SoundMixerStats SoundMixer::stats() const
+{
+
+    SoundMixerStats counters;
+    counters.started = m_started.load(std::memory_order_relaxed);
+    counters.stolen = m_stolen.load(std::memory_order_relaxed);
+    counters.dropped = m_dropped.load(std::memory_order_relaxed);
+    counters.blocks = m_blocks.load(std::memory_order_relaxed);
+    counters.musicUnderruns = m_musicUnderruns.load(std::memory_order_relaxed);
+    return counters;
+
+}
+
+/**
+ * @brief Renders one block in the output format
+ * @param data represents room for frames frames
+ * @param frames represents the block length, at most kMaxBlockFrames
+ *
+ * Commands queued before the block take effect in it, a voice scheduled inside the block starts
+ * on its exact frame. Runs on the mixer thread without locking, and only allocates for the
+ * queued streamDetached() of a deck that finished fading out
+ */
+
+void SoundMixer::render(char *data, int frames)
+{
+
+    ProfileScope scope(ProfileSection::Mixer);
+
+    const qint64 blockStart = m_clock;
+    unpackPosition(m_listener.load(std::memory_order_relaxed), m_listenerX, m_listenerY);
+    drainCommands(blockStart);
+
+    const int samples = frames * MusicStream::kChannels;
+    float *mix = m_mix.data();
+    float *effects = m_effects.data();
+    std::fill(mix, mix + samples, 0.0f);
+    std::fill(effects, effects + samples, 0.0f);
+
+    const float musicFrom = m_appliedMusicGain;
+    const float musicTo = musicGain();
+    if (!m_streamsPaused) {
+        for (int i = 0; i < kMusicDecks; ++i) {
+            Deck &deck = m_decks[i];
+            if (deck.stream && !mixDeck(deck, mix, frames, blockStart, musicFrom, musicTo)) {
+                // Queued to the GUI thread, once per track change
+                emit streamDetached(i, deck.tag);
+            }
+        }
+    }
+    m_appliedMusicGain = musicTo;
+
+    int active = 0;
+    for (Voice &voice : m_voices) {
+        if (voice.id == 0) continue;
+        mixVoice(voice, effects, frames, blockStart);
+        if (voice.id != 0) ++active;
+    }
+
+    writeOutput(mix, effects, data, frames);
+
+    m_clock += frames;
+    m_frameClock.store(m_clock, std::memory_order_release);
+    m_activeVoices.store(active, std::memory_order_relaxed);
+    m_blocks.fetch_add(1, std::memory_order_relaxed);
+
+}
+
+/**
+ * @brief Creates the sink and starts pulling from the mixer
+ */
+
+void SoundMixer::openSink()
+{
+
+    const int bytesPerFrame = m_format.bytesPerFrame();
+
+    m_sink = new QAudioSink(m_device, m_format, m_context);
+    m_sink->setBufferSize(qMax(1, m_format.sampleRate() * kBufferMs / 1000) * bytesPerFrame);
+
+    m_source = new MixerDevice(this, bytesPerFrame, m_context);
+    m_source->open(QIODevice::ReadOnly);
+    m_sink->start(m_source);
+
+    if (m_sink->error() != QAudio::NoError) {
+        LOG_WARNING("audio", "Failed to open the audio output, error %1", int(m_sink->error()));
+        closeSink();
+    }
+
+}
+
+/**
+ * @brief Stops and deletes the sink on the mixer thread
+ */
+
+void SoundMixer::closeSink()
+{
+
+    if (m_sink) {
+        m_sink->stop();
+        delete m_sink;
+        m_sink = nullptr;
+    }
+
+    delete m_source;
+    m_source = nullptr;
+
+}
+
+/**
+ * @brief Pushes a command to the mixer thread
+ *
+ * A full queue means the mixer thread is stalled, the command is counted as dropped
+ */
+
+bool SoundMixer::send(const Command &command)
+{
+
+    if (!m_running) return false;
+
+    if (!m_commands.push(command)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+
+}
+
+/**
+ * @brief Applies every queued command before a block is mixed
+ */
+
+void SoundMixer::drainCommands(qint64 blockStart)
+{
+
+    Command command;
+    while (m_commands.pop(command)) {
+        switch (command.type) {
+        case Command::Play:
+            startVoice(command, blockStart);
+            break;
+        case Command::Stop:
+        case Command::SetGain:
+        case Command::SetPosition:
+            for (Voice &voice : m_voices) {
+                if (voice.id != command.voice) continue;
+                if (command.type == Command::Stop) {
+                    voice.id = 0;
+                } else if (command.type == Command::SetGain) {
+                    voice.gain = command.gain;
+                } else {
+                    voice.x = command.x;
+                    voice.y = command.y;
+                }
+                break;
+            }
+            break;
+        case Command::StopAll:
+            for (Voice &voice : m_voices) {
+                voice.id = 0;
+            }
+            break;
+        case Command::PlayStream: {
+            Deck &deck = m_decks[command.deck];
+            deck.stream = command.stream;
+            deck.fromGain = command.fadeFrames > 0 ? 0.0f : command.gain;
+            deck.toGain = command.gain;
+            deck.fadeStart = blockStart;
+            deck.fadeFrames = command.fadeFrames;
+            deck.tag = command.tag;
+            deck.detachAtEnd = false;
+            break;
+        }
+        case Command::FadeStream: {
+            Deck &deck = m_decks[command.deck];
+            deck.fromGain = deck.gainAt(blockStart);
+            deck.toGain = command.gain;
+            deck.fadeStart = blockStart;
+            deck.fadeFrames = command.fadeFrames;
+            deck.detachAtEnd = command.flag;
+            break;
+        }
+        case Command::PauseStreams:
+            m_streamsPaused = command.flag;
+            break;
+        }
+    }
+
+}
+
+/**
+ * @brief Assigns a voice to a play command
+ *
+ * Takes a free voice if there is one. Otherwise steals the voice of lowest priority, among
+ * equals the quietest (an emitter out of range first) and then the one that started first,
+ * unless the new effect is less important than all of them. The new voice starts at the gains
+ * of its position, without a ramp from silence
+ */
+
+void SoundMixer::startVoice(const Command &command, qint64 blockStart)
+{
+
+    Voice *target = nullptr;
+    for (Voice &voice : m_voices) {
+        if (voice.id == 0) {
+            target = &voice;
+            break;
+        }
+        if (!target || voice.priority < target->priority) {
+            target = &voice;
+            continue;
+        }
+        if (voice.priority > target->priority) continue;
+
+        const float loudness = voice.left + voice.right;
+        const float targetLoudness = target->left + target->right;
+        if (loudness < targetLoudness || (loudness == targetLoudness && voice.startFrame < target->startFrame)) {
+            target = &voice;
+        }
+    }
+
+    if (target->id != 0) {
+        if (target->priority > command.priority) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_stolen.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    target->id = command.voice;
+    target->clip = command.clip;
+    target->position = 0;
+    target->gain = command.gain;
+    target->positional = command.positional;
+    target->loop = command.loop;
+    target->x = command.x;
+    target->y = command.y;
+    target->radius = command.radius;
+    target->priority = command.priority;
+    target->startFrame = qMax(command.startFrame, blockStart);
+    spatialGains(*target, m_listenerX, m_listenerY, target->left, target->right);
+    m_started.fetch_add(1, std::memory_order_relaxed);
+
+}
+
+/**
+ * @brief Computes the channel gains of a voice heard from the listener
+ *
+ * Positional voices fade with the square of the remaining fraction of their radius, silent at
+ * the edge, and are panned with equal power by the horizontal offset. Other voices play at
+ * their gain on both channels
+ */
+
+void SoundMixer::spatialGains(const Voice &voice, float listenerX, float listenerY, float &left, float &right)
+{
+
+    if (!voice.positional) {
+        left = voice.gain;
+        right = voice.gain;
+        return;
+    }
+
+    const float dx = voice.x - listenerX;
+    const float dy = voice.y - listenerY;
+    const float distance = std::sqrt(dx * dx + dy * dy);
+    if (distance >= voice.radius) {
+        left = 0.0f;
+        right = 0.0f;
+        return;
+    }
+
+    const float closeness = 1.0f - distance / voice.radius;
+    const float gain = voice.gain * closeness * closeness;
+    const float pan = dx / std::sqrt(distance * distance + kPanDistance * kPanDistance);
+    const float angle = (pan + 1.0f) * float(M_PI) / 4.0f;
+    left = gain * std::cos(angle);
+    right = gain * std::sin(angle);
+
+}
+
+/**
+ * @brief Adds the part of a voice that falls in the block to the mix
+ *
+ * Both channel gains move linearly from the last block's to this block's over the frames mixed,
+ * so gain changes, moving emitters and a moving listener never click. A voice silent at both
+ * ends of the block only advances through its clip. A voice that reaches the end of its clip
+ * starts over if it loops and is freed otherwise
+ */
+
+void SoundMixer::mixVoice(Voice &voice, float *mix, int frames, qint64 blockStart)
+{
+
+    const qint64 offset = voice.startFrame - blockStart;
+    if (offset >= frames) return;
+
+    const int first = int(qMax<qint64>(0, offset));
+    const int span = frames - first;
+
+    float left;
+    float right;
+    spatialGains(voice, m_listenerX, m_listenerY, left, right);
+    const bool audible = left > 0.0f || right > 0.0f || voice.left > 0.0f || voice.right > 0.0f;
+
+    const float scale = 1.0f / 32768.0f;
+    float leftGain = voice.left * scale;
+    float rightGain = voice.right * scale;
+    const float leftStep = (left - voice.left) * scale / span;
+    const float rightStep = (right - voice.right) * scale / span;
+    voice.left = left;
+    voice.right = right;
+
+    float *out = mix + first * MusicStream::kChannels;
+    int remaining = span;
+    while (remaining > 0) {
+        const int count = qMin(remaining, voice.clip.frames - voice.position);
+
+        if (audible) {
+            const qint16 *samples = voice.clip.samples + voice.position;
+            for (int i = 0; i < count; ++i) {
+                out[2 * i] += samples[i] * leftGain;
+                out[2 * i + 1] += samples[i] * rightGain;
+                leftGain += leftStep;
+                rightGain += rightStep;
+            }
+        }
+
+        out += count * MusicStream::kChannels;
+        remaining -= count;
+        voice.position += count;
+
+        if (voice.position >= voice.clip.frames) {
+            if (!voice.loop) {
+                voice.id = 0;
+                return;
+            }
+            voice.position = 0;
+        }
+    }
+
+}
+
+/**
+ * @brief Adds a block of a music deck to the mix
+ * @return Returns false if the deck was detached after this block
+ *
+ * The deck's fade and the music gain are both ramped across the block. A deck that cannot fill
+ * the block plays what it has, and one whose fade out is over is detached
+ */
+
+bool SoundMixer::mixDeck(Deck &deck, float *mix, int frames, qint64 blockStart, float musicFrom, float musicTo)
+{
+
+    const float scale = 1.0f / 32768.0f;
+    float gain = deck.gainAt(blockStart) * musicFrom * scale;
+    const float endGain = deck.gainAt(blockStart + frames) * musicTo * scale;
+    const float step = (endGain - gain) / frames;
+
+    qint16 *samples = m_streamBuffer.data();
+    const int read = deck.stream->read(samples, frames);
+    if (read < frames) {
+        m_musicUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < read; ++i) {
+        mix[2 * i] += samples[2 * i] * gain;
+        mix[2 * i + 1] += samples[2 * i + 1] * gain;
+        gain += step;
+    }
+
+    if (deck.detachAtEnd && blockStart + frames >= deck.fadeStart + deck.fadeFrames) {
+        deck.stream = nullptr;
+        return false;
+    }
+
+    return true;
+
+}
+
+/**
+ * @brief Adds the effects to the music and writes the mix in the output format
+ *
+ * The effects gain is ramped across the block. The sum can exceed full scale, it is clipped
+ * rather than scaled down so a single sound always plays at its own level. A mono output gets
+ * the average of both channels, outputs with more than two channels get silence on the others
+ */
+
+void SoundMixer::writeOutput(float *mix, const float *effects, char *data, int frames)
+{
+
+    const int channels = m_format.channelCount();
+    const float target = masterGain();
+    const float step = (target - m_appliedMasterGain) / frames;
+    float gain = m_appliedMasterGain;
+
+    for (int i = 0; i < frames; ++i) {
+        mix[2 * i] = qBound(-1.0f, mix[2 * i] + effects[2 * i] * gain, 1.0f);
+        mix[2 * i + 1] = qBound(-1.0f, mix[2 * i + 1] + effects[2 * i + 1] * gain, 1.0f);
+        gain += step;
+    }
+    m_appliedMasterGain = target;
+
+    const bool isFloat = m_format.sampleFormat() == QAudioFormat::Float;
+    float *floatOut = reinterpret_cast<float *>(data);
+    qint16 *intOut = reinterpret_cast<qint16 *>(data);
+
+    for (int i = 0; i < frames; ++i) {
+        const float left = mix[2 * i];
+        const float right = mix[2 * i + 1];
+        for (int c = 0; c < channels; ++c) {
+            const float value = channels == 1 ? 0.5f * (left + right) : c == 0 ? left : c == 1 ? right : 0.0f;
+            if (isFloat) {
+                *floatOut++ = value;
+            } else {
+                *intOut++ = qint16(qBound(-32768.0f, value * 32768.0f, 32767.0f));
+            }
+        }
+    }
+
+}
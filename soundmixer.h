@@ -0,0 +1,281 @@
+/**
+ * @file soundmixer.h
+ * @brief Software mixer playing pre-decoded sound effects and streamed music through one audio output
+ * @author Cherie Duong
+ */
+
+#ifndef SOUNDMIXER_H
+#define SOUNDMIXER_H
+
+#include <QObject>
+#include <QAudioDevice>
+#include <QAudioFormat>
+#include <QVector>
+#include <atomic>
+#include "spscringbuffer.h"
+
+class MusicStream;
+class QAudioSink;
+class QIODevice;
+class QThread;
+
+/**
+ * @brief Mono 16-bit PCM at the mixer's sample rate
+ *
+ * The mixer only keeps the pointer, the samples must stay valid until every voice playing them
+ * has finished or the mixer is stopped
+ */
+
+struct SoundClip {
+    const qint16 *samples = nullptr;
+    int frames = 0;
+
+    bool isValid() const { return samples && frames > 0; }
+};
+
+/**
+ * @brief Counters of the mixer since it started
+ */
+
+struct SoundMixerStats {
+    quint64 started = 0;        // Voices started
+    quint64 stolen = 0;         // Voices cut off to make room for a new one
+    quint64 dropped = 0;        // Play requests refused (busy voices of higher priority, full queue)
+    quint64 blocks = 0;         // Blocks rendered for the output
+    quint64 musicUnderruns = 0; // Blocks a music deck could not fill because its decoder was behind
+};
+
+/**
+ * @brief Mixes up to kVoiceCount effects and the music decks into one QAudioSink
+ *
+ * The sink runs in pull mode on a mixer thread and asks for a block whenever its buffer drains,
+ * so every block is rendered from decoded PCM with no decoding or allocation. The GUI thread
+ * sends play, stop and gain commands through a lock-free queue that the mixer drains at the
+ * start of each block.
+ *
+ * Music plays on kMusicDecks decks, each reading a MusicStream's ring. A deck's gain follows a
+ * timed linear fade on the mixer's clock, so a crossfade is one deck fading in while the other
+ * fades out over the same frames. Music and effects have separate master gains and are mixed in
+ * stereo.
+ *
+ * Voices start on a given frame of the mixer's clock, so effects started together (or scheduled
+ * ahead) line up to the sample within the block instead of waiting for the next one. When every
+ * voice is busy, the voice of lowest priority is stolen, the quietest and then the one that
+ * started first among equals; a request whose priority is below every busy voice is dropped
+ * instead. Gain changes are ramped over one block so they never click.
+ *
+ * A positional voice has an emitter position and a radius in scene units. Once per block the
+ * mixer pans it by its direction from the listener and attenuates it by its distance, so the GUI
+ * thread only publishes the listener's position. Emitters out of range keep their place in the
+ * clip but are not mixed, which lets a room hold hundreds of looping emitters cheaply
+ */
+
+class SoundMixer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Voices playing at once, voices out of range of the listener are not mixed
+    static const int kVoiceCount = 256;
+
+    // Output rate asked for, devices that refuse it are opened at their own rate
+    static const int kPreferredSampleRate = 48000;
+
+    // Length of the sink's buffer, bounds the latency of a new effect
+    static const int kBufferMs = 20;
+
+    // Music streams mixed at once, two allow a crossfade
+    static const int kMusicDecks = 2;
+
+    // Identifies a playing voice, 0 is never used
+    using VoiceId = quint32;
+
+    explicit SoundMixer(QObject *parent = nullptr);
+    ~SoundMixer();
+
+    // Picks the default output device and negotiates the format, clips must use sampleRate()
+    void initAudio();
+    bool isInitialized() const { return m_initialized; }
+    int sampleRate() const { return m_format.sampleRate(); }
+
+    // Starts and stops the mixer thread and its sink
+    bool start();
+    void stop();
+    bool isRunning() const { return m_running; }
+
+    // Frames rendered since start(), safe on any thread
+    qint64 frameClock() const { return m_frameClock.load(std::memory_order_acquire); }
+
+    // Starts a clip on a frame of the clock, or with the next block if startFrame has passed.
+    // Returns 0 if the request could not be queued. GUI thread only, like every command below
+    VoiceId play(const SoundClip &clip, float gain = 1.0f, int priority = 0, qint64 startFrame = -1);
+
+    // Same as play(), for an emitter at (x, y) heard up to radius away from the listener. A
+    // looping voice repeats until stopped
+    VoiceId playAt(const SoundClip &clip, float x, float y, float radius, float gain = 1.0f, bool loop = false,
+                   int priority = 0, qint64 startFrame = -1);
+
+    // Ramps a playing voice to a new gain
+    void setVoiceGain(VoiceId voice, float gain);
+
+    // Moves a positional voice's emitter
+    void setVoicePosition(VoiceId voice, float x, float y);
+
+    // Position positional voices are heard from, safe on any thread
+    void setListener(float x, float y);
+
+    // Cuts off one voice, or all of them
+    void stopVoice(VoiceId voice);
+    void stopAll();
+
+    // Gain applied to all effects, safe on any thread
+    void setMasterGain(float gain) { m_masterGain.store(gain, std::memory_order_relaxed); }
+    float masterGain() const { return m_masterGain.load(std::memory_order_relaxed); }
+
+    // Attaches a stream to a deck, fading it in from silence to gain over fadeMs. The stream
+    // must stay open until streamDetached() reports the deck let go of it. tag is handed back
+    // by streamDetached() to tell this attachment from later ones of the same deck
+    void playStream(int deck, MusicStream *stream, float gain, int fadeMs, int tag = 0);
+
+    // Fades a deck from its current gain to gain over fadeMs, detaching it at the end if asked
+    void fadeStream(int deck, float gain, int fadeMs, bool detach);
+
+    // Holds every deck where it is, effects keep playing
+    void pauseStreams(bool paused);
+
+    // Gain applied to all music, safe on any thread
+    void setMusicGain(float gain) { m_musicGain.store(gain, std::memory_order_relaxed); }
+    float musicGain() const { return m_musicGain.load(std::memory_order_relaxed); }
+
+    // Voices that were playing at the end of the last block
+    int activeVoices() const { return m_activeVoices.load(std::memory_order_relaxed); }
+
+    // Counters since start()
+    SoundMixerStats stats() const;
+
+    // Fills a block of frames in the output format, called on the mixer thread by the sink
+    void render(char *data, int frames);
+
+signals:
+    // Emitted on the mixer thread once a deck's fade out is over and it no longer reads its
+    // stream, with the tag the stream was attached with
+    void streamDetached(int deck, int tag);
+
+private:
+    struct Command {
+        enum Type : quint8 { Play, Stop, StopAll, SetGain, SetPosition, PlayStream, FadeStream, PauseStreams };
+
+        Type type = Play;
+        VoiceId voice = 0;
+        SoundClip clip;
+        float gain = 1.0f;
+        int priority = 0;
+        qint64 startFrame = -1;
+        bool positional = false;
+        bool loop = false;
+        float x = 0.0f;
+        float y = 0.0f;
+        float radius = 0.0f;
+        int deck = 0;
+        MusicStream *stream = nullptr;
+        int fadeFrames = 0;
+        int tag = 0;                // Attachment of a stream, see playStream()
+        bool flag = false;          // Detach at the end of a fade, or pause
+    };
+
+    struct Deck {
+        MusicStream *stream = nullptr;  // Null while the deck is detached
+        float fromGain = 0.0f;          // Gain at fadeStart
+        float toGain = 0.0f;            // Gain from fadeStart + fadeFrames on
+        qint64 fadeStart = 0;
+        int fadeFrames = 0;
+        int tag = 0;                    // Tag the stream was attached with
+        bool detachAtEnd = false;
+
+        // Gain on a frame of the clock
+        float gainAt(qint64 frame) const
+        {
+            if (frame >= fadeStart + fadeFrames) return toGain;
+            if (frame <= fadeStart) return fromGain;
+            return fromGain + (toGain - fromGain) * float(frame - fadeStart) / fadeFrames;
+        }
+    };
+
+    struct Voice {
+        VoiceId id = 0;             // 0 while the voice is free
+        SoundClip clip;
+        int position = 0;           // Next frame of the clip
+        float gain = 0.0f;          // Gain asked for, reached at the end of the next block
+        float left = 0.0f;          // Channel gains at the end of the last block mixed
+        float right = 0.0f;
+        bool positional = false;
+        bool loop = false;
+        float x = 0.0f;             // Emitter position and range, positional voices only
+        float y = 0.0f;
+        float radius = 0.0f;
+        int priority = 0;
+        qint64 startFrame = 0;      // Clock frame of the clip's first frame
+    };
+
+    // Opens and closes the sink, runs on the mixer thread
+    void openSink();
+    void closeSink();
+
+    // Pushes a command, false if the queue is full
+    bool send(const Command &command);
+
+    // Applies the queued commands, runs on the mixer thread
+    void drainCommands(qint64 blockStart);
+    void startVoice(const Command &command, qint64 blockStart);
+
+    // Channel gains of a voice heard from the listener
+    static void spatialGains(const Voice &voice, float listenerX, float listenerY, float &left, float &right);
+
+    // Mixes one voice into the stereo effects buffer
+    void mixVoice(Voice &voice, float *mix, int frames, qint64 blockStart);
+
+    // Mixes one music deck into the stereo mix buffer, false once the deck has detached
+    bool mixDeck(Deck &deck, float *mix, int frames, qint64 blockStart, float musicFrom, float musicTo);
+
+    // Adds the effects to the mix and writes it in the output format
+    void writeOutput(float *mix, const float *effects, char *data, int frames);
+
+    QAudioDevice m_device;
+    QAudioFormat m_format;
+    bool m_initialized;
+    bool m_running;
+    VoiceId m_nextVoiceId;
+
+    QThread *m_thread;
+    QObject *m_context;           // Lives on the mixer thread, owns the sink
+    QAudioSink *m_sink;
+    QIODevice *m_source;          // Pulls blocks from render()
+
+    SpscRingBuffer<Command, 128> m_commands;
+
+    // Only touched by the mixer thread
+    Voice m_voices[kVoiceCount];
+    Deck m_decks[kMusicDecks];
+    bool m_streamsPaused;
+    QVector<float> m_mix;           // Stereo music, then the final mix
+    QVector<float> m_effects;       // Stereo effects before the master gain
+    QVector<qint16> m_streamBuffer;
+    float m_appliedMasterGain;
+    float m_appliedMusicGain;
+    float m_listenerX;              // Listener of the block being rendered
+    float m_listenerY;
+    qint64 m_clock;
+
+    std::atomic<qint64> m_frameClock;
+    std::atomic<float> m_masterGain;
+    std::atomic<float> m_musicGain;
+    std::atomic<quint64> m_listener;    // x and y floats packed together, read in one load
+    std::atomic<int> m_activeVoices;
+    std::atomic<quint64> m_started;
+    std::atomic<quint64> m_stolen;
+    std::atomic<quint64> m_dropped;
+    std::atomic<quint64> m_blocks;
+    std::atomic<quint64> m_musicUnderruns;
+};
+
+#endif // SOUNDMIXER_H
@@ -1,141 +1,342 @@
+/**
+ * @file spriteanimation.cpp
+ * @brief Implementation of the AnimationSet, SpriteAnimation and AnimationClock classes
+ * @author Kiet Tran, Steph Oh
+ */
+
 #include "spriteanimation.h"
-#include <QDebug>
-
-SpriteAnimation::SpriteAnimation(QObject *parent)
-    : QObject(parent),
-    QGraphicsPixmapItem(),
-    m_currentState(AnimationState::IdleDown),
-    m_currentFrame(0)
-{
-    QPixmap idleSheet(":/images/Idle_full.png");
-    if (idleSheet.isNull()) {
-        qDebug() << "Failed to load idle sprite sheet!";
-    } else {
-        int idleWidth = idleSheet.width();
-        int idleHeight = idleSheet.height();
-        int rows = 4;
-        int columns = 12;
-
-        int frameW = idleWidth / columns;
-        int frameH = idleHeight / rows;
-
-        // IdleDown
-        QVector<QPixmap> idleDownFrames;
-        for (int col = 0; col < columns; ++col) {
-            idleDownFrames.push_back(idleSheet.copy(
-                col * frameW,
-                0 * frameH,
-                frameW, frameH
-                ));
-        }
-        m_animations[AnimationState::IdleDown] = idleDownFrames;
-        qDebug() << "IdleDown frames loaded:" << idleDownFrames.size();
-
-        // IdleLeft
-        QVector<QPixmap> idleLeftFrames;
-        for (int col = 0; col < columns; ++col) {
-            idleLeftFrames.push_back(idleSheet.copy(
-                col * frameW,
-                1 * frameH,
-                frameW, frameH
-                ));
-        }
-        m_animations[AnimationState::IdleLeft] = idleLeftFrames;
-        qDebug() << "IdleLeft frames loaded:" << idleLeftFrames.size();
-
-        // IdleRight
-        QVector<QPixmap> idleRightFrames;
-        for (int col = 0; col < columns; ++col) {
-            idleRightFrames.push_back(idleSheet.copy(
-                col * frameW,
-                2 * frameH,
-                frameW, frameH
-                ));
-        }
-        m_animations[AnimationState::IdleRight] = idleRightFrames;
-        qDebug() << "IdleRight frames loaded:" << idleRightFrames.size();
-
-        int columnsIdleUp = 6;
-        int frameWUp = idleWidth / columns;
-
-        QVector<QPixmap> idleUpFrames;
-        for (int col = 0; col < columnsIdleUp; ++col) {
-            idleUpFrames.push_back(idleSheet.copy(
-                col * frameWUp,
-                3 * frameH,
-                frameWUp, frameH
-                ));
+#include "assetloader.h"
+#include "atlasspriteitem.h"
+#include "logger.h"
+#include <QCoreApplication>
+#include <memory>
+
+namespace {
+
+// Size of one frame in the sprite sheets
+const int kSheetFrameSize = 64;
+
+// Part of a frame holding the character, the rest of the 64 x 64 cell is transparent
+const QRect kFrameCrop(16, 16, 32, 32);
+
+// Order of the direction rows in both sheets
+const AnimationState kIdleRows[] = {
+    AnimationState::IdleDown, AnimationState::IdleLeft, AnimationState::IdleRight, AnimationState::IdleUp
+};
+const AnimationState kWalkRows[] = {
+    AnimationState::WalkDown, AnimationState::WalkLeft, AnimationState::WalkRight, AnimationState::WalkUp
+};
+
+// Returns true if every pixel of the image is fully transparent
+bool isBlank(const QImage &image)
+{
+
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            if (qAlpha(line[x]) != 0) return false;
         }
-        m_animations[AnimationState::IdleUp] = idleUpFrames;
-        qDebug() << "IdleUp frames loaded:" << idleUpFrames.size();
     }
 
-    // Load the Walk sheet
-    QPixmap walkSheet(":/images/Walk_full.png");
-    if (walkSheet.isNull()) {
-        qDebug() << "Failed to load walk sprite sheet!";
-    } else {
-        int walkWidth = walkSheet.width();
-        int walkHeight = walkSheet.height();
-        int columns = 5;
-        int rows = 4;
-
-        int frameW = walkWidth / columns;
-        int frameH = walkHeight / rows;
-
-        // WalkDown
-        QVector<QPixmap> walkDownFrames;
-        for (int col = 0; col < columns; ++col) {
-            walkDownFrames.push_back(walkSheet.copy(
-                col * frameW,
-                0 * frameH,
-                frameW, frameH
-                ));
-        }
-        m_animations[AnimationState::WalkDown] = walkDownFrames;
-        qDebug() << "WalkDown frames loaded:" << walkDownFrames.size();
-
-        // WalkLeft
-        QVector<QPixmap> walkLeftFrames;
-        for (int col = 0; col < columns; ++col) {
-            walkLeftFrames.push_back(walkSheet.copy(
-                col * frameW,
-                1 * frameH,
-                frameW, frameH
-                ));
-        }
-        m_animations[AnimationState::WalkLeft] = walkLeftFrames;
-        qDebug() << "WalkLeft frames loaded:" << walkLeftFrames.size();
-
-        // WalkRight
-        QVector<QPixmap> walkRightFrames;
-        for (int col = 0; col < columns; ++col) {
-            walkRightFrames.push_back(walkSheet.copy(
-                col * frameW,
-                2 * frameH,
-                frameW, frameH
-                ));
+    return true;
+
+}
+
+}
+
+/**
+ * @brief Returns the clip of a state
+ */
+
+const AnimationClip &AnimationSet::clip(AnimationState state) const
+{
+
+    return m_clips[static_cast<int>(state)];
+
+}
+
+/**
+ * @brief Slices the idle and walk sheets into a shared set of clips
+ * @param name represents the prefix of the frames in the texture atlas
+ * @param idleSheet represents the idle sheet, one row per direction
+ * @param walkSheet represents the walk sheet, one row per direction
+ * @param drawSize represents the size each frame is packed and drawn at
+ *
+ * Must run on the GUI thread since the frames are painted into the atlas pages
+ */
+
+QSharedPointer<const AnimationSet> AnimationSet::fromSheets(const QString &name, const QImage &idleSheet,
+                                                            const QImage &walkSheet, const QSize &drawSize)
+{
+
+    QSharedPointer<AnimationSet> set(new AnimationSet());
+
+    const QImage idle = idleSheet.convertToFormat(QImage::Format_ARGB32);
+    const QImage walk = walkSheet.convertToFormat(QImage::Format_ARGB32);
+
+    for (int row = 0; row < 4; ++row) {
+        set->m_clips[static_cast<int>(kIdleRows[row])] =
+            sliceRow(QString("%1/idle/%2").arg(name).arg(row), idle, row, drawSize, 0.15);
+        set->m_clips[static_cast<int>(kWalkRows[row])] =
+            sliceRow(QString("%1/walk/%2").arg(name).arg(row), walk, row, drawSize, 0.1);
+    }
+
+    return set;
+
+}
+
+/**
+ * @brief Decodes the player sheets and builds the player's animation set
+ * @param context represents the object whose lifetime guards the callback
+ * @param done represents the function called with the set on the GUI thread
+ *
+ * The set is built once, later calls get the same shared set straight away
+ */
+
+void AnimationSet::loadPlayer(QObject *context, ReadyCallback done)
+{
+
+    static QSharedPointer<const AnimationSet> playerSet;
+
+    if (playerSet) {
+        done(playerSet);
+        return;
+    }
+
+    struct Sheets {
+        QImage idle;
+        QImage walk;
+        int remaining = 2;
+    };
+    std::shared_ptr<Sheets> sheets = std::make_shared<Sheets>();
+
+    auto finish = [sheets, done]() {
+        if (--sheets->remaining > 0) return;
+
+        if (sheets->idle.isNull() || sheets->walk.isNull()) {
+            LOG_WARNING("sprite", "Failed to load the player sprite sheets");
+            return;
         }
-        m_animations[AnimationState::WalkRight] = walkRightFrames;
-        qDebug() << "WalkRight frames loaded:" << walkRightFrames.size();
-
-        // WalkUp
-        QVector<QPixmap> walkUpFrames;
-        for (int col = 0; col < columns; ++col) {
-            walkUpFrames.push_back(walkSheet.copy(
-                col * frameW,
-                3 * frameH,
-                frameW, frameH
-                ));
+
+        if (!playerSet) {
+            playerSet = fromSheets("anim/player", sheets->idle, sheets->walk, QSize(75, 75));
         }
-        m_animations[AnimationState::WalkUp] = walkUpFrames;
-        qDebug() << "WalkUp frames loaded:" << walkUpFrames.size();
+        done(playerSet);
+    };
+
+    QObject *guard = context ? context : qApp;
+    AssetLoader::instance().loadPixmap(":/images/Idle_full.png", guard, [sheets, finish](const QPixmap &pixmap) {
+        sheets->idle = pixmap.toImage();
+        finish();
+    }, AssetLoader::High);
+    AssetLoader::instance().loadPixmap(":/images/Walk_full.png", guard, [sheets, finish](const QPixmap &pixmap) {
+        sheets->walk = pixmap.toImage();
+        finish();
+    }, AssetLoader::High);
+
+}
+
+/**
+ * @brief Slices one row of a sheet into a clip
+ *
+ * Frames are cropped to the character, scaled without filtering to keep the pixel art sharp and
+ * packed into the atlas. Blank cells at the end of a row (the idle up row is shorter) are dropped
+ */
+
+AnimationClip AnimationSet::sliceRow(const QString &name, const QImage &sheet, int row,
+                                     const QSize &drawSize, qreal frameDuration)
+{
+
+    AnimationClip clip;
+    clip.frameDuration = frameDuration;
+
+    const int columns = sheet.width() / kSheetFrameSize;
+    QVector<QImage> frames;
+    for (int column = 0; column < columns; ++column) {
+        frames.append(sheet.copy(kFrameCrop.translated(column * kSheetFrameSize, row * kSheetFrameSize)));
+    }
+
+    while (!frames.isEmpty() && isBlank(frames.last())) {
+        frames.removeLast();
+    }
+
+    TextureAtlas &atlas = TextureAtlas::instance();
+    for (int i = 0; i < frames.size(); ++i) {
+        const QString frameName = QString("%1/%2").arg(name).arg(i);
+        clip.frames.append(atlas.contains(frameName)
+                               ? atlas.region(frameName)
+                               : atlas.insert(frameName, frames[i].scaled(drawSize, Qt::KeepAspectRatio, Qt::FastTransformation)));
     }
 
-    if (!m_animations[m_currentState].isEmpty()) {
-        setPixmap(m_animations[m_currentState][m_currentFrame]);
+    return clip;
+
+}
+
+/**
+ * @brief Constructs an animation drawing onto an item
+ * @param target represents the item showing the frames
+ */
+
+SpriteAnimation::SpriteAnimation(AtlasSpriteItem *target)
+    : m_target(target)
+    , m_clock(nullptr)
+    , m_currentState(AnimationState::IdleDown)
+    , m_currentFrame(0)
+    , m_elapsed(0.0)
+{
+
+}
+
+/**
+ * @brief Unregisters the animation from its clock
+ */
+
+SpriteAnimation::~SpriteAnimation()
+{
+
+    if (m_clock) {
+        m_clock->remove(this);
+    }
+
+}
+
+/**
+ * @brief Sets the shared frames to play
+ * @param set represents the animation set, shared with every other item using it
+ */
+
+void SpriteAnimation::setAnimationSet(QSharedPointer<const AnimationSet> set)
+{
+
+    m_set = set;
+    m_currentFrame = 0;
+    m_elapsed = 0.0;
+    updateFrame();
+
+}
+
+/**
+ * @brief Returns true if the current state has frames to show
+ */
+
+bool SpriteAnimation::hasFrames() const
+{
+
+    return m_set && !m_set->clip(m_currentState).isEmpty();
+
+}
+
+/**
+ * @brief Switches to the clip of a state
+ * @param state represents the new state
+ *
+ * Setting the current state again keeps the playback position, so this can be called every tick
+ */
+
+void SpriteAnimation::setAnimation(AnimationState state)
+{
+
+    if (state == m_currentState) return;
+
+    m_currentState = state;
+    m_currentFrame = 0;
+    m_elapsed = 0.0;
+    updateFrame();
+
+}
+
+/**
+ * @brief Moves the playback position forward
+ * @param dt represents the elapsed simulation time in seconds
+ */
+
+void SpriteAnimation::advance(qreal dt)
+{
+
+    if (!hasFrames()) return;
+
+    const AnimationClip &clip = m_set->clip(m_currentState);
+    if (clip.frames.size() < 2) return;
+
+    m_elapsed += dt;
+    if (m_elapsed < clip.frameDuration) return;
+
+    const int steps = static_cast<int>(m_elapsed / clip.frameDuration);
+    m_elapsed -= steps * clip.frameDuration;
+    m_currentFrame = (m_currentFrame + steps) % clip.frames.size();
+    updateFrame();
+
+}
+
+/**
+ * @brief Shows the current frame on the target item
+ */
+
+void SpriteAnimation::updateFrame()
+{
+
+    if (!m_target || !hasFrames()) return;
+
+    m_target->setRegion(m_set->clip(m_currentState).frames.at(m_currentFrame));
+
+}
+
+/**
+ * @brief Detaches the animations that are still registered
+ */
+
+AnimationClock::~AnimationClock()
+{
+
+    for (int i = 0; i < m_animations.size(); ++i) {
+        m_animations[i]->m_clock = nullptr;
+    }
+
+}
+
+/**
+ * @brief Registers an animation with this clock
+ * @param animation represents the animation, moved over if it was on another clock
+ */
+
+void AnimationClock::add(SpriteAnimation *animation)
+{
+
+    if (!animation || animation->m_clock == this) return;
+
+    if (animation->m_clock) {
+        animation->m_clock->remove(animation);
+    }
+
+    animation->m_clock = this;
+    m_animations.append(animation);
+
+}
+
+/**
+ * @brief Unregisters an animation
+ */
+
+void AnimationClock::remove(SpriteAnimation *animation)
+{
+
+    if (!animation || animation->m_clock != this) return;
+
+    animation->m_clock = nullptr;
+    m_animations.removeOne(animation);
+
+}
+
+/**
+ * @brief Advances every registered animation
+ * @param dt represents the elapsed simulation time in seconds
+ */
+
+void AnimationClock::advance(qreal dt)
+{
+
+    for (int i = 0; i < m_animations.size(); ++i) {
+        m_animations[i]->advance(dt);
     }
 
-    connect(&m_timer, &QTimer::timeout, this, &SpriteAnimation::updateFrame);
-    m_timer.start(150);
 }
@@ -1,12 +1,22 @@
+/**
+ * @file spriteanimation.h
+ * @brief Frame animations shared between items and advanced by one central clock
+ * @author Kiet Tran, Steph Oh
+ */
+
 #ifndef SPRITEANIMATION_H
 #define SPRITEANIMATION_H
 
+#include <QImage>
 #include <QObject>
-#include <QGraphicsPixmapItem>
-#include <QTimer>
-#include <QMap>
+#include <QSharedPointer>
+#include <QSize>
 #include <QVector>
-#include <QPixmap>
+#include <functional>
+#include "textureatlas.h"
+
+class AtlasSpriteItem;
+class AnimationClock;
 
 enum class AnimationState {
     IdleDown, WalkDown,
@@ -15,22 +25,115 @@ enum class AnimationState {
     IdleUp, WalkUp
 };
 
-class SpriteAnimation : public QObject, public QGraphicsPixmapItem
+/**
+ * @brief One looping cycle of atlas frames
+ */
+
+struct AnimationClip {
+    QVector<AtlasRegion> frames;
+    qreal frameDuration = 0.15;  // Seconds each frame is shown
+
+    bool isEmpty() const { return frames.isEmpty(); }
+};
+
+/**
+ * @brief Immutable set of clips, one per AnimationState
+ *
+ * Frames are sliced from the sprite sheets once and packed into the texture atlas, every
+ * animated item then holds a shared pointer to the same set and only keeps its own playback
+ * position
+ */
+
+class AnimationSet
 {
-    Q_OBJECT
 public:
-    explicit SpriteAnimation(QObject *parent = nullptr);
+    using ReadyCallback = std::function<void(QSharedPointer<const AnimationSet>)>;
+
+    // Returns the clip of a state, empty if the sheets had no frames for it
+    const AnimationClip &clip(AnimationState state) const;
+
+    // Slices the idle and walk sheets (one row per direction) into clips drawn at drawSize
+    static QSharedPointer<const AnimationSet> fromSheets(const QString &name, const QImage &idleSheet,
+                                                         const QImage &walkSheet, const QSize &drawSize);
 
+    // Decodes the player sheets once and calls done on the GUI thread with the shared set
+    static void loadPlayer(QObject *context, ReadyCallback done);
+
+private:
+    AnimationSet() = default;
+
+    // Slices one row of a sheet into a clip, dropping the blank frames at the end of the row
+    static AnimationClip sliceRow(const QString &name, const QImage &sheet, int row,
+                                  const QSize &drawSize, qreal frameDuration);
+
+    AnimationClip m_clips[8];
+};
+
+/**
+ * @brief Playback position of an AnimationSet shown on one AtlasSpriteItem
+ *
+ * Has no timer of its own: the AnimationClock it is added to advances it with the game's
+ * simulation time, and the target item is only touched when the frame actually changes
+ */
+
+class SpriteAnimation
+{
+public:
+    explicit SpriteAnimation(AtlasSpriteItem *target = nullptr);
+    ~SpriteAnimation();
+
+    // Shared frames to play, an empty set leaves the target untouched
+    void setAnimationSet(QSharedPointer<const AnimationSet> set);
+    bool hasFrames() const;
+
+    // Switches to a clip, restarting it only if the state changed
     void setAnimation(AnimationState state);
+    AnimationState animation() const { return m_currentState; }
 
-private slots:
-    void updateFrame();
+    // Moves the playback position forward by dt seconds
+    void advance(qreal dt);
 
 private:
-    QMap<AnimationState, QVector<QPixmap>> m_animations;
+    friend class AnimationClock;
+
+    // Shows the current frame on the target
+    void updateFrame();
+
+    AtlasSpriteItem *m_target;
+    AnimationClock *m_clock;
+    QSharedPointer<const AnimationSet> m_set;
     AnimationState m_currentState;
     int m_currentFrame;
-    QTimer m_timer;
+    qreal m_elapsed;
+};
+
+/**
+ * @brief Advances every registered animation from a single time source
+ *
+ * Driven by the game loop's tick, so all animations step in lockstep with the simulation
+ * instead of each owning a QTimer
+ */
+
+class AnimationClock
+{
+public:
+    AnimationClock() = default;
+    ~AnimationClock();
+
+    // Registers an animation, it unregisters itself when destroyed
+    void add(SpriteAnimation *animation);
+    void remove(SpriteAnimation *animation);
+
+    // Advances every registered animation by dt seconds
+    void advance(qreal dt);
+
+    int animationCount() const { return m_animations.size(); }
+
+private:
+    AnimationClock(const AnimationClock &) = delete;
+    AnimationClock &operator=(const AnimationClock &) = delete;
+
+    QVector<SpriteAnimation *> m_animations;
 };
 
-#endif
+#endif // SPRITEANIMATION_H
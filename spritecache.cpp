@@ -0,0 +1,130 @@
+/**
+ * @file spritecache.cpp
+ * @brief Implementation of the SpriteCache class
+ * @author Kiet Tran, Steph Oh
+ */
+
+#include "spritecache.h"
+#include "assetloader.h"
+#include "logger.h"
+#include <QCoreApplication>
+#include <QPixmap>
+#include <memory>
+
+/**
+ * @brief Returns the application wide sprite cache
+ */
+
+SpriteCache &SpriteCache::instance()
+{
+
+    static SpriteCache cache;
+    return cache;
+
+}
+
+/**
+ * @brief Decodes and scales all four directions for a target size
+ * @param size represents the size the sprites are drawn at
+ * @param context represents the object whose lifetime guards the done callback
+ * @param done represents the function called once every direction is cached
+ *
+ * Called once at startup so neither the first paint nor the first key press pays for decoding
+ */
+
+void SpriteCache::preload(const QSize &size, QObject *context, std::function<void()> done)
+{
+
+    const SpriteDirection directions[] = {
+        SpriteDirection::Up, SpriteDirection::Down, SpriteDirection::Left, SpriteDirection::Right
+    };
+
+    std::shared_ptr<int> remaining = std::make_shared<int>(4);
+
+    for (SpriteDirection direction : directions) {
+        const QString name = key(direction, size);
+
+        AssetLoader::instance().loadPixmap(resourcePath(direction), context ? context : qApp,
+            [name, remaining, done](const QPixmap &pixmap) {
+                TextureAtlas::instance().insert(name, pixmap);
+                if (--*remaining == 0 && done) {
+                    done();
+                }
+            }, AssetLoader::High, size);
+    }
+
+}
+
+/**
+ * @brief Returns true if the sprite for a direction and size is already cached
+ */
+
+bool SpriteCache::contains(SpriteDirection direction, const QSize &size) const
+{
+
+    return TextureAtlas::instance().contains(key(direction, size));
+
+}
+
+/**
+ * @brief Returns the sprite for a direction scaled to a size
+ * @param direction represents the facing direction
+ * @param size represents the target size (aspect ratio is kept)
+ * @return Returns the atlas region of the sprite
+ *
+ * The source image is decoded and scaled on the calling thread only if the sprite is requested
+ * before preload() delivered it
+ */
+
+AtlasRegion SpriteCache::sprite(SpriteDirection direction, const QSize &size)
+{
+
+    TextureAtlas &atlas = TextureAtlas::instance();
+    const QString name = key(direction, size);
+
+    if (atlas.contains(name)) {
+        return atlas.region(name);
+    }
+
+    QPixmap decoded(resourcePath(direction));
+    if (decoded.isNull()) {
+        LOG_WARNING("sprite", "Failed to load sprite %1", resourcePath(direction));
+        return AtlasRegion();
+    }
+
+    return atlas.insert(name, decoded.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+
+}
+
+/**
+ * @brief Returns the resource path of the source image for a direction
+ */
+
+QString SpriteCache::resourcePath(SpriteDirection direction)
+{
+
+    switch (direction) {
+    case SpriteDirection::Up:
+        return QStringLiteral(":/images/sprite_forward.png");
+    case SpriteDirection::Down:
+        return QStringLiteral(":/images/sprite_back.png");
+    case SpriteDirection::Left:
+        return QStringLiteral(":/images/sprite_left.png");
+    case SpriteDirection::Right:
+        return QStringLiteral(":/images/sprite_right.png");
+    }
+
+    return QString();
+
+}
+
+/**
+ * @brief Returns the atlas name of a direction at a size
+ */
+
+QString SpriteCache::key(SpriteDirection direction, const QSize &size)
+{
+
+    return QString("sprite/%1@%2x%3").arg(static_cast<int>(direction)).arg(size.width()).arg(size.height());
+
+}
@@ -0,0 +1,63 @@
+/**
+ * @file spritecache.h
+ * @brief Shared cache of decoded and pre-scaled directional player sprites
+ * @author Kiet Tran, Steph Oh
+ */
+
+#ifndef SPRITECACHE_H
+#define SPRITECACHE_H
+
+#include <QSize>
+#include <QString>
+#include <functional>
+#include "textureatlas.h"
+
+class QObject;
+
+/**
+ * @brief Facing direction of a directional sprite
+ */
+
+enum class SpriteDirection {
+    Up,
+    Down,
+    Left,
+    Right
+};
+
+/**
+ * @brief Decodes and scales each directional sprite once and packs it into the texture atlas
+ *
+ * Entries are keyed by direction and target size, so callers switching direction on every
+ * key press only swap an atlas region and never touch the resource system again
+ */
+
+class SpriteCache
+{
+public:
+    // Returns the application wide cache
+    static SpriteCache &instance();
+
+    // Decodes and scales all directions for the given size on the asset loader's threads,
+    // calling done on the GUI thread once every direction is cached
+    void preload(const QSize &size, QObject *context = nullptr, std::function<void()> done = std::function<void()>());
+
+    // Returns true if the sprite for a direction and size is already cached
+    bool contains(SpriteDirection direction, const QSize &size) const;
+
+    // Returns the atlas region of a direction at the given size, loading it on first use
+    AtlasRegion sprite(SpriteDirection direction, const QSize &size);
+
+private:
+    SpriteCache() = default;
+    SpriteCache(const SpriteCache &) = delete;
+    SpriteCache &operator=(const SpriteCache &) = delete;
+
+    // Returns the resource path of the source image for a direction
+    static QString resourcePath(SpriteDirection direction);
+
+    // Atlas name combining direction and target size
+    static QString key(SpriteDirection direction, const QSize &size);
+};
+
+#endif // SPRITECACHE_H
@@ -0,0 +1,104 @@
+/**
+ * @file spscringbuffer.h
+ * @brief Fixed size lock-free queue for one producer and one consumer thread
+ * @author Kiet Tran
+ */
+
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * @brief Wait-free ring buffer between exactly one producer and one consumer thread
+ *
+ * The producer only writes the head index and the consumer only writes the tail index, so
+ * neither side ever locks or spins. Indices grow without wrapping and are masked into the
+ * storage, which requires a power of two capacity. A push onto a full buffer fails instead of
+ * overwriting, the producer decides what to do with the value
+ */
+
+template <typename T, int Capacity>
+class SpscRingBuffer
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscRingBuffer() : m_head(0), m_tail(0) {}
+
+    // Producer side: appends a value, false if the buffer is full
+    bool push(const T &value)
+    {
+        const quint64 head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == quint64(Capacity)) {
+            return false;
+        }
+
+        m_items[head & (Capacity - 1)] = value;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: removes the oldest value, false if the buffer is empty
+    bool pop(T &value)
+    {
+        const quint64 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        value = m_items[tail & (Capacity - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side: appends up to count values, returns how many fit
+    int write(const T *values, int count)
+    {
+        const quint64 head = m_head.load(std::memory_order_relaxed);
+        const int free = Capacity - int(head - m_tail.load(std::memory_order_acquire));
+        const int written = count < free ? count : free;
+
+        for (int i = 0; i < written; ++i) {
+            m_items[(head + i) & (Capacity - 1)] = values[i];
+        }
+        m_head.store(head + written, std::memory_order_release);
+        return written;
+    }
+
+    // Consumer side: removes up to count of the oldest values, returns how many were read
+    int read(T *values, int count)
+    {
+        const quint64 tail = m_tail.load(std::memory_order_relaxed);
+        const int available = int(m_head.load(std::memory_order_acquire) - tail);
+        const int taken = count < available ? count : available;
+
+        for (int i = 0; i < taken; ++i) {
+            values[i] = m_items[(tail + i) & (Capacity - 1)];
+        }
+        m_tail.store(tail + taken, std::memory_order_release);
+        return taken;
+    }
+
+    // Number of queued values, exact only when called from the producer or consumer
+    int size() const
+    {
+        return int(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+    }
+
+    bool isEmpty() const { return size() == 0; }
+
+    static constexpr int capacity() { return Capacity; }
+
+private:
+    SpscRingBuffer(const SpscRingBuffer &) = delete;
+    SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+    // Kept on separate cache lines so the two threads do not invalidate each other's index
+    alignas(64) std::atomic<quint64> m_head;
+    alignas(64) std::atomic<quint64> m_tail;
+    alignas(64) T m_items[Capacity];
+};
+
+#endif // SPSCRINGBUFFER_H
@@ -0,0 +1,298 @@
+/**
+ * @file startupbenchmark.cpp
+ * @brief Implementation of the StartupBenchmark class
+ * @author Cherie Duong
+ */
+
+#include "startupbenchmark.h"
+#include "assetpack.h"
+#include "mainwindow.h"
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QFile>
+#include <QFileInfo>
+#include <QLabel>
+#include <QProcess>
+#include <QTextStream>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_MACOS)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Line a child process prints its sample on
+const char kSampleTag[] = "startup-sample";
+
+// A child that has not painted the menu by then is reported as failed
+const int kRunTimeoutMs = 30000;
+
+// Resident memory of this process in bytes, 0 where it cannot be read
+qint64 residentBytes()
+{
+
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return qint64(counters.WorkingSetSize);
+    }
+    return 0;
+#elif defined(Q_OS_MACOS)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS) {
+        return qint64(info.resident_size);
+    }
+    return 0;
+#else
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) return 0;
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields[1].toLongLong() * sysconf(_SC_PAGESIZE) : 0;
+#endif
+
+}
+
+// Highest resident memory of this process so far in bytes
+qint64 peakResidentBytes()
+{
+
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return qint64(counters.PeakWorkingSetSize);
+    }
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(Q_OS_MACOS)
+    return qint64(usage.ru_maxrss);
+#else
+    return qint64(usage.ru_maxrss) * 1024;
+#endif
+#endif
+
+}
+
+// Uncompressed size of every resource, embedded or in the pack
+qint64 resourceBytes()
+{
+
+    qint64 total = 0;
+    QDirIterator it(":/", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        total += QFileInfo(it.next()).size();
+    }
+
+    return total;
+
+}
+
+// Median of the samples, which are sorted in place
+qint64 median(QVector<qint64> &values)
+{
+
+    if (values.isEmpty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+
+}
+
+QString megabytes(qint64 bytes)
+{
+
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+
+}
+
+QString milliseconds(qint64 ns)
+{
+
+    return QString::number(ns / 1e6, 'f', 1) + " ms";
+
+}
+
+/**
+ * @brief Watches the paints of the main window and stops the run once the menu art is drawn
+ */
+
+class PaintProbe : public QObject
+{
+public:
+    PaintProbe(QWidget *window, const QElapsedTimer &launch)
+        : m_window(window), m_launch(launch), m_firstPaintNs(-1), m_menuNs(-1), m_resident(0), m_peak(0)
+    {
+    }
+
+    bool isDone() const { return m_menuNs >= 0; }
+    qint64 firstPaintNs() const { return m_firstPaintNs; }
+    qint64 menuNs() const { return m_menuNs; }
+    qint64 resident() const { return m_resident; }
+    qint64 peak() const { return m_peak; }
+
+protected:
+    bool eventFilter(QObject *object, QEvent *event) override
+    {
+
+        if (event->type() != QEvent::Paint || isDone()) return false;
+
+        QWidget *widget = qobject_cast<QWidget *>(object);
+        if (!widget || widget->window() != m_window) return false;
+
+        if (m_firstPaintNs < 0) {
+            m_firstPaintNs = m_launch.nsecsElapsed();
+        }
+
+        // The menu background is the label the decoded art is set on
+        QLabel *label = qobject_cast<QLabel *>(widget);
+        if (label && !label->pixmap().isNull()) {
+            m_menuNs = m_launch.nsecsElapsed();
+            m_resident = residentBytes();
+            m_peak = peakResidentBytes();
+            QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+        }
+
+        return false;
+
+    }
+
+private:
+    QWidget *m_window;
+    const QElapsedTimer &m_launch;
+    qint64 m_firstPaintNs;
+    qint64 m_menuNs;
+    qint64 m_resident;
+    qint64 m_peak;
+};
+
+}
+
+/**
+ * @brief Handles the --bench-startup command line
+ * @param arguments represents the application arguments
+ * @param launch represents the timer started at the top of main()
+ * @return Returns 0 on success and 1 if a run failed
+ *
+ * Launches the executable --runs times with --child and collects the sample each run prints.
+ * Run it once on a build with resources.qrc and once on a build with CONFIG+=built_assets
+ */
+
+int StartupBenchmark::runFromCommandLine(const QStringList &arguments, const QElapsedTimer &launch)
+{
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the time to the first main menu paint and the memory it takes");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("bench-startup", "Run the startup benchmark."));
+    parser.addOption(QCommandLineOption("runs", "Fresh processes to launch.", "count", "5"));
+    parser.addOption(QCommandLineOption("child", "Show the menu once and print the sample (internal)."));
+    parser.process(arguments);
+
+    if (parser.isSet("child")) {
+        return runOnce(launch);
+    }
+
+    const int runs = qBound(1, parser.value("runs").toInt(), 100);
+    const QString program = QCoreApplication::applicationFilePath();
+
+    out << "Startup of " << QFileInfo(program).fileName() << ", " << megabytes(QFileInfo(program).size())
+        << " binary, " << megabytes(resourceBytes()) << " of resources";
+    if (AssetPack::isMounted()) {
+        out << " in " << QFileInfo(AssetPack::mountedPath()).fileName() << " ("
+            << megabytes(QFileInfo(AssetPack::mountedPath()).size()) << ")";
+    }
+    out << '\n';
+    out.flush();
+
+    QVector<qint64> firstPaint;
+    QVector<qint64> menu;
+    QVector<qint64> resident;
+    QVector<qint64> peak;
+
+    for (int run = 0; run < runs; ++run) {
+        QProcess child;
+        child.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        child.start(program, QStringList() << "--bench-startup" << "--child");
+
+        if (!child.waitForFinished(kRunTimeoutMs) || child.exitCode() != 0) {
+            child.kill();
+            err << "Run " << run + 1 << " did not paint the menu" << Qt::endl;
+            return 1;
+        }
+
+        // The sample is the last line starting with the tag, the game may log before it
+        QList<QByteArray> fields;
+        for (const QByteArray &line : child.readAllStandardOutput().split('\n')) {
+            if (line.startsWith(kSampleTag)) {
+                fields = line.trimmed().split(' ');
+            }
+        }
+        if (fields.size() != 5) {
+            err << "Run " << run + 1 << " printed no sample" << Qt::endl;
+            return 1;
+        }
+
+        firstPaint << fields[1].toLongLong();
+        menu << fields[2].toLongLong();
+        resident << fields[3].toLongLong();
+        peak << fields[4].toLongLong();
+
+        out << "  run " << run + 1 << ": first paint " << milliseconds(firstPaint.last())
+            << ", menu " << milliseconds(menu.last()) << ", resident " << megabytes(resident.last())
+            << ", peak " << megabytes(peak.last()) << '\n';
+        out.flush();
+    }
+
+    out << "  median: first paint " << milliseconds(median(firstPaint)) << ", menu " << milliseconds(median(menu))
+        << ", resident " << megabytes(median(resident)) << ", peak " << megabytes(median(peak)) << '\n';
+    out.flush();
+
+    return 0;
+
+}
+
+/**
+ * @brief Shows the main menu until its art is painted and prints the sample
+ * @param launch represents the timer started at the top of main()
+ * @return Returns 0 once the menu was painted and 1 on a timeout
+ */
+
+int StartupBenchmark::runOnce(const QElapsedTimer &launch)
+{
+
+    MainWindow window;
+    PaintProbe probe(&window, launch);
+    qApp->installEventFilter(&probe);
+
+    QTimer::singleShot(kRunTimeoutMs, qApp, &QCoreApplication::quit);
+    window.show();
+    QCoreApplication::exec();
+
+    qApp->removeEventFilter(&probe);
+    if (!probe.isDone()) return 1;
+
+    QTextStream out(stdout);
+    out << kSampleTag << ' ' << probe.firstPaintNs() << ' ' << probe.menuNs() << ' '
+        << probe.resident() << ' ' << probe.peak() << Qt::endl;
+
+    return 0;
+
+}
@@ -0,0 +1,215 @@
+/**
+ * @file textureatlas.cpp
+ * @brief Implementation of the TextureAtlas class
+ * @author Kiet Tran, Steph Oh
+ */
+
+#include "textureatlas.h"
+#include "logger.h"
+#include <QPainter>
+
+namespace {
+
+// Gap left around each image so smooth scaling does not bleed neighbouring pixels
+const int kPadding = 1;
+
+}
+
+/**
+ * @brief Constructs an empty atlas
+ * @param pageSize represents the size of each atlas page
+ */
+
+TextureAtlas::TextureAtlas(const QSize &pageSize) : m_pageSize(pageSize)
+{
+
+}
+
+/**
+ * @brief Returns the atlas shared by the game's sprites and UI pieces
+ */
+
+TextureAtlas &TextureAtlas::instance()
+{
+
+    static TextureAtlas atlas;
+    return atlas;
+
+}
+
+/**
+ * @brief Packs an image under a name
+ * @param name represents the lookup name, for example "sprite/down@75x75"
+ * @param image represents the image to pack
+ * @return Returns the region of the image, or the existing region if the name is already packed
+ */
+
+AtlasRegion TextureAtlas::insert(const QString &name, const QImage &image)
+{
+
+    return insert(name, QPixmap::fromImage(image));
+
+}
+
+/**
+ * @brief Packs a pixmap under a name
+ * @param name represents the lookup name
+ * @param pixmap represents the pixmap to pack
+ * @return Returns the region of the pixmap, or the existing region if the name is already packed
+ */
+
+AtlasRegion TextureAtlas::insert(const QString &name, const QPixmap &pixmap)
+{
+
+    auto existing = m_regions.constFind(name);
+    if (existing != m_regions.constEnd()) {
+        return existing.value();
+    }
+
+    if (pixmap.isNull()) {
+        return AtlasRegion();
+    }
+
+    const AtlasRegion region = allocate(pixmap.size());
+    if (!region.isValid()) {
+        LOG_WARNING("atlas", "Image %1 (%2 x %3) does not fit into an atlas page", name, pixmap.width(), pixmap.height());
+        return region;
+    }
+
+    QPainter painter(&m_pages[region.page].pixmap);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawPixmap(region.rect.topLeft(), pixmap);
+    painter.end();
+
+    m_regions.insert(name, region);
+    return region;
+
+}
+
+/**
+ * @brief Returns the region packed under a name
+ */
+
+AtlasRegion TextureAtlas::region(const QString &name) const
+{
+
+    return m_regions.value(name);
+
+}
+
+/**
+ * @brief Returns true if an image is packed under a name
+ */
+
+bool TextureAtlas::contains(const QString &name) const
+{
+
+    return m_regions.contains(name);
+
+}
+
+/**
+ * @brief Returns an atlas page
+ * @param index represents the page index
+ */
+
+const QPixmap &TextureAtlas::page(int index) const
+{
+
+    return m_pages.at(index).pixmap;
+
+}
+
+/**
+ * @brief Drops every page and region
+ */
+
+void TextureAtlas::clear()
+{
+
+    m_pages.clear();
+    m_regions.clear();
+
+}
+
+/**
+ * @brief Finds room for an image
+ * @param size represents the image size
+ * @return Returns the allocated region, invalid if the image is larger than a page
+ */
+
+AtlasRegion TextureAtlas::allocate(const QSize &size)
+{
+
+    const QSize padded(size.width() + 2 * kPadding, size.height() + 2 * kPadding);
+    if (padded.width() > m_pageSize.width() || padded.height() > m_pageSize.height()) {
+        return AtlasRegion();
+    }
+
+    AtlasRegion region;
+    QRect rect;
+
+    for (int i = 0; i < m_pages.size(); ++i) {
+        if (allocateOnPage(m_pages[i], padded, rect)) {
+            region.page = i;
+            region.rect = QRect(rect.topLeft() + QPoint(kPadding, kPadding), size);
+            return region;
+        }
+    }
+
+    // Opens a new transparent page
+    Page page;
+    page.pixmap = QPixmap(m_pageSize);
+    page.pixmap.fill(Qt::transparent);
+    page.usedHeight = 0;
+    m_pages.append(page);
+
+    allocateOnPage(m_pages.last(), padded, rect);
+    region.page = m_pages.size() - 1;
+    region.rect = QRect(rect.topLeft() + QPoint(kPadding, kPadding), size);
+    return region;
+
+}
+
+/**
+ * @brief Tries to place an image on a page
+ * @param page represents the page to place the image on
+ * @param size represents the padded image size
+ * @param rect receives the placement on success
+ * @return true if the image was placed
+ *
+ * Picks the lowest shelf that is tall enough and wastes the least height, and opens a new
+ * shelf below the used area otherwise
+ */
+
+bool TextureAtlas::allocateOnPage(Page &page, const QSize &size, QRect &rect) const
+{
+
+    Shelf *best = nullptr;
+    for (Shelf &shelf : page.shelves) {
+        if (shelf.height < size.height()) continue;
+        if (m_pageSize.width() - shelf.usedWidth < size.width()) continue;
+        if (!best || shelf.height < best->height) {
+            best = &shelf;
+        }
+    }
+
+    if (!best) {
+        if (m_pageSize.height() - page.usedHeight < size.height()) {
+            return false;
+        }
+
+        Shelf shelf;
+        shelf.y = page.usedHeight;
+        shelf.height = size.height();
+        shelf.usedWidth = 0;
+        page.shelves.append(shelf);
+        page.usedHeight += size.height();
+        best = &page.shelves.last();
+    }
+
+    rect = QRect(QPoint(best->usedWidth, best->y), size);
+    best->usedWidth += size.width();
+    return true;
+
+}
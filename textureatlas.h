@@ -0,0 +1,87 @@
+/**
+ * @file textureatlas.h
+ * @brief Packs small game images into a few large atlas pages
+ * @author Kiet Tran, Steph Oh
+ */
+
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Location of an image inside an atlas
+ */
+
+struct AtlasRegion {
+    int page = -1;  // Index of the atlas page, -1 if the region is empty
+    QRect rect;     // Sub-rectangle of the page in pixels
+
+    bool isValid() const { return page >= 0; }
+};
+
+/**
+ * @brief Packs small images into large pixmap pages with a lookup table of sub-rectangles
+ *
+ * Images are placed with a shelf packer: each page is split into horizontal shelves and an image
+ * goes onto the first shelf with room, or opens a new shelf (or page) when none fits. Images are
+ * painted straight into the page pixmap, so sprites, animation frames and UI pieces share a few
+ * large pixmaps and are drawn as sub-rectangles of them instead of living as separate pixmaps
+ */
+
+class TextureAtlas
+{
+public:
+    explicit TextureAtlas(const QSize &pageSize = QSize(1024, 1024));
+
+    // Returns the atlas shared by the game's sprites and UI pieces
+    static TextureAtlas &instance();
+
+    // Packs an image under a name, replacing nothing if the name already exists
+    AtlasRegion insert(const QString &name, const QImage &image);
+    AtlasRegion insert(const QString &name, const QPixmap &pixmap);
+
+    // Returns the region packed under a name, invalid if the name is unknown
+    AtlasRegion region(const QString &name) const;
+    bool contains(const QString &name) const;
+
+    // Atlas pages
+    int pageCount() const { return m_pages.size(); }
+    const QPixmap &page(int index) const;
+
+    // Drops every page and region
+    void clear();
+
+private:
+    // Horizontal strip of a page holding images up to its height
+    struct Shelf {
+        int y;
+        int height;
+        int usedWidth;
+    };
+
+    // Page pixmap with its shelves
+    struct Page {
+        QPixmap pixmap;
+        QVector<Shelf> shelves;
+        int usedHeight;
+    };
+
+    // Finds room for an image of the given size, adding a page if needed
+    AtlasRegion allocate(const QSize &size);
+
+    // Tries to place an image of the given size on one page
+    bool allocateOnPage(Page &page, const QSize &size, QRect &rect) const;
+
+    QSize m_pageSize;
+    QVector<Page> m_pages;
+    QHash<QString, AtlasRegion> m_regions;
+};
+
+#endif // TEXTUREATLAS_H
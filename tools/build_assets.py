@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+"""
+@file build_assets.py
+@brief Build-time asset pipeline for resources.qrc
+@author Cherie Duong
+
+Reads resources.qrc and writes an optimised copy of every resource it lists into an output
+directory, together with an assets.qrc that gives each file its original alias (so the game
+opens the same ":/images/..." and "qrc:/horror_music/..." paths) and a manifest.json of the
+sizes before and after.
+
+- Images larger than the size they are drawn at are downscaled to fit it, keeping the aspect
+  ratio, and written as optimised PNG (JPEG stays JPEG). Everything else is copied.
+- Audio is transcoded with ffmpeg to Opus at 48 kHz, the mixer's rate, so neither the sound bank
+  nor the music streams resample it; effects are downmixed to mono like the bank stores them,
+  music stays stereo. The decoder probes the content, so the ".mp3" aliases keep working.
+
+Outputs newer than their source are kept, so "make assets" only redoes what changed.
+
+Usage: build_assets.py resources.qrc OUTPUT_DIR [--no-audio]
+Needs Pillow, and ffmpeg on the PATH for the audio (without it audio is copied as is).
+"""
+
+import argparse
+import fnmatch
+import json
+import os
+import shutil
+import subprocess
+import sys
+import xml.etree.ElementTree as ElementTree
+
+from PIL import Image
+
+# Largest size each image is drawn at, by resource path. The player sprites are only ever drawn
+# at 75 x 75 (see SpriteCache), full screen art at the 1440 x 900 scene
+RENDER_SIZES = [
+    ("images/sprite_*.png", (75, 75)),
+    ("images/main_menu.png", (1440, 900)),
+    ("images/room*_bg.png", (1440, 900)),
+    ("jumpscares/*", (1440, 900)),
+]
+
+# Tracks played through AudioSystem::playBackgroundMusic, everything else is an effect
+MUSIC = [
+    "horror_music/background_main.mp3",
+    "horror_music/background_music1.mp3",
+]
+
+IMAGE_EXTENSIONS = (".png", ".jpg", ".jpeg")
+AUDIO_EXTENSIONS = (".mp3", ".wav", ".ogg", ".opus", ".m4a", ".flac")
+
+MIXER_SAMPLE_RATE = 48000
+EFFECT_BITRATE = "64k"
+MUSIC_BITRATE = "128k"
+
+
+def render_size(path):
+    for pattern, size in RENDER_SIZES:
+        if fnmatch.fnmatch(path, pattern):
+            return size
+    return None
+
+
+def is_up_to_date(source, output):
+    return os.path.exists(output) and os.path.getmtime(output) >= os.path.getmtime(source)
+
+
+def read_qrc(qrc_path):
+    """Returns (prefix, alias, source file) for every file of a .qrc"""
+
+    root = ElementTree.parse(qrc_path).getroot()
+    base = os.path.dirname(os.path.abspath(qrc_path))
+    entries = []
+
+    for resource in root.iter("qresource"):
+        prefix = resource.get("prefix", "/")
+        for node in resource.iter("file"):
+            path = node.text.strip()
+            alias = node.get("alias", path)
+            entries.append((prefix, alias, os.path.join(base, path)))
+
+    return entries
+
+
+def build_image(source, output, alias):
+    """Downscales an image to its render size, returns (action, source size, output size)
+
+    The source is kept when it already fits, or when the downscaled file would not be smaller
+    """
+
+    with Image.open(source) as image:
+        source_size = image.size
+        target = render_size(alias)
+
+        if target is None or (image.width <= target[0] and image.height <= target[1]):
+            shutil.copyfile(source, output)
+        elif not is_up_to_date(source, output):
+            scale = min(target[0] / image.width, target[1] / image.height)
+            size = (max(1, round(image.width * scale)), max(1, round(image.height * scale)))
+            scaled = image.resize(size, Image.LANCZOS, reducing_gap=3.0)
+            if output.lower().endswith(".png"):
+                scaled.save(output, optimize=True)
+            else:
+                scaled.convert("RGB").save(output, quality=90, optimize=True)
+            if os.path.getsize(output) >= os.path.getsize(source):
+                shutil.copyfile(source, output)
+
+    with Image.open(output) as image:
+        output_size = image.size
+
+    return ("copied" if output_size == source_size else "downscaled"), source_size, output_size
+
+
+def build_audio(source, output, alias, ffmpeg):
+    """Transcodes a track to Opus at the mixer's rate, returns the action taken"""
+
+    if ffmpeg is None:
+        shutil.copyfile(source, output)
+        return "copied"
+
+    if is_up_to_date(source, output):
+        return "transcoded"
+
+    music = alias in MUSIC
+    command = [
+        ffmpeg, "-v", "error", "-y", "-i", source,
+        "-vn", "-map_metadata", "-1",
+        "-ac", "2" if music else "1",
+        "-ar", str(MIXER_SAMPLE_RATE),
+        "-c:a", "libopus", "-b:a", MUSIC_BITRATE if music else EFFECT_BITRATE,
+        "-f", "ogg", output,
+    ]
+    subprocess.run(command, check=True)
+    return "transcoded"
+
+
+def write_qrc(path, entries):
+    prefixes = {}
+    for prefix, alias, file in entries:
+        prefixes.setdefault(prefix, []).append((alias, file))
+
+    with open(path, "w", encoding="utf-8") as qrc:
+        qrc.write("<!DOCTYPE RCC>\n<RCC version=\"1.0\">\n")
+        for prefix, files in prefixes.items():
+            qrc.write("    <qresource prefix=\"%s\">\n" % prefix)
+            for alias, file in files:
+                qrc.write("        <file alias=\"%s\">%s</file>\n" % (alias, file))
+            qrc.write("    </qresource>\n")
+        qrc.write("</RCC>\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Downscales and transcodes the resources of a .qrc")
+    parser.add_argument("qrc", help="resource file to process, usually resources.qrc")
+    parser.add_argument("output", help="directory for the processed files, assets.qrc and manifest.json")
+    parser.add_argument("--no-audio", action="store_true", help="copy audio instead of transcoding it")
+    arguments = parser.parse_args()
+
+    ffmpeg = None if arguments.no_audio else shutil.which("ffmpeg")
+    if ffmpeg is None and not arguments.no_audio:
+        print("warning: ffmpeg not found, audio is copied without transcoding", file=sys.stderr)
+
+    entries = read_qrc(arguments.qrc)
+    missing = [file for _, _, file in entries if not os.path.isfile(file)]
+    if missing:
+        for file in missing:
+            print("error: %s does not exist" % file, file=sys.stderr)
+        return 1
+
+    os.makedirs(arguments.output, exist_ok=True)
+    built = []
+    manifest = []
+
+    for prefix, alias, source in entries:
+        output = os.path.join(arguments.output, alias)
+        os.makedirs(os.path.dirname(output), exist_ok=True)
+        extension = os.path.splitext(alias)[1].lower()
+        record = {"alias": alias, "prefix": prefix, "sourceBytes": os.path.getsize(source)}
+
+        if extension in IMAGE_EXTENSIONS:
+            action, source_size, output_size = build_image(source, output, alias)
+            record["sourceSize"] = list(source_size)
+            record["outputSize"] = list(output_size)
+        elif extension in AUDIO_EXTENSIONS:
+            action = build_audio(source, output, alias, ffmpeg)
+        else:
+            shutil.copyfile(source, output)
+            action = "copied"
+
+        record["action"] = action
+        record["outputBytes"] = os.path.getsize(output)
+        manifest.append(record)
+        built.append((prefix, alias, os.path.relpath(output, arguments.output)))
+
+    write_qrc(os.path.join(arguments.output, "assets.qrc"), built)
+
+    source_bytes = sum(record["sourceBytes"] for record in manifest)
+    output_bytes = sum(record["outputBytes"] for record in manifest)
+    with open(os.path.join(arguments.output, "manifest.json"), "w", encoding="utf-8") as file:
+        json.dump({
+            "assets": manifest,
+            "sourceBytes": source_bytes,
+            "outputBytes": output_bytes,
+        }, file, indent=2)
+
+    for record in manifest:
+        print("%-11s %10d -> %10d  %s" % (record["action"], record["sourceBytes"], record["outputBytes"], record["alias"]))
+    print("%-11s %10d -> %10d  (%.1f%%)" % ("total", source_bytes, output_bytes,
+                                           100.0 * output_bytes / max(1, source_bytes)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
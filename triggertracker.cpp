@@ -0,0 +1,49 @@
+/**
+ * @file triggertracker.cpp
+ * @brief Implementation of the TriggerTracker class
+ * @author Kiet Tran
+ */
+
+#include "triggertracker.h"
+#include "level.h"
+
+/**
+ * @brief Forgets every zone
+ * @param triggerCount represents the number of triggers of the new room
+ */
+
+void TriggerTracker::reset(int triggerCount)
+{
+
+    m_inside.fill(false, triggerCount);
+    m_fired.fill(false, triggerCount);
+
+}
+
+/**
+ * @brief Returns the triggers a box has just entered
+ * @param level represents the room the triggers belong to
+ * @param box represents the collision box of the player
+ */
+
+QVector<int> TriggerTracker::update(const Level &level, const QRectF &box)
+{
+
+    QVector<int> entered;
+    const int count = qMin(level.triggerCount(), m_inside.size());
+
+    for (int i = 0; i < count; ++i) {
+        const bool inside = level.triggerRect(i).intersects(box);
+        const bool enteredNow = inside && !m_inside[i];
+        m_inside[i] = inside;
+
+        if (!enteredNow) continue;
+        if (m_fired[i] && level.trigger(i).once) continue;
+
+        m_fired[i] = true;
+        entered.append(i);
+    }
+
+    return entered;
+
+}
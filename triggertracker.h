@@ -0,0 +1,36 @@
+/**
+ * @file triggertracker.h
+ * @brief Tracks which trigger zones of a room a box has entered
+ * @author Kiet Tran
+ */
+
+#ifndef TRIGGERTRACKER_H
+#define TRIGGERTRACKER_H
+
+#include <QRectF>
+#include <QVector>
+
+class Level;
+
+/**
+ * @brief Remembers which trigger zones a box is inside and which once-only zones already fired
+ *
+ * Shared by the game window and the headless simulation so both fire triggers on the same tick
+ */
+
+class TriggerTracker
+{
+public:
+    // Forgets every zone, for a room with the given number of triggers
+    void reset(int triggerCount);
+
+    // Returns the triggers the box entered since the previous call, in trigger order.
+    // Once-only triggers are reported a single time per visit of the room
+    QVector<int> update(const Level &level, const QRectF &box);
+
+private:
+    QVector<bool> m_inside;  // Whether the box is inside each trigger zone
+    QVector<bool> m_fired;   // Whether each trigger zone has fired
+};
+
+#endif // TRIGGERTRACKER_H
@@ -0,0 +1,141 @@
+/**
+ * @file voiceactivitydetector.cpp
+ * @brief Implementation of the VoiceActivityDetector class
+ * @author Kiet Tran, Steph Oh
+ */
+
+#include "voiceactivitydetector.h"
+#include "dspkernels.h"
+
+namespace {
+
+// Quiet time that still belongs to the segment, bounds the spotter's decision latency
+const int kHangoverMs = 80;
+
+// Floor assumed before anything was heard
+const qreal kInitialNoiseFloor = 300.0;
+
+// Segments longer than this are taken to be a louder room rather than speech
+const int kMaxSegmentMs = 5000;
+
+// Thresholds never drop below this, digital silence would otherwise trigger on any click
+const qreal kMinThreshold = 150.0;
+
+// Ratio over the noise floor that starts a segment, and the lower one that keeps it going
+const qreal kOnsetRatio = 3.0;
+const qreal kOffsetRatio = 2.0;
+
+// Hops with more crossings than this are hiss rather than voice
+const qreal kMaxOnsetCrossingRate = 0.6;
+
+// Hops after a reset during which the floor follows the level closely
+const int kCalibrationHops = 25;
+
+// Smoothing of the floor: falling, rising while quiet and rising during speech
+const qreal kFallRate = 0.1;
+const qreal kRiseRate = 0.005;
+const qreal kSpeechRiseRate = 0.0005;
+const qreal kCalibrationRate = 0.2;
+
+}
+
+/**
+ * @brief Constructs a detector for hops of a length
+ * @param hopMs represents the length of the hops passed to process()
+ */
+
+VoiceActivityDetector::VoiceActivityDetector(int hopMs)
+    : m_hangoverHops(qMax(1, kHangoverMs / qMax(1, hopMs)))
+    , m_maxSegmentHops(kMaxSegmentMs / qMax(1, hopMs))
+    , m_hopsSeen(0)
+    , m_quietHops(0)
+    , m_inSegment(false)
+    , m_segmentHops(0)
+    , m_segmentMinimum(0.0)
+    , m_noiseFloor(kInitialNoiseFloor)
+{
+
+}
+
+/**
+ * @brief Forgets the noise floor and any open segment
+ */
+
+void VoiceActivityDetector::reset()
+{
+
+    m_hopsSeen = 0;
+    m_quietHops = 0;
+    m_inSegment = false;
+    m_noiseFloor = kInitialNoiseFloor;
+
+}
+
+/**
+ * @brief Classifies one hop
+ * @param samples represents the hop
+ * @param count represents the number of samples
+ * @param level represents the RMS of the hop
+ */
+
+VoiceActivity VoiceActivityDetector::process(const qint16 *samples, int count, qreal level)
+{
+
+    // Learns the room for the first half second, whatever is heard
+    if (m_hopsSeen < kCalibrationHops) {
+        ++m_hopsSeen;
+        m_noiseFloor += (level - m_noiseFloor) * kCalibrationRate;
+        return VoiceActivity::Silence;
+    }
+
+    if (!m_inSegment) {
+        const bool onset = level > threshold() && Dsp::zeroCrossingRate(samples, count) < kMaxOnsetCrossingRate;
+        if (!onset) {
+            m_noiseFloor += (level - m_noiseFloor) * (level < m_noiseFloor ? kFallRate : kRiseRate);
+            return VoiceActivity::Silence;
+        }
+
+        m_inSegment = true;
+        m_quietHops = 0;
+        m_segmentHops = 0;
+        m_segmentMinimum = level;
+        return VoiceActivity::Speech;
+    }
+
+    // Speech pauses now and then, a level that never drops is the room's new noise floor
+    m_segmentMinimum = qMin(m_segmentMinimum, level);
+    if (++m_segmentHops >= m_maxSegmentHops) {
+        m_noiseFloor = m_segmentMinimum;
+        m_inSegment = false;
+        return VoiceActivity::End;
+    }
+
+    // Keeps adapting during speech so a lasting change of the room cannot hold a segment open
+    if (level > m_noiseFloor) {
+        m_noiseFloor += (level - m_noiseFloor) * kSpeechRiseRate;
+    }
+
+    if (level > qMax(kMinThreshold, m_noiseFloor * kOffsetRatio)) {
+        m_quietHops = 0;
+        return VoiceActivity::Speech;
+    }
+
+    if (++m_quietHops <= m_hangoverHops) {
+        return VoiceActivity::Hangover;
+    }
+
+    m_inSegment = false;
+    return VoiceActivity::End;
+
+}
+
+/**
+ * @brief Returns the RMS a hop needs to start a segment
+ */
+
+qreal VoiceActivityDetector::threshold() const
+{
+
+    return qMax(kMinThreshold, m_noiseFloor * kOnsetRatio);
+
+}
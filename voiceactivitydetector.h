@@ -0,0 +1,65 @@
+/**
+ * @file voiceactivitydetector.h
+ * @brief Energy and zero crossing voice activity detection with an adaptive noise floor
+ * @author Kiet Tran, Steph Oh
+ */
+
+#ifndef VOICEACTIVITYDETECTOR_H
+#define VOICEACTIVITYDETECTOR_H
+
+#include <QtGlobal>
+
+/**
+ * @brief Classification of one hop
+ */
+
+enum class VoiceActivity {
+    Silence,    // No speech, downstream processing can sleep
+    Speech,     // Above the speech threshold
+    Hangover,   // Quiet, but within the hangover after speech, still part of the segment
+    End         // First quiet hop after the hangover, the segment is over
+};
+
+/**
+ * @brief Decides hop by hop whether the microphone hears speech
+ *
+ * Tracks the ambient noise floor (falling quickly, rising slowly) and calls a hop speech once its
+ * RMS is a fixed ratio above the floor, so a fan or a noisy room raises the threshold instead of
+ * keeping the detector triggered, and a segment that never pauses for five seconds resets the
+ * floor to its quietest hop. Hiss with a very high zero crossing rate never starts a segment, and
+ * a short hangover keeps pauses between words inside one segment
+ */
+
+class VoiceActivityDetector
+{
+public:
+    // Hop length in milliseconds, sets how many hops the hangover lasts
+    explicit VoiceActivityDetector(int hopMs = 20);
+
+    // Starts over, the noise floor is learnt again quickly
+    void reset();
+
+    // Classifies one hop from its samples and RMS
+    VoiceActivity process(const qint16 *samples, int count, qreal level);
+
+    // True between the first Speech hop and the End hop of a segment
+    bool inSegment() const { return m_inSegment; }
+
+    // Estimated RMS of the background noise
+    qreal noiseFloor() const { return m_noiseFloor; }
+
+    // RMS a hop needs to start a segment
+    qreal threshold() const;
+
+private:
+    int m_hangoverHops;
+    int m_maxSegmentHops;
+    int m_hopsSeen;
+    int m_quietHops;
+    bool m_inSegment;
+    int m_segmentHops;
+    qreal m_segmentMinimum;     // Quietest hop of the open segment
+    qreal m_noiseFloor;
+};
+
+#endif // VOICEACTIVITYDETECTOR_H
@@ -1,6 +1,6 @@
 #include "voicechallenge.h"
 #include <QGraphicsPixmapItem>
-#include <QDebug>
+#include "logger.h"
 #include <QDir>
 #include <QRandomGenerator>
 #include <QBrush>
@@ -9,52 +9,48 @@
 #include <QFont>
 #include <QApplication>
 #include <QGraphicsProxyWidget>
+#include "assetloader.h"
+#include "challengescheduler.h"
+#include "profiler.h"
 
-VoiceChallenge::VoiceChallenge(QGraphicsScene *scene, Player *player, QObject *parent)
+VoiceChallenge::VoiceChallenge(QGraphicsScene *scene, Player *player, ChallengeScheduler *scheduler, QObject *parent)
     : QObject(parent),
     m_scene(scene),
     m_player(player),
-    m_jumpscareFolder(":/jumpscares"),
-    m_challengeInterval(30000),
-    m_challengeTime(10000),
+    m_scheduler(scheduler),
     m_inputField(nullptr),
     m_inputFieldProxy(nullptr),
     m_submitButton(nullptr),
     m_buttonProxy(nullptr),
-    m_challengeActive(false)
+    m_voiceInputEnabled(false),
+    m_jumpscareFolder(":/jumpscares"),
+    m_jumpscareCache(3)
 {
-    // Initialize timers
-    m_challengeIntervalTimer = new QTimer(this);
-    m_challengeTimer = new QTimer(this);
-    m_countdownTimer = new QTimer(this);
+    // Timers only hide the jumpscare and checkmark, challenge timing runs on the game loop
     m_jumpscareTimer = new QTimer(this);
     m_successCheckTimer = new QTimer(this);
+    m_jumpscareTimer->setSingleShot(true);
+    m_successCheckTimer->setSingleShot(true);
 
     // Connect signals
-    connect(m_challengeIntervalTimer, &QTimer::timeout, this, &VoiceChallenge::showChallenge);
-    connect(m_challengeTimer, &QTimer::timeout, this, &VoiceChallenge::onChallengeTimeout);
-    connect(m_countdownTimer, &QTimer::timeout, this, &VoiceChallenge::updateCountdown);
     connect(m_jumpscareTimer, &QTimer::timeout, this, &VoiceChallenge::hideJumpscare);
     connect(m_successCheckTimer, &QTimer::timeout, this, &VoiceChallenge::hideSuccessCheck);
 
-    // Initialize challenge phrases
-    m_challengePhrases << "she sells seashells by the seashore"
-                       << "peter piper picked a peck of peppers"
-                       << "red lorry yellow lorry red lorry"
-                       << "black bug bit a big black bear"
-                       << "fred fed ted bread and ted fed fred"
-                       << "how can a clam cram in a clean can"
-                       << "six slippery snails slid slowly seaward"
-                       << "truly rural truly rural truly rural"
-                       << "brisk brave brigadiers brandish blades"
-                       << "four fine fresh fish for you";
+    connect(m_scheduler, &ChallengeScheduler::challengeStarted, this, &VoiceChallenge::showChallenge);
+    connect(m_scheduler, &ChallengeScheduler::challengeFailed, this, &VoiceChallenge::onChallengeTimeout);
+    connect(m_scheduler, &ChallengeScheduler::challengePassed, this, &VoiceChallenge::onChallengePassed);
+    connect(m_scheduler, &ChallengeScheduler::countdownChanged, this, &VoiceChallenge::updateCountdown);
 
 
     // Create UI elements
     createChallengeUI();
 
+    // Lists the jumpscares once and decodes the first one ahead of time
+    enumerateJumpscares();
+    prepareNextJumpscare();
+
     // Debug message to show initialization
-    qDebug() << "Text challenge system initialized with jumpscare path:" << m_jumpscareFolder;
+    LOG_DEBUG("challenge", "Text challenge system initialized with jumpscare path %1", m_jumpscareFolder);
 }
 
 VoiceChallenge::~VoiceChallenge()
@@ -100,17 +96,15 @@ VoiceChallenge::~VoiceChallenge()
 
 void VoiceChallenge::start()
 {
-    // Start the interval timer to trigger challenges
-    m_challengeIntervalTimer->start(m_challengeInterval);
-    qDebug() << "Text challenge system started. First challenge in" << m_challengeInterval / 1000 << "seconds";
+    // Starts waiting for the first challenge
+    m_scheduler->start();
+    LOG_INFO("challenge", "Text challenge system started, first challenge in %1 seconds", m_scheduler->interval() / 1000);
 }
 
 void VoiceChallenge::stop()
 {
-    // Stop all timers
-    m_challengeIntervalTimer->stop();
-    m_challengeTimer->stop();
-    m_countdownTimer->stop();
+    // Stop the scheduler and all timers
+    if (m_scheduler) m_scheduler->stop();
     m_jumpscareTimer->stop();
     m_successCheckTimer->stop();
 
@@ -123,42 +117,48 @@ void VoiceChallenge::stop()
     if (m_inputFieldProxy) m_inputFieldProxy->setVisible(false);
     if (m_buttonProxy) m_buttonProxy->setVisible(false);
 
-    m_challengeActive = false;
-    qDebug() << "Text challenge system stopped";
+    LOG_INFO("challenge", "Text challenge system stopped");
 }
 
 void VoiceChallenge::setJumpscareFolder(const QString &path)
 {
+    if (path == m_jumpscareFolder && !m_jumpscareImages.isEmpty()) {
+        return;
+    }
+
     m_jumpscareFolder = path;
-    qDebug() << "Jumpscare folder set to:" << path;
+    LOG_DEBUG("challenge", "Jumpscare folder set to %1", path);
+
+    // Re-lists and re-prepares the jumpscares of the new folder
+    m_jumpscareCache.clear();
+    enumerateJumpscares();
+    prepareNextJumpscare();
 }
 
 void VoiceChallenge::setChallengeInterval(int ms)
 {
-    m_challengeInterval = ms;
-    if (m_challengeIntervalTimer->isActive()) {
-        m_challengeIntervalTimer->setInterval(ms);
-    }
-    qDebug() << "Challenge interval set to:" << ms / 1000 << "seconds";
+    m_scheduler->setInterval(ms);
+    LOG_DEBUG("challenge", "Challenge interval set to %1 seconds", ms / 1000);
 }
 
 void VoiceChallenge::setChallengeTime(int ms)
 {
-    m_challengeTime = ms;
-    qDebug() << "Challenge time set to:" << ms / 1000 << "seconds";
+    m_scheduler->setTimeLimit(ms);
+    LOG_DEBUG("challenge", "Challenge time set to %1 seconds", ms / 1000);
 }
 
-void VoiceChallenge::showChallenge()
+void VoiceChallenge::setVoiceInputEnabled(bool enabled)
 {
-    if (m_challengeActive) {
-        return; // Don't show a new challenge if one is already active
+    m_voiceInputEnabled = enabled;
+    if (m_inputField) {
+        m_inputField->setPlaceholderText(enabled ? "Say or type the phrase..." : "Type the phrase...");
     }
+}
 
-    // Get a random challenge phrase
-    m_currentChallenge = getRandomChallenge();
-
+void VoiceChallenge::showChallenge(const QString &phrase)
+{
     // Set the challenge text
-    m_challengeText->setPlainText(m_currentChallenge);
+    m_challengeText->setPlainText(phrase);
 
     // Make sure overlay is in the right position and size
     QRectF sceneRect = m_scene->sceneRect();
@@ -176,51 +176,51 @@ void VoiceChallenge::showChallenge()
 
     // Show and reset input field
     m_inputField->clear();
-    m_inputField->setPlaceholderText("Type the phrase...");
+    m_inputField->setPlaceholderText(m_voiceInputEnabled ? "Say or type the phrase..." : "Type the phrase...");
     m_inputFieldProxy->setVisible(true);
     m_buttonProxy->setVisible(true);
 
     // Set focus to input field
     m_inputField->setFocus();
 
-    // Start challenge timer
-    m_challengeTimer->start(m_challengeTime);
-    m_countdownTimer->start(1000); // Update countdown every second
-    m_elapsedTimer.start();
-
-    m_challengeActive = true;
-    qDebug() << "Text challenge started: \"" << m_currentChallenge << "\"";
+    LOG_DEBUG("challenge", "Text challenge started: \"%1\"", phrase);
 }
 
 void VoiceChallenge::onChallengeTimeout()
 {
     // Challenge failed - show jumpscare
-    qDebug() << "Challenge timeout! Showing jumpscare...";
+    LOG_INFO("challenge", "Challenge timed out, showing jumpscare");
     showJumpscare();
 
-    // Decrease player health by 20%
+    // Decrease player health by the scheduler's damage (20% of max health)
     if (m_player) {
-        int maxHealth = 100; // Assuming max health is 100, adjust if different
-        int damage = maxHealth * 0.2; // 20% of max health
+        int damage = m_scheduler->damage();
         m_player->decreaseHealth(damage);
-        qDebug() << "Player health decreased by" << damage << "points";
+        LOG_DEBUG("challenge", "Player health decreased by %1 points", damage);
     }
 
-    // Rest of method remains the same
-    m_challengeTimer->stop();
-    m_countdownTimer->stop();
+    // Hide challenge UI, the scheduler already waits for the next challenge
+    hideChallengeUI();
+}
+
+void VoiceChallenge::onChallengePassed()
+{
+    LOG_INFO("challenge", "Text challenge completed successfully");
+
+    // Show success checkmark
+    showSuccessCheck();
 
-    // Hide challenge UI
+    // Hide challenge UI, the scheduler already waits for the next challenge
+    hideChallengeUI();
+}
+
+void VoiceChallenge::hideChallengeUI()
+{
     m_overlay->setVisible(false);
     m_challengeText->setVisible(false);
     m_countdownText->setVisible(false);
     m_inputFieldProxy->setVisible(false);
     m_buttonProxy->setVisible(false);
-
-    m_challengeActive = false;
-
-    // Restart the interval timer for the next challenge
-    m_challengeIntervalTimer->start(m_challengeInterval);
 }
 
 void VoiceChallenge::hideJumpscare()
@@ -310,35 +310,33 @@ void VoiceChallenge::createChallengeUI()
     });
 
     // Create success checkmark
-    m_successCheck = new QGraphicsPixmapItem();
-    // Create a green checkmark (you could replace this with an image)
-    QPixmap checkmark(100, 100);
-    checkmark.fill(Qt::transparent);
-    QPainter painter(&checkmark);
-    painter.setPen(QPen(Qt::green, 10));
-    painter.drawLine(20, 50, 40, 80);
-    painter.drawLine(40, 80, 80, 30);
-    painter.end();
-
-    m_successCheck->setPixmap(checkmark);
+    m_successCheck = new AtlasSpriteItem();
+    if (!TextureAtlas::instance().contains("ui/checkmark")) {
+        // Create a green checkmark (you could replace this with an image)
+        QImage checkmark(100, 100, QImage::Format_ARGB32_Premultiplied);
+        checkmark.fill(Qt::transparent);
+        QPainter painter(&checkmark);
+        painter.setPen(QPen(Qt::green, 10));
+        painter.drawLine(20, 50, 40, 80);
+        painter.drawLine(40, 80, 80, 30);
+        painter.end();
+
+        TextureAtlas::instance().insert("ui/checkmark", checkmark);
+    }
+
+    m_successCheck->setRegion(TextureAtlas::instance().region("ui/checkmark"));
     m_successCheck->setPos(sceneRect.width()/2 - 50, sceneRect.height()/2 - 50);
     m_successCheck->setZValue(12);
     m_successCheck->setVisible(false);
     m_scene->addItem(m_successCheck);
 }
 
-void VoiceChallenge::updateCountdown()
+void VoiceChallenge::updateCountdown(int seconds)
 {
-    if (!m_challengeActive) return;
-
-    // Calculate remaining time
-    int elapsed = m_elapsedTimer.elapsed();
-    int remaining = (m_challengeTime - elapsed) / 1000;
-
-    if (remaining < 0) remaining = 0;
+    if (!m_scheduler->isActive()) return;
 
     // Update the countdown text
-    m_countdownText->setPlainText(QString::number(remaining));
+    m_countdownText->setPlainText(QString::number(seconds));
 
     // Calculate center position for countdown text
     QRectF sceneRect = m_scene->sceneRect();
@@ -349,39 +347,99 @@ void VoiceChallenge::updateCountdown()
 
 void VoiceChallenge::showJumpscare()
 {
-    QString imagePath = getRandomJumpscareImage();
+    QString imagePath = m_nextJumpscare.isEmpty() ? getRandomJumpscareImage() : m_nextJumpscare;
 
-    qDebug() << "Attempting to show jumpscare image:" << imagePath;
+    LOG_DEBUG("challenge", "Showing jumpscare image %1", imagePath);
 
     if (!imagePath.isEmpty()) {
-        QPixmap jumpscare(imagePath);
-
-        if (!jumpscare.isNull()) {
-            // Scale to fit the screen if needed
-            QRectF sceneRect = m_scene->sceneRect();
-            if (jumpscare.width() > sceneRect.width() || jumpscare.height() > sceneRect.height()) {
-                jumpscare = jumpscare.scaled(sceneRect.width(), sceneRect.height(),
-                                             Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        // The prepared jumpscare is normally decoded and scaled already
+        QPixmap *cached = m_jumpscareCache.object(imagePath);
+        if (cached) {
+            displayJumpscare(*cached);
+        } else {
+            // Still decoding, so decode here rather than skipping the scare
+            QPixmap jumpscare(imagePath);
+
+            if (!jumpscare.isNull()) {
+                // Scale to fit the screen if needed
+                QRectF sceneRect = m_scene->sceneRect();
+                if (jumpscare.width() > sceneRect.width() || jumpscare.height() > sceneRect.height()) {
+                    jumpscare = jumpscare.scaled(sceneRect.width(), sceneRect.height(),
+                                                 Qt::KeepAspectRatio, Qt::SmoothTransformation);
+                }
+                displayJumpscare(jumpscare);
+            } else {
+                LOG_WARNING("challenge", "Failed to load jumpscare image %1", imagePath);
+                // Try alternative method to load the image
+                tryAlternativeImageLoad(imagePath);
             }
+        }
+    } else {
+        LOG_WARNING("challenge", "No jumpscare images found");
+    }
 
-            // Center the jumpscare
-            m_jumpscareImage->setPixmap(jumpscare);
-            m_jumpscareImage->setPos((sceneRect.width() - jumpscare.width())/2,
-                                     (sceneRect.height() - jumpscare.height())/2);
-            m_jumpscareImage->setVisible(true);
+    // Gets the following jumpscare ready while this one is on screen
+    prepareNextJumpscare();
+}
 
-            // Set timer to hide jumpscare after 3 seconds
-            m_jumpscareTimer->start(3000);
+void VoiceChallenge::displayJumpscare(const QPixmap &jumpscare)
+{
+    QRectF sceneRect = m_scene->sceneRect();
 
-            qDebug() << "Showing jumpscare:" << imagePath << ", Size:" << jumpscare.size();
-        } else {
-            qWarning() << "Failed to load jumpscare image:" << imagePath;
-            // Try alternative method to load the image
-            tryAlternativeImageLoad(imagePath);
-        }
+    // Center the jumpscare
+    m_jumpscareImage->setPixmap(jumpscare);
+    m_jumpscareImage->setPos((sceneRect.width() - jumpscare.width())/2,
+                             (sceneRect.height() - jumpscare.height())/2);
+    m_jumpscareImage->setVisible(true);
+
+    // Set timer to hide jumpscare after 3 seconds
+    m_jumpscareTimer->start(3000);
+
+    LOG_DEBUG("challenge", "Showing jumpscare of %1 x %2", jumpscare.width(), jumpscare.height());
+}
+
+void VoiceChallenge::enumerateJumpscares()
+{
+    // Works for both resource and file system folders
+    QDir directory(m_jumpscareFolder);
+    const QStringList fileImages = directory.entryList(QStringList() << "*.png" << "*.jpg" << "*.jpeg", QDir::Files);
+
+    m_jumpscareImages.clear();
+    for (const QString& img : fileImages) {
+        m_jumpscareImages << directory.filePath(img);
+    }
+
+    if (m_jumpscareImages.isEmpty()) {
+        LOG_WARNING("challenge", "No images found in jumpscare folder %1", m_jumpscareFolder);
     } else {
-        qWarning() << "No jumpscare images found!";
+        LOG_DEBUG("challenge", "Found %1 jumpscare images in %2", m_jumpscareImages.size(), m_jumpscareFolder);
+    }
+}
+
+void VoiceChallenge::prepareNextJumpscare()
+{
+    // Avoids showing the same scare twice in a row when there is a choice
+    const QString previous = m_nextJumpscare;
+    m_nextJumpscare = getRandomJumpscareImage();
+    if (m_jumpscareImages.size() > 1) {
+        while (m_nextJumpscare == previous) {
+            m_nextJumpscare = getRandomJumpscareImage();
+        }
+    }
+
+    if (m_nextJumpscare.isEmpty() || m_jumpscareCache.contains(m_nextJumpscare) || !m_scene) {
+        return;
     }
+
+    // Decodes and scales down to the scene in the background. Kept out of QPixmapCache, the
+    // bounded jumpscare cache is the only one holding them
+    const QString path = m_nextJumpscare;
+    const QSize sceneSize = m_scene->sceneRect().size().toSize();
+    AssetLoader::instance().loadPixmap(path, this, [this, path](const QPixmap &jumpscare) {
+        if (!jumpscare.isNull()) {
+            m_jumpscareCache.insert(path, new QPixmap(jumpscare));
+        }
+    }, AssetLoader::Low, sceneSize, Qt::KeepAspectRatio, true, false);
 }
 
 void VoiceChallenge::tryAlternativeImageLoad(const QString& path)
@@ -400,10 +458,10 @@ void VoiceChallenge::tryAlternativeImageLoad(const QString& path)
                                  (sceneRect.height() - jumpscare.height())/2);
         m_jumpscareImage->setVisible(true);
         m_jumpscareTimer->start(3000);
-        qDebug() << "Loaded jumpscare using alternative method:" << resourcePath;
+        LOG_DEBUG("challenge", "Loaded jumpscare using alternative method: %1", resourcePath);
     } else {
         // If still not working, try a hardcoded default image
-        qDebug() << "Trying to show default jumpscare image...";
+        LOG_DEBUG("challenge", "Trying to show default jumpscare image");
         QPixmap defaultJumpscare(":/jumpscares/image1.jpg");
         if (!defaultJumpscare.isNull()) {
             QRectF sceneRect = m_scene->sceneRect();
@@ -412,9 +470,9 @@ void VoiceChallenge::tryAlternativeImageLoad(const QString& path)
                                      (sceneRect.height() - defaultJumpscare.height())/2);
             m_jumpscareImage->setVisible(true);
             m_jumpscareTimer->start(3000);
-            qDebug() << "Loaded default jumpscare image";
+            LOG_DEBUG("challenge", "Loaded default jumpscare image");
         } else {
-            qWarning() << "Failed to load ANY jumpscare image!";
+            LOG_ERROR("challenge", "Failed to load any jumpscare image");
         }
     }
 }
@@ -432,86 +490,29 @@ void VoiceChallenge::showSuccessCheck()
     }
 }
 
-QString VoiceChallenge::getRandomChallenge()
-{
-    if (m_challengePhrases.isEmpty()) {
-        return "please type this phrase"; // Default if no phrases available
-    }
-
-    // Pick a random phrase
-    int index = QRandomGenerator::global()->bounded(m_challengePhrases.size());
-    return m_challengePhrases.at(index);
-}
-
 QString VoiceChallenge::getRandomJumpscareImage()
 {
-    // Create a list of images
-    QStringList images;
-
-    // Try resource path first
-    for (int i = 1; i <= 12; i++) {
-        QString path = QString(":/jumpscares/image%1.jpg").arg(i);
-        if (QFile::exists(path)) {
-            images << path;
-        }
-    }
-
-    // If no resource images found, try file system
-    if (images.isEmpty()) {
-        QDir directory(m_jumpscareFolder);
-        QStringList fileImages = directory.entryList(QStringList() << "*.png" << "*.jpg" << "*.jpeg", QDir::Files);
-
-        if (fileImages.isEmpty()) {
-            qWarning() << "No images found in jumpscare folder:" << m_jumpscareFolder;
-            return QString();
-        }
-
-        // Convert to full paths
-        for (const QString& img : fileImages) {
-            images << directory.absoluteFilePath(img);
-        }
-    }
-
-    if (images.isEmpty()) {
+    if (m_jumpscareImages.isEmpty()) {
         return QString();
     }
 
     // Use QRandomGenerator to select a random image
-    int index = QRandomGenerator::global()->bounded(images.size());
-    return images.at(index);
+    int index = QRandomGenerator::global()->bounded(m_jumpscareImages.size());
+    return m_jumpscareImages.at(index);
 }
 
 void VoiceChallenge::checkTextInput(const QString& input)
 {
-    if (!m_challengeActive)
-        return;
-
-    qDebug() << "Checking input: \"" << input << "\" against challenge: \"" << m_currentChallenge << "\"";
+    ProfileScope scope(ProfileSection::Challenges);
 
-    // Compare input with challenge (case insensitive)
-    if (input.toLower().trimmed() == m_currentChallenge.toLower().trimmed()) {
-        // Input matches - success!
-        qDebug() << "Text challenge completed successfully!";
-
-        // Show success checkmark
-        showSuccessCheck();
-
-        // Stop timers
-        m_challengeTimer->stop();
-        m_countdownTimer->stop();
-
-        // Hide challenge UI
-        m_overlay->setVisible(false);
-        m_challengeText->setVisible(false);
-        m_countdownText->setVisible(false);
-        m_inputFieldProxy->setVisible(false);
-        m_buttonProxy->setVisible(false);
+    if (!m_scheduler->isActive())
+        return;
 
-        m_challengeActive = false;
+    // Logs the length only, the typed text is the player's and stays out of the log
+    LOG_TRACE("challenge", "Checking %1 typed characters against the challenge", input.size());
 
-        // Restart the interval timer for the next challenge
-        m_challengeIntervalTimer->start(m_challengeInterval);
-    } else {
+    // Compare input with challenge (case insensitive), a match is handled by onChallengePassed()
+    if (!m_scheduler->submit(input)) {
         // Input doesn't match - provide feedback
         m_inputField->clear();
         m_inputField->setPlaceholderText("Incorrect - try again!");
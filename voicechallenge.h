@@ -13,21 +13,25 @@
 #include <QGraphicsTextItem>
 #include <QGraphicsScene>
 #include <QStringList>
-#include <QElapsedTimer>
 #include <QPainter>
 #include <QFileInfo>
 #include <QLineEdit>
 #include <QPushButton>
 #include <QGraphicsProxyWidget>
+#include <QCache>
+#include <QPixmap>
+#include <QPointer>
 #include "player.h"
+#include "atlasspriteitem.h"
 
 class QGraphicsPixmapItem;
+class ChallengeScheduler;
 
 /**
  * @brief Manages voice recognition challenges and jumpscare effects
  *
- * Handles challenge timing, UI display, input validation,
- * and jumpscare consequences for failed challenges
+ * Shows the challenges of a ChallengeScheduler, which decides their timing and checks the
+ * input, and plays the jumpscare consequences for failed challenges
  */
 
 class VoiceChallenge : public QObject
@@ -35,7 +39,7 @@ class VoiceChallenge : public QObject
     Q_OBJECT
 
 public:
-    explicit VoiceChallenge(QGraphicsScene *scene, Player *player, QObject *parent = nullptr);
+    explicit VoiceChallenge(QGraphicsScene *scene, Player *player, ChallengeScheduler *scheduler, QObject *parent = nullptr);
     ~VoiceChallenge();
 
     // Start the challenge system (will trigger first challenge after the interval)
@@ -53,13 +57,22 @@ public:
     // Set the time allowed for a challenge (in milliseconds)
     void setChallengeTime(int ms);
 
+    // Tells the player a phrase can be said as well as typed
+    void setVoiceInputEnabled(bool enabled);
+
 private slots:
     // Show a new challenge
-    void showChallenge();
+    void showChallenge(const QString &phrase);
 
     // Handle challenge timeout
     void onChallengeTimeout();
 
+    // Handle a passed challenge
+    void onChallengePassed();
+
+    // Update the countdown timer display
+    void updateCountdown(int seconds);
+
     // Hide the jumpscare image
     void hideJumpscare();
 
@@ -70,8 +83,8 @@ private:
     // Create the challenge UI elements
     void createChallengeUI();
 
-    // Update the countdown timer display
-    void updateCountdown();
+    // Hide the challenge overlay, text and input
+    void hideChallengeUI();
 
     // Show a jumpscare image
     void showJumpscare();
@@ -82,12 +95,18 @@ private:
     // Show success checkmark
     void showSuccessCheck();
 
-    // Get a random challenge word/phrase
-    QString getRandomChallenge();
-
     // Get a random jumpscare image path
     QString getRandomJumpscareImage();
 
+    // Lists the jumpscare images of the jumpscare folder once
+    void enumerateJumpscares();
+
+    // Picks the next jumpscare and decodes it in the background
+    void prepareNextJumpscare();
+
+    // Displays a decoded jumpscare centered in the scene
+    void displayJumpscare(const QPixmap &jumpscare);
+
     // Check the user's text input
     void checkTextInput(const QString& input);
 
@@ -97,14 +116,8 @@ private:
     // Player reference for health management
     Player *m_player;
 
-    // Timer between challenges
-    QTimer *m_challengeIntervalTimer;
-
-    // Timer for challenge duration
-    QTimer *m_challengeTimer;
-
-    // Timer for countdown display
-    QTimer *m_countdownTimer;
+    // Timing and checking of the challenges, advanced by the game loop
+    QPointer<ChallengeScheduler> m_scheduler;
 
     // Timer for hiding jumpscares
     QTimer *m_jumpscareTimer;
@@ -112,9 +125,6 @@ private:
     // Timer for hiding success checkmark
     QTimer *m_successCheckTimer;
 
-    // Elapsed timer for tracking challenge time
-    QElapsedTimer m_elapsedTimer;
-
     // Background overlay
     QGraphicsRectItem *m_overlay;
 
@@ -127,8 +137,8 @@ private:
     // Jumpscare image
     QGraphicsPixmapItem *m_jumpscareImage;
 
-    // Success checkmark
-    QGraphicsPixmapItem *m_successCheck;
+    // Success checkmark, drawn from the texture atlas
+    AtlasSpriteItem *m_successCheck;
 
     // Text input field
     QLineEdit *m_inputField;
@@ -138,23 +148,20 @@ private:
     QPushButton *m_submitButton;
     QGraphicsProxyWidget *m_buttonProxy;
 
-    // List of challenge phrases
-    QStringList m_challengePhrases;
-
-    // Current challenge text
-    QString m_currentChallenge;
+    // Whether a keyword spotter is listening for the phrases
+    bool m_voiceInputEnabled;
 
     // Path to jumpscare images folder
     QString m_jumpscareFolder;
 
-    // Challenge interval (milliseconds)
-    int m_challengeInterval;
+    // Jumpscare images found in the folder
+    QStringList m_jumpscareImages;
 
-    // Challenge time allowed (milliseconds)
-    int m_challengeTime;
+    // Decoded jumpscares pre-scaled to the scene, least recently used ones are dropped first
+    QCache<QString, QPixmap> m_jumpscareCache;
 
-    // Whether a challenge is active
-    bool m_challengeActive;
+    // Jumpscare shown on the next failed challenge
+    QString m_nextJumpscare;
 
 };
 